@@ -0,0 +1,121 @@
+#include "AssetLoader.h"
+#include "Logger.h"
+#include "Profiler.h"
+#include <chrono>
+#include <exception>
+
+AssetLoader::AssetLoader(size_t workerCount, std::function<void()> workerInit) {
+    if (workerCount == 0) {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        workerCount = hardware > 1 ? hardware - 1 : 1;
+    }
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers.emplace_back([this, workerInit] { WorkerLoop(workerInit); });
+    }
+    LOG_INFO << "[AssetLoader] Запущено рабочих потоков: " << workerCount << std::endl;
+}
+
+AssetLoader::~AssetLoader() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+        queued.clear();
+    }
+    workAvailable.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void AssetLoader::Submit(LoadFunction load, UploadFunction upload) {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        Job job;
+        job.load = std::move(load);
+        job.upload = std::move(upload);
+        queued.push_back(std::move(job));
+    }
+    workAvailable.notify_one();
+}
+
+void AssetLoader::WorkerLoop(const std::function<void()>& workerInit) {
+    if (workerInit) workerInit();
+    profiler.SetThreadName("AssetLoader");
+
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            workAvailable.wait(lock, [this] { return stopping || !queued.empty(); });
+            if (stopping) return;
+            job = std::move(queued.front());
+            queued.pop_front();
+            ++inFlight;
+        }
+
+        try {
+            PROFILE_ZONE("AssetLoader::Load");
+            job.bytes = job.load ? job.load() : 0;
+        } catch (const std::exception& e) {
+            LOG_ERROR << "[AssetLoader] Ошибка в фоновой загрузке: " << e.what() << std::endl;
+            job.bytes = 0;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            completed.push_back(std::move(job));
+            --inFlight;
+        }
+        loadsFinished.notify_all();
+    }
+}
+
+bool AssetLoader::PopCompleted(Job& job) {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    if (completed.empty()) return false;
+    job = std::move(completed.front());
+    completed.pop_front();
+    return true;
+}
+
+size_t AssetLoader::PumpUploads(const AssetUploadBudget& budget) {
+    PROFILE_ZONE("AssetLoader::PumpUploads");
+    auto start = std::chrono::steady_clock::now();
+    size_t bytes = 0;
+    size_t uploads = 0;
+
+    Job job;
+    // Хотя бы одна загрузка за кадр, чтобы крупный ресурс не застрял навсегда
+    while (PopCompleted(job)) {
+        if (job.upload) job.upload();
+        bytes += job.bytes;
+        ++uploads;
+
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (elapsed >= budget.maxMilliseconds || bytes >= budget.maxBytes) break;
+    }
+
+    uploadedBytes += bytes;
+    return uploads;
+}
+
+void AssetLoader::Flush() {
+    // Загрузка на GPU может поставить новые задачи (например, текстуру модели), поэтому повторяем до пустых очередей
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            loadsFinished.wait(lock, [this] { return queued.empty() && inFlight == 0; });
+            if (completed.empty()) return;
+        }
+        Job job;
+        while (PopCompleted(job)) {
+            if (job.upload) job.upload();
+            uploadedBytes += job.bytes;
+        }
+    }
+}
+
+size_t AssetLoader::GetPendingCount() const {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return queued.size() + inFlight + completed.size();
+}
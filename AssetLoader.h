@@ -0,0 +1,62 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Состояние ресурса, загружаемого в фоне.
+enum class AssetState {
+    Pending,
+    Ready,
+    Failed
+};
+
+// Бюджет загрузки готовых ресурсов на GPU за один кадр.
+struct AssetUploadBudget {
+    double maxMilliseconds = 2.0;
+    size_t maxBytes = 8 * 1024 * 1024;
+};
+
+// Фоновая загрузка ресурсов: чтение файлов, импорт и декодирование выполняются рабочими потоками,
+// а главный поток только выгружает готовые результаты на GPU в пределах бюджета кадра.
+class AssetLoader {
+public:
+    using LoadFunction = std::function<size_t()>; // рабочий поток, возвращает объём данных для загрузки
+    using UploadFunction = std::function<void()>; // главный поток
+
+    explicit AssetLoader(size_t workerCount = 0, std::function<void()> workerInit = nullptr);
+    ~AssetLoader();
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    void Submit(LoadFunction load, UploadFunction upload);
+    size_t PumpUploads(const AssetUploadBudget& budget);
+    void Flush();
+
+    size_t GetPendingCount() const;
+    size_t GetWorkerCount() const { return workers.size(); }
+    size_t GetUploadedBytes() const { return uploadedBytes; }
+
+private:
+    struct Job {
+        LoadFunction load;
+        UploadFunction upload;
+        size_t bytes = 0;
+    };
+
+    void WorkerLoop(const std::function<void()>& workerInit);
+    bool PopCompleted(Job& job);
+
+    mutable std::mutex queueMutex;
+    std::condition_variable workAvailable;
+    std::condition_variable loadsFinished;
+    std::deque<Job> queued;
+    std::deque<Job> completed;
+    size_t inFlight = 0;
+    size_t uploadedBytes = 0;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+};
@@ -0,0 +1,330 @@
+// Фоновая загрузка множества разных моделей через AssetLoader против последовательной загрузки.
+// Модели - сферы разного разрешения с общим материалом и текстурой, пишутся во временную директорию.
+// ModelLoader: холодный проход без кэша, где каждую модель одновременно грузят два задания (импорт, LOD и запись
+// одного .meshcache из разных потоков), затем тёплый проход из кэша; результат обоих совпадает с последовательным.
+// MeshRegistry: AcquireAsync против Acquire - состояние, байты на устройстве, общий меш и текстура для одного пути.
+// Работает без GPU: "загрузка на GPU" - копирование в системную память и NullRenderDevice.
+// Запуск: AsyncLoadBenchmark [число моделей] [рабочих потоков] [--check]
+#include "AssetLoader.h"
+#include "MeshBvh.h"
+#include "MeshCache.h"
+#include "MeshRegistry.h"
+#include "ModelLoader.h"
+#include "NullRenderDevice.h"
+#include "SphereObj.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace {
+    struct UploadedMesh {
+        std::vector<float> vertices;
+        std::vector<uint8_t> indices;
+        std::vector<MeshLod> lods;
+        std::vector<MeshSubmesh> submeshes;
+        std::vector<std::string> materialTextures;
+        bool loaded = false;
+        bool fromCache = false;
+    };
+
+    void Upload(const ModelLoader& loader, UploadedMesh& target) {
+        target.vertices.assign(loader.GetVertexData(), loader.GetVertexData() + loader.GetVertexFloatCount());
+        const uint8_t* indexBytes = static_cast<const uint8_t*>(loader.GetIndexData());
+        target.indices.assign(indexBytes, indexBytes + loader.GetIndexCount() * loader.GetIndexSize());
+        target.lods.assign(loader.GetLodData(), loader.GetLodData() + loader.GetLodCount());
+        target.submeshes.assign(loader.GetSubmeshData(), loader.GetSubmeshData() + loader.GetSubmeshCount());
+        target.materialTextures.clear();
+        for (size_t i = 0; i < loader.GetMaterialCount(); ++i) target.materialTextures.push_back(loader.GetMaterialTexture(i));
+        target.loaded = true;
+        target.fromCache = loader.IsLoadedFromCache();
+    }
+
+    template <typename T>
+    bool SameBytes(const std::vector<T>& a, const std::vector<T>& b) {
+        return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+    }
+
+    bool SameMesh(const UploadedMesh& a, const UploadedMesh& b) {
+        return a.loaded && b.loaded && a.vertices == b.vertices && a.indices == b.indices && SameBytes(a.lods, b.lods) &&
+               SameBytes(a.submeshes, b.submeshes) && a.materialTextures == b.materialTextures;
+    }
+
+    double ElapsedMs(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Сферы попарно разного разрешения; все ссылаются на один .mtl и одну текстуру
+    std::vector<std::string> WriteModels(const std::filesystem::path& directory, int count) {
+        std::error_code error;
+        std::filesystem::remove_all(directory, error);
+        std::filesystem::create_directories(directory, error);
+        // Текстура берётся из Textures/; без неё материал остаётся без текстуры
+        bool texture = std::filesystem::copy_file("Textures/soccer_ball_diffuse.tif", directory / "ball.tif",
+                                                  std::filesystem::copy_options::overwrite_existing, error);
+        {
+            std::ofstream material(directory / "spheres.mtl");
+            material << "newmtl ball\n";
+            if (texture) material << "map_Kd ball.tif\n";
+        }
+
+        std::vector<std::string> paths;
+        for (int i = 0; i < count; ++i) {
+            std::filesystem::path path = directory / ("sphere_" + std::to_string(i) + ".obj");
+            if (!WriteSphereObj(path, 16 + 4 * (i % 8), 8 + 2 * (i / 8), "spheres.mtl", "ball")) return {};
+            paths.push_back(path.string());
+        }
+        return paths;
+    }
+
+    void RemoveCaches(const std::vector<std::string>& paths) {
+        std::error_code error;
+        for (const std::string& path : paths) std::filesystem::remove(MeshCache::GetCachePath(path), error);
+    }
+
+    double LoadSerial(const std::vector<std::string>& paths, std::vector<UploadedMesh>& results) {
+        results.assign(paths.size(), UploadedMesh());
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < paths.size(); ++i) {
+            ModelLoader loader;
+            if (loader.LoadModel(paths[i])) Upload(loader, results[i]);
+        }
+        return ElapsedMs(start);
+    }
+
+    // Каждая модель ставится в очередь copies раз подряд: соседние задания грузят один путь одновременно
+    double LoadAsync(const std::vector<std::string>& paths, size_t copies, size_t workers,
+                     std::vector<UploadedMesh>& results, size_t& frames) {
+        results.assign(paths.size() * copies, UploadedMesh());
+        AssetUploadBudget budget;
+        budget.maxMilliseconds = 1.0;
+        frames = 0;
+        AssetLoader assetLoader(workers);
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < results.size(); ++i) {
+            auto loader = std::make_shared<ModelLoader>();
+            auto loaded = std::make_shared<bool>(false);
+            UploadedMesh* target = &results[i];
+            std::string path = paths[i / copies];
+            assetLoader.Submit(
+                [loader, loaded, path]() -> size_t {
+                    *loaded = loader->LoadModel(path);
+                    return *loaded ? loader->GetVertexFloatCount() * sizeof(float) + loader->GetIndexCount() * loader->GetIndexSize() : 0;
+                },
+                [loader, loaded, target]() {
+                    if (*loaded) Upload(*loader, *target);
+                });
+        }
+        // Имитация кадров: главный поток только выгружает готовое в пределах бюджета
+        while (assetLoader.GetPendingCount() > 0) {
+            assetLoader.PumpUploads(budget);
+            ++frames;
+        }
+        return ElapsedMs(start);
+    }
+
+    // Сверка с последовательной загрузкой; fromCache - сколько заданий прочитали кэш
+    int CountMismatches(const std::vector<UploadedMesh>& serial, const std::vector<UploadedMesh>& async, size_t copies,
+                       size_t& fromCache) {
+        int mismatches = 0;
+        fromCache = 0;
+        for (size_t i = 0; i < async.size(); ++i) {
+            if (!SameMesh(serial[i / copies], async[i])) ++mismatches;
+            if (async[i].fromCache) ++fromCache;
+        }
+        return mismatches;
+    }
+
+    struct RegisteredMesh {
+        AssetState state = AssetState::Pending;
+        size_t byteSize = 0;
+        size_t indexCount = 0;
+        size_t lodCount = 0;
+        size_t submeshCount = 0;
+        size_t collisionNodes = 0;
+        float boundingRadius = 0.0f;
+        std::vector<AssetState> textureStates;
+    };
+
+    struct RegistryPass {
+        std::vector<RegisteredMesh> meshes;
+        RenderFrameStats deviceStats;
+        size_t imports = 0;
+        size_t importsAvoided = 0;
+        size_t bytesSaved = 0;
+        bool shared = true; // повторный запрос пути вернул тот же меш, все меши - одну текстуру
+        double ms = 0.0;
+    };
+
+    void Record(const std::vector<MeshHandle>& handles, RegistryPass& pass) {
+        const Texture* firstTexture = nullptr;
+        for (const MeshHandle& mesh : handles) {
+            RegisteredMesh record;
+            record.state = mesh->GetState();
+            record.byteSize = mesh->byteSize;
+            record.indexCount = mesh->indexCount;
+            record.lodCount = mesh->lods.size();
+            record.submeshCount = mesh->submeshCount;
+            record.collisionNodes = mesh->collision ? mesh->collision->GetNodeCount() : 0;
+            record.boundingRadius = mesh->boundingRadius;
+            for (const TextureHandle& texture : mesh->materialTextures) {
+                record.textureStates.push_back(texture ? texture->GetState() : AssetState::Failed);
+                if (!texture) continue;
+                if (!firstTexture) firstTexture = texture.get();
+                if (texture.get() != firstTexture) pass.shared = false;
+            }
+            pass.meshes.push_back(record);
+        }
+    }
+
+    // Счётчики реестра глобальные: проход учитывает только свой прирост
+    template <typename Acquire>
+    void RunRegistryPass(const std::vector<std::string>& paths, RegistryPass& pass, Acquire acquire) {
+        size_t imports = meshRegistry.GetImportCount();
+        size_t importsAvoided = meshRegistry.GetImportsAvoided();
+        size_t bytesSaved = meshRegistry.GetBytesSaved();
+        RemoveCaches(paths);
+
+        NullRenderDevice device;
+        const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+        device.BeginFrame(clearColor);
+        auto start = std::chrono::steady_clock::now();
+        std::vector<MeshHandle> handles = acquire(device);
+        pass.ms = ElapsedMs(start);
+        device.EndFrame();
+
+        for (size_t i = 0; i < paths.size(); ++i) {
+            if (handles[2 * i] != handles[2 * i + 1]) pass.shared = false;
+        }
+        std::vector<MeshHandle> unique;
+        for (size_t i = 0; i < handles.size(); i += 2) unique.push_back(handles[i]);
+        Record(unique, pass);
+        pass.deviceStats = device.GetFrameStats();
+        pass.imports = meshRegistry.GetImportCount() - imports;
+        pass.importsAvoided = meshRegistry.GetImportsAvoided() - importsAvoided;
+        pass.bytesSaved = meshRegistry.GetBytesSaved() - bytesSaved;
+    }
+
+    bool SameRegistration(const RegisteredMesh& a, const RegisteredMesh& b) {
+        return a.state == AssetState::Ready && a.state == b.state && a.byteSize == b.byteSize &&
+               a.indexCount == b.indexCount && a.lodCount == b.lodCount && a.submeshCount == b.submeshCount &&
+               a.collisionNodes == b.collisionNodes && a.boundingRadius == b.boundingRadius &&
+               a.textureStates == b.textureStates;
+    }
+}
+
+int main(int argc, char** argv) {
+    int count = 64;
+    size_t workers = 0;
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--check")) count = 16;
+        else if (positional == 0 && ++positional) count = std::atoi(argv[i]);
+        else if (positional == 1 && ++positional) workers = static_cast<size_t>(std::atoi(argv[i]));
+    }
+    if (count <= 0) count = 1;
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "katamari_async_load";
+    std::vector<std::string> paths = WriteModels(directory, count);
+    if (paths.empty()) {
+        std::printf("FAIL: could not write models to %s\n", directory.string().c_str());
+        return 1;
+    }
+
+    // Последовательно: холодный импорт пишет кэш, тёплый читает его
+    RemoveCaches(paths);
+    std::vector<UploadedMesh> serialCold, serialWarm;
+    double serialColdMs = LoadSerial(paths, serialCold);
+    double serialWarmMs = LoadSerial(paths, serialWarm);
+    int cacheMismatches = 0;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        if (!SameMesh(serialCold[i], serialWarm[i]) || serialCold[i].fromCache || !serialWarm[i].fromCache) ++cacheMismatches;
+    }
+
+    const size_t copies = 2;
+    size_t workerCount = AssetLoader(workers).GetWorkerCount();
+    std::vector<UploadedMesh> asyncCold, asyncWarm;
+    size_t coldFrames = 0, warmFrames = 0, coldFromCache = 0, warmFromCache = 0;
+    RemoveCaches(paths);
+    double asyncColdMs = LoadAsync(paths, copies, workers, asyncCold, coldFrames);
+    double asyncWarmMs = LoadAsync(paths, copies, workers, asyncWarm, warmFrames);
+    int coldMismatches = CountMismatches(serialCold, asyncCold, copies, coldFromCache);
+    int warmMismatches = CountMismatches(serialWarm, asyncWarm, copies, warmFromCache);
+
+    // Реестр: каждый путь запрашивается дважды подряд, второй запрос должен получить тот же меш
+    RegistryPass serialRegistry, asyncRegistry;
+    RunRegistryPass(paths, serialRegistry, [&paths](NullRenderDevice& device) {
+        std::vector<MeshHandle> handles;
+        for (const std::string& path : paths) {
+            handles.push_back(meshRegistry.Acquire(device, path));
+            handles.push_back(meshRegistry.Acquire(device, path));
+        }
+        return handles;
+    });
+    RunRegistryPass(paths, asyncRegistry, [&paths, workers](NullRenderDevice& device) {
+        AssetLoader assetLoader(workers);
+        std::vector<MeshHandle> handles;
+        for (const std::string& path : paths) {
+            handles.push_back(meshRegistry.AcquireAsync(assetLoader, device, path));
+            handles.push_back(meshRegistry.AcquireAsync(assetLoader, device, path));
+        }
+        // Текстуры ставятся в очередь из выгрузки меша, поэтому ждём, пока очередь не опустеет совсем
+        while (assetLoader.GetPendingCount() > 0) assetLoader.PumpUploads(AssetUploadBudget());
+        return handles;
+    });
+    int registryMismatches = 0;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        if (!SameRegistration(serialRegistry.meshes[i], asyncRegistry.meshes[i])) ++registryMismatches;
+    }
+
+    std::printf("models:         %zu distinct, each loaded %zu times concurrently\n", paths.size(), copies);
+    std::printf("workers:        %zu\n", workerCount);
+    std::printf("serial:         cold %.3f ms, warm %.3f ms\n", serialColdMs, serialWarmMs);
+    std::printf("async cold:     %.3f ms (%zu pump calls), %zu of %zu loads hit the cache, %d mismatches\n", asyncColdMs,
+                coldFrames, coldFromCache, asyncCold.size(), coldMismatches);
+    std::printf("async warm:     %.3f ms (%zu pump calls), %zu of %zu loads hit the cache, %d mismatches\n", asyncWarmMs,
+                warmFrames, warmFromCache, asyncWarm.size(), warmMismatches);
+    std::printf("registry:       Acquire %.3f ms, AcquireAsync %.3f ms; imports %zu/%zu, avoided %zu/%zu, "
+                "bytes saved %zu/%zu, uploaded %zu/%zu bytes in %zu/%zu resources, %d mismatches\n",
+                serialRegistry.ms, asyncRegistry.ms, serialRegistry.imports, asyncRegistry.imports,
+                serialRegistry.importsAvoided, asyncRegistry.importsAvoided, serialRegistry.bytesSaved,
+                asyncRegistry.bytesSaved, serialRegistry.deviceStats.bytesUploaded,
+                asyncRegistry.deviceStats.bytesUploaded, serialRegistry.deviceStats.resourcesCreated,
+                asyncRegistry.deviceStats.resourcesCreated, registryMismatches);
+
+    bool ok = true;
+    if (cacheMismatches) {
+        std::printf("FAIL: %d models differ between import and the cache written from it\n", cacheMismatches);
+        ok = false;
+    }
+    if (coldMismatches || warmMismatches) {
+        std::printf("FAIL: concurrent loads differ from serial loads\n");
+        ok = false;
+    }
+    // Холодный проход должен действительно импортировать: хотя бы одна копия каждой модели без кэша
+    if (asyncCold.size() - coldFromCache < paths.size() || warmFromCache != asyncWarm.size()) {
+        std::printf("FAIL: the cold pass read the cache or the warm pass did not\n");
+        ok = false;
+    }
+    if (registryMismatches || !serialRegistry.shared || !asyncRegistry.shared) {
+        std::printf("FAIL: AcquireAsync meshes differ from Acquire or a path was not shared\n");
+        ok = false;
+    }
+    if (serialRegistry.imports != paths.size() || asyncRegistry.imports != paths.size() ||
+        serialRegistry.importsAvoided != paths.size() || asyncRegistry.importsAvoided != paths.size() ||
+        serialRegistry.bytesSaved != asyncRegistry.bytesSaved ||
+        serialRegistry.deviceStats.bytesUploaded != asyncRegistry.deviceStats.bytesUploaded ||
+        serialRegistry.deviceStats.resourcesCreated != asyncRegistry.deviceStats.resourcesCreated) {
+        std::printf("FAIL: registry counters or device uploads differ between Acquire and AcquireAsync\n");
+        ok = false;
+    }
+    std::printf(ok ? "OK\n" : "FAILED\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,26 @@
+// Готовит модели для проверок ctest: Textures/soccer_ball.obj не хранится в репозитории,
+// поэтому на его место пишется UV-сфера с материалом из soccer_ball.mtl. Настоящую модель, если она есть, не трогает.
+// Запуск: BenchmarkAssets [директория с Textures/ = текущая]
+#include "SphereObj.h"
+#include <cstdio>
+#include <filesystem>
+#include <system_error>
+
+int main(int argc, char** argv) {
+    std::filesystem::path textures = std::filesystem::path(argc > 1 ? argv[1] : ".") / "Textures";
+    std::filesystem::path model = textures / "soccer_ball.obj";
+    if (std::filesystem::exists(model)) {
+        std::printf("%s exists, keeping it\n", model.string().c_str());
+        return 0;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(textures, error);
+    // 64 x 32: около 4k треугольников - хватает на цепочку LOD, оптимизацию индексов и BVH
+    if (!WriteSphereObj(model, 64, 32, "soccer_ball.mtl", "blinn1SG.001")) {
+        std::printf("FAIL: could not write %s\n", model.string().c_str());
+        return 1;
+    }
+    std::printf("wrote fixture sphere %s\n", model.string().c_str());
+    return 0;
+}
@@ -0,0 +1,127 @@
+// Стоимость поиска подбираемых объектов за кадр: пространственная сетка против полного перебора.
+// Плотность объектов постоянна, площадь мира растёт вместе с их числом.
+// Запуск: BroadphaseBenchmark [число кадров] [--check]
+#include "SpatialHash.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+    struct Pickup {
+        DirectX::XMFLOAT3 position;
+        float radius;
+        bool attached;
+    };
+
+    constexpr float KatamariRadius = 1.0f;
+    constexpr float Speed = 5.0f;
+    constexpr float DeltaTime = 1.0f / 60.0f;
+    constexpr float AreaPerPickup = 16.0f;
+
+    std::vector<Pickup> MakeScene(size_t count, float& halfExtent) {
+        halfExtent = 0.5f * std::sqrt(static_cast<float>(count) * AreaPerPickup);
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> coord(-halfExtent, halfExtent);
+        std::uniform_real_distribution<float> size(0.25f, 0.75f);
+        std::vector<Pickup> pickups(count);
+        for (auto& pickup : pickups) {
+            pickup.radius = size(rng);
+            pickup.position = DirectX::XMFLOAT3(coord(rng), pickup.radius, coord(rng));
+            pickup.attached = false;
+        }
+        return pickups;
+    }
+
+    bool Overlaps(const DirectX::XMFLOAT3& center, const Pickup& pickup) {
+        float dx = pickup.position.x - center.x;
+        float dy = pickup.position.y - center.y;
+        float dz = pickup.position.z - center.z;
+        float reach = KatamariRadius + pickup.radius;
+        return dx * dx + dy * dy + dz * dz < reach * reach;
+    }
+
+    // Катамари катится по окружности, чтобы каждый кадр попадать в новые ячейки
+    DirectX::XMFLOAT3 KatamariPosition(int frame, float halfExtent) {
+        float orbit = halfExtent * 0.5f;
+        float angle = frame * Speed * DeltaTime / orbit;
+        return DirectX::XMFLOAT3(orbit * std::cos(angle), KatamariRadius, orbit * std::sin(angle));
+    }
+
+    double RunHashed(std::vector<Pickup> pickups, float halfExtent, int frames, size_t& attached, double& buildMs) {
+        auto buildStart = std::chrono::steady_clock::now();
+        SpatialHash hash(2.0f);
+        for (size_t i = 0; i < pickups.size(); ++i) {
+            hash.Insert(static_cast<uint32_t>(i), pickups[i].position, pickups[i].radius);
+        }
+        buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+
+        std::vector<uint32_t> candidates;
+        attached = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            DirectX::XMFLOAT3 center = KatamariPosition(frame, halfExtent);
+            hash.Query(center, KatamariRadius, candidates);
+            for (uint32_t id : candidates) {
+                if (Overlaps(center, pickups[id])) {
+                    pickups[id].attached = true;
+                    hash.Remove(id);
+                    ++attached;
+                }
+            }
+        }
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / frames;
+    }
+
+    double RunBruteForce(std::vector<Pickup> pickups, float halfExtent, int frames, size_t& attached) {
+        attached = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            DirectX::XMFLOAT3 center = KatamariPosition(frame, halfExtent);
+            for (auto& pickup : pickups) {
+                if (!pickup.attached && Overlaps(center, pickup)) {
+                    pickup.attached = true;
+                    ++attached;
+                }
+            }
+        }
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / frames;
+    }
+}
+
+int main(int argc, char** argv) {
+    int frames = 600;
+    std::vector<size_t> counts = { 1000, 10000, 100000, 1000000 };
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--check")) {
+            frames = 20;
+            counts = { 1000, 10000 };
+        } else {
+            frames = std::atoi(argv[i]);
+        }
+    }
+    if (frames <= 0) frames = 1;
+
+    std::printf("%10s %12s %14s %14s %10s\n", "pickups", "build ms", "hash us/frame", "brute us/frame", "attached");
+    for (size_t count : counts) {
+        float halfExtent = 0.0f;
+        std::vector<Pickup> pickups = MakeScene(count, halfExtent);
+
+        size_t hashedAttached = 0, bruteAttached = 0;
+        double buildMs = 0.0;
+        double hashed = RunHashed(pickups, halfExtent, frames, hashedAttached, buildMs);
+        // Полный перебор на миллионе объектов слишком долог для всех кадров
+        int bruteFrames = count >= 1000000 ? frames / 10 + 1 : frames;
+        double brute = RunBruteForce(pickups, halfExtent, bruteFrames, bruteAttached);
+
+        std::printf("%10zu %12.2f %14.3f %14.3f %10zu\n", count, buildMs, hashed, brute, hashedAttached);
+        if (bruteFrames == frames && hashedAttached != bruteAttached) {
+            std::printf("mismatch: hash attached %zu, brute force attached %zu\n", hashedAttached, bruteAttached);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,146 @@
+// Отсечение сфер по пирамиде видимости: SIMD по четыре сферы против скалярной проверки.
+// Сверяет списки видимых сфер и печатает пропускную способность для 100k и 1M тел (или заданного числа).
+// Запуск: FrustumCullBenchmark [число сфер] [число кадров] [--check]
+#include "FrustumCuller.h"
+#include "FollowCamera.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+    struct Sphere {
+        DirectX::XMFLOAT3 center;
+        float radius;
+    };
+
+    // Наименьший запас по плоскостям; отрицательный - сфера снаружи
+    float Margin(const DirectX::XMFLOAT4 planes[6], const Sphere& sphere) {
+        float margin = 1e30f;
+        for (int i = 0; i < 6; ++i) {
+            float distance = planes[i].x * sphere.center.x +
+                             (planes[i].y * sphere.center.y + (planes[i].z * sphere.center.z + planes[i].w));
+            margin = std::fmin(margin, distance + sphere.radius);
+        }
+        return margin;
+    }
+
+    void CullScalar(const DirectX::XMFLOAT4 planes[6], const std::vector<Sphere>& spheres, std::vector<uint32_t>& visible) {
+        visible.clear();
+        for (size_t i = 0; i < spheres.size(); ++i) {
+            if (Margin(planes, spheres[i]) >= 0.0f) visible.push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    // Расхождения допустимы только у сфер, касающихся плоскости (FMA меняет округление)
+    bool Validate(const DirectX::XMFLOAT4 planes[6], const std::vector<Sphere>& spheres,
+                  const std::vector<uint32_t>& simd, const std::vector<uint32_t>& scalar) {
+        std::vector<char> simdVisible(spheres.size(), 0), scalarVisible(spheres.size(), 0);
+        for (uint32_t i : simd) simdVisible[i] = 1;
+        for (uint32_t i : scalar) scalarVisible[i] = 1;
+        for (size_t i = 1; i < simd.size(); ++i) {
+            if (simd[i] <= simd[i - 1]) {
+                std::printf("FAIL: visible indices are not strictly increasing\n");
+                return false;
+            }
+        }
+        for (size_t i = 0; i < spheres.size(); ++i) {
+            if (simdVisible[i] != scalarVisible[i] && std::fabs(Margin(planes, spheres[i])) > 1e-3f) {
+                std::printf("FAIL: sphere %zu is %s by SIMD but %s by the scalar test\n", i,
+                            simdVisible[i] ? "visible" : "culled", scalarVisible[i] ? "visible" : "culled");
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool CheckKnownCases() {
+        FollowCamera camera(DirectX::XMFLOAT3(0.0f, 5.0f, -10.0f), DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f));
+        FrustumCuller culler;
+        culler.Begin();
+        culler.Add(DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), 1.0f);     // 0: цель камеры
+        culler.Add(DirectX::XMFLOAT3(0.0f, 5.0f, -20.0f), 1.0f);   // 1: за камерой
+        culler.Add(DirectX::XMFLOAT3(500.0f, 0.0f, 0.0f), 1.0f);   // 2: далеко сбоку
+        culler.Add(DirectX::XMFLOAT3(0.0f, 0.0f, 2000.0f), 1.0f);  // 3: за дальней плоскостью
+        culler.Add(DirectX::XMFLOAT3(0.0f, 5.0f, -10.05f), 0.5f);  // 4: камера внутри сферы
+        const std::vector<uint32_t>& visible = culler.Cull(camera.GetViewProjMatrix());
+        if (visible.size() != 2 || visible[0] != 0 || visible[1] != 4 || culler.GetCulledCount() != 3) {
+            std::printf("FAIL: known-case spheres classified incorrectly (%zu visible)\n", visible.size());
+            return false;
+        }
+        return true;
+    }
+
+    bool Run(size_t count, int frames) {
+        std::mt19937 rng(11);
+        std::uniform_real_distribution<float> horizontal(-1000.0f, 1000.0f);
+        std::uniform_real_distribution<float> vertical(0.0f, 20.0f);
+        std::uniform_real_distribution<float> radius(0.25f, 2.0f);
+        std::vector<Sphere> spheres(count);
+        for (Sphere& sphere : spheres) {
+            sphere.center = DirectX::XMFLOAT3(horizontal(rng), vertical(rng), horizontal(rng));
+            sphere.radius = radius(rng);
+        }
+
+        FrustumCuller culler;
+        std::vector<uint32_t> scalarVisible;
+        double simdMs = 0.0, scalarMs = 0.0;
+        size_t visibleTotal = 0;
+        for (int frame = 0; frame < frames; ++frame) {
+            // Камера облетает центр, чтобы доля видимых менялась от кадра к кадру
+            float angle = DirectX::XM_2PI * frame / frames;
+            FollowCamera camera(DirectX::XMFLOAT3(std::sin(angle) * 50.0f, 8.0f, std::cos(angle) * 50.0f),
+                                DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f));
+            DirectX::XMMATRIX viewProj = camera.GetViewProjMatrix();
+
+            auto start = std::chrono::steady_clock::now();
+            culler.Begin();
+            for (const Sphere& sphere : spheres) culler.Add(sphere.center, sphere.radius);
+            const std::vector<uint32_t>& visible = culler.Cull(viewProj);
+            auto middle = std::chrono::steady_clock::now();
+            DirectX::XMFLOAT4 planes[6];
+            FrustumCuller::ExtractPlanes(viewProj, planes);
+            CullScalar(planes, spheres, scalarVisible);
+            auto end = std::chrono::steady_clock::now();
+
+            simdMs += std::chrono::duration<double, std::milli>(middle - start).count();
+            scalarMs += std::chrono::duration<double, std::milli>(end - middle).count();
+            visibleTotal += visible.size();
+            if (!Validate(planes, spheres, visible, scalarVisible)) return false;
+        }
+
+        std::printf("%9zu %10.1f %12.3f %12.3f %14.1f\n", count, double(visibleTotal) / frames, simdMs / frames,
+                    scalarMs / frames, count / (simdMs / frames) / 1000.0);
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    int frames = 20;
+    std::vector<size_t> counts = { 100000, 1000000 };
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--check")) {
+            frames = 2;
+            counts = { 10000 };
+        } else if (positional == 0 && ++positional) {
+            counts = { std::strtoull(argv[i], nullptr, 10) };
+        } else if (positional == 1 && ++positional) {
+            frames = std::atoi(argv[i]);
+        }
+    }
+    if (frames <= 0) frames = 1;
+
+    if (!CheckKnownCases()) return 1;
+
+    // Время SIMD включает заполнение упакованных массивов, как в Render::CullBodies
+    std::printf("%9s %10s %12s %12s %14s\n", "spheres", "visible", "simd ms", "scalar ms", "Mspheres/s");
+    for (size_t count : counts) {
+        if (!Run(count, frames)) return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
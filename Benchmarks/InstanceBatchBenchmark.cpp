@@ -0,0 +1,109 @@
+// Сборка инстансных групп на CPU: N тел с несколькими мешами и материалами.
+// Проверяет, что каждое тело попало в свою группу ровно один раз и в исходном порядке,
+// и сравнивает число вызовов отрисовки с путём "один DrawIndexed на тело".
+// Запуск: InstanceBatchBenchmark [число тел] [число кадров] [--check]
+#include "InstanceBatcher.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+    struct Body {
+        int mesh;
+        bool textured;
+        DirectX::XMFLOAT3 position;
+        DirectX::XMFLOAT4 color;
+    };
+
+    // Позиция тела кодируется в мировой матрице, по ней находим тело после сборки
+    bool Validate(const InstanceBatcher& batcher, const std::vector<Body>& bodies, const int* meshes) {
+        const std::vector<InstanceBatch>& batches = batcher.GetBatches();
+        const std::vector<InstanceData>& instances = batcher.GetInstances();
+        if (instances.size() != bodies.size()) {
+            std::printf("FAIL: %zu instances for %zu bodies\n", instances.size(), bodies.size());
+            return false;
+        }
+
+        size_t covered = 0;
+        std::vector<bool> seen(bodies.size(), false);
+        for (const InstanceBatch& batch : batches) {
+            if (batch.firstInstance != covered) {
+                std::printf("FAIL: batch starts at %u, expected %zu\n", batch.firstInstance, covered);
+                return false;
+            }
+            covered += batch.instanceCount;
+
+            size_t previous = 0;
+            for (uint32_t i = batch.firstInstance; i < batch.firstInstance + batch.instanceCount; ++i) {
+                size_t body = static_cast<size_t>(instances[i].world._41);
+                if (body >= bodies.size() || seen[body] || (i > batch.firstInstance && body <= previous) ||
+                    &meshes[bodies[body].mesh] != batch.mesh || bodies[body].textured != batch.textured ||
+                    instances[i].color.x != bodies[body].color.x) {
+                    std::printf("FAIL: instance %u (body %zu) is in the wrong batch or out of order\n", i, body);
+                    return false;
+                }
+                seen[body] = true;
+                previous = body;
+            }
+        }
+        return covered == bodies.size();
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t count = 100000;
+    int frames = 100;
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--check")) {
+            count = 10000;
+            frames = 2;
+        } else if (positional == 0 && ++positional) {
+            count = static_cast<size_t>(std::atoll(argv[i]));
+        } else if (positional == 1 && ++positional) {
+            frames = std::atoi(argv[i]);
+        }
+    }
+    if (frames <= 0) frames = 1;
+
+    // Почти все подбираемые тела - один мяч; немного других мешей и нетекстурированных тел
+    const int meshCount = 4;
+    int meshes[meshCount] = {};
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    std::vector<Body> bodies(count);
+    for (size_t i = 0; i < count; ++i) {
+        int roll = percent(rng);
+        bodies[i].mesh = roll < 90 ? 0 : 1 + roll % (meshCount - 1);
+        bodies[i].textured = percent(rng) < 95;
+        bodies[i].position = DirectX::XMFLOAT3(static_cast<float>(i), 1.0f, unit(rng) * 100.0f);
+        bodies[i].color = DirectX::XMFLOAT4(unit(rng), unit(rng), unit(rng), 1.0f);
+    }
+
+    InstanceBatcher batcher;
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; ++frame) {
+        batcher.Begin();
+        for (const Body& body : bodies) {
+            DirectX::XMMATRIX world = DirectX::XMMatrixTranslation(body.position.x, body.position.y, body.position.z);
+            batcher.Add(&meshes[body.mesh], 0, body.textured, world, body.color, DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f));
+        }
+        batcher.Build();
+    }
+    double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+
+    if (!Validate(batcher, bodies, meshes)) return 1;
+
+    std::printf("bodies:               %zu\n", count);
+    std::printf("draw calls per body:  %zu\n", count);
+    std::printf("draw calls instanced: %zu\n", batcher.GetBatches().size());
+    std::printf("instance bytes:       %zu\n", batcher.GetInstances().size() * sizeof(InstanceData));
+    std::printf("build ms/frame:       %.3f\n", buildMs);
+    std::printf("OK\n");
+    return 0;
+}
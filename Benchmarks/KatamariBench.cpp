@@ -0,0 +1,374 @@
+// Набор микробенчмарков горячих путей симуляции и загрузки на синтетических сценах от 10 до 1M тел:
+// CheckCollision, UpdatePosition с UpdateWorldTransforms, GetWorldMatrix, AttachChild и обновление кучи,
+// FollowCamera::GetViewProjMatrix и ModelLoader::LoadModel (импорт и тёплый кэш).
+// Результаты печатаются таблицей и пишутся в JSON; с --baseline сравниваются с сохранённым прогоном,
+// и замедление больше порога даёт код возврата 1.
+// Запуск: KatamariBench [--json файл] [--baseline файл] [--threshold доля] [--max-bodies N] [--filter подстрока]
+//                       [--min-time мс] [--check]
+#include "CelestialBody.h"
+#include "FollowCamera.h"
+#include "ModelLoader.h"
+#include "SphereObj.h"
+#include "TransformHierarchy.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+    const size_t SceneSizes[] = { 10, 100, 1000, 10000, 100000, 1000000 };
+
+    struct Options {
+        const char* jsonPath = nullptr;
+        const char* baselinePath = nullptr;
+        double threshold = 0.15;
+        size_t maxBodies = 1000000;
+        const char* filter = nullptr;
+        double minMilliseconds = 200.0;
+    };
+
+    struct Result {
+        std::string name;
+        size_t size;   // тел в сцене или треугольников модели
+        double nsPerOp;
+        uint64_t ops;  // операций в одном замере
+        int samples;
+    };
+
+    // Сцена из N свободных тел вокруг катамари; иерархия объявлена первой и переживает тела
+    struct Scene {
+        TransformHierarchy transforms;
+        std::unique_ptr<CelestialBody> katamari;
+        std::vector<std::unique_ptr<CelestialBody>> bodies;
+    };
+
+    // Плотность постоянна: около 1% тел касается катамари в начале координат
+    std::unique_ptr<Scene> BuildScene(size_t count, uint32_t seed) {
+        auto scene = std::make_unique<Scene>();
+        scene->katamari = std::make_unique<CelestialBody>(scene->transforms, std::string(), DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f),
+                                                          DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), 1.0f, true,
+                                                          DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f));
+        std::mt19937 rng(seed);
+        float halfExtent = std::sqrt(count * 3.14159f * 1.5f * 1.5f / 0.01f) * 0.5f;
+        std::uniform_real_distribution<float> coordinate(-halfExtent, halfExtent);
+        std::uniform_real_distribution<float> size(0.2f, 0.5f);
+        scene->bodies.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            scene->bodies.push_back(std::make_unique<CelestialBody>(
+                scene->transforms, std::string(), DirectX::XMFLOAT3(coordinate(rng), 1.0f, coordinate(rng)),
+                DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), size(rng), true, DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f)));
+        }
+        scene->transforms.UpdateWorldTransforms();
+        return scene;
+    }
+
+    double Median(std::vector<double> values) {
+        std::sort(values.begin(), values.end());
+        size_t middle = values.size() / 2;
+        return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) * 0.5;
+    }
+
+    // Замеры повторяются, пока не наберётся minMilliseconds (не меньше трёх, не больше 50); результат - медиана.
+    // setup не входит во время; run возвращает число выполненных операций
+    Result Measure(const Options& options, const std::string& name, size_t size, const std::function<void()>& setup,
+                   const std::function<uint64_t()>& run) {
+        std::vector<double> sampleNs;
+        uint64_t ops = 0;
+        double totalMs = 0.0;
+        while (sampleNs.size() < 50 && (sampleNs.size() < 3 || totalMs < options.minMilliseconds)) {
+            if (setup) setup();
+            auto start = std::chrono::steady_clock::now();
+            ops = run();
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            sampleNs.push_back(ns / std::max<uint64_t>(ops, 1));
+            totalMs += ns * 1e-6;
+        }
+        return Result{ name, size, Median(sampleNs), ops, static_cast<int>(sampleNs.size()) };
+    }
+
+    // Маленькие сцены проходятся несколько раз за замер, чтобы замер был дольше разрешения таймера
+    size_t Passes(size_t count) {
+        return std::max<size_t>(1, 100000 / count);
+    }
+
+    bool Selected(const Options& options, const char* name) {
+        return !options.filter || std::strstr(name, options.filter);
+    }
+
+    bool BenchScenes(const Options& options, std::vector<Result>& results) {
+        for (size_t count : SceneSizes) {
+            if (count > options.maxBodies) break;
+            std::unique_ptr<Scene> scene = BuildScene(count, static_cast<uint32_t>(count));
+            CelestialBody& katamari = *scene->katamari;
+            size_t passes = Passes(count);
+
+            if (Selected(options, "CheckCollision")) {
+                // Сверка с прямой формулой: тот же список попаданий
+                size_t expected = 0;
+                for (const auto& body : scene->bodies) {
+                    DirectX::XMFLOAT3 a = katamari.GetPosition(), b = body->GetPosition();
+                    float dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+                    float reach = katamari.radius + body->radius;
+                    if (dx * dx + dy * dy + dz * dz < reach * reach) ++expected;
+                }
+                size_t hits = 0;
+                results.push_back(Measure(options, "CheckCollision", count, nullptr, [&] {
+                    hits = 0;
+                    DirectX::XMVECTOR attachmentPoint;
+                    for (size_t pass = 0; pass < passes; ++pass) {
+                        for (const auto& body : scene->bodies) {
+                            if (katamari.CheckCollision(body.get(), attachmentPoint)) ++hits;
+                        }
+                    }
+                    return uint64_t(passes * count);
+                }));
+                if (hits != expected * passes) {
+                    std::printf("FAIL: CheckCollision found %zu hits in %zu bodies, expected %zu\n", hits / passes,
+                                count, expected);
+                    return false;
+                }
+            }
+
+            if (Selected(options, "UpdateWorldTransforms")) {
+                DirectX::XMVECTOR velocity = DirectX::XMVectorSet(0.001f, 0.0f, -0.001f, 0.0f);
+                results.push_back(Measure(options, "UpdateWorldTransforms", count, nullptr, [&] {
+                    for (size_t pass = 0; pass < passes; ++pass) {
+                        for (const auto& body : scene->bodies) body->UpdatePosition(velocity, 1.0f / 60.0f);
+                        scene->transforms.UpdateWorldTransforms();
+                    }
+                    return uint64_t(passes * count);
+                }));
+            }
+
+            if (Selected(options, "GetWorldMatrix")) {
+                float checksum = 0.0f;
+                results.push_back(Measure(options, "GetWorldMatrix", count, nullptr, [&] {
+                    DirectX::XMVECTOR sum = DirectX::XMVectorZero();
+                    for (size_t pass = 0; pass < passes; ++pass) {
+                        for (const auto& body : scene->bodies) sum = DirectX::XMVectorAdd(sum, body->GetWorldMatrix().r[3]);
+                    }
+                    checksum += DirectX::XMVectorGetX(sum);
+                    return uint64_t(passes * count);
+                }));
+                if (!std::isfinite(checksum)) {
+                    std::printf("FAIL: GetWorldMatrix produced a non-finite translation\n");
+                    return false;
+                }
+            }
+
+            if (Selected(options, "AttachChild") || Selected(options, "PileUpdate")) {
+                // Свежие сцены на каждый замер: прикрепить можно только свободное тело
+                size_t copies = std::max<size_t>(1, 10000 / count);
+                std::vector<std::unique_ptr<Scene>> piles;
+                auto build = [&] {
+                    piles.clear();
+                    for (size_t copy = 0; copy < copies; ++copy) piles.push_back(BuildScene(count, static_cast<uint32_t>(copy)));
+                };
+                auto attachAll = [&] {
+                    for (auto& pile : piles) {
+                        for (auto& body : pile->bodies) pile->katamari->AttachChild(body.get());
+                        pile->transforms.UpdateWorldTransforms();
+                    }
+                    return uint64_t(copies * count);
+                };
+                if (Selected(options, "AttachChild")) {
+                    results.push_back(Measure(options, "AttachChild", count, build, attachAll));
+                }
+                build();
+                std::vector<DirectX::XMFLOAT3> before;
+                for (auto& body : piles[0]->bodies) before.push_back(body->GetPosition());
+                attachAll();
+                for (size_t i = 0; i < before.size(); ++i) {
+                    DirectX::XMFLOAT3 after = piles[0]->bodies[i]->GetPosition();
+                    if (std::fabs(after.x - before[i].x) + std::fabs(after.y - before[i].y) +
+                        std::fabs(after.z - before[i].z) > 1e-3f * (1.0f + std::fabs(before[i].x) + std::fabs(before[i].z))) {
+                        std::printf("FAIL: AttachChild moved body %zu of %zu\n", i, count);
+                        return false;
+                    }
+                }
+
+                if (Selected(options, "PileUpdate")) {
+                    // Катамари катится и вращается, вся куча следует за ним
+                    DirectX::XMVECTOR roll = DirectX::XMQuaternionRotationAxis(DirectX::XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f), 0.03f);
+                    DirectX::XMVECTOR velocity = DirectX::XMVectorSet(0.0f, 0.0f, 5.0f, 0.0f);
+                    results.push_back(Measure(options, "PileUpdate", count, nullptr, [&] {
+                        for (auto& pile : piles) {
+                            pile->katamari->Rotate(roll);
+                            pile->katamari->UpdatePosition(velocity, 1.0f / 60.0f);
+                            pile->transforms.UpdateWorldTransforms();
+                        }
+                        return uint64_t(copies * count);
+                    }));
+                }
+            }
+        }
+        return true;
+    }
+
+    void BenchCamera(const Options& options, std::vector<Result>& results) {
+        if (!Selected(options, "GetViewProjMatrix")) return;
+        FollowCamera camera(DirectX::XMFLOAT3(0.0f, 5.0f, -10.0f), DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f));
+        const size_t calls = 100000;
+        float checksum = 0.0f;
+        results.push_back(Measure(options, "GetViewProjMatrix", 1, nullptr, [&] {
+            DirectX::XMVECTOR sum = DirectX::XMVectorZero();
+            for (size_t i = 0; i < calls; ++i) {
+                camera.Update(DirectX::XMFLOAT3(float(i % 100), 1.0f, float(i % 37)), float(i % 10));
+                sum = DirectX::XMVectorAdd(sum, camera.GetViewProjMatrix().r[0]);
+            }
+            checksum += DirectX::XMVectorGetX(sum);
+            return uint64_t(calls);
+        }));
+        if (!std::isfinite(checksum)) std::printf("warning: non-finite view-projection matrix\n");
+    }
+
+    bool BenchModelLoader(const Options& options, std::vector<Result>& results) {
+        if (!Selected(options, "LoadModel")) return true;
+        std::filesystem::path directory = std::filesystem::temp_directory_path() / "katamari_bench";
+        std::filesystem::create_directories(directory);
+
+        for (int segments : { 32, 128 }) {
+            int rings = segments / 2;
+            std::string name = "sphere_" + std::to_string(segments) + "x" + std::to_string(rings) + ".obj";
+            std::string path = (directory / name).string();
+            WriteSphereObj(path, segments, rings);
+            size_t triangles = size_t(2) * segments * (rings - 1);
+            std::filesystem::remove(MeshCache::GetCachePath(path));
+
+            ModelLoader loader;
+            results.push_back(Measure(options, "LoadModel/import", triangles, nullptr, [&] {
+                return uint64_t(loader.LoadModel(path, false) ? 1 : 0);
+            }));
+            if (results.back().ops != 1 || loader.GetLodCount() == 0 || loader.GetIndexCount() < triangles * 3) {
+                std::printf("FAIL: LoadModel could not import %s\n", path.c_str());
+                return false;
+            }
+            size_t importedIndices = loader.GetIndexCount();
+
+            // Первая загрузка с кэшем пишет .meshcache, остальные читают его
+            loader.LoadModel(path);
+            results.push_back(Measure(options, "LoadModel/cache", triangles, nullptr, [&] {
+                return uint64_t(loader.LoadModel(path) && loader.IsLoadedFromCache() ? 1 : 0);
+            }));
+            if (results.back().ops != 1 || loader.GetIndexCount() != importedIndices) {
+                std::printf("FAIL: LoadModel did not reload %s from its cache\n", path.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string Key(const std::string& name, size_t size) {
+        return name + "/" + std::to_string(size);
+    }
+
+    // Одна запись на строку, как её пишет WriteJson
+    bool ReadBaseline(const char* path, std::map<std::string, double>& baseline) {
+        std::ifstream file(path);
+        if (!file.is_open()) {
+            std::printf("FAIL: cannot open baseline %s\n", path);
+            return false;
+        }
+        std::string line;
+        while (std::getline(file, line)) {
+            char name[128];
+            size_t size = 0;
+            double nsPerOp = 0.0;
+            if (std::sscanf(line.c_str(), " {\"name\": \"%127[^\"]\", \"size\": %zu, \"ns_per_op\": %lf", name, &size,
+                            &nsPerOp) == 3) {
+                baseline[Key(name, size)] = nsPerOp;
+            }
+        }
+        if (baseline.empty()) {
+            std::printf("FAIL: baseline %s has no results\n", path);
+            return false;
+        }
+        return true;
+    }
+
+    bool WriteJson(const char* path, const std::vector<Result>& results) {
+        std::ofstream file(path, std::ios::out | std::ios::trunc);
+        if (!file.is_open()) return false;
+        file << "{\n  \"benchmarks\": [\n";
+        char line[256];
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result& result = results[i];
+            std::snprintf(line, sizeof(line),
+                          "    {\"name\": \"%s\", \"size\": %zu, \"ns_per_op\": %.4f, \"ops\": %llu, \"samples\": %d}%s\n",
+                          result.name.c_str(), result.size, result.nsPerOp, (unsigned long long)result.ops,
+                          result.samples, i + 1 < results.size() ? "," : "");
+            file << line;
+        }
+        file << "  ]\n}\n";
+        return static_cast<bool>(file);
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!std::strcmp(argv[i], "--json") && hasValue) options.jsonPath = argv[++i];
+        else if (!std::strcmp(argv[i], "--baseline") && hasValue) options.baselinePath = argv[++i];
+        else if (!std::strcmp(argv[i], "--threshold") && hasValue) options.threshold = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--max-bodies") && hasValue) options.maxBodies = std::strtoull(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "--filter") && hasValue) options.filter = argv[++i];
+        else if (!std::strcmp(argv[i], "--min-time") && hasValue) options.minMilliseconds = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--check")) {
+            options.maxBodies = 1000;
+            options.minMilliseconds = 5.0;
+        } else {
+            std::fprintf(stderr, "usage: %s [--json file] [--baseline file] [--threshold fraction] [--max-bodies N]"
+                                 " [--filter substring] [--min-time ms] [--check]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::map<std::string, double> baseline;
+    if (options.baselinePath && !ReadBaseline(options.baselinePath, baseline)) return 1;
+
+    std::vector<Result> results;
+    if (!BenchScenes(options, results)) return 1;
+    BenchCamera(options, results);
+    if (!BenchModelLoader(options, results)) return 1;
+
+    int regressions = 0;
+    std::printf("%-24s %9s %12s %8s %12s %9s\n", "benchmark", "size", "ns/op", "samples", "baseline", "change");
+    for (const Result& result : results) {
+        std::printf("%-24s %9zu %12.3f %8d", result.name.c_str(), result.size, result.nsPerOp, result.samples);
+        auto it = baseline.find(Key(result.name, result.size));
+        if (it != baseline.end() && it->second > 0.0) {
+            double change = result.nsPerOp / it->second - 1.0;
+            bool regressed = change > options.threshold;
+            regressions += regressed;
+            std::printf(" %12.3f %+8.1f%%%s", it->second, change * 100.0, regressed ? "  REGRESSION" : "");
+        }
+        std::printf("\n");
+    }
+
+    if (options.jsonPath) {
+        if (!WriteJson(options.jsonPath, results)) {
+            std::printf("FAIL: cannot write %s\n", options.jsonPath);
+            return 1;
+        }
+        std::printf("results written to %s\n", options.jsonPath);
+    }
+    if (regressions) {
+        std::printf("FAIL: %d benchmark(s) slower than the baseline by more than %.0f%%\n", regressions,
+                    options.threshold * 100.0);
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,223 @@
+// Уровни детализации: проверка упрощения на UV-сфере со швом и треугольники за кадр без LOD и с LOD.
+// Сцена - катамари с N мячами, раскиданными далеко от камеры; отправка идёт в NullRenderDevice.
+// Запуск: LodBenchmark [число мячей] [число кадров] [--threshold пиксели] [--check]
+#include "NullRenderDevice.h"
+#include "Render.h"
+#include "Ground.h"
+#include "KatamariWorld.h"
+#include "MeshRegistry.h"
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+    // Единичная сфера: шов по долготе и полюса продублированы, как у импортированных моделей
+    void BuildSphere(int rings, int segments, std::vector<float>& vertices, std::vector<uint32_t>& indices) {
+        for (int ring = 0; ring <= rings; ++ring) {
+            for (int segment = 0; segment <= segments; ++segment) {
+                float theta = DirectX::XM_PI * ring / rings;
+                float phi = DirectX::XM_2PI * (segment % segments) / segments;
+                float x = std::sin(theta) * std::cos(phi), y = std::cos(theta), z = std::sin(theta) * std::sin(phi);
+                float vertex[8] = { x, y, z, x, y, z, float(segment) / segments, float(ring) / rings };
+                vertices.insert(vertices.end(), vertex, vertex + 8);
+            }
+        }
+        for (int ring = 0; ring < rings; ++ring) {
+            for (int segment = 0; segment < segments; ++segment) {
+                uint32_t a = ring * (segments + 1) + segment;
+                uint32_t b = a + segments + 1;
+                if (ring > 0) indices.insert(indices.end(), { a, a + 1, b });
+                if (ring + 1 < rings) indices.insert(indices.end(), { b, a + 1, b + 1 });
+            }
+        }
+    }
+
+    bool CheckSimplifier() {
+        std::vector<float> vertices;
+        std::vector<uint32_t> indices;
+        BuildSphere(32, 64, vertices, indices);
+        size_t vertexCount = vertices.size() / 8;
+        std::vector<MeshLod> lods;
+        MeshSimplifier::BuildLodChain(vertices.data(), vertexCount, 8, indices, lods);
+
+        std::printf("%5s %10s %12s %12s\n", "lod", "triangles", "error", "max offset");
+        if (lods.size() < 3) {
+            std::printf("FAIL: only %zu LOD levels generated for a %zu-triangle sphere\n", lods.size(), lods[0].indexCount / size_t(3));
+            return false;
+        }
+        for (size_t level = 0; level < lods.size(); ++level) {
+            const MeshLod& lod = lods[level];
+            if (lod.indexCount % 3 != 0 || size_t(lod.firstIndex) + lod.indexCount > indices.size()) {
+                std::printf("FAIL: LOD %zu range is outside the index buffer\n", level);
+                return false;
+            }
+            if (level > 0 && (lod.indexCount >= lods[level - 1].indexCount || lod.error < lods[level - 1].error)) {
+                std::printf("FAIL: LOD %zu does not reduce triangles or its error decreased\n", level);
+                return false;
+            }
+
+            // Вершины берутся из исходного буфера, поэтому отклонение грани от сферы - у её центра.
+            // Квадрики меряют расстояние до плоскостей исходных граней, так что центр вправе уйти глубже на их прогиб
+            float maxOffset = 0.0f;
+            for (uint32_t i = lod.firstIndex; i < lod.firstIndex + lod.indexCount; i += 3) {
+                const float* p[3];
+                for (int k = 0; k < 3; ++k) {
+                    if (indices[i + k] >= vertexCount) {
+                        std::printf("FAIL: LOD %zu references vertex %u of %zu\n", level, indices[i + k], vertexCount);
+                        return false;
+                    }
+                    p[k] = &vertices[size_t(indices[i + k]) * 8];
+                }
+                if (!std::memcmp(p[0], p[1], 12) || !std::memcmp(p[1], p[2], 12) || !std::memcmp(p[0], p[2], 12)) {
+                    std::printf("FAIL: LOD %zu contains a degenerate triangle\n", level);
+                    return false;
+                }
+                float cx = (p[0][0] + p[1][0] + p[2][0]) / 3.0f;
+                float cy = (p[0][1] + p[1][1] + p[2][1]) / 3.0f;
+                float cz = (p[0][2] + p[1][2] + p[2][2]) / 3.0f;
+                maxOffset = std::fmax(maxOffset, 1.0f - std::sqrt(cx * cx + cy * cy + cz * cz));
+            }
+            std::printf("%5zu %10u %12.5f %12.5f\n", level, lod.indexCount / 3, lod.error, maxOffset);
+            if (level > 0 && maxOffset > 2.0f * lod.error + 0.01f) {
+                std::printf("FAIL: LOD %zu deviates by %.4f, reported error is %.4f\n", level, maxOffset, lod.error);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    struct ModeResult {
+        RenderFrameStats stats;
+        double msPerFrame;
+    };
+
+    ModeResult RunMode(Render& render, NullRenderDevice& device, const KatamariWorld& world,
+                       const std::vector<MeshHandle>& bodyMeshes, const Ground& ground, DirectX::XMMATRIX viewProj,
+                       DirectX::XMFLOAT3 cameraPos, bool lod, int frames) {
+        render.SetLodEnabled(lod);
+        render.RenderScene(world.GetBodies(), bodyMeshes, &ground, viewProj, cameraPos);
+
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            render.RenderScene(world.GetBodies(), bodyMeshes, &ground, viewProj, cameraPos);
+        }
+        ModeResult result;
+        result.msPerFrame = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+        result.stats = device.GetFrameStats();
+        return result;
+    }
+
+    // Камера дрожит на сотые доли процента расстояния: без гистерезиса тела на границе уровня переключались бы каждый кадр.
+    // Отсечение выключено, чтобы число треугольников менялось только из-за смены уровней.
+    // Первый проход по дрожанию - прогрев: тело, пришедшее с более точного уровня, огрубляется один раз
+    size_t CountLodSwitches(Render& render, NullRenderDevice& device, const KatamariWorld& world,
+                            const std::vector<MeshHandle>& bodyMeshes, const Ground& ground, DirectX::XMFLOAT3 cameraPos) {
+        render.SetLodEnabled(true);
+        render.SetCullingEnabled(false);
+        size_t switches = 0;
+        size_t previous = 0;
+        for (int frame = 0; frame < 120; ++frame) {
+            float jitter = 1.0f + 0.0002f * std::sin(frame * DirectX::XM_2PI / 60.0f);
+            DirectX::XMFLOAT3 position(cameraPos.x * jitter, cameraPos.y * jitter, cameraPos.z * jitter);
+            FollowCamera camera(position, DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f));
+            render.RenderScene(world.GetBodies(), bodyMeshes, &ground, camera.GetViewProjMatrix(), position);
+            size_t primitives = device.GetFrameStats().primitives;
+            if (frame > 60 && primitives != previous) ++switches;
+            previous = primitives;
+        }
+        render.SetCullingEnabled(true);
+        return switches;
+    }
+
+    void Print(const char* name, const ModeResult& result) {
+        std::printf("%-8s %10zu %12zu %10.3f\n", name, result.stats.drawCalls, result.stats.primitives, result.msPerFrame);
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t pickups = 2000;
+    int frames = 20;
+    float threshold = 1.0f;
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--threshold") && i + 1 < argc) threshold = static_cast<float>(std::atof(argv[++i]));
+        else if (!std::strcmp(argv[i], "--check")) {
+            pickups = 200;
+            frames = 2;
+        } else if (positional == 0 && ++positional) pickups = std::strtoull(argv[i], nullptr, 10);
+        else if (positional == 1 && ++positional) frames = std::atoi(argv[i]);
+    }
+    if (frames <= 0) frames = 1;
+
+    if (!CheckSimplifier()) return 1;
+
+    NullRenderDevice device;
+    Render render(device);
+    if (!render.Initialize()) return 1;
+    render.SetLodThreshold(threshold, 600);
+
+    AssetLoader assetLoader(1);
+    Ground ground(device, assetLoader, "Textures/ground.obj");
+    assetLoader.Flush();
+    assetLoader.PumpUploads(AssetUploadBudget{ 1e9, size_t(-1) });
+
+    KatamariWorld world;
+    world.PopulateDefaultScene();
+    std::mt19937 rng(12);
+    std::uniform_real_distribution<float> coordinate(-300.0f, 300.0f);
+    for (size_t i = 0; i < pickups; ++i) {
+        world.AddPickup("Textures/soccer_ball.obj", DirectX::XMFLOAT3(coordinate(rng), 0.5f, coordinate(rng)),
+                        DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), 0.5f, i % 10 != 0, DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f));
+    }
+    world.Step(KatamariInput());
+
+    std::vector<MeshHandle> bodyMeshes;
+    size_t readyBodies = 0;
+    size_t maxLods = 0;
+    for (const auto& body : world.GetBodies()) {
+        bodyMeshes.push_back(meshRegistry.Acquire(device, body->modelPath));
+        if (bodyMeshes.back() && bodyMeshes.back()->IsReady()) {
+            ++readyBodies;
+            maxLods = std::max(maxLods, bodyMeshes.back()->lods.size());
+        }
+    }
+    if (readyBodies == 0) {
+        std::printf("FAIL: no body mesh could be loaded (run from the directory containing Textures/)\n");
+        return 1;
+    }
+
+    // Камера поднята над полем, как у большого катамари: дальние мячи занимают по нескольку пикселей
+    DirectX::XMFLOAT3 cameraPos(0.0f, 40.0f, -120.0f);
+    FollowCamera camera(cameraPos, DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f));
+    DirectX::XMMATRIX viewProj = camera.GetViewProjMatrix();
+    ModeResult full = RunMode(render, device, world, bodyMeshes, ground, viewProj, cameraPos, false, frames);
+    ModeResult reduced = RunMode(render, device, world, bodyMeshes, ground, viewProj, cameraPos, true, frames);
+    size_t visibleBodies = render.GetLastVisibleBodyCount();
+    size_t switches = CountLodSwitches(render, device, world, bodyMeshes, ground, cameraPos);
+
+    std::printf("bodies: %zu (ready %zu, visible %zu), LOD levels: %zu, threshold: %.2f px\n", world.GetBodies().size(),
+                readyBodies, visibleBodies, maxLods, threshold);
+    std::printf("%-8s %10s %12s %10s\n", "mode", "draws", "triangles", "ms/frame");
+    Print("lod0", full);
+    Print("lod", reduced);
+    std::printf("triangles per frame: %zu -> %zu (%.1f%%), LOD switches under camera jitter: %zu\n",
+                full.stats.primitives, reduced.stats.primitives,
+                100.0 * double(reduced.stats.primitives) / double(full.stats.primitives), switches);
+
+    if (reduced.stats.primitives > full.stats.primitives || (maxLods > 1 && reduced.stats.primitives == full.stats.primitives)) {
+        std::printf("FAIL: LOD selection did not reduce submitted triangles\n");
+        return 1;
+    }
+    if (switches != 0) {
+        std::printf("FAIL: LOD levels switched %zu times while the camera only jittered\n", switches);
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
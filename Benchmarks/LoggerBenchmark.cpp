@@ -0,0 +1,173 @@
+// Стоимость одного вызова лога из многих потоков: прежний логгер (мьютекс и flush на каждый токен)
+// против колец потоков с фоновой записью, а также уровни, отключённые при запуске и при компиляции.
+// Проверяет, что строки в файле целые, идут по порядку внутри потока и ни одна не потеряна без учёта.
+// Запуск: LoggerBenchmark [записей на поток] [--check]
+#define KATAMARI_LOG_MIN_LEVEL 1 // Trace вырезается, как в сборке с NDEBUG
+#include "Logger.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    // Прежний Logger: каждый токен берёт мьютекс и сбрасывает файл
+    class MutexLogger {
+    public:
+        explicit MutexLogger(const std::string& path) : logFile(path, std::ios::out | std::ios::trunc) {}
+
+        template<typename T>
+        MutexLogger& operator<<(const T& value) {
+            std::lock_guard<std::mutex> lock(logMutex);
+            logFile << value;
+            logFile.flush();
+            return *this;
+        }
+
+        MutexLogger& operator<<(std::ostream& (*manip)(std::ostream&)) {
+            std::lock_guard<std::mutex> lock(logMutex);
+            logFile << manip;
+            logFile.flush();
+            return *this;
+        }
+
+    private:
+        std::ofstream logFile;
+        std::mutex logMutex;
+    };
+
+    std::string TempPath(const std::string& name) {
+        std::filesystem::path directory = std::filesystem::temp_directory_path() / "katamari_logger";
+        std::filesystem::create_directories(directory);
+        std::filesystem::path path = directory / name;
+        std::filesystem::remove(path);
+        return path.string();
+    }
+
+    // Среднее время вызова в потоке, нс; потоки стартуют одновременно
+    double Measure(int threadCount, int records, const std::function<void(int, int)>& body) {
+        std::atomic<int> ready(0);
+        std::atomic<bool> go(false);
+        std::vector<double> threadNs(threadCount, 0.0);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threadCount; ++t) {
+            threads.emplace_back([&, t] {
+                ready.fetch_add(1);
+                while (!go.load()) std::this_thread::yield();
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < records; ++i) body(t, i);
+                auto end = std::chrono::steady_clock::now();
+                threadNs[t] = std::chrono::duration<double, std::nano>(end - start).count();
+            });
+        }
+        while (ready.load() < threadCount) std::this_thread::yield();
+        go.store(true);
+        for (std::thread& thread : threads) thread.join();
+
+        double total = 0.0;
+        for (double ns : threadNs) total += ns;
+        return total / (double(threadCount) * records);
+    }
+
+    // Каждая строка - "thread T record I"; номера записей внутри потока строго растут
+    bool Validate(const std::string& path, int threadCount, int records, uint64_t dropped, bool lossless) {
+        std::ifstream file(path);
+        std::vector<long long> last(threadCount, -1);
+        std::string line;
+        uint64_t lines = 0;
+        while (std::getline(file, line)) {
+            if (line.rfind("[Logger]", 0) == 0) continue; // отчёт о пропущенных записях
+            int thread = -1;
+            long long record = -1;
+            char tail = 0;
+            if (std::sscanf(line.c_str(), "thread %d record %lld%c", &thread, &record, &tail) != 2 ||
+                thread < 0 || thread >= threadCount || record < 0 || record >= records) {
+                std::printf("FAIL: damaged line in %s: \"%s\"\n", path.c_str(), line.c_str());
+                return false;
+            }
+            if (record <= last[thread]) {
+                std::printf("FAIL: thread %d record %lld follows record %lld\n", thread, record, last[thread]);
+                return false;
+            }
+            last[thread] = record;
+            ++lines;
+        }
+
+        uint64_t expected = uint64_t(threadCount) * records;
+        if (lines + dropped != expected || (lossless && dropped != 0)) {
+            std::printf("FAIL: %llu lines written, %llu dropped, %llu expected\n", (unsigned long long)lines,
+                        (unsigned long long)dropped, (unsigned long long)expected);
+            return false;
+        }
+        return true;
+    }
+
+    bool Run(int threadCount, int records) {
+        MutexLogger oldLogger(TempPath("old_" + std::to_string(threadCount) + ".txt"));
+        double oldNs = Measure(threadCount, records, [&](int t, int i) {
+            oldLogger << "thread " << t << " record " << i << std::endl;
+        });
+
+        std::string infoPath = TempPath("info_" + std::to_string(threadCount) + ".txt");
+        logger.SetSinkPath(infoPath);
+        logger.SetLevel(LogLevel::Info);
+        uint64_t droppedBefore = logger.GetDroppedCount();
+        auto start = std::chrono::steady_clock::now();
+        double asyncNs = Measure(threadCount, records, [](int t, int i) {
+            LOG_INFO << "thread " << t << " record " << i << std::endl;
+        });
+        logger.Flush();
+        double writtenMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        uint64_t dropped = logger.GetDroppedCount() - droppedBefore;
+        if (!Validate(infoPath, threadCount, records, dropped, false)) return false;
+
+        // Warning ждёт места в кольце вместо отбрасывания
+        std::string warningPath = TempPath("warning_" + std::to_string(threadCount) + ".txt");
+        logger.SetSinkPath(warningPath);
+        droppedBefore = logger.GetDroppedCount();
+        Measure(threadCount, records, [](int t, int i) {
+            LOG_WARNING << "thread " << t << " record " << i << std::endl;
+        });
+        logger.Flush();
+        if (!Validate(warningPath, threadCount, records, logger.GetDroppedCount() - droppedBefore, true)) return false;
+
+        logger.SetLevel(LogLevel::Warning);
+        double disabledNs = Measure(threadCount, records, [](int t, int i) {
+            LOG_INFO << "thread " << t << " record " << i << std::endl;
+        });
+        double compiledOutNs = Measure(threadCount, records, [](int t, int i) {
+            LOG_TRACE << "thread " << t << " record " << i << std::endl;
+        });
+        logger.Flush();
+        if (!Validate(warningPath, threadCount, records, 0, true)) {
+            std::printf("FAIL: disabled levels reached the log\n");
+            return false;
+        }
+
+        std::printf("%7d %10.1f %10.1f %10.1f %12.2f %12.2f %9llu\n", threadCount, oldNs, asyncNs, writtenMs,
+                    disabledNs, compiledOutNs, (unsigned long long)dropped);
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    int records = 20000;
+    for (int i = 1; i < argc; ++i) records = std::strcmp(argv[i], "--check") ? std::atoi(argv[i]) : 2000;
+    if (records <= 0) records = 1;
+
+    // async ns - время вызова в потоке; written ms - до попадания всех записей в файл
+    std::printf("%7s %10s %10s %10s %12s %12s %9s\n", "threads", "mutex ns", "async ns", "written ms",
+                "disabled ns", "compiled ns", "dropped");
+    for (int threadCount : { 1, 4, 8 }) {
+        if (!Run(threadCount, records)) return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
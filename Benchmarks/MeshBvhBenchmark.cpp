@@ -0,0 +1,301 @@
+// BVH меша для точного подбора: сфера против треугольников на бугристом торе от 1k до 1M треугольников.
+// Печатает время построения, размер дерева и запросы в секунду против перебора всех треугольников;
+// на выборке запросов сверяет попадание и расстояние до ближайшей точки с перебором.
+// Проверяет и вырожденные случаи: совпадающие треугольники, треугольники-точки, ошибки во входных данных,
+// а также подбор в KatamariWorld: тело с формой прилипает только при касании треугольников.
+// Запуск: MeshBvhBenchmark [число запросов=200000] [--check]
+#include "KatamariWorld.h"
+#include "MeshBvh.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+    struct TestMesh {
+        std::vector<float> vertices; // позиция, нормаль, texCoord - как у ModelLoader
+        std::vector<uint32_t> indices;
+        float size = 0.0f;           // радиус ограничивающей сферы
+    };
+
+    struct Query {
+        DirectX::XMFLOAT3 center;
+        float radius;
+    };
+
+    const size_t FloatsPerVertex = 8;
+
+    void AddVertex(TestMesh& mesh, float x, float y, float z) {
+        float vertex[FloatsPerVertex] = { x, y, z, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f };
+        mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + FloatsPerVertex);
+    }
+
+    // Тор с буграми: невыпуклый и совсем не похожий на сферу, 2 * rings * sides треугольников
+    TestMesh MakeBumpyTorus(size_t targetTriangles) {
+        size_t rings = std::max<size_t>(4, static_cast<size_t>(std::sqrt(targetTriangles)));
+        size_t sides = std::max<size_t>(3, targetTriangles / (2 * rings));
+        TestMesh mesh;
+        const float majorRadius = 1.0f, minorRadius = 0.35f;
+        for (size_t ring = 0; ring < rings; ++ring) {
+            float u = DirectX::XM_2PI * ring / rings;
+            for (size_t side = 0; side < sides; ++side) {
+                float v = DirectX::XM_2PI * side / sides;
+                float r = minorRadius * (1.0f + 0.25f * std::sin(5.0f * u) * std::sin(3.0f * v));
+                AddVertex(mesh, (majorRadius + r * std::cos(v)) * std::cos(u), r * std::sin(v),
+                          (majorRadius + r * std::cos(v)) * std::sin(u));
+            }
+        }
+        for (size_t ring = 0; ring < rings; ++ring) {
+            for (size_t side = 0; side < sides; ++side) {
+                uint32_t a = static_cast<uint32_t>(ring * sides + side);
+                uint32_t b = static_cast<uint32_t>(((ring + 1) % rings) * sides + side);
+                uint32_t c = static_cast<uint32_t>(((ring + 1) % rings) * sides + (side + 1) % sides);
+                uint32_t d = static_cast<uint32_t>(ring * sides + (side + 1) % sides);
+                mesh.indices.insert(mesh.indices.end(), { a, b, c, a, c, d });
+            }
+        }
+        mesh.size = majorRadius + minorRadius * 1.25f;
+        return mesh;
+    }
+
+    // Ближайшая точка треугольника к p, скалярно и с ветвлениями (Ericson, 5.1.5) - эталон для перебора
+    DirectX::XMVECTOR ClosestPointOnTriangle(DirectX::FXMVECTOR p, DirectX::FXMVECTOR a, DirectX::FXMVECTOR b,
+                                             DirectX::GXMVECTOR c) {
+        using namespace DirectX;
+        XMVECTOR ab = XMVectorSubtract(b, a), ac = XMVectorSubtract(c, a), ap = XMVectorSubtract(p, a);
+        float d1 = XMVectorGetX(XMVector3Dot(ab, ap)), d2 = XMVectorGetX(XMVector3Dot(ac, ap));
+        if (d1 <= 0.0f && d2 <= 0.0f) return a;
+        XMVECTOR bp = XMVectorSubtract(p, b);
+        float d3 = XMVectorGetX(XMVector3Dot(ab, bp)), d4 = XMVectorGetX(XMVector3Dot(ac, bp));
+        if (d3 >= 0.0f && d4 <= d3) return b;
+        float vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return XMVectorAdd(a, XMVectorScale(ab, d1 / (d1 - d3)));
+        XMVECTOR cp = XMVectorSubtract(p, c);
+        float d5 = XMVectorGetX(XMVector3Dot(ab, cp)), d6 = XMVectorGetX(XMVector3Dot(ac, cp));
+        if (d6 >= 0.0f && d5 <= d6) return c;
+        float vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return XMVectorAdd(a, XMVectorScale(ac, d2 / (d2 - d6)));
+        float va = d3 * d6 - d5 * d4;
+        if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+            return XMVectorAdd(b, XMVectorScale(XMVectorSubtract(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6))));
+        }
+        float denom = va + vb + vc;
+        if (!(denom > 0.0f)) return a; // вырожденный треугольник: сюда попадает только точка
+        return XMVectorAdd(a, XMVectorAdd(XMVectorScale(ab, vb / denom), XMVectorScale(ac, vc / denom)));
+    }
+
+    float BruteForceDistanceSq(const TestMesh& mesh, DirectX::XMFLOAT3 center) {
+        using namespace DirectX;
+        XMVECTOR p = XMLoadFloat3(&center);
+        float best = FLT_MAX;
+        for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+            XMVECTOR a = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&mesh.vertices[mesh.indices[i] * FloatsPerVertex]));
+            XMVECTOR b = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&mesh.vertices[mesh.indices[i + 1] * FloatsPerVertex]));
+            XMVECTOR c = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&mesh.vertices[mesh.indices[i + 2] * FloatsPerVertex]));
+            XMVECTOR q = ClosestPointOnTriangle(p, a, b, c);
+            best = std::min(best, XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(p, q))));
+        }
+        return best;
+    }
+
+    // Сферы размером с катамари относительно предмета: от мелких до сравнимых с ним, в объёме чуть больше меша
+    std::vector<Query> MakeQueries(float size, size_t count, uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> coordinate(-1.2f * size, 1.2f * size);
+        std::uniform_real_distribution<float> radius(0.02f * size, 0.3f * size);
+        std::vector<Query> queries(count);
+        for (Query& query : queries) {
+            query.center = DirectX::XMFLOAT3(coordinate(rng), 0.3f * coordinate(rng), coordinate(rng));
+            query.radius = radius(rng);
+        }
+        return queries;
+    }
+
+    // Сверка с перебором: попадание должно совпасть, кроме сфер, касающихся меша на грани точности float
+    bool Verify(const MeshBvh& bvh, const TestMesh& mesh, const std::vector<Query>& queries, size_t count,
+                const char* name) {
+        using namespace DirectX;
+        float tolerance = 1e-4f * (1.0f + mesh.size);
+        for (size_t i = 0; i < count; ++i) {
+            const Query& query = queries[i];
+            float expected = std::sqrt(BruteForceDistanceSq(mesh, query.center));
+            XMFLOAT3 closest;
+            bool hit = bvh.IntersectSphere(query.center, query.radius, closest);
+            bool expectedHit = expected < query.radius;
+            if (hit != expectedHit && std::fabs(expected - query.radius) > tolerance) {
+                std::printf("FAIL: %s, query %zu: BVH %s, brute force distance %.6f, radius %.6f\n", name, i,
+                            hit ? "hit" : "missed", expected, query.radius);
+                return false;
+            }
+            if (hit) {
+                XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&query.center), XMLoadFloat3(&closest));
+                float distance = XMVectorGetX(XMVector3Length(offset));
+                if (std::fabs(distance - expected) > tolerance) {
+                    std::printf("FAIL: %s, query %zu: closest point at %.6f, brute force %.6f\n", name, i, distance,
+                                expected);
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool CheckEdgeCases() {
+        MeshBvh bvh;
+        DirectX::XMFLOAT3 closest;
+
+        // Тысяча одинаковых треугольников: центроиды совпадают, SAH делить нечем
+        TestMesh stack;
+        AddVertex(stack, 0.0f, 0.0f, 0.0f);
+        AddVertex(stack, 1.0f, 0.0f, 0.0f);
+        AddVertex(stack, 0.0f, 1.0f, 0.0f);
+        for (int i = 0; i < 1000; ++i) stack.indices.insert(stack.indices.end(), { 0u, 1u, 2u });
+        if (!bvh.Build(stack.vertices.data(), FloatsPerVertex, 3, stack.indices.data(), sizeof(uint32_t),
+                       stack.indices.size()) ||
+            bvh.GetDepth() > MeshBvh::MaxDepth ||
+            !bvh.IntersectSphere(DirectX::XMFLOAT3(0.25f, 0.25f, 0.5f), 0.6f, closest) ||
+            std::fabs(closest.z) > 1e-6f || bvh.IntersectSphere(DirectX::XMFLOAT3(0.25f, 0.25f, 0.5f), 0.4f, closest)) {
+            std::printf("FAIL: stacked identical triangles\n");
+            return false;
+        }
+
+        // Треугольники-точки и треугольники-отрезки: остаются только рёбра и вершины
+        TestMesh degenerate;
+        AddVertex(degenerate, 2.0f, 0.0f, 0.0f);
+        AddVertex(degenerate, 0.0f, 0.0f, 0.0f);
+        AddVertex(degenerate, 0.0f, 0.0f, 4.0f);
+        degenerate.indices = { 0, 0, 0, 1, 2, 2 };
+        uint16_t shortIndices[] = { 0, 0, 0, 1, 2, 2 };
+        if (!bvh.Build(degenerate.vertices.data(), FloatsPerVertex, 3, shortIndices, sizeof(uint16_t), 6) ||
+            !bvh.IntersectSphere(DirectX::XMFLOAT3(0.0f, 1.0f, 2.0f), 1.01f, closest) ||
+            std::fabs(closest.z - 2.0f) > 1e-5f || bvh.IntersectSphere(DirectX::XMFLOAT3(0.0f, 1.0f, 2.0f), 0.99f, closest) ||
+            !bvh.IntersectSphere(DirectX::XMFLOAT3(2.0f, 0.5f, 0.0f), 0.51f, closest)) {
+            std::printf("FAIL: degenerate triangles\n");
+            return false;
+        }
+
+        // Ошибки во входных данных: false и пустое дерево, запросы не попадают
+        uint32_t outOfRange[] = { 0, 1, 7 };
+        uint32_t partial[] = { 0, 1 };
+        if (bvh.Build(degenerate.vertices.data(), FloatsPerVertex, 3, outOfRange, sizeof(uint32_t), 3) || !bvh.IsEmpty() ||
+            bvh.Build(degenerate.vertices.data(), FloatsPerVertex, 3, partial, sizeof(uint32_t), 2) ||
+            bvh.Build(degenerate.vertices.data(), FloatsPerVertex, 3, outOfRange, 1, 3) ||
+            bvh.IntersectSphere(DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), 10.0f, closest)) {
+            std::printf("FAIL: invalid input was accepted\n");
+            return false;
+        }
+        return true;
+    }
+
+    // Подбор в мире: катамари в дыре тора касается его ограничивающей сферы, но не треугольников,
+    // а катамари на трубке тора касается и того и другого. Без формы оба тора прилипают, как раньше
+    bool CheckWorldPickup() {
+        TestMesh torus = MakeBumpyTorus(2000);
+        auto bvh = std::make_shared<MeshBvh>();
+        if (!bvh->Build(torus.vertices.data(), FloatsPerVertex, torus.vertices.size() / FloatsPerVertex,
+                        torus.indices.data(), sizeof(uint32_t), torus.indices.size())) {
+            std::printf("FAIL: torus BVH was not built\n");
+            return false;
+        }
+        for (bool withMesh : { false, true }) {
+            KatamariWorld world;
+            world.AddDefaultKatamari();
+            // Масштаб 2: дыра радиусом около 1.3 вокруг катамари радиусом 1; у второго тора трубка проходит через катамари
+            uint32_t ring = world.AddPickup("Textures/soccer_ball.obj", DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f),
+                                            DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), 2.0f, false,
+                                            DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f));
+            uint32_t tube = world.AddPickup("Textures/soccer_ball.obj", DirectX::XMFLOAT3(2.0f, 1.0f, 0.0f),
+                                            DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), 2.0f, false,
+                                            DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f));
+            if (withMesh) {
+                world.SetCollisionMesh(ring, bvh);
+                world.SetCollisionMesh(tube, bvh);
+            }
+            world.Step(KatamariInput());
+            bool ringAttached = world.GetBodies()[ring]->parent != nullptr;
+            bool tubeAttached = world.GetBodies()[tube]->parent != nullptr;
+            if (ringAttached == withMesh || !tubeAttached) {
+                std::printf("FAIL: %s collision mesh: ring %s, tube %s\n", withMesh ? "with" : "without",
+                            ringAttached ? "attached" : "free", tubeAttached ? "attached" : "free");
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t queryCount = 200000;
+    std::vector<size_t> targets = { 1000, 10000, 100000, 1000000 };
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--check")) {
+            queryCount = 5000;
+            targets = { 1000, 10000 };
+        } else {
+            queryCount = std::strtoul(argv[i], nullptr, 10);
+        }
+    }
+    if (queryCount == 0) queryCount = 1;
+
+    if (!CheckEdgeCases() || !CheckWorldPickup()) return 1;
+    std::printf("edge cases and world pickup: OK\n\n");
+
+    std::printf("%10s %9s %9s %6s %9s %8s %13s %13s %9s %8s %9s\n", "triangles", "build ms", "nodes", "depth", "KB",
+                "B/tri", "BVH q/s", "brute q/s", "speedup", "hits", "sphere");
+    bool ok = true;
+    for (size_t target : targets) {
+        TestMesh mesh = MakeBumpyTorus(target);
+        size_t vertexCount = mesh.vertices.size() / FloatsPerVertex;
+
+        MeshBvh bvh;
+        auto buildStart = std::chrono::steady_clock::now();
+        bool built = bvh.Build(mesh.vertices.data(), FloatsPerVertex, vertexCount, mesh.indices.data(), sizeof(uint32_t),
+                               mesh.indices.size());
+        double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+        if (!built) {
+            std::printf("FAIL: BVH for %zu triangles was not built\n", target);
+            return 1;
+        }
+
+        std::vector<Query> queries = MakeQueries(mesh.size, queryCount, static_cast<uint32_t>(target));
+        size_t hits = 0, sphereHits = 0;
+        DirectX::XMFLOAT3 closest;
+        auto queryStart = std::chrono::steady_clock::now();
+        for (const Query& query : queries) hits += bvh.IntersectSphere(query.center, query.radius, closest);
+        double bvhSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - queryStart).count();
+        // Сколько из них подобрала бы прежняя проверка по ограничивающей сфере
+        for (const Query& query : queries) {
+            DirectX::XMVECTOR center = DirectX::XMLoadFloat3(&query.center);
+            float distance = DirectX::XMVectorGetX(DirectX::XMVector3Length(center));
+            sphereHits += distance < query.radius + bvh.GetBoundingRadius();
+        }
+
+        // Перебор на выборке: около 2e8 проверок треугольников на меш
+        size_t bruteCount = std::min(queryCount, std::max<size_t>(50, 200000000 / bvh.GetTriangleCount()));
+        auto bruteStart = std::chrono::steady_clock::now();
+        volatile float sink = 0.0f;
+        for (size_t i = 0; i < bruteCount; ++i) sink = sink + BruteForceDistanceSq(mesh, queries[i].center);
+        double bruteSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - bruteStart).count();
+
+        double bvhRate = queryCount / bvhSeconds;
+        double bruteRate = bruteCount / bruteSeconds;
+        std::printf("%10zu %9.2f %9zu %6u %9.1f %8.1f %13.0f %13.1f %8.0fx %7.1f%% %8.1f%%\n", bvh.GetTriangleCount(),
+                    buildMs, bvh.GetNodeCount(), bvh.GetDepth(), bvh.GetByteSize() / 1024.0,
+                    double(bvh.GetByteSize()) / bvh.GetTriangleCount(), bvhRate, bruteRate, bvhRate / bruteRate,
+                    100.0 * hits / queryCount, 100.0 * sphereHits / queryCount);
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "%zu triangles", bvh.GetTriangleCount());
+        // Сверка - на тех же запросах, что и замер перебора, но не больше тысячи
+        if (!Verify(bvh, mesh, queries, std::min<size_t>(bruteCount, 1000), name)) ok = false;
+    }
+    std::printf("\nhits: spheres touching the mesh; sphere: spheres the bounding-sphere test alone accepts\n");
+    std::printf(ok ? "OK\n" : "FAILED\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+// Сравнение холодного импорта через Assimp с тёплой загрузкой из отображённого в память кэша.
+// Запуск: MeshCacheBenchmark [путь к модели] [число итераций] [--check]
+#include "ModelLoader.h"
+#include "MeshCache.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+    template<typename Fn>
+    double MeasureMs(int iterations, Fn&& fn) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            fn();
+        }
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+    }
+
+    bool SameMesh(const ModelLoader& a, const ModelLoader& b) {
+        if (a.GetMaterialCount() != b.GetMaterialCount()) return false;
+        for (size_t i = 0; i < a.GetMaterialCount(); ++i) {
+            if (a.GetMaterialTexture(i) != b.GetMaterialTexture(i)) return false;
+        }
+        return a.GetVertexFloatCount() == b.GetVertexFloatCount() &&
+               a.GetIndexCount() == b.GetIndexCount() && a.GetIndexSize() == b.GetIndexSize() &&
+               a.GetLodCount() == b.GetLodCount() && a.GetSubmeshCount() == b.GetSubmeshCount() &&
+               std::memcmp(a.GetLodData(), b.GetLodData(), a.GetLodCount() * sizeof(MeshLod)) == 0 &&
+               std::memcmp(a.GetSubmeshData(), b.GetSubmeshData(), a.GetSubmeshCount() * sizeof(MeshSubmesh)) == 0 &&
+               std::memcmp(a.GetVertexData(), b.GetVertexData(), a.GetVertexFloatCount() * sizeof(float)) == 0 &&
+               std::memcmp(a.GetIndexData(), b.GetIndexData(), a.GetIndexCount() * a.GetIndexSize()) == 0;
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string modelPath = "Textures/soccer_ball.obj";
+    int iterations = 20;
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--check")) iterations = 1;
+        else if (positional == 0 && ++positional) modelPath = argv[i];
+        else if (positional == 1 && ++positional) iterations = std::atoi(argv[i]);
+    }
+    if (iterations <= 0) iterations = 1;
+
+    ModelLoader cold;
+    if (!cold.LoadModel(modelPath, false)) {
+        std::printf("failed to import %s\n", modelPath.c_str());
+        return 1;
+    }
+
+    // Первая загрузка с кэшем создаёт .meshcache, если его нет или он устарел
+    ModelLoader warm;
+    if (!warm.LoadModel(modelPath) || !warm.LoadModel(modelPath) || !warm.IsLoadedFromCache()) {
+        std::printf("failed to build mesh cache for %s\n", modelPath.c_str());
+        return 1;
+    }
+    if (!SameMesh(cold, warm)) {
+        std::printf("cached mesh differs from Assimp import\n");
+        return 1;
+    }
+
+    double coldMs = MeasureMs(iterations, [&] { cold.LoadModel(modelPath, false); });
+    double warmMs = MeasureMs(iterations, [&] { warm.LoadModel(modelPath); });
+
+    std::printf("model:        %s\n", modelPath.c_str());
+    std::printf("vertices:     %zu\n", cold.GetVertexFloatCount() / MeshCache::FloatsPerVertex);
+    std::printf("indices:      %zu\n", cold.GetIndexCount());
+    std::printf("iterations:   %d\n", iterations);
+    std::printf("cold assimp:  %.3f ms\n", coldMs);
+    std::printf("warm mmap:    %.3f ms\n", warmMs);
+    std::printf("speedup:      %.1fx\n", warmMs > 0.0 ? coldMs / warmMs : 0.0);
+    return 0;
+}
@@ -0,0 +1,413 @@
+// Оптимизация индексных буферов: ACMR/ATVR кэша вершин и перерисовка до и после для синтетических мешей
+// с перемешанными треугольниками и для моделей, импортированных в порядке файла и с оптимизацией.
+// Запуск: MeshOptimizationBenchmark [модель.obj ...] [--check]
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "ModelLoader.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    constexpr size_t FloatsPerVertex = 8;
+    constexpr int OverdrawResolution = 256;
+
+    struct TestMesh {
+        std::vector<float> vertices;
+        std::vector<uint32_t> indices;
+    };
+
+    // Перерисовка: фрагменты, прошедшие тест глубины, на покрытый пиксель. Шесть ортографических видов вдоль осей,
+    // нелицевые грани отбрасываются так же, как в D3D11 (лицевая грань - по часовой стрелке для зрителя)
+    float AnalyzeOverdraw(const float* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount) {
+        float minimum[3], maximum[3];
+        for (int k = 0; k < 3; ++k) {
+            minimum[k] = std::numeric_limits<float>::max();
+            maximum[k] = -std::numeric_limits<float>::max();
+        }
+        for (size_t v = 0; v < vertexCount; ++v) {
+            for (int k = 0; k < 3; ++k) {
+                minimum[k] = std::min(minimum[k], vertices[v * FloatsPerVertex + k]);
+                maximum[k] = std::max(maximum[k], vertices[v * FloatsPerVertex + k]);
+            }
+        }
+        float extent = std::max({ maximum[0] - minimum[0], maximum[1] - minimum[1], maximum[2] - minimum[2], 1e-6f });
+
+        size_t shaded = 0;
+        size_t covered = 0;
+        std::vector<float> depth(size_t(OverdrawResolution) * OverdrawResolution);
+        for (int axis = 0; axis < 3; ++axis) {
+            int uAxis = (axis + 1) % 3;
+            int vAxis = (axis + 2) % 3;
+            for (float direction : { 1.0f, -1.0f }) {
+                std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::max());
+                for (size_t i = 0; i + 2 < indexCount; i += 3) {
+                    const float* p[3];
+                    for (int c = 0; c < 3; ++c) p[c] = vertices + size_t(indices[i + c]) * FloatsPerVertex;
+                    float e1[3], e2[3];
+                    for (int k = 0; k < 3; ++k) {
+                        e1[k] = p[1][k] - p[0][k];
+                        e2[k] = p[2][k] - p[0][k];
+                    }
+                    float normal[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+                    // Зритель смотрит вдоль direction по оси axis: лицевая грань повёрнута нормалью к нему
+                    if (!(normal[axis] * direction < 0.0f)) continue;
+
+                    float x[3], y[3], z[3];
+                    for (int c = 0; c < 3; ++c) {
+                        x[c] = (p[c][uAxis] - minimum[uAxis]) / extent * (OverdrawResolution - 1);
+                        y[c] = (p[c][vAxis] - minimum[vAxis]) / extent * (OverdrawResolution - 1);
+                        z[c] = p[c][axis] * direction;
+                    }
+                    float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+                    if (area == 0.0f) continue;
+                    if (area < 0.0f) {
+                        std::swap(x[1], x[2]);
+                        std::swap(y[1], y[2]);
+                        std::swap(z[1], z[2]);
+                        area = -area;
+                    }
+
+                    int x0 = std::max(0, int(std::floor(std::min({ x[0], x[1], x[2] }))));
+                    int y0 = std::max(0, int(std::floor(std::min({ y[0], y[1], y[2] }))));
+                    int x1 = std::min(OverdrawResolution - 1, int(std::ceil(std::max({ x[0], x[1], x[2] }))));
+                    int y1 = std::min(OverdrawResolution - 1, int(std::ceil(std::max({ y[0], y[1], y[2] }))));
+                    for (int py = y0; py <= y1; ++py) {
+                        for (int px = x0; px <= x1; ++px) {
+                            float sx = px + 0.5f, sy = py + 0.5f;
+                            float w0 = (x[2] - x[1]) * (sy - y[1]) - (y[2] - y[1]) * (sx - x[1]);
+                            float w1 = (x[0] - x[2]) * (sy - y[2]) - (y[0] - y[2]) * (sx - x[2]);
+                            float w2 = (x[1] - x[0]) * (sy - y[0]) - (y[1] - y[0]) * (sx - x[0]);
+                            if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) continue;
+                            float fragmentDepth = (w0 * z[0] + w1 * z[1] + w2 * z[2]) / area;
+                            float& stored = depth[size_t(py) * OverdrawResolution + px];
+                            if (stored == std::numeric_limits<float>::max()) ++covered;
+                            if (fragmentDepth < stored) {
+                                stored = fragmentDepth;
+                                ++shaded;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        return covered ? float(shaded) / float(covered) : 0.0f;
+    }
+
+    // Треугольники как тройки содержимого вершин с сохранением обхода: сравнимы при любой нумерации вершин
+    std::vector<std::array<uint32_t, 3>> CanonicalTriangles(const float* vertices, const uint32_t* indices, size_t indexCount,
+                                                            std::map<std::array<float, FloatsPerVertex>, uint32_t>& ids) {
+        std::vector<std::array<uint32_t, 3>> triangles;
+        for (size_t i = 0; i + 2 < indexCount; i += 3) {
+            std::array<uint32_t, 3> triangle;
+            for (int c = 0; c < 3; ++c) {
+                std::array<float, FloatsPerVertex> key;
+                std::memcpy(key.data(), vertices + size_t(indices[i + c]) * FloatsPerVertex, sizeof(float) * FloatsPerVertex);
+                triangle[c] = ids.emplace(key, uint32_t(ids.size())).first->second;
+            }
+            std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+            triangles.push_back(triangle);
+        }
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    }
+
+    bool SameTriangles(const float* verticesA, const uint32_t* indicesA, const float* verticesB, const uint32_t* indicesB,
+                       size_t indexCount) {
+        std::map<std::array<float, FloatsPerVertex>, uint32_t> ids;
+        return CanonicalTriangles(verticesA, indicesA, indexCount, ids) == CanonicalTriangles(verticesB, indicesB, indexCount, ids);
+    }
+
+    // Обход задаётся так, чтобы нормаль грани смотрела по outward (как у лицевых граней моделей)
+    void PushTriangle(TestMesh& mesh, uint32_t a, uint32_t b, uint32_t c, const float outward[3]) {
+        const float* p0 = mesh.vertices.data() + size_t(a) * FloatsPerVertex;
+        const float* p1 = mesh.vertices.data() + size_t(b) * FloatsPerVertex;
+        const float* p2 = mesh.vertices.data() + size_t(c) * FloatsPerVertex;
+        float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        float normal[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+        if (normal[0] * outward[0] + normal[1] * outward[1] + normal[2] * outward[2] < 0.0f) std::swap(b, c);
+        mesh.indices.insert(mesh.indices.end(), { a, b, c });
+    }
+
+    void AddSphere(TestMesh& mesh, float radius, int rings, int segments) {
+        uint32_t first = uint32_t(mesh.vertices.size() / FloatsPerVertex);
+        for (int ring = 0; ring <= rings; ++ring) {
+            for (int segment = 0; segment <= segments; ++segment) {
+                float theta = 3.14159265f * ring / rings, phi = 6.2831853f * segment / segments;
+                float x = std::sin(theta) * std::cos(phi), y = std::cos(theta), z = std::sin(theta) * std::sin(phi);
+                float vertex[FloatsPerVertex] = { x * radius, y * radius, z * radius, x, y, z,
+                                                  float(segment) / segments, float(ring) / rings };
+                mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + FloatsPerVertex);
+            }
+        }
+        for (int ring = 0; ring < rings; ++ring) {
+            for (int segment = 0; segment < segments; ++segment) {
+                uint32_t a = first + ring * (segments + 1) + segment, b = a + segments + 1;
+                for (const std::array<uint32_t, 3>& triangle : { std::array<uint32_t, 3>{ a, a + 1, b },
+                                                                 std::array<uint32_t, 3>{ b, a + 1, b + 1 } }) {
+                    if (ring == 0 && triangle[0] == a) continue;          // вырожденные у полюсов
+                    if (ring == rings - 1 && triangle[0] == b) continue;
+                    const float* p0 = mesh.vertices.data() + size_t(triangle[0]) * FloatsPerVertex;
+                    const float* p1 = mesh.vertices.data() + size_t(triangle[1]) * FloatsPerVertex;
+                    const float* p2 = mesh.vertices.data() + size_t(triangle[2]) * FloatsPerVertex;
+                    float center[3] = { p0[0] + p1[0] + p2[0], p0[1] + p1[1] + p2[1], p0[2] + p1[2] + p2[2] };
+                    PushTriangle(mesh, triangle[0], triangle[1], triangle[2], center);
+                }
+            }
+        }
+    }
+
+    TestMesh MakeGrid(int size) {
+        TestMesh mesh;
+        for (int z = 0; z <= size; ++z) {
+            for (int x = 0; x <= size; ++x) {
+                float vertex[FloatsPerVertex] = { float(x), 0.0f, float(z), 0.0f, 1.0f, 0.0f, float(x) / size, float(z) / size };
+                mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + FloatsPerVertex);
+            }
+        }
+        const float up[3] = { 0.0f, 1.0f, 0.0f };
+        for (int z = 0; z < size; ++z) {
+            for (int x = 0; x < size; ++x) {
+                uint32_t a = z * (size + 1) + x, b = a + size + 1;
+                PushTriangle(mesh, a, a + 1, b, up);
+                PushTriangle(mesh, b, a + 1, b + 1, up);
+            }
+        }
+        return mesh;
+    }
+
+    // Худший исходный порядок: треугольники и вершины перемешаны
+    void Shuffle(TestMesh& mesh, uint32_t seed) {
+        std::mt19937 rng(seed);
+        size_t vertexCount = mesh.vertices.size() / FloatsPerVertex;
+        std::vector<uint32_t> permutation(vertexCount);
+        std::iota(permutation.begin(), permutation.end(), 0u);
+        std::shuffle(permutation.begin(), permutation.end(), rng);
+        std::vector<float> vertices(mesh.vertices.size());
+        for (size_t v = 0; v < vertexCount; ++v) {
+            std::memcpy(vertices.data() + size_t(permutation[v]) * FloatsPerVertex, mesh.vertices.data() + v * FloatsPerVertex,
+                        sizeof(float) * FloatsPerVertex);
+        }
+        mesh.vertices.swap(vertices);
+        for (uint32_t& index : mesh.indices) index = permutation[index];
+
+        std::vector<std::array<uint32_t, 3>> triangles(mesh.indices.size() / 3);
+        std::memcpy(triangles.data(), mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+        std::shuffle(triangles.begin(), triangles.end(), rng);
+        std::memcpy(mesh.indices.data(), triangles.data(), mesh.indices.size() * sizeof(uint32_t));
+    }
+
+    struct PassReport {
+        VertexCacheStats cache;
+        float overdraw;
+    };
+
+    PassReport Analyze(const TestMesh& mesh) {
+        size_t vertexCount = mesh.vertices.size() / FloatsPerVertex;
+        return { MeshOptimizer::AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), vertexCount),
+                 AnalyzeOverdraw(mesh.vertices.data(), vertexCount, mesh.indices.data(), mesh.indices.size()) };
+    }
+
+    void PrintPass(const char* name, const char* pass, const PassReport& report, double ms) {
+        std::printf("%-12s %-14s %8.3f %8.3f %10.3f %10.2f\n", name, pass, report.cache.acmr, report.cache.atvr,
+                    report.overdraw, ms);
+    }
+
+    double ElapsedMs(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Три прохода по отдельности с проверкой, что набор треугольников и их обход сохраняются
+    bool CheckSynthetic(const char* name, TestMesh mesh, float maxAcmr, float maxOverdraw) {
+        size_t vertexCount = mesh.vertices.size() / FloatsPerVertex;
+        const TestMesh original = mesh;
+        PassReport before = Analyze(mesh);
+        PrintPass(name, "shuffled", before, 0.0);
+
+        auto start = std::chrono::steady_clock::now();
+        MeshOptimizer::OptimizeVertexCache(mesh.indices.data(), mesh.indices.size(), vertexCount);
+        double cacheMs = ElapsedMs(start);
+        PassReport cache = Analyze(mesh);
+        PrintPass(name, "vertex cache", cache, cacheMs);
+
+        start = std::chrono::steady_clock::now();
+        MeshOptimizer::OptimizeOverdraw(mesh.vertices.data(), vertexCount, FloatsPerVertex, mesh.indices.data(),
+                                        mesh.indices.size());
+        double overdrawMs = ElapsedMs(start);
+        PassReport overdraw = Analyze(mesh);
+        PrintPass(name, "+ overdraw", overdraw, overdrawMs);
+
+        start = std::chrono::steady_clock::now();
+        size_t usedVertices = MeshOptimizer::OptimizeVertexFetch(mesh.vertices.data(), vertexCount, FloatsPerVertex,
+                                                                 mesh.indices.data(), mesh.indices.size());
+        double fetchMs = ElapsedMs(start);
+        mesh.vertices.resize(usedVertices * FloatsPerVertex);
+        PassReport fetch = Analyze(mesh);
+        PrintPass(name, "+ fetch", fetch, fetchMs);
+
+        bool ok = true;
+        if (!SameTriangles(original.vertices.data(), original.indices.data(), mesh.vertices.data(), mesh.indices.data(),
+                           mesh.indices.size())) {
+            std::printf("FAIL: %s: optimization changed the set of triangles or their winding\n", name);
+            ok = false;
+        }
+        if (!(cache.cache.acmr < before.cache.acmr) || cache.cache.acmr > maxAcmr) {
+            std::printf("FAIL: %s: ACMR %.3f after the vertex cache pass, expected below %.3f and %.3f\n", name,
+                        cache.cache.acmr, before.cache.acmr, maxAcmr);
+            ok = false;
+        }
+        // Кластеры режутся с порогом 1.05; на границах кластеров кэш не сбрасывается, так что запас небольшой
+        if (overdraw.cache.acmr > cache.cache.acmr * 1.05f + 0.02f) {
+            std::printf("FAIL: %s: overdraw pass raised ACMR from %.3f to %.3f\n", name, cache.cache.acmr, overdraw.cache.acmr);
+            ok = false;
+        }
+        if (std::fabs(fetch.cache.acmr - overdraw.cache.acmr) > 1e-6f || std::fabs(fetch.overdraw - overdraw.overdraw) > 1e-6f) {
+            std::printf("FAIL: %s: vertex fetch pass changed the triangle order\n", name);
+            ok = false;
+        }
+        if (overdraw.overdraw > maxOverdraw) {
+            std::printf("FAIL: %s: overdraw %.3f after the overdraw pass, expected at most %.3f\n", name, overdraw.overdraw,
+                        maxOverdraw);
+            ok = false;
+        }
+        return ok;
+    }
+
+    // Полный импортный путь: цепочка LOD и Optimize по всем уровням
+    bool CheckLodChain() {
+        TestMesh mesh;
+        AddSphere(mesh, 1.0f, 48, 96);
+        Shuffle(mesh, 7);
+        std::vector<MeshLod> lods;
+        MeshSimplifier::BuildLodChain(mesh.vertices.data(), mesh.vertices.size() / FloatsPerVertex, FloatsPerVertex,
+                                      mesh.indices, lods);
+        const TestMesh original = mesh;
+        MeshOptimizer::Optimize(mesh.vertices, FloatsPerVertex, mesh.indices, lods);
+
+        bool ok = true;
+        for (size_t level = 0; level < lods.size(); ++level) {
+            const MeshLod& lod = lods[level];
+            VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(original.indices.data() + lod.firstIndex,
+                                                                        lod.indexCount, original.vertices.size() / FloatsPerVertex);
+            VertexCacheStats after = MeshOptimizer::AnalyzeVertexCache(mesh.indices.data() + lod.firstIndex, lod.indexCount,
+                                                                       mesh.vertices.size() / FloatsPerVertex);
+            std::printf("lod chain    LOD %zu %10u tris   ACMR %.3f -> %.3f\n", level, lod.indexCount / 3, before.acmr,
+                        after.acmr);
+            if (!SameTriangles(original.vertices.data(), original.indices.data() + lod.firstIndex, mesh.vertices.data(),
+                               mesh.indices.data() + lod.firstIndex, lod.indexCount)) {
+                std::printf("FAIL: LOD %zu triangles changed\n", level);
+                ok = false;
+            }
+            if (!(after.acmr < before.acmr)) {
+                std::printf("FAIL: LOD %zu ACMR did not improve\n", level);
+                ok = false;
+            }
+        }
+        return ok;
+    }
+
+    void WidenIndices(const ModelLoader& loader, std::vector<uint32_t>& indices) {
+        const void* data = loader.GetIndexData();
+        if (loader.GetIndexSize() == sizeof(uint16_t)) {
+            const uint16_t* shortIndices = static_cast<const uint16_t*>(data);
+            indices.assign(shortIndices, shortIndices + loader.GetIndexCount());
+        } else {
+            const uint32_t* longIndices = static_cast<const uint32_t*>(data);
+            indices.assign(longIndices, longIndices + loader.GetIndexCount());
+        }
+    }
+
+    bool ReportModel(const std::string& path) {
+        ModelLoader fileOrder;
+        ModelLoader optimized;
+        if (!fileOrder.LoadModel(path, false, false) || !optimized.LoadModel(path, false, true)) {
+            std::printf("FAIL: could not load %s\n", path.c_str());
+            return false;
+        }
+        std::vector<uint32_t> before, after;
+        WidenIndices(fileOrder, before);
+        WidenIndices(optimized, after);
+        size_t beforeVertices = fileOrder.GetVertexFloatCount() / FloatsPerVertex;
+        size_t afterVertices = optimized.GetVertexFloatCount() / FloatsPerVertex;
+
+        std::printf("%s\n", path.c_str());
+        std::printf("  vertices: %zu -> %zu, index buffer: %zu bytes as 32-bit -> %zu bytes (%zu-bit)\n", beforeVertices,
+                    afterVertices, optimized.GetIndexCount() * sizeof(uint32_t),
+                    optimized.GetIndexCount() * optimized.GetIndexSize(), optimized.GetIndexSize() * 8);
+        bool ok = true;
+        for (size_t level = 0; level < optimized.GetLodCount(); ++level) {
+            const MeshLod& lodBefore = fileOrder.GetLodData()[level];
+            const MeshLod& lodAfter = optimized.GetLodData()[level];
+            VertexCacheStats cacheBefore = MeshOptimizer::AnalyzeVertexCache(before.data() + lodBefore.firstIndex,
+                                                                             lodBefore.indexCount, beforeVertices);
+            VertexCacheStats cacheAfter = MeshOptimizer::AnalyzeVertexCache(after.data() + lodAfter.firstIndex,
+                                                                            lodAfter.indexCount, afterVertices);
+            float overdrawBefore = AnalyzeOverdraw(fileOrder.GetVertexData(), beforeVertices,
+                                                   before.data() + lodBefore.firstIndex, lodBefore.indexCount);
+            float overdrawAfter = AnalyzeOverdraw(optimized.GetVertexData(), afterVertices,
+                                                  after.data() + lodAfter.firstIndex, lodAfter.indexCount);
+            std::printf("  LOD %zu: %7u tris  ACMR %.3f -> %.3f  ATVR %.3f -> %.3f  overdraw %.3f -> %.3f\n", level,
+                        lodAfter.indexCount / 3, cacheBefore.acmr, cacheAfter.acmr, cacheBefore.atvr, cacheAfter.atvr,
+                        overdrawBefore, overdrawAfter);
+            // Порядок файла бывает уже неплохим, но оптимизированный не должен быть заметно хуже
+            if (cacheAfter.acmr > cacheBefore.acmr + 0.01f) {
+                std::printf("FAIL: %s LOD %zu: ACMR got worse\n", path.c_str(), level);
+                ok = false;
+            }
+        }
+        if (fileOrder.GetLodCount() != optimized.GetLodCount()) {
+            std::printf("FAIL: %s: LOD count differs between file order and optimized import\n", path.c_str());
+            ok = false;
+        }
+        return ok;
+    }
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> models;
+    // Проверки здесь быстрые: --check ничего не сокращает
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--check")) models.push_back(argv[i]);
+    }
+    if (models.empty()) models.push_back("Textures/soccer_ball.obj");
+
+    std::printf("FIFO cache of %zu vertices, overdraw from 6 axis views at %dx%d\n", MeshOptimizer::AnalysisCacheSize,
+                OverdrawResolution, OverdrawResolution);
+    std::printf("%-12s %-14s %8s %8s %10s %10s\n", "mesh", "pass", "ACMR", "ATVR", "overdraw", "ms");
+
+    TestMesh grid = MakeGrid(200);
+    Shuffle(grid, 1);
+    TestMesh sphere;
+    AddSphere(sphere, 1.0f, 64, 128);
+    Shuffle(sphere, 2);
+    // Вложенные сферы: внутренние полностью закрыты внешней, если она нарисована первой.
+    // Порядок "изнутри наружу" - худший случай: без прохода против перерисовки каждый пиксель закрашивается трижды
+    TestMesh shells;
+    AddSphere(shells, 0.6f, 32, 64);
+    AddSphere(shells, 0.8f, 32, 64);
+    AddSphere(shells, 1.0f, 32, 64);
+    TestMesh shuffledShells = shells;
+    Shuffle(shuffledShells, 3);
+
+    const float anyOverdraw = std::numeric_limits<float>::max();
+    bool ok = CheckSynthetic("grid", grid, 0.75f, anyOverdraw);
+    ok = CheckSynthetic("sphere", sphere, 0.75f, anyOverdraw) && ok;
+    ok = CheckSynthetic("shells", shells, 0.75f, 1.05f) && ok;
+    ok = CheckSynthetic("shells, mix", shuffledShells, 0.75f, 1.05f) && ok;
+    ok = CheckLodChain() && ok;
+    for (const std::string& model : models) ok = ReportModel(model) && ok;
+
+    if (!ok) return 1;
+    std::printf("OK\n");
+    return 0;
+}
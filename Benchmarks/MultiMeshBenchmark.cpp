@@ -0,0 +1,377 @@
+// Модель из нескольких мешей и материалов: импорт в один буфер с таблицей подмешей против набора однообъектных файлов.
+// Проверяются таблица подмешей, геометрия каждого материала и кэш; затем сцена из N реквизитов отправляется
+// в NullRenderDevice в обоих вариантах. Модели генерируются во временный каталог.
+// Запуск: MultiMeshBenchmark [число реквизитов] [число кадров] [--check]
+#include "NullRenderDevice.h"
+#include "Render.h"
+#include "Ground.h"
+#include "KatamariWorld.h"
+#include "MeshRegistry.h"
+#include "ModelLoader.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    constexpr size_t PartCount = 12;
+
+    struct Material {
+        const char* name;
+        const char* texture; // пустая строка - материал без текстуры
+    };
+    const Material Materials[] = { { "wood", "wood.png" }, { "metal", "metal.png" }, { "paint", "" } };
+
+    // Деталь реквизита: вершина - позиция, нормаль, UV
+    struct Part {
+        std::vector<std::array<float, 8>> vertices;
+        std::vector<uint32_t> indices;
+        size_t material;
+    };
+
+    Part BuildCylinder(float x, float y, float z, float radius, float height, int segments, int rings) {
+        Part part;
+        for (int ring = 0; ring <= rings; ++ring) {
+            for (int segment = 0; segment <= segments; ++segment) {
+                float phi = DirectX::XM_2PI * (segment % segments) / segments;
+                float nx = std::cos(phi), nz = std::sin(phi);
+                part.vertices.push_back({ x + radius * nx, y + height * ring / rings, z + radius * nz, nx, 0.0f, nz,
+                                          float(segment) / segments, float(ring) / rings });
+            }
+        }
+        for (int ring = 0; ring < rings; ++ring) {
+            for (int segment = 0; segment < segments; ++segment) {
+                uint32_t a = ring * (segments + 1) + segment;
+                uint32_t b = a + segments + 1;
+                part.indices.insert(part.indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+            }
+        }
+        return part;
+    }
+
+    Part BuildBox(float x, float y, float z, float size) {
+        Part part;
+        for (int axis = 0; axis < 3; ++axis) {
+            for (float side : { -1.0f, 1.0f }) {
+                uint32_t base = static_cast<uint32_t>(part.vertices.size());
+                int u = (axis + 1) % 3, v = (axis + 2) % 3;
+                for (int corner = 0; corner < 4; ++corner) {
+                    float p[3], n[3] = { 0.0f, 0.0f, 0.0f };
+                    p[axis] = side * size;
+                    p[u] = (corner == 1 || corner == 2 ? 1.0f : -1.0f) * size;
+                    p[v] = (corner >= 2 ? 1.0f : -1.0f) * size;
+                    n[axis] = side;
+                    part.vertices.push_back({ x + p[0], y + p[1], z + p[2], n[0], n[1], n[2],
+                                              corner == 1 || corner == 2 ? 1.0f : 0.0f, corner >= 2 ? 1.0f : 0.0f });
+                }
+                if (side > 0.0f) part.indices.insert(part.indices.end(), { base, base + 2, base + 1, base, base + 3, base + 2 });
+                else part.indices.insert(part.indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 });
+            }
+        }
+        return part;
+    }
+
+    std::vector<Part> BuildProp() {
+        std::vector<Part> parts;
+        for (size_t i = 0; i < PartCount; ++i) {
+            float angle = DirectX::XM_2PI * i / PartCount;
+            float x = 0.6f * std::cos(angle), z = 0.6f * std::sin(angle), y = -0.5f + 0.05f * i;
+            Part part = i % 2 == 0 ? BuildCylinder(x, y, z, 0.15f, 0.6f, 24, 8) : BuildBox(x, y, z, 0.12f);
+            part.material = i % 3;
+            parts.push_back(std::move(part));
+        }
+        return parts;
+    }
+
+    // Позиции пишутся с 9 значащими цифрами, чтобы float после разбора совпал с исходным
+    void WritePart(std::ofstream& file, const Part& part, size_t& vertexBase) {
+        file.precision(9);
+        file << "usemtl " << Materials[part.material].name << "\n";
+        for (const auto& vertex : part.vertices) file << "v " << vertex[0] << " " << vertex[1] << " " << vertex[2] << "\n";
+        for (const auto& vertex : part.vertices) file << "vn " << vertex[3] << " " << vertex[4] << " " << vertex[5] << "\n";
+        // Assimp переворачивает V (aiProcess_FlipUVs), поэтому в файл пишется 1 - v
+        for (const auto& vertex : part.vertices) file << "vt " << vertex[6] << " " << 1.0f - vertex[7] << "\n";
+        for (size_t i = 0; i < part.indices.size(); i += 3) {
+            file << "f";
+            for (size_t k = 0; k < 3; ++k) {
+                size_t index = vertexBase + part.indices[i + k] + 1;
+                file << " " << index << "/" << index << "/" << index;
+            }
+            file << "\n";
+        }
+        vertexBase += part.vertices.size();
+    }
+
+    bool WriteModels(const std::filesystem::path& directory, const std::vector<Part>& parts) {
+        std::ofstream mtl(directory / "prop.mtl");
+        for (const Material& material : Materials) {
+            mtl << "newmtl " << material.name << "\nKd 0.8 0.8 0.8\n";
+            if (*material.texture) mtl << "map_Kd " << material.texture << "\n";
+        }
+
+        std::ofstream merged(directory / "prop.obj");
+        merged << "mtllib prop.mtl\n";
+        size_t mergedBase = 0;
+        for (size_t i = 0; i < parts.size(); ++i) {
+            merged << "o part" << i << "\n";
+            WritePart(merged, parts[i], mergedBase);
+
+            std::ofstream single(directory / ("part" + std::to_string(i) + ".obj"));
+            single << "mtllib prop.mtl\no part" << i << "\n";
+            size_t singleBase = 0;
+            WritePart(single, parts[i], singleBase);
+            if (!single.good()) return false;
+        }
+        return mtl.good() && merged.good();
+    }
+
+    // Треугольник по позициям с точностью 1e-4, повёрнутый к наименьшей вершине: обход сохраняется
+    using Triangle = std::array<long, 9>;
+
+    Triangle Canonical(const float* a, const float* b, const float* c) {
+        std::array<std::array<long, 3>, 3> corners;
+        const float* points[3] = { a, b, c };
+        for (int k = 0; k < 3; ++k) {
+            for (int axis = 0; axis < 3; ++axis) corners[k][axis] = std::lround(points[k][axis] * 10000.0f);
+        }
+        int first = int(std::min_element(corners.begin(), corners.end()) - corners.begin());
+        Triangle triangle;
+        for (int k = 0; k < 3; ++k) {
+            for (int axis = 0; axis < 3; ++axis) triangle[k * 3 + axis] = corners[(first + k) % 3][axis];
+        }
+        return triangle;
+    }
+
+    uint32_t ReadIndex(const ModelLoader& loader, size_t i) {
+        if (loader.GetIndexSize() == sizeof(uint16_t)) return static_cast<const uint16_t*>(loader.GetIndexData())[i];
+        return static_cast<const uint32_t*>(loader.GetIndexData())[i];
+    }
+
+    bool CheckImport(const ModelLoader& loader, const std::vector<Part>& parts) {
+        size_t lodCount = loader.GetLodCount();
+        size_t materialCount = loader.GetMaterialCount();
+        if (lodCount == 0 || loader.GetSubmeshCount() % lodCount != 0) {
+            std::printf("FAIL: submesh table has %zu entries for %zu LOD levels\n", loader.GetSubmeshCount(), lodCount);
+            return false;
+        }
+        if (lodCount < 2) {
+            std::printf("FAIL: no simplified levels were built for the prop\n");
+            return false;
+        }
+        size_t submeshCount = loader.GetSubmeshCount() / lodCount;
+        if (materialCount != std::size(Materials) || submeshCount != std::size(Materials)) {
+            std::printf("FAIL: expected %zu materials and submeshes, got %zu and %zu\n", std::size(Materials), materialCount,
+                        submeshCount);
+            return false;
+        }
+
+        // Подмеши уровня идут подряд, покрывают его целиком и в том же порядке материалов, что у базового
+        const MeshLod* lods = loader.GetLodData();
+        const MeshSubmesh* submeshes = loader.GetSubmeshData();
+        for (size_t level = 0; level < lodCount; ++level) {
+            uint32_t next = lods[level].firstIndex;
+            for (size_t i = 0; i < submeshCount; ++i) {
+                const MeshSubmesh& submesh = submeshes[level * submeshCount + i];
+                if (submesh.firstIndex != next || submesh.indexCount % 3 != 0 || submesh.indexCount == 0 ||
+                    submesh.material >= materialCount || submesh.material != submeshes[i].material) {
+                    std::printf("FAIL: LOD %zu submesh %zu breaks the table layout\n", level, i);
+                    return false;
+                }
+                next += submesh.indexCount;
+            }
+            if (next != lods[level].firstIndex + lods[level].indexCount) {
+                std::printf("FAIL: LOD %zu submeshes do not cover the level\n", level);
+                return false;
+            }
+        }
+
+        // Базовый уровень: у каждого материала ровно треугольники его деталей
+        std::map<std::string, std::vector<Triangle>> expected;
+        for (const Part& part : parts) {
+            auto& triangles = expected[Materials[part.material].texture];
+            for (size_t i = 0; i < part.indices.size(); i += 3) {
+                triangles.push_back(Canonical(part.vertices[part.indices[i]].data(), part.vertices[part.indices[i + 1]].data(),
+                                              part.vertices[part.indices[i + 2]].data()));
+            }
+        }
+        const float* vertices = loader.GetVertexData();
+        for (size_t i = 0; i < submeshCount; ++i) {
+            const MeshSubmesh& submesh = submeshes[i];
+            std::vector<Triangle> actual;
+            for (uint32_t index = submesh.firstIndex; index < submesh.firstIndex + submesh.indexCount; index += 3) {
+                actual.push_back(Canonical(vertices + size_t(ReadIndex(loader, index)) * MeshCache::FloatsPerVertex,
+                                           vertices + size_t(ReadIndex(loader, index + 1)) * MeshCache::FloatsPerVertex,
+                                           vertices + size_t(ReadIndex(loader, index + 2)) * MeshCache::FloatsPerVertex));
+            }
+            std::vector<Triangle>& reference = expected[loader.GetMaterialTexture(submesh.material)];
+            std::sort(actual.begin(), actual.end());
+            std::sort(reference.begin(), reference.end());
+            if (actual != reference) {
+                std::printf("FAIL: submesh %zu (material '%s') has %zu triangles that differ from its parts (%zu)\n", i,
+                            loader.GetMaterialTexture(submesh.material).c_str(), actual.size(), reference.size());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool SameTables(const ModelLoader& a, const ModelLoader& b) {
+        if (a.GetMaterialCount() != b.GetMaterialCount() || a.GetSubmeshCount() != b.GetSubmeshCount()) return false;
+        for (size_t i = 0; i < a.GetMaterialCount(); ++i) {
+            if (a.GetMaterialTexture(i) != b.GetMaterialTexture(i)) return false;
+        }
+        return std::memcmp(a.GetSubmeshData(), b.GetSubmeshData(), a.GetSubmeshCount() * sizeof(MeshSubmesh)) == 0;
+    }
+
+    struct ModeResult {
+        RenderFrameStats stats;
+        double msPerFrame;
+    };
+
+    ModeResult RunMode(Render& render, NullRenderDevice& device, const KatamariWorld& world,
+                       const std::vector<MeshHandle>& bodyMeshes, const Ground& ground, bool instanced, int frames) {
+        render.SetInstancingEnabled(instanced);
+        render.SetCullingEnabled(false);
+        render.SetLodEnabled(false);
+        DirectX::XMMATRIX viewProj = DirectX::XMMatrixIdentity();
+        DirectX::XMFLOAT3 cameraPos(0.0f, 5.0f, -10.0f);
+        render.RenderScene(world.GetBodies(), bodyMeshes, &ground, viewProj, cameraPos);
+
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            render.RenderScene(world.GetBodies(), bodyMeshes, &ground, viewProj, cameraPos);
+        }
+        ModeResult result;
+        result.msPerFrame = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+        result.stats = device.GetFrameStats();
+        return result;
+    }
+
+    void Print(const char* name, size_t buffers, const ModeResult& result) {
+        std::printf("%-20s %8zu %10zu %10zu %12zu %10.3f\n", name, buffers, result.stats.drawCalls, result.stats.stateChanges,
+                    result.stats.primitives, result.msPerFrame);
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t props = 200;
+    int frames = 20;
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--check")) {
+            props = 20;
+            frames = 2;
+        } else if (positional == 0 && ++positional) {
+            props = std::strtoull(argv[i], nullptr, 10);
+        } else if (positional == 1 && ++positional) {
+            frames = std::atoi(argv[i]);
+        }
+    }
+    if (props == 0) props = 1;
+    if (frames <= 0) frames = 1;
+
+    std::error_code error;
+    std::filesystem::path directory = std::filesystem::temp_directory_path(error) / "katamari_multimesh";
+    std::filesystem::create_directories(directory, error);
+    std::vector<Part> parts = BuildProp();
+    if (error || !WriteModels(directory, parts)) {
+        std::printf("FAIL: could not write test models to %s\n", directory.string().c_str());
+        return 1;
+    }
+    std::string propPath = (directory / "prop.obj").string();
+    std::filesystem::remove(MeshCache::GetCachePath(propPath), error);
+
+    ModelLoader imported;
+    if (!imported.LoadModel(propPath, false)) {
+        std::printf("FAIL: could not import %s\n", propPath.c_str());
+        return 1;
+    }
+    if (!CheckImport(imported, parts)) return 1;
+
+    ModelLoader cached;
+    if (!cached.LoadModel(propPath) || !cached.LoadModel(propPath) || !cached.IsLoadedFromCache() ||
+        !SameTables(imported, cached) || !CheckImport(cached, parts)) {
+        std::printf("FAIL: submesh or material table did not survive the mesh cache\n");
+        return 1;
+    }
+
+    size_t submeshCount = imported.GetSubmeshCount() / imported.GetLodCount();
+    std::printf("prop: %zu parts, %zu materials, %zu submeshes per level, %zu LOD levels, %zu vertices, %zu-bit indices\n",
+                parts.size(), imported.GetMaterialCount(), submeshCount, imported.GetLodCount(),
+                imported.GetVertexFloatCount() / MeshCache::FloatsPerVertex, imported.GetIndexSize() * 8);
+
+    NullRenderDevice device;
+    Render render(device);
+    if (!render.Initialize()) return 1;
+    AssetLoader assetLoader(1);
+    Ground ground(device, assetLoader, "");
+
+    // Одинаковая сцена двумя способами: реквизит одним телом или каждая деталь отдельным телом из своего файла
+    KatamariWorld mergedWorld;
+    KatamariWorld partWorld;
+    std::mt19937 rng(15);
+    std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+    for (size_t i = 0; i < props; ++i) {
+        DirectX::XMFLOAT3 position(coordinate(rng), 0.5f, coordinate(rng));
+        DirectX::XMFLOAT4 color(1.0f, 1.0f, 1.0f, 1.0f);
+        DirectX::XMFLOAT3 emissive(0.0f, 0.0f, 0.0f);
+        mergedWorld.AddPickup(propPath, position, color, 0.5f, true, emissive);
+        for (size_t part = 0; part < parts.size(); ++part) {
+            partWorld.AddPickup((directory / ("part" + std::to_string(part) + ".obj")).string(), position, color, 0.5f, true,
+                                emissive);
+        }
+    }
+
+    std::vector<MeshHandle> mergedMeshes;
+    for (const auto& body : mergedWorld.GetBodies()) mergedMeshes.push_back(meshRegistry.Acquire(device, body->modelPath));
+    std::vector<MeshHandle> partMeshes;
+    for (const auto& body : partWorld.GetBodies()) partMeshes.push_back(meshRegistry.Acquire(device, body->modelPath));
+    for (const MeshHandle& mesh : mergedMeshes) {
+        if (!mesh || !mesh->IsReady()) {
+            std::printf("FAIL: merged prop could not be registered\n");
+            return 1;
+        }
+    }
+    for (const MeshHandle& mesh : partMeshes) {
+        if (!mesh || !mesh->IsReady()) {
+            std::printf("FAIL: a part model could not be registered\n");
+            return 1;
+        }
+    }
+
+    ModeResult mergedDirect = RunMode(render, device, mergedWorld, mergedMeshes, ground, false, frames);
+    ModeResult partDirect = RunMode(render, device, partWorld, partMeshes, ground, false, frames);
+    ModeResult mergedInstanced = RunMode(render, device, mergedWorld, mergedMeshes, ground, true, frames);
+    ModeResult partInstanced = RunMode(render, device, partWorld, partMeshes, ground, true, frames);
+
+    // Пол рисуется запасной плоскостью и даёт одинаковый вклад в обе сцены
+    std::printf("%zu props\n", props);
+    std::printf("%-20s %8s %10s %10s %12s %10s\n", "mode", "buffers", "draws", "states", "triangles", "ms/frame");
+    Print("merged per-body", 2, mergedDirect);
+    Print("parts per-body", 2 * parts.size(), partDirect);
+    Print("merged instanced", 2, mergedInstanced);
+    Print("parts instanced", 2 * parts.size(), partInstanced);
+
+    if (mergedDirect.stats.primitives != partDirect.stats.primitives ||
+        mergedInstanced.stats.primitives != partInstanced.stats.primitives) {
+        std::printf("FAIL: merged prop draws %zu triangles, separate parts draw %zu\n", mergedDirect.stats.primitives,
+                    partDirect.stats.primitives);
+        return 1;
+    }
+    if (mergedDirect.stats.drawCalls >= partDirect.stats.drawCalls ||
+        mergedInstanced.stats.drawCalls > submeshCount + 1) {
+        std::printf("FAIL: merged prop does not reduce draw calls\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,328 @@
+// Процедурное население мира без окна и GPU. Проверяет, что регионы порождаются одинаково по seed, что уснувший
+// и снова разбуженный регион возвращает все мячи, кроме подобранных, и что катамари, катящийся десятки километров,
+// держит постоянное число живых тел и время тика. В конце сравнивает тик в мире, где все мячи квадрата регионов
+// созданы сразу, с тиком того же мира через PickupSpawner.
+// Запуск: PickupSpawnBenchmark [километров=20] [--naive-regions N] [--check]
+#include "KatamariWorld.h"
+#include "PickupSpawner.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace {
+    using RegionCoord = std::pair<int32_t, int32_t>;
+
+    RegionCoord RegionOf(DirectX::XMFLOAT3 position) {
+        return RegionCoord(PickupSpawner::GetRegionCoord(position.x), PickupSpawner::GetRegionCoord(position.z));
+    }
+
+    bool SamePickups(const std::vector<PickupSpawn>& a, const std::vector<PickupSpawn>& b) {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (std::memcmp(&a[i].position, &b[i].position, sizeof(a[i].position)) != 0 ||
+                std::memcmp(&a[i].color, &b[i].color, sizeof(a[i].color)) != 0 || a[i].radius != b[i].radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint64_t RunScripted(uint32_t seed) {
+        KatamariWorld world;
+        world.AddDefaultKatamari();
+        PickupSpawner spawner(world, seed);
+        spawner.Update();
+        for (int tick = 0; tick < 6000; ++tick) {
+            KatamariInput input;
+            if (tick % 2000 < 1200) input.forward = true;
+            else input.right = true;
+            world.Step(input, 0.1f);
+            spawner.Update();
+        }
+        return world.ComputeStateHash();
+    }
+
+    bool CheckDeterminism() {
+        KatamariWorld worldA, worldB;
+        PickupSpawner a(worldA, 7), b(worldB, 7);
+        std::vector<PickupSpawn> first, second;
+        const int32_t regions[][2] = { { 0, 0 }, { -3, 5 }, { 40000, -40000 } };
+        for (const auto& region : regions) {
+            a.GenerateRegion(region[0], region[1], first);
+            b.GenerateRegion(region[0], region[1], second);
+            if (first.empty() || !SamePickups(first, second)) {
+                std::printf("FAIL: region (%d, %d) is not reproduced from the seed\n", region[0], region[1]);
+                return false;
+            }
+            for (const PickupSpawn& pickup : first) {
+                if (RegionOf(pickup.position) != RegionCoord(region[0], region[1])) {
+                    std::printf("FAIL: region (%d, %d) spawned a pickup outside itself\n", region[0], region[1]);
+                    return false;
+                }
+            }
+        }
+        uint64_t run = RunScripted(7), again = RunScripted(7), other = RunScripted(8);
+        if (run != again || run == other) {
+            std::printf("FAIL: state hashes %016llx / %016llx / %016llx (seed 7, seed 7, seed 8)\n",
+                        static_cast<unsigned long long>(run), static_cast<unsigned long long>(again),
+                        static_cast<unsigned long long>(other));
+            return false;
+        }
+        return true;
+    }
+
+    // Вперёд с подбором, в сторону так далеко, что регионы пути засыпают, и обратно
+    bool CheckRevisit() {
+        KatamariWorld world;
+        world.AddDefaultKatamari();
+        PickupSpawner spawner(world, 3);
+        spawner.Update();
+        std::vector<DirectX::XMFLOAT3> collected;
+        const struct { int ticks; int direction; } legs[] = { { 4000, 0 }, { 4000, 1 }, { 4000, 2 } };
+        size_t sleptBeforeReturn = 0;
+        for (const auto& leg : legs) {
+            if (leg.direction == 2) sleptBeforeReturn = spawner.GetSleptRegionCount();
+            for (int tick = 0; tick < leg.ticks; ++tick) {
+                KatamariInput input;
+                input.forward = leg.direction == 0;
+                input.right = leg.direction == 1;
+                input.left = leg.direction == 2;
+                world.Step(input, 0.1f);
+                for (const KatamariAttachEvent& event : world.GetAttachEvents()) {
+                    collected.push_back(world.GetBodies()[event.body]->GetPosition());
+                }
+                spawner.Update();
+            }
+        }
+        if (collected.empty() || sleptBeforeReturn == 0 || spawner.GetCollectedCount() != collected.size()) {
+            std::printf("FAIL: revisit run collected %zu, spawner counted %zu, slept %zu regions\n", collected.size(),
+                        spawner.GetCollectedCount(), sleptBeforeReturn);
+            return false;
+        }
+
+        // Каждый живой регион содержит ровно порождённые seed мячи без подобранных
+        std::map<RegionCoord, std::vector<DirectX::XMFLOAT3>> freeBodies;
+        const CelestialBody* katamari = world.GetKatamari();
+        size_t freeCount = 0;
+        for (const auto& body : world.GetBodies()) {
+            if (!body || body.get() == katamari || body->parent) continue;
+            freeBodies[RegionOf(body->GetPosition())].push_back(body->GetPosition());
+            ++freeCount;
+        }
+        if (freeCount != spawner.GetLivePickupCount()) {
+            std::printf("FAIL: %zu free bodies in the world, spawner tracks %zu\n", freeCount,
+                        spawner.GetLivePickupCount());
+            return false;
+        }
+        size_t restoredRegions = 0;
+        std::vector<PickupSpawn> generated;
+        for (const auto& entry : freeBodies) {
+            spawner.GenerateRegion(entry.first.first, entry.first.second, generated);
+            size_t expected = 0, collectedHere = 0;
+            for (const PickupSpawn& pickup : generated) {
+                DirectX::XMFLOAT3 spawn = pickup.position;
+                bool wasCollected = false;
+                for (const DirectX::XMFLOAT3& p : collected) {
+                    if (std::fabs(p.x - spawn.x) < 1e-4f && std::fabs(p.z - spawn.z) < 1e-4f) wasCollected = true;
+                }
+                bool present = false;
+                for (const DirectX::XMFLOAT3& p : entry.second) {
+                    if (std::fabs(p.x - spawn.x) < 1e-4f && std::fabs(p.z - spawn.z) < 1e-4f) present = true;
+                }
+                if (present == wasCollected) {
+                    std::printf("FAIL: region (%d, %d) pickup at %.2f, %.2f is %s\n", entry.first.first,
+                                entry.first.second, spawn.x, spawn.z,
+                                wasCollected ? "back after being collected" : "missing after waking");
+                    return false;
+                }
+                if (wasCollected) ++collectedHere;
+                else ++expected;
+            }
+            if (entry.second.size() != expected) {
+                std::printf("FAIL: region (%d, %d) holds %zu bodies, expected %zu\n", entry.first.first,
+                            entry.first.second, entry.second.size(), expected);
+                return false;
+            }
+            if (collectedHere) ++restoredRegions;
+        }
+        if (restoredRegions == 0) {
+            std::printf("FAIL: no region with collected pickups was woken again\n");
+            return false;
+        }
+        std::printf("revisit: %zu collected, %zu regions woken again without them, %zu dormant records\n",
+                    collected.size(), restoredRegions, spawner.GetDormantRecordCount());
+        return true;
+    }
+
+    struct Segment {
+        double ms = 0.0;
+        double spawnerMs = 0.0;
+        double maxMs = 0.0;
+        size_t ticks = 0;
+        size_t maxLive = 0;
+        size_t maxSlots = 0;
+        size_t attached = 0;
+        size_t woken = 0;
+        size_t dormant = 0;
+    };
+
+    // Все мячи квадрата regions x regions живут сразу; возвращает мс на тик
+    double TimeNaiveWorld(int32_t regions, size_t& pickups) {
+        KatamariWorld world;
+        world.AddDefaultKatamari();
+        PickupSpawner generator(world, 1);
+        std::vector<PickupSpawn> generated;
+        pickups = 0;
+        for (int32_t z = -regions / 2; z < regions - regions / 2; ++z) {
+            for (int32_t x = -regions / 2; x < regions - regions / 2; ++x) {
+                generator.GenerateRegion(x, z, generated);
+                for (const PickupSpawn& pickup : generated) {
+                    world.AddPickup("Textures/soccer_ball.obj", pickup.position, pickup.color, pickup.radius, true,
+                                    pickup.emissiveColor);
+                }
+                pickups += generated.size();
+            }
+        }
+        const int ticks = 300;
+        auto start = std::chrono::steady_clock::now();
+        for (int tick = 0; tick < ticks; ++tick) {
+            KatamariInput input;
+            input.forward = true;
+            world.Step(input, 0.1f);
+        }
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / ticks;
+    }
+
+    double TimeSpawnerWorld(size_t& live) {
+        KatamariWorld world;
+        world.AddDefaultKatamari();
+        PickupSpawner spawner(world, 1);
+        spawner.Update();
+        const int ticks = 300;
+        auto start = std::chrono::steady_clock::now();
+        for (int tick = 0; tick < ticks; ++tick) {
+            KatamariInput input;
+            input.forward = true;
+            world.Step(input, 0.1f);
+            spawner.Update();
+        }
+        live = world.GetLiveBodyCount();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / ticks;
+    }
+}
+
+int main(int argc, char** argv) {
+    double kilometres = 20.0;
+    int32_t naiveRegions = 160;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--naive-regions") && i + 1 < argc) naiveRegions = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--check")) {
+            kilometres = 2.0;
+            naiveRegions = 40;
+        } else {
+            kilometres = std::atof(argv[i]);
+        }
+    }
+    if (kilometres <= 0.0) kilometres = 1.0;
+    if (naiveRegions < 1) naiveRegions = 1;
+    // Тики идут без PROFILE_FRAME; зоны не пишутся, чтобы рост буферов профайлера не попадал в замер
+    profiler.SetEnabled(false);
+
+    if (!CheckDeterminism()) return 1;
+    std::printf("regions reproduced from the seed, scripted runs deterministic: OK\n");
+    if (!CheckRevisit()) return 1;
+
+    TerrainHeightfield heightfield;
+    KatamariWorld world;
+    world.SetGround(&heightfield);
+    world.AddDefaultKatamari();
+    PickupSpawner spawner(world, 1);
+    spawner.Update();
+
+    // Шаг 0.1 с при скорости 5 м/с - 0.5 м за тик
+    const float deltaTime = 0.1f;
+    const double metresPerTick = 0.5;
+    size_t totalTicks = static_cast<size_t>(kilometres * 1000.0 / metresPerTick);
+    size_t ticksPerKm = static_cast<size_t>(1000.0 / metresPerTick);
+    std::vector<Segment> segments(static_cast<size_t>(std::ceil(kilometres)));
+    for (size_t tick = 0; tick < totalTicks; ++tick) {
+        // Первая половина пути - вперёд, вторая - вправо
+        KatamariInput input;
+        if (tick < totalTicks / 2) input.forward = true;
+        else input.right = true;
+
+        size_t wokenBefore = spawner.GetWokenRegionCount();
+        auto start = std::chrono::steady_clock::now();
+        world.Step(input, deltaTime);
+        auto stepped = std::chrono::steady_clock::now();
+        spawner.Update();
+        auto end = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+        Segment& segment = segments[std::min(tick / ticksPerKm, segments.size() - 1)];
+        segment.ms += ms;
+        segment.spawnerMs += std::chrono::duration<double, std::milli>(end - stepped).count();
+        segment.maxMs = std::max(segment.maxMs, ms);
+        ++segment.ticks;
+        segment.maxLive = std::max(segment.maxLive, spawner.GetLivePickupCount());
+        segment.maxSlots = std::max(segment.maxSlots, world.GetBodies().size());
+        segment.attached = world.GetKatamari()->GetChildren().size();
+        segment.woken += spawner.GetWokenRegionCount() - wokenBefore;
+        segment.dormant = spawner.GetDormantRecordCount();
+    }
+
+    std::printf("km   ms/tick  spawner ms   max ms  live pickups  body slots  attached  regions woken  dormant records\n");
+    for (size_t i = 0; i < segments.size(); ++i) {
+        const Segment& s = segments[i];
+        if (!s.ticks) continue;
+        std::printf("%-4zu %7.4f %11.5f %8.3f %13zu %11zu %9zu %14zu %16zu\n", i + 1, s.ms / s.ticks,
+                    s.spawnerMs / s.ticks, s.maxMs, s.maxLive, s.maxSlots, s.attached, s.woken, s.dormant);
+    }
+    size_t regionsTouched = spawner.GetWokenRegionCount();
+    std::printf("regions woken %zu, slept %zu; about %zu pickups generated along the way, %zu collected\n",
+                regionsTouched, spawner.GetSleptRegionCount(),
+                regionsTouched * (spawner.GetPickupsPerRegion() * 3 / 4), spawner.GetCollectedCount());
+
+    bool ok = true;
+    // Живых мячей не больше, чем вмещают регионы радиуса с запасным кольцом
+    size_t side = 2 * spawner.GetActiveRadius() + 3;
+    size_t liveBound = side * side * spawner.GetPickupsPerRegion();
+    const Segment& first = segments.size() > 1 ? segments[1] : segments[0];
+    const Segment& last = segments.back();
+    for (const Segment& s : segments) {
+        if (s.maxLive > liveBound || s.maxSlots > liveBound + s.attached + 1) {
+            std::printf("FAIL: %zu live pickups in %zu body slots, bound %zu\n", s.maxLive, s.maxSlots, liveBound);
+            ok = false;
+            break;
+        }
+    }
+    // Тик дорожает с ростом кучи на катамари (её узлы пересчитываются каждый тик), но не с размером мира:
+    // живых мячей столько же, а обслуживание регионов не зависит от пройденного пути
+    if (last.ticks && first.ticks && last.spawnerMs / last.ticks > 1.5 * first.spawnerMs / first.ticks + 0.002) {
+        std::printf("FAIL: spawner time grew from %.5f to %.5f ms per tick over the run\n",
+                    first.spawnerMs / first.ticks, last.spawnerMs / last.ticks);
+        ok = false;
+    }
+
+    size_t naivePickups = 0, spawnerLive = 0;
+    double naiveMs = TimeNaiveWorld(naiveRegions, naivePickups);
+    double spawnerMs = TimeSpawnerWorld(spawnerLive);
+    std::printf("all %zu pickups of %dx%d regions live: %.4f ms/tick; spawner, unbounded world, %zu live bodies: "
+                "%.4f ms/tick (%.1fx)\n", naivePickups, naiveRegions, naiveRegions, naiveMs, spawnerLive, spawnerMs,
+                spawnerMs > 0.0 ? naiveMs / spawnerMs : 0.0);
+    // Тик полного мира не платит за лежащие мячи, поэтому на малом квадрате оба тика - доли микросекунды;
+    // проваливается только заметное отставание спавнера, как у проверки времени спавнера выше
+    if (naivePickups > 10 * spawnerLive && spawnerMs > 1.5 * naiveMs + 0.002) {
+        std::printf("FAIL: the spawner world ticks slower than the fully materialized one\n");
+        ok = false;
+    }
+    std::printf(ok ? "OK\n" : "FAILED\n");
+    return ok ? 0 : 1;
+}
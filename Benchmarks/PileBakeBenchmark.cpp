@@ -0,0 +1,275 @@
+// Запекание кучи: N тел, прикреплённых к катамари, рисуются по вызову на тело, инстансно и запечёнными кусками.
+// На NullRenderDevice считает вызовы отрисовки, байты загрузки и время кадра на CPU, на программном растеризаторе
+// сверяет кадры попиксельно до и после того, как катамари прокатился с кучей.
+// Запуск: PileBakeBenchmark [число тел в куче] [число кадров] [--max-draw-calls N] [--check]
+#include "NullRenderDevice.h"
+#include "SoftwareRenderDevice.h"
+#include "Render.h"
+#include "Ground.h"
+#include "KatamariWorld.h"
+#include "MeshRegistry.h"
+#include "PileBaker.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <objbase.h>
+#endif
+
+namespace {
+    const DirectX::XMFLOAT4 PileColors[] = {
+        DirectX::XMFLOAT4(1.0f, 0.3f, 0.3f, 1.0f), DirectX::XMFLOAT4(0.3f, 1.0f, 0.3f, 1.0f),
+        DirectX::XMFLOAT4(0.3f, 0.3f, 1.0f, 1.0f), DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f)
+    };
+
+    enum class Mode {
+        PerBody,
+        Instanced,
+        Baked
+    };
+
+    const char* ModeName(Mode mode) {
+        return mode == Mode::PerBody ? "per-body" : mode == Mode::Instanced ? "instanced" : "baked";
+    }
+
+    // Сцена по умолчанию и куча из pileSize тел на поверхности катамари: четыре цвета, каждое четвёртое тело с текстурой
+    struct PileScene {
+        KatamariWorld world;
+        std::vector<MeshHandle> bodyMeshes;
+    };
+
+    bool BuildPileScene(PileScene& scene, RenderDevice& device, size_t pileSize) {
+        KatamariWorld& world = scene.world;
+        world.PopulateDefaultScene();
+        std::mt19937 rng(7);
+        std::normal_distribution<float> direction(0.0f, 1.0f);
+        std::uniform_real_distribution<float> size(0.08f, 0.2f);
+        DirectX::XMFLOAT3 center = world.GetKatamari()->GetPosition();
+        float katamariRadius = world.GetKatamari()->radius;
+        for (size_t i = 0; i < pileSize; ++i) {
+            DirectX::XMVECTOR normal = DirectX::XMVector3Normalize(
+                DirectX::XMVectorSet(direction(rng), direction(rng), direction(rng), 0.0f));
+            float radius = size(rng);
+            DirectX::XMFLOAT3 position;
+            DirectX::XMStoreFloat3(&position, DirectX::XMVectorAdd(DirectX::XMLoadFloat3(&center),
+                                                                   DirectX::XMVectorScale(normal, katamariRadius + radius * 0.5f)));
+            uint32_t body = world.AddPickup("Textures/soccer_ball.obj", position, PileColors[i % 4], radius, i % 4 == 0,
+                                            DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f));
+            world.GetKatamari()->AttachChild(world.GetBodies()[body].get());
+        }
+        world.Step(KatamariInput());
+
+        // Float32 у всех тел: запечённые куски хранятся во float, и кадры сравниваются без ошибки квантования
+        for (const auto& body : world.GetBodies()) {
+            scene.bodyMeshes.push_back(meshRegistry.Acquire(device, body->modelPath));
+            if (!scene.bodyMeshes.back() || !scene.bodyMeshes.back()->IsReady()) {
+                std::printf("FAIL: body mesh could not be loaded (run from the directory containing Textures/)\n");
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Все прикреплённые тела запекаются; возвращает число пачек и наибольшее время выгрузки пачки на главном потоке
+    bool BakeAll(PileBaker& baker, AssetLoader& assetLoader, PileScene& scene, size_t& batches, double& maxUploadMs) {
+        batches = 0;
+        maxUploadMs = 0.0;
+        for (int frame = 0; frame < 100000; ++frame) {
+            baker.Update(scene.world.GetBodies(), scene.bodyMeshes, scene.world.GetKatamariIndex());
+            if (baker.GetPendingBodyCount() == 0) return true;
+            // Ждём пачку с рабочего потока; выгрузка на главном потоке замеряется отдельно
+            while (true) {
+                auto start = std::chrono::steady_clock::now();
+                if (assetLoader.PumpUploads(AssetUploadBudget{ 1e9, size_t(-1) }) > 0) {
+                    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                    maxUploadMs = std::max(maxUploadMs, ms);
+                    ++batches;
+                    break;
+                }
+                std::this_thread::yield();
+            }
+        }
+        std::printf("FAIL: %zu bodies were never baked\n", baker.GetPendingBodyCount());
+        return false;
+    }
+
+    void SetMode(Render& render, PileBaker& baker, Mode mode) {
+        render.SetInstancingEnabled(mode != Mode::PerBody);
+        render.SetPileBaker(mode == Mode::Baked ? &baker : nullptr);
+    }
+
+    struct ModeResult {
+        RenderFrameStats stats;
+        double msPerFrame;
+    };
+
+    ModeResult MeasureMode(Render& render, PileBaker& baker, NullRenderDevice& device, PileScene& scene,
+                           const Ground& ground, Mode mode, int frames) {
+        SetMode(render, baker, mode);
+        FollowCamera& camera = scene.world.GetCamera();
+        DirectX::XMMATRIX viewProj = camera.GetViewProjMatrix();
+        DirectX::XMFLOAT3 cameraPos = camera.GetPosition();
+
+        // Первый кадр прогревает буфер экземпляров
+        render.RenderScene(scene.world.GetBodies(), scene.bodyMeshes, &ground, viewProj, cameraPos);
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            render.RenderScene(scene.world.GetBodies(), scene.bodyMeshes, &ground, viewProj, cameraPos);
+        }
+        ModeResult result;
+        result.msPerFrame = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+        result.stats = device.GetFrameStats();
+        return result;
+    }
+
+    std::vector<uint32_t> RenderImage(Render& render, PileBaker& baker, SoftwareRenderDevice& device, PileScene& scene,
+                                      const Ground& ground, Mode mode) {
+        SetMode(render, baker, mode);
+        // Камера мира отъезжает на два метра за каждое тело кучи; кадр снимается вплотную к катамари
+        DirectX::XMFLOAT3 target = scene.world.GetKatamari()->GetPosition();
+        FollowCamera camera(DirectX::XMFLOAT3(target.x + 1.5f, target.y + 2.0f, target.z - 4.0f), target);
+        render.RenderScene(scene.world.GetBodies(), scene.bodyMeshes, &ground, camera.GetViewProjMatrix(),
+                           camera.GetPosition());
+        std::vector<uint32_t> pixels;
+        for (uint32_t y = 0; y < device.GetHeight(); ++y) {
+            for (uint32_t x = 0; x < device.GetWidth(); ++x) pixels.push_back(device.GetPixel(x, y));
+        }
+        return pixels;
+    }
+
+    // Вершины куска посчитаны на CPU одной матрицей вместо двух на GPU: расходятся лишь отдельные пиксели силуэтов
+    bool CompareImages(const char* label, const std::vector<uint32_t>& expected, const std::vector<uint32_t>& actual,
+                       size_t covered) {
+        size_t differing = 0;
+        for (size_t i = 0; i < expected.size(); ++i) {
+            int maxDelta = 0;
+            for (int shift = 0; shift < 24; shift += 8) {
+                int a = (expected[i] >> shift) & 0xFF, b = (actual[i] >> shift) & 0xFF;
+                maxDelta = std::max(maxDelta, std::abs(a - b));
+            }
+            if (maxDelta > 8) ++differing;
+        }
+        std::printf("%s: pixels differing by more than 8/255: %zu of %zu covered\n", label, differing, covered);
+        if (covered == 0 || differing * 200 > covered) {
+            std::printf("FAIL: baked pile changes more than 0.5%% of the covered pixels\n");
+            return false;
+        }
+        return true;
+    }
+
+    bool CheckImages(size_t pileSize) {
+#ifdef _WIN32
+        AssetLoader assetLoader(1, [] { CoInitializeEx(nullptr, COINIT_MULTITHREADED); });
+#else
+        AssetLoader assetLoader(1);
+#endif
+        SoftwareRenderDevice device(800, 600);
+        Render render(device);
+        if (!render.Initialize()) return false;
+        render.SetLodEnabled(false); // куски запекаются из базового уровня
+        Ground ground(device, assetLoader, "Textures/ground.obj");
+        assetLoader.Flush();
+        assetLoader.PumpUploads(AssetUploadBudget{ 1e9, size_t(-1) });
+
+        PileScene scene;
+        if (!BuildPileScene(scene, device, pileSize)) return false;
+        PileBaker baker(device, assetLoader);
+        size_t batches = 0;
+        double maxUploadMs = 0.0;
+        if (!BakeAll(baker, assetLoader, scene, batches, maxUploadMs)) return false;
+
+        std::vector<uint32_t> expected = RenderImage(render, baker, device, scene, ground, Mode::Instanced);
+        size_t covered = device.CountCoveredPixels();
+        if (!CompareImages("at rest", expected, RenderImage(render, baker, device, scene, ground, Mode::Baked), covered)) {
+            return false;
+        }
+
+        // Куча катится вместе с катамари: куски следуют за мировой матрицей корня без перезапекания
+        KatamariInput input;
+        input.forward = true;
+        input.left = true;
+        for (int tick = 0; tick < 45; ++tick) scene.world.Step(input);
+        expected = RenderImage(render, baker, device, scene, ground, Mode::Instanced);
+        covered = device.CountCoveredPixels();
+        return CompareImages("after rolling", expected, RenderImage(render, baker, device, scene, ground, Mode::Baked),
+                             covered);
+    }
+}
+
+int main(int argc, char** argv) {
+#ifdef _WIN32
+    CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+#endif
+    size_t pileSize = 2000;
+    int frames = 50;
+    size_t maxDrawCalls = 0;
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--max-draw-calls") && i + 1 < argc) maxDrawCalls = std::strtoull(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "--check")) {
+            pileSize = 200;
+            frames = 2;
+        } else if (positional == 0 && ++positional) pileSize = std::strtoull(argv[i], nullptr, 10);
+        else if (positional == 1 && ++positional) frames = std::atoi(argv[i]);
+    }
+    if (frames <= 0) frames = 1;
+
+    // Меши реестра привязаны к устройству, на котором созданы: сверка кадров идёт первой и освобождает свои
+    if (!CheckImages(std::min<size_t>(pileSize, 500))) return 1;
+
+    NullRenderDevice device;
+    Render render(device);
+    if (!render.Initialize()) return 1;
+    // Сравнивается вся куча: без отсечения и уровней детализации треугольников в кадре столько же, сколько в кусках
+    render.SetLodEnabled(false);
+    render.SetCullingEnabled(false);
+    AssetLoader assetLoader(1);
+    Ground ground(device, assetLoader, "Textures/ground.obj");
+    assetLoader.Flush();
+    assetLoader.PumpUploads(AssetUploadBudget{ 1e9, size_t(-1) });
+
+    PileScene scene;
+    if (!BuildPileScene(scene, device, pileSize)) return 1;
+    PileBaker baker(device, assetLoader);
+    size_t batches = 0;
+    double maxUploadMs = 0.0;
+    auto bakeStart = std::chrono::steady_clock::now();
+    if (!BakeAll(baker, assetLoader, scene, batches, maxUploadMs)) return 1;
+    double bakeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - bakeStart).count();
+    if (baker.GetBakedBodyCount() != pileSize) {
+        std::printf("FAIL: %zu of %zu pile bodies baked\n", baker.GetBakedBodyCount(), pileSize);
+        return 1;
+    }
+
+    ModeResult results[3];
+    const Mode modes[] = { Mode::PerBody, Mode::Instanced, Mode::Baked };
+    for (int i = 0; i < 3; ++i) results[i] = MeasureMode(render, baker, device, scene, ground, modes[i], frames);
+
+    std::printf("pile: %zu bodies, baked in %.1f ms, %zu batches of up to %zu, slowest upload %.2f ms, %zu chunks\n",
+                pileSize, bakeMs, batches, baker.GetBatchSize(), maxUploadMs, baker.GetChunks().size());
+    std::printf("%-10s %10s %12s %14s %10s\n", "mode", "draws", "primitives", "bytes uploaded", "ms/frame");
+    for (int i = 0; i < 3; ++i) {
+        std::printf("%-10s %10zu %12zu %14zu %10.3f\n", ModeName(modes[i]), results[i].stats.drawCalls,
+                    results[i].stats.primitives, results[i].stats.bytesUploaded, results[i].msPerFrame);
+    }
+
+    // Запечённые куски несут те же треугольники, что и тела по отдельности
+    const ModeResult& baked = results[2];
+    if (baked.stats.primitives != results[0].stats.primitives) {
+        std::printf("FAIL: baked frame has %zu primitives, per-body frame %zu\n", baked.stats.primitives,
+                    results[0].stats.primitives);
+        return 1;
+    }
+    if (maxDrawCalls && baked.stats.drawCalls > maxDrawCalls) {
+        std::printf("FAIL: %zu draw calls exceed the limit of %zu\n", baked.stats.drawCalls, maxDrawCalls);
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
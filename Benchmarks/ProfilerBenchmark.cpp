@@ -0,0 +1,270 @@
+// Профайлер зон: стоимость одной зоны (включённой и выключенной при запуске), проверка вложенности
+// зон по потокам, перцентилей на известных длительностях, окна статистики постоянного размера
+// и корректности трассы Chrome.
+// Запуск: ProfilerBenchmark [число зон] [--check]
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+#if KATAMARI_PROFILER
+    void SpinFor(int64_t nanoseconds) {
+        int64_t end = profiler.Now() + nanoseconds;
+        while (profiler.Now() < end) {
+        }
+    }
+
+    const ProfileZoneStats* FindZone(const std::vector<ProfileZoneStats>& stats, const char* name) {
+        for (const ProfileZoneStats& zone : stats) {
+            if (zone.name == name) return &zone;
+        }
+        return nullptr;
+    }
+
+    // Кадр i длится не меньше (i + 1) * 100 мкс во внешней зоне. Вытеснение потока удлиняет кадры,
+    // поэтому статистика сверяется ещё и с замером вокруг зоны: он длиннее зоны лишь на пару вызовов таймера
+    bool CheckStatistics() {
+        profiler.Reset();
+        profiler.SetEnabled(true);
+        std::vector<double> around;
+        for (int frame = 0; frame < 100; ++frame) {
+            int64_t start = profiler.Now();
+            {
+                PROFILE_ZONE("Outer");
+                SpinFor((frame + 1) * 100000);
+                PROFILE_ZONE("Inner");
+                PROFILE_ZONE("Inner");
+            }
+            around.push_back((profiler.Now() - start) / 1e6);
+            PROFILE_FRAME();
+        }
+
+        std::vector<ProfileZoneStats> stats = profiler.GetZoneStats();
+        const ProfileZoneStats* outer = FindZone(stats, "Outer");
+        const ProfileZoneStats* inner = FindZone(stats, "Inner");
+        const ProfileZoneStats* frame = FindZone(stats, "Frame");
+        if (!outer || !inner || !frame || profiler.GetFrameCount() != 100) {
+            std::printf("FAIL: expected Outer, Inner and Frame zones over 100 frames\n");
+            return false;
+        }
+        // Ближайший ранг по тем же кадрам: замер вокруг зоны не короче зоны ни в одном кадре,
+        // значит, и его порядковые статистики не меньше; ошибка ранга сдвинула бы значение на соседний кадр
+        std::sort(around.begin(), around.end());
+        double aroundMean = 0.0;
+        for (double ms : around) aroundMean += ms / around.size();
+        auto rank = [&around](double fraction) { return around[static_cast<size_t>(std::ceil(fraction * 100)) - 1]; };
+        auto near = [](double measured, double expected, double bound) {
+            return measured >= bound && measured <= expected + 1e-3 && measured > expected - 0.05;
+        };
+        if (!near(outer->p50Ms, rank(0.50), 5.0) || !near(outer->p95Ms, rank(0.95), 9.5) ||
+            !near(outer->p99Ms, rank(0.99), 9.9) || !near(outer->maxMs, around.back(), 10.0) ||
+            !near(outer->meanMs, aroundMean, 5.05)) {
+            std::printf("FAIL: Outer stats mean=%.3f p50=%.3f p95=%.3f p99=%.3f max=%.3f, "
+                        "measured around the zone mean=%.3f p50=%.3f p95=%.3f p99=%.3f max=%.3f\n", outer->meanMs,
+                        outer->p50Ms, outer->p95Ms, outer->p99Ms, outer->maxMs, aroundMean, rank(0.50), rank(0.95),
+                        rank(0.99), around.back());
+            return false;
+        }
+        if (std::fabs(inner->callsPerFrame - 2.0) > 1e-9 || std::fabs(outer->callsPerFrame - 1.0) > 1e-9 ||
+            frame->meanMs < outer->meanMs) {
+            std::printf("FAIL: calls per frame Outer=%.2f Inner=%.2f, frame %.3f ms\n", outer->callsPerFrame,
+                        inner->callsPerFrame, frame->meanMs);
+            return false;
+        }
+        return true;
+    }
+
+    // Долгая игра: память истории кадров не растёт, а статистика видит только последние кадры окна
+    bool CheckBoundedHistory() {
+        profiler.Reset();
+        profiler.SetEnabled(true);
+        profiler.SetTraceCapacity(0);
+        profiler.SetHistoryFrames(100);
+        for (int frame = 0; frame < 100; ++frame) {
+            {
+                PROFILE_ZONE("Windowed");
+                SpinFor(1000000);
+            }
+            PROFILE_FRAME();
+        }
+        for (int frame = 0; frame < 100; ++frame) {
+            PROFILE_ZONE("Windowed");
+            PROFILE_FRAME();
+        }
+        std::vector<ProfileZoneStats> stats = profiler.GetZoneStats();
+        const ProfileZoneStats* windowed = FindZone(stats, "Windowed");
+        if (!windowed || windowed->maxMs >= 0.5) {
+            std::printf("FAIL: slow frames outside the window still count, max=%.3f ms\n", windowed ? windowed->maxMs : 0.0);
+            return false;
+        }
+
+        const int totalFrames = 200000;
+        profiler.Reset();
+        profiler.SetHistoryFrames(1024);
+        size_t warmBytes = 0;
+        for (int frame = 0; frame < totalFrames; ++frame) {
+            {
+                PROFILE_ZONE("Update");
+                PROFILE_ZONE("Collide");
+            }
+            PROFILE_FRAME();
+            if (frame == 2000) warmBytes = profiler.GetHistoryBytes();
+        }
+        size_t finalBytes = profiler.GetHistoryBytes();
+        profiler.SetTraceCapacity(256 * 1024);
+        if (profiler.GetFrameCount() != static_cast<size_t>(totalFrames) || warmBytes == 0 || finalBytes != warmBytes) {
+            std::printf("FAIL: history grew from %zu to %zu bytes over %zu frames\n", warmBytes, finalBytes,
+                        profiler.GetFrameCount());
+            return false;
+        }
+        std::printf("history: %zu bytes after 2000 frames, %zu after %d\n", warmBytes, finalBytes, totalFrames);
+        return true;
+    }
+
+    struct ParsedEvent {
+        std::string name;
+        uint32_t tid;
+        double ts;
+        double dur;
+    };
+
+    // Разбор только того, что пишет WriteChromeTrace: по событию "X" на строку
+    bool ParseTrace(const std::string& path, std::vector<ParsedEvent>& events, size_t& metadata) {
+        std::ifstream file(path);
+        std::string line;
+        if (!std::getline(file, line) || line != "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[") return false;
+        metadata = 0;
+        bool closed = false;
+        while (std::getline(file, line)) {
+            if (line == "]}") {
+                closed = true;
+                break;
+            }
+            if (line.back() == ',') line.pop_back();
+            if (line.find("\"ph\":\"M\"") != std::string::npos) {
+                ++metadata;
+                continue;
+            }
+            char name[64];
+            ParsedEvent event;
+            if (std::sscanf(line.c_str(), "{\"name\":\"%63[^\"]\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%lf,\"dur\":%lf}",
+                            name, &event.tid, &event.ts, &event.dur) != 4) {
+                std::printf("FAIL: malformed trace line: %s\n", line.c_str());
+                return false;
+            }
+            event.name = name;
+            events.push_back(event);
+        }
+        return closed;
+    }
+
+    // Зоны нескольких потоков: у каждого потока дочерняя зона лежит внутри родительской
+    bool CheckThreadsAndTrace() {
+        profiler.Reset();
+        profiler.SetEnabled(true);
+        const int threadCount = 4;
+        const int iterations = 50;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threadCount; ++t) {
+            threads.emplace_back([t] {
+                profiler.SetThreadName("Worker \"" + std::to_string(t) + "\"");
+                for (int i = 0; i < iterations; ++i) {
+                    PROFILE_ZONE("Parent");
+                    SpinFor(2000);
+                    {
+                        PROFILE_ZONE("Child");
+                        SpinFor(2000);
+                    }
+                }
+            });
+        }
+        for (std::thread& thread : threads) thread.join();
+        PROFILE_FRAME();
+
+        std::string path = (std::filesystem::temp_directory_path() / "katamari_profiler_trace.json").string();
+        if (!profiler.WriteChromeTrace(path)) {
+            std::printf("FAIL: cannot write %s\n", path.c_str());
+            return false;
+        }
+        std::vector<ParsedEvent> events;
+        size_t metadata = 0;
+        if (!ParseTrace(path, events, metadata)) {
+            std::printf("FAIL: trace %s is not the expected JSON\n", path.c_str());
+            return false;
+        }
+
+        size_t parents = 0, children = 0;
+        for (const ParsedEvent& child : events) {
+            if (child.name == "Parent") ++parents;
+            if (child.name != "Child") continue;
+            ++children;
+            bool nested = false;
+            for (const ParsedEvent& parent : events) {
+                if (parent.name == "Parent" && parent.tid == child.tid && parent.ts <= child.ts &&
+                    child.ts + child.dur <= parent.ts + parent.dur + 1e-3) {
+                    nested = true;
+                    break;
+                }
+            }
+            if (!nested) {
+                std::printf("FAIL: Child zone at %.3f us on thread %u has no enclosing Parent\n", child.ts, child.tid);
+                return false;
+            }
+        }
+        if (parents != threadCount * iterations || children != threadCount * iterations ||
+            metadata < static_cast<size_t>(threadCount)) {
+            std::printf("FAIL: trace has %zu Parent, %zu Child, %zu thread names\n", parents, children, metadata);
+            return false;
+        }
+        return true;
+    }
+
+#endif
+    // Кадры по 1000 зон: буфер потока после первого кадра уже не растёт
+    double MeasureZone(int zones) {
+        const int zonesPerFrame = 1000;
+        double ns = 0.0;
+        int measured = 0;
+        for (; measured < zones; measured += zonesPerFrame) {
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < zonesPerFrame; ++i) {
+                PROFILE_ZONE("Measured");
+            }
+            ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            PROFILE_FRAME();
+        }
+        return ns / measured;
+    }
+}
+
+int main(int argc, char** argv) {
+    int zones = 1000000;
+    for (int i = 1; i < argc; ++i) zones = std::strcmp(argv[i], "--check") ? std::atoi(argv[i]) : 10000;
+    if (zones <= 0) zones = 1;
+
+#if KATAMARI_PROFILER
+    if (!CheckStatistics() || !CheckBoundedHistory() || !CheckThreadsAndTrace()) return 1;
+#else
+    std::printf("profiler zones are compiled out (KATAMARI_PROFILER=0), checks skipped\n");
+#endif
+
+    profiler.Reset();
+    profiler.SetTraceCapacity(0);
+    profiler.SetEnabled(true);
+    double enabledNs = MeasureZone(zones);
+    profiler.SetEnabled(false);
+    double disabledNs = MeasureZone(zones);
+    std::printf("%12s %12s %14s\n", "zones", "enabled ns", "disabled ns");
+    std::printf("%12d %12.2f %14.2f\n", zones, enabledNs, disabledNs);
+    std::printf("OK\n");
+    return 0;
+}
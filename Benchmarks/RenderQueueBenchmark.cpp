@@ -0,0 +1,254 @@
+// Очередь отрисовки: порядок полей ключа, сортировка очереди против std::stable_sort на 1k, 10k, 100k и 1M вызовов,
+// отбрасывание повторных заявок и отправка сцены из мячей с float- и сжатыми вершинами через NullRenderDevice
+// с сортировкой и без неё. Любая ошибка сверки - ненулевой код выхода.
+// Запуск: RenderQueueBenchmark [число мячей] [число кадров] [--check]
+#include "RenderQueue.h"
+#include "NullRenderDevice.h"
+#include "Render.h"
+#include "Ground.h"
+#include "KatamariWorld.h"
+#include "MeshRegistry.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+    bool CheckKeys() {
+        // Старшее поле решает при любых младших
+        uint64_t low = RenderQueue::MakeKey(0, 63, 65535, 65535, 1e30f);
+        uint64_t high = RenderQueue::MakeKey(1, 0, 0, 0, 0.0f);
+        if (!(low < high)) {
+            std::printf("FAIL: pass does not dominate the rest of the key\n");
+            return false;
+        }
+        if (!(RenderQueue::MakeKey(0, 1, 65535, 65535, 1e30f) < RenderQueue::MakeKey(0, 2, 0, 0, 0.0f)) ||
+            !(RenderQueue::MakeKey(0, 1, 7, 65535, 1e30f) < RenderQueue::MakeKey(0, 1, 8, 0, 0.0f)) ||
+            !(RenderQueue::MakeKey(0, 1, 7, 3, 1e30f) < RenderQueue::MakeKey(0, 1, 7, 4, 0.0f))) {
+            std::printf("FAIL: pipeline, texture and mesh are not ordered by significance\n");
+            return false;
+        }
+        // Ближние раньше дальних; за камерой - как на нуле
+        uint64_t previous = RenderQueue::MakeKey(0, 1, 1, 1, 0.0f);
+        if (RenderQueue::MakeKey(0, 1, 1, 1, -5.0f) != previous) {
+            std::printf("FAIL: negative depth is not clamped to zero\n");
+            return false;
+        }
+        for (float depth = 0.01f; depth < 1e5f; depth *= 1.01f) {
+            uint64_t key = RenderQueue::MakeKey(0, 1, 1, 1, depth);
+            if (key < previous) {
+                std::printf("FAIL: key decreases with depth at %g\n", depth);
+                return false;
+            }
+            previous = key;
+        }
+        if (RenderQueue::MakeKey(0, 1, 1, 1, 10.0f) == RenderQueue::MakeKey(0, 1, 1, 1, 10.5f)) {
+            std::printf("FAIL: depth resolution is too coarse to order 10 and 10.5\n");
+            return false;
+        }
+        return true;
+    }
+
+    bool CheckClaims() {
+        RenderQueue queue;
+        queue.Begin(4);
+        bool first[] = { queue.Claim(0), queue.Claim(1), queue.Claim(0), queue.Claim(2), queue.Claim(1), queue.Claim(9) };
+        bool expected[] = { true, true, false, true, false, true };
+        if (!std::equal(first, first + 6, expected) || queue.GetDeduplicatedCount() != 2) {
+            std::printf("FAIL: repeated claims within a frame are not rejected\n");
+            return false;
+        }
+        queue.Begin(4);
+        if (!queue.Claim(0) || !queue.Claim(1) || queue.GetDeduplicatedCount() != 0) {
+            std::printf("FAIL: claims leak into the next frame\n");
+            return false;
+        }
+        if (queue.GetResourceId(nullptr) != 0 || queue.GetResourceId(&queue) != queue.GetResourceId(&queue) ||
+            queue.GetResourceId(&queue) == queue.GetResourceId(&first)) {
+            std::printf("FAIL: resource ids are not dense per-frame numbers\n");
+            return false;
+        }
+        return true;
+    }
+
+    // Ключи как у сцены: немного конвейеров, текстур и мешей, глубина - любая
+    bool CheckSort(size_t count, int repeats) {
+        std::mt19937 rng(static_cast<uint32_t>(count));
+        std::uniform_int_distribution<uint32_t> pipeline(1, 8), texture(0, 40), mesh(1, 200);
+        std::uniform_real_distribution<float> depth(0.5f, 500.0f);
+        std::vector<RenderQueueItem> source(count);
+        for (size_t i = 0; i < count; ++i) {
+            source[i] = { RenderQueue::MakeKey(0, pipeline(rng), texture(rng), mesh(rng), depth(rng)),
+                          static_cast<uint32_t>(i), 0 };
+        }
+
+        RenderQueue queue;
+        double radixMs = 0.0;
+        for (int r = 0; r < repeats; ++r) {
+            queue.Begin(0);
+            for (const RenderQueueItem& item : source) queue.Add(item.key, item.object, item.part);
+            auto start = std::chrono::steady_clock::now();
+            queue.Sort();
+            radixMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        std::vector<RenderQueueItem> reference;
+        double stdMs = 0.0;
+        for (int r = 0; r < repeats; ++r) {
+            reference = source;
+            auto start = std::chrono::steady_clock::now();
+            std::stable_sort(reference.begin(), reference.end(),
+                             [](const RenderQueueItem& a, const RenderQueueItem& b) { return a.key < b.key; });
+            stdMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        const std::vector<RenderQueueItem>& sorted = queue.GetItems();
+        for (size_t i = 0; i < count; ++i) {
+            if (sorted[i].key != reference[i].key || sorted[i].object != reference[i].object) {
+                std::printf("FAIL: radix order differs from std::stable_sort at %zu of %zu\n", i, count);
+                return false;
+            }
+        }
+        std::printf("%-9zu %12.3f %12.3f %9.1fx\n", count, radixMs / repeats, stdMs / repeats, stdMs / radixMs);
+        return true;
+    }
+
+    struct ModeResult {
+        RenderFrameStats stats;
+        size_t queued;
+        size_t deduplicated;
+        double msPerFrame;
+    };
+
+    ModeResult RunMode(Render& render, NullRenderDevice& device, const KatamariWorld& world,
+                       const std::vector<MeshHandle>& bodyMeshes, const Ground& ground, bool instanced, bool sorted,
+                       int frames) {
+        render.SetInstancingEnabled(instanced);
+        render.SetSortingEnabled(sorted);
+        render.SetCullingEnabled(false);
+        render.SetLodEnabled(false);
+        DirectX::XMMATRIX viewProj = DirectX::XMMatrixIdentity();
+        DirectX::XMFLOAT3 cameraPos(0.0f, 5.0f, -10.0f);
+
+        render.RenderScene(world.GetBodies(), bodyMeshes, &ground, viewProj, cameraPos);
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            render.RenderScene(world.GetBodies(), bodyMeshes, &ground, viewProj, cameraPos);
+        }
+        ModeResult result;
+        result.msPerFrame = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+        result.stats = device.GetFrameStats();
+        result.queued = render.GetLastQueuedDrawCount();
+        result.deduplicated = render.GetLastDeduplicatedDrawCount();
+        return result;
+    }
+
+    void Print(const char* name, const ModeResult& result) {
+        std::printf("%-18s %8zu %8zu %8zu %10zu %10zu %10.3f\n", name, result.stats.drawCalls, result.queued,
+                    result.deduplicated, result.stats.stateChanges, result.stats.redundantBinds, result.msPerFrame);
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t pickups = 10000;
+    int frames = 50;
+    bool check = false;
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--check")) {
+            check = true;
+            pickups = 1000;
+            frames = 2;
+        } else if (positional == 0 && ++positional) {
+            pickups = std::strtoull(argv[i], nullptr, 10);
+        } else if (positional == 1 && ++positional) {
+            frames = std::atoi(argv[i]);
+        }
+    }
+    if (frames <= 0) frames = 1;
+
+    bool ok = CheckKeys() && CheckClaims();
+    if (ok) {
+        std::printf("items     radix ms/sort  std ms/sort   speedup\n");
+        ok = CheckSort(1000, check ? 5 : 200) && CheckSort(10000, check ? 2 : 50);
+        if (!check) ok = ok && CheckSort(100000, 10) && CheckSort(1000000, 3);
+    }
+    if (!ok) return 1;
+
+    NullRenderDevice device;
+    Render render(device);
+    if (!render.Initialize()) return 1;
+
+    AssetLoader assetLoader(1);
+    Ground ground(device, assetLoader, "Textures/ground.obj");
+    assetLoader.Flush();
+    assetLoader.PumpUploads(AssetUploadBudget{ 1e9, size_t(-1) });
+
+    // Мячи с float- и сжатыми вершинами вперемешку: это два меша и два конвейера, без сортировки
+    // соседние вызовы постоянно переключают и то и другое
+    KatamariWorld world;
+    world.PopulateDefaultScene();
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+    for (size_t i = 0; i < pickups; ++i) {
+        world.AddPickup("Textures/soccer_ball.obj", DirectX::XMFLOAT3(coordinate(rng), 0.5f, coordinate(rng)),
+                        DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), 0.5f, i % 10 != 0, DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f));
+    }
+    world.Step(KatamariInput());
+
+    std::vector<MeshHandle> bodyMeshes;
+    for (size_t i = 0; i < world.GetBodies().size(); ++i) {
+        VertexFormat format = i % 2 ? VertexFormat::Compact : VertexFormat::Float32;
+        bodyMeshes.push_back(meshRegistry.Acquire(device, world.GetBodies()[i]->modelPath, format));
+    }
+
+    size_t readyBodies = 0;
+    size_t expectedDraws = 0;
+    for (size_t i = 0; i < bodyMeshes.size(); ++i) {
+        if (!bodyMeshes[i] || !bodyMeshes[i]->IsReady()) continue;
+        ++readyBodies;
+        const MeshSubmesh* submeshes = bodyMeshes[i]->GetSubmeshes(0);
+        for (size_t s = 0; s < bodyMeshes[i]->submeshCount; ++s) expectedDraws += submeshes[s].indexCount != 0;
+    }
+    if (readyBodies == 0) {
+        std::printf("FAIL: no body mesh could be loaded (run from the directory containing Textures/)\n");
+        return 1;
+    }
+    std::printf("bodies: %zu (ready %zu), body submesh draws: %zu, frames: %d\n", bodyMeshes.size(), readyBodies,
+                expectedDraws, frames);
+
+    ModeResult perBodyUnsorted = RunMode(render, device, world, bodyMeshes, ground, false, false, frames);
+    ModeResult perBody = RunMode(render, device, world, bodyMeshes, ground, false, true, frames);
+    ModeResult instancedUnsorted = RunMode(render, device, world, bodyMeshes, ground, true, false, frames);
+    ModeResult instanced = RunMode(render, device, world, bodyMeshes, ground, true, true, frames);
+    std::printf("mode                  draws   queued  deduped  state chg  redundant   ms/frame\n");
+    Print("per-body unsorted", perBodyUnsorted);
+    Print("per-body sorted", perBody);
+    Print("instanced unsorted", instancedUnsorted);
+    Print("instanced sorted", instanced);
+
+    // Каждое готовое тело попадает в очередь ровно один раз и даёт по вызову на непустой подмеш
+    if (perBody.queued != expectedDraws || perBodyUnsorted.queued != expectedDraws) {
+        std::printf("FAIL: per-body queue emitted %zu draws, expected %zu\n", perBody.queued, expectedDraws);
+        ok = false;
+    }
+    if (perBody.deduplicated || instanced.deduplicated) {
+        std::printf("FAIL: visible body list produced duplicate claims\n");
+        ok = false;
+    }
+    if (perBody.stats.primitives != perBodyUnsorted.stats.primitives ||
+        instanced.stats.primitives != perBody.stats.primitives) {
+        std::printf("FAIL: sorting or instancing changed the primitive count\n");
+        ok = false;
+    }
+    if (perBody.stats.stateChanges > perBodyUnsorted.stats.stateChanges ||
+        instanced.stats.stateChanges > instancedUnsorted.stats.stateChanges) {
+        std::printf("FAIL: sorted submission changes more state than unsorted\n");
+        ok = false;
+    }
+    std::printf(ok ? "OK\n" : "FAILED\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+// Кадры в секунду программного растеризатора на сцене катамари по умолчанию, 800x600.
+// Сохраняет последний кадр в BMP и сверяет инстансный путь с вызовом на тело попиксельно.
+// Запуск: SoftwareRasterBenchmark [число кадров] [--threads N] [--output файл.bmp] [--min-fps N] [--check]
+#include "SoftwareRenderDevice.h"
+#include "Render.h"
+#include "Ground.h"
+#include "KatamariWorld.h"
+#include "MeshRegistry.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <objbase.h>
+#endif
+
+namespace {
+    double RenderFrames(Render& render, KatamariWorld& world, const std::vector<MeshHandle>& bodyMeshes,
+                        const Ground& ground, int frames) {
+        FollowCamera& camera = world.GetCamera();
+        DirectX::XMMATRIX viewProj = camera.GetViewProjMatrix();
+        DirectX::XMFLOAT3 cameraPos = camera.GetPosition();
+
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            render.RenderScene(world.GetBodies(), bodyMeshes, &ground, viewProj, cameraPos);
+        }
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::vector<uint32_t> CopyImage(const SoftwareRenderDevice& device) {
+        std::vector<uint32_t> pixels;
+        pixels.reserve(size_t(device.GetWidth()) * device.GetHeight());
+        for (uint32_t y = 0; y < device.GetHeight(); ++y) {
+            for (uint32_t x = 0; x < device.GetWidth(); ++x) pixels.push_back(device.GetPixel(x, y));
+        }
+        return pixels;
+    }
+}
+
+int main(int argc, char** argv) {
+    int frames = 60;
+    size_t threads = 0;
+    double minFps = 0.0;
+    std::string outputPath = "katamari_software.bmp";
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--threads") && i + 1 < argc) threads = std::strtoull(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "--output") && i + 1 < argc) outputPath = argv[++i];
+        else if (!std::strcmp(argv[i], "--min-fps") && i + 1 < argc) minFps = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--check")) frames = 2;
+        else frames = std::atoi(argv[i]);
+    }
+    if (frames <= 0) frames = 1;
+
+#ifdef _WIN32
+    // WIC-декодер текстур требует COM и в главном потоке, и в рабочих
+    CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+    AssetLoader assetLoader(1, [] { CoInitializeEx(nullptr, COINIT_MULTITHREADED); });
+#else
+    AssetLoader assetLoader(1);
+#endif
+
+    SoftwareRenderDevice device(800, 600, threads);
+    Render render(device);
+    if (!render.Initialize()) return 1;
+
+    Ground ground(device, assetLoader, "Textures/ground.obj");
+    assetLoader.Flush();
+    assetLoader.PumpUploads(AssetUploadBudget{ 1e9, size_t(-1) });
+
+    KatamariWorld world;
+    world.PopulateDefaultScene();
+    world.Step(KatamariInput());
+
+    std::vector<MeshHandle> bodyMeshes;
+    for (const auto& body : world.GetBodies()) {
+        bodyMeshes.push_back(meshRegistry.Acquire(device, body->modelPath));
+    }
+    size_t readyBodies = 0;
+    bool allTextured = true;
+    for (size_t i = 0; i < bodyMeshes.size(); ++i) {
+        const MeshHandle& mesh = bodyMeshes[i];
+        if (!mesh || !mesh->IsReady()) continue;
+        ++readyBodies;
+        allTextured = allTextured && world.GetBodies()[i]->useTexture && mesh->HasReadyTexture();
+    }
+    if (readyBodies == 0) {
+        std::printf("FAIL: no body mesh could be loaded (run from the directory containing Textures/)\n");
+        return 1;
+    }
+
+    // Эталон: вызов на тело, затем замер инстансного пути, которым рисует игра
+    render.SetInstancingEnabled(false);
+    RenderFrames(render, world, bodyMeshes, ground, 1);
+    std::vector<uint32_t> perBodyImage = CopyImage(device);
+
+    render.SetInstancingEnabled(true);
+    RenderFrames(render, world, bodyMeshes, ground, 1);
+    double seconds = RenderFrames(render, world, bodyMeshes, ground, frames);
+    std::vector<uint32_t> instancedImage = CopyImage(device);
+    const RenderFrameStats& stats = device.GetFrameStats();
+
+    size_t differing = 0;
+    for (size_t i = 0; i < instancedImage.size(); ++i) {
+        if (instancedImage[i] != perBodyImage[i]) ++differing;
+    }
+    size_t covered = device.CountCoveredPixels();
+    double fps = frames / seconds;
+
+    std::printf("bodies: %zu (ready %zu), threads: %zu, frames: %d\n", world.GetBodies().size(), readyBodies,
+                device.GetThreadCount(), frames);
+    std::printf("draws: %zu, primitives submitted: %zu, triangles binned: %zu\n", stats.drawCalls, stats.primitives,
+                device.GetTriangleCount());
+    std::printf("%.3f ms/frame, %.1f fps at %ux%u\n", 1000.0 * seconds / frames, fps, device.GetWidth(), device.GetHeight());
+    std::printf("pixels differing from the per-body path: %zu, pixels covered: %zu\n", differing, covered);
+
+    if (!device.SaveImage(outputPath)) {
+        std::printf("FAIL: could not write %s\n", outputPath.c_str());
+        return 1;
+    }
+    std::printf("image: %s\n", outputPath.c_str());
+
+    if (covered == 0) {
+        std::printf("FAIL: the frame contains only the clear color\n");
+        return 1;
+    }
+    // Без текстуры путь на тело рисует PSMainTextured с пустой выборкой, а инстансный - PSMainColored
+    if (allTextured && differing != 0) {
+        std::printf("FAIL: instanced and per-body paths produced different images\n");
+        return 1;
+    }
+    if (minFps > 0.0 && fps < minFps) {
+        std::printf("FAIL: %.1f fps is below the limit of %.1f\n", fps, minFps);
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
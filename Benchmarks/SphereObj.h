@@ -0,0 +1,35 @@
+#pragma once
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+// UV-сфера радиуса 1 в OBJ для бенчмарков, которым нужна модель без файлов из репозитория:
+// (segments + 1) * (rings + 1) вершин, 2 * segments * (rings - 1) треугольников.
+// materialLibrary и material - .mtl рядом с файлом и материал из него, пусто - без материала
+inline bool WriteSphereObj(const std::filesystem::path& path, int segments, int rings,
+                           const std::string& materialLibrary = "", const std::string& material = "") {
+    std::ofstream file(path);
+    if (!file) return false;
+    if (!materialLibrary.empty()) file << "mtllib " << materialLibrary << "\nusemtl " << material << '\n';
+    for (int ring = 0; ring <= rings; ++ring) {
+        float theta = 3.14159265f * ring / rings;
+        for (int segment = 0; segment <= segments; ++segment) {
+            float phi = 6.28318531f * (segment % segments) / segments;
+            float x = std::sin(theta) * std::cos(phi), y = std::cos(theta), z = std::sin(theta) * std::sin(phi);
+            file << "v " << x << ' ' << y << ' ' << z << "\nvn " << x << ' ' << y << ' ' << z << "\nvt "
+                 << float(segment) / segments << ' ' << float(ring) / rings << '\n';
+        }
+    }
+    for (int ring = 0; ring < rings; ++ring) {
+        for (int segment = 0; segment < segments; ++segment) {
+            int a = ring * (segments + 1) + segment + 1;
+            int b = a + segments + 1;
+            if (ring != 0) file << "f " << a << '/' << a << '/' << a << ' ' << b << '/' << b << '/' << b << ' '
+                                << a + 1 << '/' << a + 1 << '/' << a + 1 << '\n';
+            if (ring != rings - 1) file << "f " << a + 1 << '/' << a + 1 << '/' << a + 1 << ' ' << b << '/' << b << '/'
+                                        << b << ' ' << b + 1 << '/' << b + 1 << '/' << b + 1 << '\n';
+        }
+    }
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,124 @@
+// Стоимость отправки кадра через NullRenderDevice: сцена катамари с N дополнительными мячами,
+// инстансный путь против вызова на тело. Работает без GPU, пригоден для регрессий в CI.
+// Запуск: SubmissionBenchmark [число мячей] [число кадров] [--max-draw-calls N] [--max-state-changes N] [--check]
+#include "NullRenderDevice.h"
+#include "Render.h"
+#include "Ground.h"
+#include "KatamariWorld.h"
+#include "MeshRegistry.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+    struct ModeResult {
+        RenderFrameStats stats;
+        double msPerFrame;
+    };
+
+    ModeResult RunMode(Render& render, NullRenderDevice& device, const KatamariWorld& world,
+                       const std::vector<MeshHandle>& bodyMeshes, const Ground& ground, bool instanced, int frames) {
+        render.SetInstancingEnabled(instanced);
+        // Замеряется только отправка: единичная viewProj отсекла бы почти все мячи, а уровни детализации дробили бы группы
+        render.SetCullingEnabled(false);
+        render.SetLodEnabled(false);
+        DirectX::XMMATRIX viewProj = DirectX::XMMatrixIdentity();
+        DirectX::XMFLOAT3 cameraPos(0.0f, 5.0f, -10.0f);
+
+        // Первый кадр прогревает буфер экземпляров, его загрузки в замер не входят
+        render.RenderScene(world.GetBodies(), bodyMeshes, &ground, viewProj, cameraPos);
+
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            render.RenderScene(world.GetBodies(), bodyMeshes, &ground, viewProj, cameraPos);
+        }
+        ModeResult result;
+        result.msPerFrame = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+        result.stats = device.GetFrameStats();
+        return result;
+    }
+
+    void Print(const char* name, const ModeResult& result) {
+        std::printf("%-10s %10zu %10zu %12zu %12zu %14zu %10.3f\n", name, result.stats.drawCalls, result.stats.primitives,
+                    result.stats.stateChanges, result.stats.redundantBinds, result.stats.bytesUploaded, result.msPerFrame);
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t pickups = 10000;
+    int frames = 100;
+    size_t maxDrawCalls = 0;
+    size_t maxStateChanges = 0;
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--max-draw-calls") && i + 1 < argc) maxDrawCalls = std::strtoull(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "--max-state-changes") && i + 1 < argc) maxStateChanges = std::strtoull(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "--check")) {
+            pickups = 1000;
+            frames = 2;
+        } else if (positional == 0 && ++positional) pickups = std::strtoull(argv[i], nullptr, 10);
+        else if (positional == 1 && ++positional) frames = std::atoi(argv[i]);
+    }
+    if (frames <= 0) frames = 1;
+
+    NullRenderDevice device;
+    Render render(device);
+    if (!render.Initialize()) return 1;
+
+    AssetLoader assetLoader(1);
+    Ground ground(device, assetLoader, "Textures/ground.obj");
+    assetLoader.Flush();
+    assetLoader.PumpUploads(AssetUploadBudget{ 1e9, size_t(-1) });
+
+    KatamariWorld world;
+    world.PopulateDefaultScene();
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+    for (size_t i = 0; i < pickups; ++i) {
+        world.AddPickup("Textures/soccer_ball.obj", DirectX::XMFLOAT3(coordinate(rng), 0.5f, coordinate(rng)),
+                        DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), 0.5f, i % 10 != 0, DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f));
+    }
+    world.Step(KatamariInput());
+
+    std::vector<MeshHandle> bodyMeshes;
+    for (const auto& body : world.GetBodies()) {
+        bodyMeshes.push_back(meshRegistry.Acquire(device, body->modelPath));
+    }
+    size_t readyBodies = 0;
+    for (const MeshHandle& mesh : bodyMeshes) {
+        if (mesh && mesh->IsReady()) ++readyBodies;
+    }
+    if (readyBodies == 0) {
+        std::printf("FAIL: no body mesh could be loaded (run from the directory containing Textures/)\n");
+        return 1;
+    }
+
+    ModeResult perBody = RunMode(render, device, world, bodyMeshes, ground, false, frames);
+    ModeResult instanced = RunMode(render, device, world, bodyMeshes, ground, true, frames);
+
+    std::printf("bodies: %zu (ready %zu), frames: %d\n", world.GetBodies().size(), readyBodies, frames);
+    std::printf("%-10s %10s %10s %12s %12s %14s %10s\n", "mode", "draws", "primitives", "state chg", "redundant",
+                "bytes uploaded", "ms/frame");
+    Print("per-body", perBody);
+    Print("instanced", instanced);
+
+    // Пол плюс одно тело на вызов; в инстансном пути вызовов не больше, чем групп меш/материал
+    if (perBody.stats.drawCalls != readyBodies + 1 || perBody.stats.primitives != instanced.stats.primitives ||
+        instanced.stats.drawCalls > 1 + 2 * meshRegistry.GetLiveMeshCount()) {
+        std::printf("FAIL: submission counts do not match the scene\n");
+        return 1;
+    }
+    if (maxDrawCalls && instanced.stats.drawCalls > maxDrawCalls) {
+        std::printf("FAIL: %zu draw calls exceed the limit of %zu\n", instanced.stats.drawCalls, maxDrawCalls);
+        return 1;
+    }
+    if (maxStateChanges && instanced.stats.stateChanges > maxStateChanges) {
+        std::printf("FAIL: %zu state changes exceed the limit of %zu\n", instanced.stats.stateChanges, maxStateChanges);
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,359 @@
+// Планировщик задач с перехватом работы: сначала проверки (каждый индекс ParallelFor ровно один раз, порядок
+// зависимостей графа, вложенные ParallelFor в задачах графа, параллельный пересчёт иерархии по уровням после
+// переноса узлов под соседей того же уровня), затем масштабирование кадра на большой синтетической
+// сцене - свободные мячи, куча на катамари и неподвижная камера над полем - при 1, 2, 4, 8 и 16 потоках.
+// Кадр: KatamariWorld::Step и Render::RenderScene через NullRenderDevice в режимах с инстансингом и без.
+// Состояние мира, статистика кадра и хеш всех загрузок буферов и вызовов отрисовки должны совпасть с прогоном
+// без планировщика; любое расхождение - ненулевой код выхода.
+// Запуск: TaskSchedulerBenchmark [число мячей=200000] [число кадров=30] [--check]
+#include "TaskScheduler.h"
+#include "NullRenderDevice.h"
+#include "Render.h"
+#include "Ground.h"
+#include "KatamariWorld.h"
+#include "MeshRegistry.h"
+#include "Profiler.h"
+#include "TransformHierarchy.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+    const size_t ThreadCounts[] = { 1, 2, 4, 8, 16 };
+
+    uint64_t HashBytes(uint64_t hash, const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // Null-устройство, которое хеширует содержимое обновлений буферов и параметры вызовов отрисовки:
+    // совпадение хеша значит, что на GPU ушли те же константы, те же экземпляры и в том же порядке
+    class HashingRenderDevice : public NullRenderDevice {
+    public:
+        uint64_t GetStreamHash() const { return streamHash; }
+        void ResetStreamHash() { streamHash = 14695981039346656037ull; }
+
+    protected:
+        bool DoUpdateBuffer(RenderBufferId id, const void* data, size_t byteSize) override {
+            streamHash = HashBytes(streamHash, data, byteSize);
+            return NullRenderDevice::DoUpdateBuffer(id, data, byteSize);
+        }
+        void DoDrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex) override {
+            uint32_t call[] = { indexCount, startIndex, static_cast<uint32_t>(baseVertex) };
+            streamHash = HashBytes(streamHash, call, sizeof(call));
+        }
+        void DoDrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex,
+                                    uint32_t startInstance) override {
+            uint32_t call[] = { indexCount, instanceCount, startIndex, static_cast<uint32_t>(baseVertex), startInstance };
+            streamHash = HashBytes(streamHash, call, sizeof(call));
+        }
+
+    private:
+        uint64_t streamHash = 14695981039346656037ull;
+    };
+
+    bool CheckParallelFor(TaskScheduler& scheduler) {
+        const size_t count = 100003;
+        std::vector<std::atomic<uint32_t>> visits(count);
+        for (auto& visit : visits) visit.store(0);
+        for (size_t grain : { size_t(1), size_t(7), size_t(1000), count * 2 }) {
+            scheduler.ParallelFor(count, grain, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) visits[i].fetch_add(1, std::memory_order_relaxed);
+            });
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (visits[i].load() != 4) {
+                std::printf("FAIL: %zu threads, ParallelFor visited index %zu %u times instead of 4\n",
+                            scheduler.GetThreadCount(), i, visits[i].load());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Ромб a -> (b, c) -> d и независимая e; b и c внутри запускают ParallelFor
+    bool CheckGraph(TaskScheduler& scheduler) {
+        std::atomic<uint32_t> clock(0);
+        uint32_t stamps[5];
+        std::atomic<size_t> innerSum(0);
+        auto inner = [&] {
+            scheduler.ParallelFor(10000, 100, [&](size_t begin, size_t end) {
+                size_t sum = 0;
+                for (size_t i = begin; i < end; ++i) sum += i;
+                innerSum.fetch_add(sum);
+            });
+        };
+        TaskGraph graph;
+        TaskGraph::TaskId a = graph.AddTask("a", [&] { stamps[0] = clock.fetch_add(1); });
+        TaskGraph::TaskId b = graph.AddTask("b", [&] { inner(); stamps[1] = clock.fetch_add(1); });
+        TaskGraph::TaskId c = graph.AddTask("c", [&] { inner(); stamps[2] = clock.fetch_add(1); });
+        TaskGraph::TaskId d = graph.AddTask("d", [&] { stamps[3] = clock.fetch_add(1); });
+        graph.AddTask("e", [&] { stamps[4] = clock.fetch_add(1); });
+        graph.AddDependency(a, b);
+        graph.AddDependency(a, c);
+        graph.AddDependency(b, d);
+        graph.AddDependency(c, d);
+        if (graph.AddDependency(d, a)) {
+            std::printf("FAIL: a dependency on a later task was accepted\n");
+            return false;
+        }
+
+        // Граф перезапускается без перестройки
+        for (int run = 0; run < 200; ++run) {
+            clock.store(0);
+            innerSum.store(0);
+            scheduler.Run(graph);
+            if (clock.load() != 5 || !(stamps[0] < stamps[1] && stamps[0] < stamps[2] && stamps[1] < stamps[3] &&
+                                       stamps[2] < stamps[3])) {
+                std::printf("FAIL: %zu threads, run %d broke the task dependencies\n", scheduler.GetThreadCount(), run);
+                return false;
+            }
+            if (innerSum.load() != 2 * (10000ull * 9999 / 2)) {
+                std::printf("FAIL: %zu threads, nested ParallelFor lost work\n", scheduler.GetThreadCount());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Мировая трансформация узла должна получаться из мировой трансформации родителя и своей локальной
+    bool MatchesParent(const TransformHierarchy& hierarchy, TransformHierarchy::NodeId node) {
+        TransformHierarchy::NodeId parent = hierarchy.GetParent(node);
+        if (parent == TransformHierarchy::InvalidNode) return true;
+        DirectX::XMFLOAT3 local = hierarchy.GetLocalPosition(node);
+        DirectX::XMFLOAT3 parentPosition = hierarchy.GetWorldPosition(parent);
+        DirectX::XMFLOAT4 parentRotation = hierarchy.GetWorldRotation(parent);
+        DirectX::XMVECTOR expected = DirectX::XMVectorAdd(
+            DirectX::XMLoadFloat3(&parentPosition),
+            DirectX::XMVector3Rotate(DirectX::XMVectorScale(DirectX::XMLoadFloat3(&local), hierarchy.GetWorldScale(parent)),
+                                     DirectX::XMLoadFloat4(&parentRotation)));
+        DirectX::XMFLOAT3 position = hierarchy.GetWorldPosition(node);
+        DirectX::XMFLOAT3 e;
+        DirectX::XMStoreFloat3(&e, expected);
+        return std::fabs(position.x - e.x) + std::fabs(position.y - e.y) + std::fabs(position.z - e.z) < 1e-4f;
+    }
+
+    // Катамари с широкой кучей; каждый кадр часть тел кучи переносится под далёкое тело того же уровня и обратно.
+    // Перенос обязан опустить узел на уровень ниже без сортировки: иначе параллельный пересчёт уровня
+    // читал бы родителя, которого считает другой поток или который ещё не пересчитан
+    bool CheckHierarchyLevels(TaskScheduler& scheduler) {
+        using NodeId = TransformHierarchy::NodeId;
+        const size_t count = 8192;
+        TransformHierarchy parallel, serial;
+        parallel.SetTaskScheduler(&scheduler);
+        std::vector<NodeId> parallelNodes, serialNodes;
+        DirectX::XMFLOAT4 identity(0.0f, 0.0f, 0.0f, 1.0f);
+        for (TransformHierarchy* hierarchy : { &parallel, &serial }) {
+            std::vector<NodeId>& nodes = hierarchy == &parallel ? parallelNodes : serialNodes;
+            for (size_t i = 0; i < count; ++i) {
+                DirectX::XMFLOAT3 position(std::cos(i * 0.7f), 1.0f + std::sin(i * 0.3f), std::sin(i * 0.7f));
+                nodes.push_back(hierarchy->CreateNode(position, identity, i ? 0.4f : 1.0f));
+            }
+            for (size_t i = 1; i < count; ++i) hierarchy->SetParent(nodes[i], nodes[0]);
+            hierarchy->UpdateWorldTransforms();
+        }
+
+        for (int frame = 0; frame < 8; ++frame) {
+            for (TransformHierarchy* hierarchy : { &parallel, &serial }) {
+                std::vector<NodeId>& nodes = hierarchy == &parallel ? parallelNodes : serialNodes;
+                DirectX::XMFLOAT4 rotation;
+                DirectX::XMStoreFloat4(&rotation, DirectX::XMQuaternionRotationAxis(
+                                                      DirectX::XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f), frame * 0.1f));
+                hierarchy->SetLocalRotation(nodes[0], rotation);
+                for (size_t i = 1 + frame % 3; i < count / 2; i += 3) {
+                    hierarchy->SetParent(nodes[i], frame % 2 ? nodes[0] : nodes[count - i]);
+                }
+                hierarchy->UpdateWorldTransforms();
+            }
+            if (parallel.GetSortCount() != 0) {
+                std::printf("FAIL: %zu threads, same-level reparenting sorted the hierarchy %zu times\n",
+                            scheduler.GetThreadCount(), parallel.GetSortCount());
+                return false;
+            }
+            for (size_t i = 0; i < count; ++i) {
+                if (!MatchesParent(parallel, parallelNodes[i])) {
+                    std::printf("FAIL: %zu threads, frame %d: node %zu was composed from a stale parent\n",
+                                scheduler.GetThreadCount(), frame, i);
+                    return false;
+                }
+                DirectX::XMFLOAT4X4 a, b;
+                DirectX::XMStoreFloat4x4(&a, parallel.GetWorldMatrix(parallelNodes[i]));
+                DirectX::XMStoreFloat4x4(&b, serial.GetWorldMatrix(serialNodes[i]));
+                if (std::memcmp(&a, &b, sizeof(a)) != 0) {
+                    std::printf("FAIL: %zu threads, frame %d: node %zu differs from the single-threaded pass\n",
+                                scheduler.GetThreadCount(), frame, i);
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    struct FrameResult {
+        double stepMs = 0.0;
+        double renderMs = 0.0;
+        uint64_t stateHash = 0;
+        uint64_t streamHash = 0;
+        RenderFrameStats stats;
+        size_t visible = 0;
+        size_t recomputed = 0;
+        double stolenPerFrame = 0.0;
+    };
+
+    // Мячи на квадрате 600 x 600 м, каждый десятый уже в куче катамари: куча пересчитывается каждый кадр
+    void BuildScene(KatamariWorld& world, size_t pickups) {
+        world.AddDefaultKatamari();
+        std::mt19937 rng(11);
+        std::uniform_real_distribution<float> coordinate(-300.0f, 300.0f);
+        for (size_t i = 0; i < pickups; ++i) {
+            world.AddPickup("Textures/soccer_ball.obj", DirectX::XMFLOAT3(coordinate(rng), 0.5f, coordinate(rng)),
+                            DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), 0.5f, i % 10 != 0, DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f));
+        }
+        CelestialBody* katamari = world.GetKatamari();
+        for (size_t i = 1; i <= pickups; i += 10) katamari->AttachChild(world.GetBodies()[i].get());
+        world.Step(KatamariInput());
+    }
+
+    FrameResult RunFrames(HashingRenderDevice& device, const Ground& ground, const std::vector<MeshHandle>& bodyMeshes,
+                          size_t pickups, TaskScheduler* scheduler, bool instanced, int frames) {
+        KatamariWorld world;
+        BuildScene(world, pickups);
+        world.SetTaskScheduler(scheduler);
+        Render render(device);
+        render.Initialize();
+        render.SetInstancingEnabled(instanced);
+        render.SetTaskScheduler(scheduler);
+
+        // Камера над краем поля смотрит на центр: в кадре больше половины мячей
+        DirectX::XMFLOAT3 cameraPos(0.0f, 60.0f, -320.0f);
+        DirectX::XMMATRIX viewProj =
+            DirectX::XMMatrixLookAtLH(DirectX::XMLoadFloat3(&cameraPos), DirectX::XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f),
+                                      DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)) *
+            DirectX::XMMatrixPerspectiveFovLH(0.9f, 4.0f / 3.0f, 0.1f, 1000.0f);
+
+        KatamariInput input;
+        input.forward = true;
+        FrameResult result;
+        device.ResetStreamHash();
+        size_t stolenStart = scheduler ? scheduler->GetStolenTaskCount() : 0;
+        for (int frame = 0; frame < frames; ++frame) {
+            auto stepStart = std::chrono::steady_clock::now();
+            world.Step(input);
+            auto renderStart = std::chrono::steady_clock::now();
+            render.RenderScene(world.GetBodies(), bodyMeshes, &ground, viewProj, cameraPos);
+            auto renderEnd = std::chrono::steady_clock::now();
+            result.stepMs += std::chrono::duration<double, std::milli>(renderStart - stepStart).count();
+            result.renderMs += std::chrono::duration<double, std::milli>(renderEnd - renderStart).count();
+        }
+        result.stepMs /= frames;
+        result.renderMs /= frames;
+        result.stateHash = world.ComputeStateHash();
+        result.streamHash = device.GetStreamHash();
+        result.stats = device.GetFrameStats();
+        result.visible = render.GetLastVisibleBodyCount();
+        result.recomputed = world.GetTransforms().GetLastRecomputedCount();
+        if (scheduler) result.stolenPerFrame = double(scheduler->GetStolenTaskCount() - stolenStart) / frames;
+        return result;
+    }
+
+    bool SameFrame(const FrameResult& a, const FrameResult& b) {
+        return a.stateHash == b.stateHash && a.streamHash == b.streamHash && a.visible == b.visible &&
+               a.stats.drawCalls == b.stats.drawCalls && a.stats.instances == b.stats.instances &&
+               a.stats.primitives == b.stats.primitives && a.stats.stateChanges == b.stats.stateChanges &&
+               a.stats.bytesUploaded == b.stats.bytesUploaded;
+    }
+
+    void Print(const char* name, const FrameResult& result, double baseFrameMs) {
+        double frameMs = result.stepMs + result.renderMs;
+        std::printf("%-8s %10.3f %11.3f %10.3f %8.2fx %13.1f\n", name, result.stepMs, result.renderMs, frameMs,
+                    frameMs > 0.0 ? baseFrameMs / frameMs : 0.0, result.stolenPerFrame);
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t pickups = 200000;
+    int frames = 30;
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--check")) {
+            pickups = 5000;
+            frames = 3;
+        } else if (positional == 0 && ++positional) {
+            pickups = std::strtoul(argv[i], nullptr, 10);
+        } else if (positional == 1 && ++positional) {
+            frames = std::atoi(argv[i]);
+        }
+    }
+    if (frames <= 0) frames = 1;
+    // Бенчмарк не закрывает кадры профайлера: без PROFILE_FRAME зоны копились бы весь прогон
+    profiler.SetEnabled(false);
+
+    bool ok = true;
+    for (size_t threads : ThreadCounts) {
+        TaskScheduler scheduler(threads);
+        ok = CheckParallelFor(scheduler) && CheckGraph(scheduler) && CheckHierarchyLevels(scheduler) && ok;
+    }
+    if (!ok) return 1;
+    std::printf("scheduler checks: OK\n");
+
+    HashingRenderDevice device;
+    AssetLoader assetLoader(1);
+    Ground ground(device, assetLoader, "Textures/ground.obj");
+    assetLoader.Flush();
+    assetLoader.PumpUploads(AssetUploadBudget{ 1e9, size_t(-1) });
+
+    // Тела строятся одинаково в каждом прогоне, поэтому меши по индексу тела общие для всех прогонов
+    std::vector<MeshHandle> bodyMeshes;
+    {
+        KatamariWorld world;
+        BuildScene(world, pickups);
+        for (const auto& body : world.GetBodies()) {
+            bodyMeshes.push_back(meshRegistry.Acquire(device, body->modelPath, VertexFormat::Compact));
+        }
+    }
+    if (!bodyMeshes[0] || !bodyMeshes[0]->IsReady()) {
+        std::printf("FAIL: body mesh could not be loaded (run from the directory containing Textures/)\n");
+        return 1;
+    }
+
+    std::printf("bodies: %zu, pile: %zu, frames: %d, hardware threads: %u\n", bodyMeshes.size(), (pickups + 9) / 10,
+                frames, std::thread::hardware_concurrency());
+    for (bool instanced : { true, false }) {
+        FrameResult serial = RunFrames(device, ground, bodyMeshes, pickups, nullptr, instanced, frames);
+        std::printf("\n%s: visible %zu, draws %zu, transforms recomputed %zu\n", instanced ? "instanced" : "per-body",
+                    serial.visible, serial.stats.drawCalls, serial.recomputed);
+        std::printf("%-8s %10s %11s %10s %9s %13s\n", "threads", "step ms", "render ms", "frame ms", "speedup",
+                    "stolen/frame");
+        Print("serial", serial, serial.stepMs + serial.renderMs);
+
+        double oneThreadMs = 0.0;
+        for (size_t threads : ThreadCounts) {
+            TaskScheduler scheduler(threads);
+            FrameResult result = RunFrames(device, ground, bodyMeshes, pickups, &scheduler, instanced, frames);
+            if (threads == 1) oneThreadMs = result.stepMs + result.renderMs;
+            char name[16];
+            std::snprintf(name, sizeof(name), "%zu", threads);
+            Print(name, result, oneThreadMs);
+            if (!SameFrame(result, serial)) {
+                std::printf("FAIL: %zu threads produced a different world or frame than the serial run\n", threads);
+                ok = false;
+            }
+        }
+    }
+    if (std::thread::hardware_concurrency() < 16) {
+        std::printf("\nnote: fewer cores than threads; rows above the core count measure scheduling overhead only\n");
+    }
+    std::printf(ok ? "OK\n" : "FAILED\n");
+    return ok ? 0 : 1;
+}
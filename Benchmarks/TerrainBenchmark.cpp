@@ -0,0 +1,318 @@
+// Потоковая земля без окна и GPU: проверка сшивки уровней детализации и одинаковых вершин на общих рёбрах тайлов,
+// затем катамари катится по рельефу на заданное число километров через NullRenderDevice. По каждому километру
+// печатаются время кадра, занятая тайлами память, число построенных и вытесненных тайлов; память не должна
+// превышать бюджет, а время кадра - расти с пройденным расстоянием. Отдельно проверяется, что тайлы, для которых
+// устройство не создаёт буфер, не держат предзагрузку и не заказываются заново каждый кадр.
+// Запуск: TerrainBenchmark [километров=20] [--budget-mb N] [--check]
+#include "NullRenderDevice.h"
+#include "Render.h"
+#include "Terrain.h"
+#include "KatamariWorld.h"
+#include "Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <vector>
+
+namespace {
+    constexpr uint32_t Side = Terrain::TileCells + 1;
+
+    // Номера j (или i) вершин, которые варианты индексов используют на стороне side
+    std::set<uint32_t> EdgeVertices(const std::vector<uint16_t>& indices, uint32_t side) {
+        std::set<uint32_t> used;
+        for (uint16_t index : indices) {
+            uint32_t i = index % Side, j = index / Side;
+            if (side == Terrain::StitchNegX && i == 0) used.insert(j);
+            if (side == Terrain::StitchPosX && i == Terrain::TileCells) used.insert(j);
+            if (side == Terrain::StitchNegZ && j == 0) used.insert(i);
+            if (side == Terrain::StitchPosZ && j == Terrain::TileCells) used.insert(i);
+        }
+        return used;
+    }
+
+    uint32_t OppositeSide(uint32_t side) {
+        switch (side) {
+            case Terrain::StitchNegX: return Terrain::StitchPosX;
+            case Terrain::StitchPosX: return Terrain::StitchNegX;
+            case Terrain::StitchNegZ: return Terrain::StitchPosZ;
+            default: return Terrain::StitchNegZ;
+        }
+    }
+
+    bool CheckIndices() {
+        std::vector<uint16_t> indices, coarse;
+        for (uint32_t lod = 0; lod < Terrain::LodCount; ++lod) {
+            uint32_t masks = lod + 1 < Terrain::LodCount ? 16 : 1;
+            for (uint32_t mask = 0; mask < masks; ++mask) {
+                Terrain::BuildLodIndices(lod, mask, indices);
+                // Все треугольники обходятся в одну сторону и вместе покрывают тайл ровно один раз
+                int64_t doubleArea = 0;
+                for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+                    int32_t ax = indices[t] % Side, az = indices[t] / Side;
+                    int32_t bx = indices[t + 1] % Side, bz = indices[t + 1] / Side;
+                    int32_t cx = indices[t + 2] % Side, cz = indices[t + 2] / Side;
+                    int64_t cross = int64_t(bx - ax) * (cz - az) - int64_t(bz - az) * (cx - ax);
+                    if (cross <= 0) {
+                        std::printf("FAIL: lod %u mask %u has a flipped or degenerate triangle\n", lod, mask);
+                        return false;
+                    }
+                    doubleArea += cross;
+                }
+                if (doubleArea != 2 * int64_t(Terrain::TileCells) * Terrain::TileCells) {
+                    std::printf("FAIL: lod %u mask %u covers %lld of %u half-cells\n", lod, mask,
+                                static_cast<long long>(doubleArea), 2 * Terrain::TileCells * Terrain::TileCells);
+                    return false;
+                }
+                if (lod + 1 == Terrain::LodCount) continue;
+
+                // Сшитая сторона использует ровно те вершины, что и более грубый сосед на общем ребре
+                Terrain::BuildLodIndices(lod + 1, 0, coarse);
+                for (uint32_t side = 1; side < 16; side <<= 1) {
+                    std::set<uint32_t> fine = EdgeVertices(indices, side);
+                    std::set<uint32_t> expected = (mask & side) ? EdgeVertices(coarse, OppositeSide(side))
+                                                                : EdgeVertices(indices, side);
+                    if (fine != expected) {
+                        std::printf("FAIL: lod %u mask %u side %u does not match the coarser neighbour\n", lod, mask, side);
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    // Соседние тайлы получают побитово одинаковые высоты и нормали на общем ребре, а сдвиги тайлов точные
+    bool CheckSeams(const TerrainHeightfield& heightfield) {
+        std::vector<float> a, b;
+        float minHeight, maxHeight;
+        const int32_t tiles[][4] = { { 3, -2, 4, -2 }, { -7, 11, -7, 12 }, { 15000, 9, 15001, 9 } };
+        for (const auto& pair : tiles) {
+            Terrain::BuildTileVertices(heightfield, pair[0], pair[1], a, minHeight, maxHeight);
+            Terrain::BuildTileVertices(heightfield, pair[2], pair[3], b, minHeight, maxHeight);
+            bool alongX = pair[2] != pair[0];
+            for (uint32_t k = 0; k < Side; ++k) {
+                uint32_t first = alongX ? k * Side + Terrain::TileCells : Terrain::TileCells * Side + k;
+                uint32_t second = alongX ? k * Side : k;
+                const float* va = &a[first * 8];
+                const float* vb = &b[second * 8];
+                float ax = va[0] + pair[0] * Terrain::TileSize, bx = vb[0] + pair[2] * Terrain::TileSize;
+                float az = va[2] + pair[1] * Terrain::TileSize, bz = vb[2] + pair[3] * Terrain::TileSize;
+                if (ax != bx || az != bz || std::memcmp(va + 1, vb + 1, sizeof(float)) != 0 ||
+                    std::memcmp(va + 3, vb + 3, 3 * sizeof(float)) != 0) {
+                    std::printf("FAIL: tiles %d,%d and %d,%d disagree at shared edge vertex %u\n", pair[0], pair[1],
+                                pair[2], pair[3], k);
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Устройство, которое по флагу отказывает в вершинных буферах и считает попытки
+    class FailingRenderDevice : public NullRenderDevice {
+    public:
+        bool failVertexBuffers = true;
+        size_t vertexAttempts = 0;
+
+    protected:
+        bool DoCreateBuffer(RenderBufferId id, RenderBufferType type, RenderBufferUsage usage, size_t byteSize,
+                            const void* initialData) override {
+            if (type == RenderBufferType::Vertex) {
+                ++vertexAttempts;
+                if (failVertexBuffers) return false;
+            }
+            return NullRenderDevice::DoCreateBuffer(id, type, usage, byteSize, initialData);
+        }
+    };
+
+    // Предзагрузка как в main.cpp; false - цикл не закончился за разумное число раундов
+    bool Preload(Terrain& terrain, AssetLoader& assetLoader, DirectX::XMFLOAT3 focus) {
+        for (int round = 0; round < 1000; ++round) {
+            terrain.Update(focus);
+            assetLoader.Flush();
+            if (terrain.GetMissingTileCount() <= terrain.GetFailedTileCount()) return true;
+        }
+        return false;
+    }
+
+    // Тайлы без буфера: предзагрузка завершается, число попыток ограничено, а после ухода и возвращения фокуса
+    // заработавшее устройство строит их заново
+    bool CheckFailedTiles(const TerrainHeightfield& heightfield) {
+        LogLevel level = logger.GetLevel();
+        logger.SetLevel(LogLevel::Off); // ошибка на каждую попытку каждого тайла
+        FailingRenderDevice device;
+        AssetLoader assetLoader(2);
+        bool ok = true;
+        {
+            Terrain terrain(device, assetLoader, heightfield);
+            terrain.SetViewRadius(3);
+            DirectX::XMFLOAT3 home(10.0f, 0.0f, 10.0f);
+            if (!terrain.Initialize() || !Preload(terrain, assetLoader, home)) {
+                std::printf("FAIL: terrain preload does not finish when every tile fails\n");
+                ok = false;
+            } else {
+                size_t visible = 7 * 7, requested = 9 * 9;
+                size_t preloadAttempts = device.vertexAttempts;
+                size_t attemptsBefore = 0;
+                for (int frame = 0; frame < 2000; ++frame) {
+                    if (frame == 1000) attemptsBefore = device.vertexAttempts;
+                    terrain.Update(home);
+                    assetLoader.Flush();
+                }
+                if (terrain.GetFailedTileCount() != visible || terrain.GetResidentTileCount() != 0 ||
+                    device.vertexAttempts > requested * Terrain::MaxTileFailures ||
+                    device.vertexAttempts != attemptsBefore) {
+                    std::printf("FAIL: %zu failed tiles, %zu vertex buffer attempts (%zu in preload, %zu in the last "
+                                "1000 frames)\n", terrain.GetFailedTileCount(), device.vertexAttempts, preloadAttempts,
+                                device.vertexAttempts - attemptsBefore);
+                    ok = false;
+                }
+
+                device.failVertexBuffers = false;
+                DirectX::XMFLOAT3 away(home.x + 20 * Terrain::TileSize, 0.0f, home.z);
+                if (ok && (!Preload(terrain, assetLoader, away) || !Preload(terrain, assetLoader, home) ||
+                           terrain.GetMissingTileCount() != 0 || terrain.GetFailedTileCount() != 0)) {
+                    std::printf("FAIL: %zu tiles still missing after the device recovered\n",
+                                terrain.GetMissingTileCount());
+                    ok = false;
+                }
+                if (ok) {
+                    std::printf("failing tiles: preload finished, %zu vertex buffer attempts for %zu tiles\n",
+                                attemptsBefore, requested);
+                }
+            }
+        }
+        logger.SetLevel(level);
+        return ok;
+    }
+
+    struct Segment {
+        double ms = 0.0;
+        double maxMs = 0.0;
+        size_t frames = 0;
+        size_t maxResidentBytes = 0;
+        size_t maxResidentTiles = 0;
+        size_t drawnTiles = 0;
+        size_t maxMissingTiles = 0;
+        size_t built = 0;
+        size_t evicted = 0;
+    };
+}
+
+int main(int argc, char** argv) {
+    double kilometres = 20.0;
+    size_t budgetMb = 16;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--budget-mb") && i + 1 < argc) budgetMb = std::strtoull(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "--check")) kilometres = 2.0;
+        else kilometres = std::atof(argv[i]);
+    }
+    if (kilometres <= 0.0) kilometres = 1.0;
+
+    TerrainHeightfield heightfield;
+    if (!CheckIndices() || !CheckSeams(heightfield)) return 1;
+    std::printf("stitched lod variants and shared tile edges: OK\n");
+    if (!CheckFailedTiles(heightfield)) return 1;
+
+    NullRenderDevice device;
+    Render render(device);
+    if (!render.Initialize()) return 1;
+    AssetLoader assetLoader(2);
+    Terrain terrain(device, assetLoader, heightfield);
+    if (!terrain.Initialize()) return 1;
+    terrain.SetMemoryBudget(budgetMb * 1024 * 1024);
+
+    KatamariWorld world;
+    world.SetGround(&heightfield);
+    world.PopulateDefaultScene();
+    std::vector<MeshHandle> bodyMeshes; // тела не рисуются, замеряется только земля
+    if (!Preload(terrain, assetLoader, world.GetKatamari()->GetPosition())) return 1;
+
+    // Шаг 0.5 с при скорости 5 м/с - 2.5 м за кадр, пролёт со скоростью около 150 м/с при 60 кадрах
+    const float deltaTime = 0.5f;
+    const double metresPerFrame = 2.5;
+    size_t totalFrames = static_cast<size_t>(kilometres * 1000.0 / metresPerFrame);
+    size_t framesPerKm = static_cast<size_t>(1000.0 / metresPerFrame);
+    AssetUploadBudget uploadBudget;
+
+    std::vector<Segment> segments(static_cast<size_t>(std::ceil(kilometres)));
+    bool ok = true;
+    double maxGroundError = 0.0;
+    for (size_t frame = 0; frame < totalFrames; ++frame) {
+        // Первая половина пути - вперёд, вторая - вправо: меняется направление подгрузки
+        KatamariInput input;
+        if (frame < totalFrames / 2) input.forward = true;
+        else input.right = true;
+
+        size_t builtBefore = terrain.GetBuiltTileCount(), evictedBefore = terrain.GetEvictedTileCount();
+        auto start = std::chrono::steady_clock::now();
+        world.Step(input, deltaTime);
+        DirectX::XMFLOAT3 position = world.GetKatamari()->GetPosition();
+        terrain.Update(position);
+        assetLoader.PumpUploads(uploadBudget);
+        FollowCamera& camera = world.GetCamera();
+        render.RenderScene(world.GetBodies(), bodyMeshes, &terrain, camera.GetViewProjMatrix(), camera.GetPosition());
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        // Кадры здесь идут без паузы в 16 мс, поэтому заказанные тайлы достраиваются и выгружаются вне замера,
+        // как если бы рабочие потоки успели за остаток кадра
+        size_t missing = terrain.GetMissingTileCount();
+        if (terrain.GetPendingTileCount() > 0) assetLoader.Flush();
+
+        Segment& segment = segments[std::min(frame / framesPerKm, segments.size() - 1)];
+        segment.ms += ms;
+        segment.maxMs = std::max(segment.maxMs, ms);
+        ++segment.frames;
+        segment.maxResidentBytes = std::max(segment.maxResidentBytes, terrain.GetResidentBytes());
+        segment.maxResidentTiles = std::max(segment.maxResidentTiles, terrain.GetResidentTileCount());
+        segment.drawnTiles += terrain.GetLastDrawnTileCount();
+        segment.maxMissingTiles = std::max(segment.maxMissingTiles, missing);
+        segment.built += terrain.GetBuiltTileCount() - builtBefore;
+        segment.evicted += terrain.GetEvictedTileCount() - evictedBefore;
+
+        float expectedY = heightfield.GetHeight(position.x, position.z) + world.GetKatamari()->radius;
+        maxGroundError = std::max(maxGroundError, double(std::fabs(position.y - expectedY)));
+    }
+
+    std::printf("km   ms/frame   max ms  resident MB  tiles  drawn/frame  max missing  built  evicted\n");
+    for (size_t i = 0; i < segments.size(); ++i) {
+        const Segment& s = segments[i];
+        if (!s.frames) continue;
+        std::printf("%-4zu %8.3f %8.3f %12.2f %6zu %12.1f %12zu %6zu %8zu\n", i + 1, s.ms / s.frames, s.maxMs,
+                    s.maxResidentBytes / (1024.0 * 1024.0), s.maxResidentTiles, double(s.drawnTiles) / s.frames,
+                    s.maxMissingTiles, s.built, s.evicted);
+    }
+    DirectX::XMFLOAT3 end = world.GetKatamari()->GetPosition();
+    std::printf("end position: %.0f, %.1f, %.0f; tiles built %zu, evicted %zu; budget %zu MB\n", end.x, end.y, end.z,
+                terrain.GetBuiltTileCount(), terrain.GetEvictedTileCount(), budgetMb);
+
+    // Первый километр прогревает кэш; дальше память и время кадра не должны расти с расстоянием
+    const Segment& first = segments.size() > 1 ? segments[1] : segments[0];
+    const Segment& last = segments.back();
+    for (const Segment& s : segments) {
+        if (s.maxResidentBytes > terrain.GetMemoryBudget()) {
+            std::printf("FAIL: resident tiles use %zu bytes, over the %zu byte budget\n", s.maxResidentBytes,
+                        terrain.GetMemoryBudget());
+            ok = false;
+            break;
+        }
+    }
+    if (last.frames && first.frames && last.ms / last.frames > 1.5 * first.ms / first.frames + 0.05) {
+        std::printf("FAIL: frame time grew from %.3f to %.3f ms over the run\n", first.ms / first.frames,
+                    last.ms / last.frames);
+        ok = false;
+    }
+    if (last.maxResidentTiles > first.maxResidentTiles + 2 * (2 * terrain.GetViewRadius() + 3)) {
+        std::printf("FAIL: resident tile count grew from %zu to %zu\n", first.maxResidentTiles, last.maxResidentTiles);
+        ok = false;
+    }
+    if (maxGroundError > 1e-3) {
+        std::printf("FAIL: katamari drifted %.4f m off the terrain surface\n", maxGroundError);
+        ok = false;
+    }
+    std::printf(ok ? "OK\n" : "FAILED\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,360 @@
+// Обновление мировых трансформаций для глубоких и широких куч катамари:
+// плоский проход TransformHierarchy против прежней рекурсивной схемы Update + XMMatrixDecompose.
+// Перед замером проверяется, что удаление узла делает его потомков корнями без сдвига в мире.
+// Затем почти неподвижные сцены: лежащие мячи, катящийся катамари с кучей и доля мячей, сдвигаемых каждый кадр;
+// пересчёт только грязных узлов сравнивается с полным проходом по времени и побитово по матрицам.
+// Наконец сбор кучи: каждый кадр катамари подбирает мячи, а регионы усыпляют и будят лежащие мячи;
+// ни прикрепление, ни удаление не должны пересортировывать массив.
+// Запуск: TransformHierarchyBenchmark [число прикреплённых тел] [число кадров] [--check]
+#include "TransformHierarchy.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+    // Прежняя схема CelestialBody::Update: relativeTransform * parentWorld, затем разложение матрицы
+    struct LegacyBody {
+        DirectX::XMFLOAT3 position;
+        DirectX::XMFLOAT4 rotation = DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+        float radius = 1.0f;
+        DirectX::XMMATRIX relativeTransform = DirectX::XMMatrixIdentity();
+        LegacyBody* parent = nullptr;
+        std::vector<LegacyBody*> children;
+
+        DirectX::XMMATRIX GetWorldMatrix() const {
+            return DirectX::XMMatrixScaling(radius, radius, radius) *
+                   DirectX::XMMatrixRotationQuaternion(DirectX::XMLoadFloat4(&rotation)) *
+                   DirectX::XMMatrixTranslation(position.x, position.y, position.z);
+        }
+
+        void Update() {
+            if (parent) {
+                DirectX::XMMATRIX world = relativeTransform * parent->GetWorldMatrix();
+                DirectX::XMVECTOR pos, rot, scale;
+                DirectX::XMMatrixDecompose(&scale, &rot, &pos, world);
+                DirectX::XMStoreFloat3(&position, pos);
+                DirectX::XMStoreFloat4(&rotation, rot);
+            }
+            for (auto* child : children) child->Update();
+        }
+
+        void AttachChild(LegacyBody* child) {
+            child->parent = this;
+            DirectX::XMVECTOR relative = DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&child->position),
+                                                                   DirectX::XMLoadFloat3(&position));
+            child->relativeTransform = DirectX::XMMatrixTranslationFromVector(relative);
+            children.push_back(child);
+        }
+    };
+
+    struct Pile {
+        TransformHierarchy hierarchy;
+        std::vector<TransformHierarchy::NodeId> nodes;
+        std::vector<std::unique_ptr<LegacyBody>> legacy;
+    };
+
+    // deep: каждое тело прикреплено к предыдущему; wide: все тела прикреплены к корню
+    void BuildPile(Pile& pile, size_t count, bool deep) {
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+        DirectX::XMFLOAT4 identity(0.0f, 0.0f, 0.0f, 1.0f);
+
+        for (size_t i = 0; i <= count; ++i) {
+            DirectX::XMFLOAT3 position(offset(rng) + i * 0.01f, 1.0f + offset(rng), offset(rng));
+            pile.nodes.push_back(pile.hierarchy.CreateNode(position, identity, 1.0f));
+            auto body = std::make_unique<LegacyBody>();
+            body->position = position;
+            pile.legacy.push_back(std::move(body));
+        }
+        for (size_t i = 1; i <= count; ++i) {
+            size_t parent = deep ? i - 1 : 0;
+            pile.hierarchy.SetParent(pile.nodes[i], pile.nodes[parent]);
+            pile.legacy[parent]->AttachChild(pile.legacy[i].get());
+        }
+        pile.hierarchy.UpdateWorldTransforms();
+    }
+
+    void RollRoot(Pile& pile, int frame) {
+        DirectX::XMVECTOR delta = DirectX::XMQuaternionRotationAxis(DirectX::XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f), 0.01f);
+        DirectX::XMFLOAT3 position(0.0f, 1.0f, frame * 0.05f);
+
+        DirectX::XMFLOAT4 rotation = pile.hierarchy.GetLocalRotation(pile.nodes[0]);
+        DirectX::XMStoreFloat4(&rotation, DirectX::XMQuaternionMultiply(DirectX::XMLoadFloat4(&rotation), delta));
+        pile.hierarchy.SetLocalRotation(pile.nodes[0], rotation);
+        pile.hierarchy.SetLocalPosition(pile.nodes[0], position);
+
+        LegacyBody& root = *pile.legacy[0];
+        DirectX::XMStoreFloat4(&root.rotation, DirectX::XMQuaternionMultiply(DirectX::XMLoadFloat4(&root.rotation), delta));
+        root.position = position;
+    }
+
+    double MaxPositionError(const Pile& pile) {
+        double maxError = 0.0;
+        for (size_t i = 0; i < pile.nodes.size(); ++i) {
+            DirectX::XMFLOAT3 a = pile.hierarchy.GetWorldPosition(pile.nodes[i]);
+            const DirectX::XMFLOAT3& b = pile.legacy[i]->position;
+            double error = std::fabs(a.x - b.x) + std::fabs(a.y - b.y) + std::fabs(a.z - b.z);
+            if (error > maxError) maxError = error;
+        }
+        return maxError;
+    }
+
+    void Run(const char* name, size_t count, bool deep, int frames) {
+        Pile pile;
+        BuildPile(pile, count, deep);
+
+        auto flatStart = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            RollRoot(pile, frame);
+            pile.hierarchy.UpdateWorldTransforms();
+        }
+        double flatMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - flatStart).count() / frames;
+
+        // Прежний главный цикл вызывал Update у каждого тела, и каждое рекурсивно обновляло поддерево.
+        // Для глубокой кучи это квадратичная стоимость, поэтому прогоняется только первый кадр
+        int legacyFrames = deep ? 1 : frames;
+        Pile legacyPile;
+        BuildPile(legacyPile, count, deep);
+        auto legacyStart = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < legacyFrames; ++frame) {
+            RollRoot(legacyPile, frame);
+            for (auto& body : legacyPile.legacy) body->Update();
+        }
+        double legacyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - legacyStart).count() / legacyFrames;
+
+        legacyPile.hierarchy.UpdateWorldTransforms();
+        std::printf("%-6s %8zu %14.3f %16.3f %12.2e\n", name, count, flatMs, legacyMs, MaxPositionError(legacyPile));
+    }
+
+    // Катамари (узел 0) с кучей из pileCount тел и staticCount лежащих мячей
+    void BuildStaticScene(TransformHierarchy& hierarchy, std::vector<TransformHierarchy::NodeId>& nodes,
+                          size_t staticCount, size_t pileCount) {
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> coordinate(-500.0f, 500.0f);
+        DirectX::XMFLOAT4 identity(0.0f, 0.0f, 0.0f, 1.0f);
+        nodes.push_back(hierarchy.CreateNode(DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f), identity, 1.0f));
+        for (size_t i = 0; i < staticCount + pileCount; ++i) {
+            DirectX::XMFLOAT3 position(coordinate(rng), 0.5f, coordinate(rng));
+            if (i < pileCount) position = DirectX::XMFLOAT3(std::cos(i * 0.7f), 1.0f + std::sin(i * 0.3f), std::sin(i * 0.7f));
+            nodes.push_back(hierarchy.CreateNode(position, identity, 0.4f));
+        }
+        for (size_t i = 1; i <= pileCount; ++i) hierarchy.SetParent(nodes[i], nodes[0]);
+        hierarchy.UpdateWorldTransforms();
+    }
+
+    // Кадр: катамари катится, каждый movingStride-й лежащий мяч сдвигается (0 - все лежат)
+    void StepStaticScene(TransformHierarchy& hierarchy, const std::vector<TransformHierarchy::NodeId>& nodes,
+                         size_t pileCount, size_t movingStride, int frame) {
+        DirectX::XMFLOAT4 rotation;
+        DirectX::XMStoreFloat4(&rotation, DirectX::XMQuaternionRotationAxis(DirectX::XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f),
+                                                                            frame * 0.01f));
+        hierarchy.SetLocalRotation(nodes[0], rotation);
+        hierarchy.SetLocalPosition(nodes[0], DirectX::XMFLOAT3(0.0f, 1.0f, frame * 0.05f));
+        for (size_t i = pileCount + 1; movingStride && i < nodes.size(); i += movingStride) {
+            DirectX::XMFLOAT3 position = hierarchy.GetLocalPosition(nodes[i]);
+            position.x += 0.01f;
+            hierarchy.SetLocalPosition(nodes[i], position);
+        }
+        hierarchy.UpdateWorldTransforms();
+    }
+
+    bool RunStatic(size_t staticCount, size_t pileCount, size_t movingStride, int frames) {
+        TransformHierarchy incremental, full;
+        full.SetIncrementalUpdates(false);
+        std::vector<TransformHierarchy::NodeId> incrementalNodes, fullNodes;
+        BuildStaticScene(incremental, incrementalNodes, staticCount, pileCount);
+        BuildStaticScene(full, fullNodes, staticCount, pileCount);
+
+        auto incrementalStart = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame) StepStaticScene(incremental, incrementalNodes, pileCount, movingStride, frame);
+        double incrementalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - incrementalStart).count() / frames;
+        auto fullStart = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame) StepStaticScene(full, fullNodes, pileCount, movingStride, frame);
+        double fullMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - fullStart).count() / frames;
+
+        size_t moving = movingStride ? (staticCount + movingStride - 1) / movingStride : 0;
+        size_t expected = 1 + pileCount + moving;
+        double movingPercent = staticCount ? 100.0 * moving / staticCount : 0.0;
+        std::printf("%8zu %6zu %8.1f%% %12zu %10zu %14.4f %13.4f %8.1fx\n", staticCount, pileCount, movingPercent,
+                    incremental.GetLastRecomputedCount(), incremental.GetLastReusedCount(), incrementalMs, fullMs,
+                    incrementalMs > 0.0 ? fullMs / incrementalMs : 0.0);
+        if (incremental.GetLastRecomputedCount() != expected) {
+            std::printf("FAIL: %zu matrices recomputed, expected %zu\n", incremental.GetLastRecomputedCount(), expected);
+            return false;
+        }
+        // Пропущенный пересчёт дал бы устаревшую матрицу; лишний - те же биты, поэтому сверка побитовая
+        for (size_t i = 0; i < incrementalNodes.size(); ++i) {
+            DirectX::XMFLOAT4X4 a, b;
+            DirectX::XMStoreFloat4x4(&a, incremental.GetWorldMatrix(incrementalNodes[i]));
+            DirectX::XMStoreFloat4x4(&b, full.GetWorldMatrix(fullNodes[i]));
+            if (std::memcmp(&a, &b, sizeof(a)) != 0) {
+                std::printf("FAIL: node %zu differs from the full pass\n", i);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Кадр сбора: attachCount мячей прикрепляются к катамари, столько же лежащих удаляются и создаются заново
+    void StepAttachScene(TransformHierarchy& hierarchy, std::vector<TransformHierarchy::NodeId>& loose, std::mt19937& rng,
+                         TransformHierarchy::NodeId katamari, size_t attachCount, int frame) {
+        DirectX::XMFLOAT4 identity(0.0f, 0.0f, 0.0f, 1.0f);
+        hierarchy.SetLocalPosition(katamari, DirectX::XMFLOAT3(0.0f, 1.0f, frame * 0.05f));
+        for (size_t i = 0; i < attachCount && !loose.empty(); ++i) {
+            size_t index = rng() % loose.size();
+            hierarchy.SetParent(loose[index], katamari);
+            loose[index] = loose.back();
+            loose.pop_back();
+        }
+        for (size_t i = 0; i < attachCount && !loose.empty(); ++i) {
+            size_t index = rng() % loose.size();
+            hierarchy.DestroyNode(loose[index]);
+            loose[index] = hierarchy.CreateNode(DirectX::XMFLOAT3(frame * 0.1f, 0.5f, i * 0.1f), identity, 0.4f);
+        }
+        hierarchy.UpdateWorldTransforms();
+    }
+
+    bool RunAttach(size_t staticCount, size_t attachCount, int frames) {
+        TransformHierarchy incremental, full;
+        full.SetIncrementalUpdates(false);
+        std::vector<TransformHierarchy::NodeId> incrementalNodes, fullNodes;
+        BuildStaticScene(incremental, incrementalNodes, staticCount, 0);
+        BuildStaticScene(full, fullNodes, staticCount, 0);
+        std::vector<TransformHierarchy::NodeId> incrementalLoose(incrementalNodes.begin() + 1, incrementalNodes.end());
+        std::vector<TransformHierarchy::NodeId> fullLoose(fullNodes.begin() + 1, fullNodes.end());
+        std::mt19937 incrementalRng(11), fullRng(11);
+
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            StepAttachScene(incremental, incrementalLoose, incrementalRng, incrementalNodes[0], attachCount, frame);
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+        for (int frame = 0; frame < frames; ++frame) StepAttachScene(full, fullLoose, fullRng, fullNodes[0], attachCount, frame);
+
+        size_t attached = attachCount * frames;
+        std::printf("%8zu %8zu %10zu %8zu %14.4f\n", staticCount, attachCount, attached, incremental.GetSortCount(), ms);
+        if (incremental.GetSortCount() != 0) {
+            std::printf("FAIL: %zu sorts for %zu attaches, expected none\n", incremental.GetSortCount(), attached);
+            return false;
+        }
+        for (size_t i = 0; i < incrementalLoose.size(); ++i) {
+            DirectX::XMFLOAT4X4 a, b;
+            DirectX::XMStoreFloat4x4(&a, incremental.GetWorldMatrix(incrementalLoose[i]));
+            DirectX::XMStoreFloat4x4(&b, full.GetWorldMatrix(fullLoose[i]));
+            if (std::memcmp(&a, &b, sizeof(a)) != 0) {
+                std::printf("FAIL: loose node %zu differs from the full pass\n", i);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool SameWorld(const TransformHierarchy& hierarchy, TransformHierarchy::NodeId node, const DirectX::XMFLOAT3& position,
+                   const DirectX::XMFLOAT4& rotation, float scale) {
+        DirectX::XMFLOAT3 p = hierarchy.GetWorldPosition(node);
+        DirectX::XMFLOAT4 r = hierarchy.GetWorldRotation(node);
+        float error = std::fabs(p.x - position.x) + std::fabs(p.y - position.y) + std::fabs(p.z - position.z) +
+                      std::fabs(r.x - rotation.x) + std::fabs(r.y - rotation.y) + std::fabs(r.z - rotation.z) +
+                      std::fabs(r.w - rotation.w) + std::fabs(hierarchy.GetWorldScale(node) - scale);
+        return error < 1e-4f;
+    }
+
+    // Удаление узла: прямые потомки становятся корнями с прежней мировой трансформацией,
+    // внуки остаются у своих родителей, а перенесённый ранее ребёнок не задевается
+    bool CheckDestroyReroots() {
+        using NodeId = TransformHierarchy::NodeId;
+        TransformHierarchy hierarchy;
+        DirectX::XMFLOAT4 identity(0.0f, 0.0f, 0.0f, 1.0f);
+        DirectX::XMFLOAT4 turned;
+        DirectX::XMStoreFloat4(&turned, DirectX::XMQuaternionRotationAxis(DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), 0.7f));
+
+        NodeId root = hierarchy.CreateNode(DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f), turned, 2.0f);
+        NodeId parent = hierarchy.CreateNode(DirectX::XMFLOAT3(3.0f, 1.0f, 0.0f), turned, 0.5f);
+        NodeId first = hierarchy.CreateNode(DirectX::XMFLOAT3(4.0f, 2.0f, 1.0f), identity, 0.3f);
+        NodeId second = hierarchy.CreateNode(DirectX::XMFLOAT3(2.0f, 0.5f, -1.0f), identity, 0.2f);
+        NodeId moved = hierarchy.CreateNode(DirectX::XMFLOAT3(3.0f, 3.0f, 3.0f), identity, 0.1f);
+        NodeId grandchild = hierarchy.CreateNode(DirectX::XMFLOAT3(5.0f, 2.0f, 1.0f), identity, 0.1f);
+        hierarchy.SetParent(parent, root);
+        hierarchy.SetParent(first, parent);
+        hierarchy.SetParent(second, parent);
+        hierarchy.SetParent(moved, parent);
+        hierarchy.SetParent(grandchild, first);
+        hierarchy.SetParent(moved, root);
+        hierarchy.UpdateWorldTransforms();
+
+        const NodeId watched[] = { first, second, moved, grandchild };
+        DirectX::XMFLOAT3 positions[4];
+        DirectX::XMFLOAT4 rotations[4];
+        float scales[4];
+        for (int i = 0; i < 4; ++i) {
+            positions[i] = hierarchy.GetWorldPosition(watched[i]);
+            rotations[i] = hierarchy.GetWorldRotation(watched[i]);
+            scales[i] = hierarchy.GetWorldScale(watched[i]);
+        }
+
+        hierarchy.DestroyNode(parent);
+        hierarchy.UpdateWorldTransforms();
+        bool ok = hierarchy.GetParent(first) == TransformHierarchy::InvalidNode &&
+                  hierarchy.GetParent(second) == TransformHierarchy::InvalidNode && hierarchy.GetParent(moved) == root &&
+                  hierarchy.GetParent(grandchild) == first;
+        for (int i = 0; i < 4; ++i) ok = ok && SameWorld(hierarchy, watched[i], positions[i], rotations[i], scales[i]);
+
+        // Освобождённый NodeId возвращается без потомков: его удаление не трогает чужих детей
+        NodeId reused = hierarchy.CreateNode(DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), identity, 1.0f);
+        hierarchy.DestroyNode(reused);
+        ok = ok && hierarchy.GetParent(moved) == root && hierarchy.GetParent(grandchild) == first;
+
+        hierarchy.DestroyNode(first);
+        hierarchy.UpdateWorldTransforms();
+        ok = ok && hierarchy.GetParent(grandchild) == TransformHierarchy::InvalidNode &&
+             SameWorld(hierarchy, grandchild, positions[3], rotations[3], scales[3]) && hierarchy.GetNodeCount() == 4;
+
+        std::printf("destroy re-roots children: %s\n", ok ? "ok" : "FAIL");
+        return ok;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t count = 10000;
+    int frames = 100;
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--check")) {
+            count = 1000;
+            frames = 3;
+        } else if (positional == 0 && ++positional) {
+            count = static_cast<size_t>(std::atoll(argv[i]));
+        } else if (positional == 1 && ++positional) {
+            frames = std::atoi(argv[i]);
+        }
+    }
+    if (frames <= 0) frames = 1;
+    if (!CheckDestroyReroots()) return 1;
+
+    std::printf("%-6s %8s %14s %16s %12s\n", "pile", "children", "flat ms/frame", "legacy ms/frame", "max error");
+    Run("wide", count, false, frames);
+    Run("deep", count, true, frames);
+
+    std::printf("\n%8s %6s %9s %12s %10s %14s %13s %9s\n", "static", "pile", "moving", "recomputed", "reused",
+                "dirty ms/frame", "full ms/frame", "speedup");
+    bool ok = true;
+    const size_t pileCounts[] = { 0, 500 };
+    const size_t movingStrides[] = { 0, 100, 10 };
+    for (size_t staticCount : { count, count * 10 }) {
+        for (size_t pileCount : pileCounts) {
+            for (size_t stride : movingStrides) ok = RunStatic(staticCount, pileCount, stride, frames) && ok;
+        }
+    }
+
+    std::printf("\n%8s %8s %10s %8s %14s\n", "static", "attach", "attached", "sorts", "ms/frame");
+    for (size_t staticCount : { count, count * 10 }) {
+        for (size_t attachCount : { size_t(1), size_t(16) }) ok = RunAttach(staticCount, attachCount, frames) && ok;
+    }
+    std::printf(ok ? "OK\n" : "FAILED\n");
+    return ok ? 0 : 1;
+}
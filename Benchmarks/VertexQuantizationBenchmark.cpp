@@ -0,0 +1,249 @@
+// Сжатые вершины: проверка ошибки квантования на синтетических мешах, экономия памяти и чтения вершин по моделям,
+// сверка кадра программного растеризатора с Float32 и Compact вершинами.
+// Запуск: VertexQuantizationBenchmark [модель.obj ...] [--check]
+#include "SoftwareRenderDevice.h"
+#include "Render.h"
+#include "Ground.h"
+#include "KatamariWorld.h"
+#include "MeshRegistry.h"
+#include "ModelLoader.h"
+#include "VertexQuantizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <objbase.h>
+#endif
+
+namespace {
+    // Октаэдрическая развёртка в SNORM16: шаг решётки 1/32767, растяжение развёртки не больше двух
+    constexpr double MaxNormalErrorDegrees = 0.01;
+
+    struct QuantizationError {
+        double position = 0.0; // наибольшая ошибка в долях допуска (полшага решётки); допустимо <= 1
+        double texCoord = 0.0;
+        double normalDegrees = 0.0;
+    };
+
+    double ToleranceRatio(float original, float decoded, float scale) {
+        // Полшага UNORM16 плюс округление float при восстановлении offset + unorm * scale
+        double tolerance = 0.5 * scale / 65535.0 + 4.0 * 1.2e-7 * (std::fabs(original) + std::fabs(scale));
+        double error = std::fabs(double(original) - double(decoded));
+        return tolerance > 0.0 ? error / tolerance : (error > 0.0 ? 1e9 : 0.0);
+    }
+
+    QuantizationError Measure(const float* vertices, size_t vertexCount) {
+        VertexQuantization quantization = VertexQuantizer::ComputeQuantization(vertices, vertexCount);
+        std::vector<CompactVertex> packed;
+        VertexQuantizer::Encode(vertices, vertexCount, quantization, packed);
+
+        QuantizationError error;
+        for (size_t i = 0; i < vertexCount; ++i) {
+            const float* original = vertices + i * VertexQuantizer::FloatsPerVertex;
+            float decoded[VertexQuantizer::FloatsPerVertex];
+            VertexQuantizer::Decode(packed[i], quantization, decoded);
+            for (int c = 0; c < 3; ++c) {
+                error.position = std::max(error.position, ToleranceRatio(original[c], decoded[c], quantization.positionScale[c]));
+            }
+            for (int c = 0; c < 2; ++c) {
+                error.texCoord = std::max(error.texCoord,
+                                          ToleranceRatio(original[6 + c], decoded[6 + c], quantization.texCoordScale[c]));
+            }
+            double length = std::sqrt(double(original[3]) * original[3] + double(original[4]) * original[4] +
+                                      double(original[5]) * original[5]);
+            if (length > 0.0) {
+                // Угол через модуль векторного произведения: acos теряет точность около единицы
+                double cx = double(original[4]) * decoded[5] - double(original[5]) * decoded[4];
+                double cy = double(original[5]) * decoded[3] - double(original[3]) * decoded[5];
+                double cz = double(original[3]) * decoded[4] - double(original[4]) * decoded[3];
+                double sine = std::sqrt(cx * cx + cy * cy + cz * cz) / length;
+                error.normalDegrees = std::max(error.normalDegrees, std::asin(std::min(sine, 1.0)) * 180.0 / 3.14159265358979);
+            }
+        }
+        return error;
+    }
+
+    bool Check(const char* name, const std::vector<float>& vertices) {
+        QuantizationError error = Measure(vertices.data(), vertices.size() / VertexQuantizer::FloatsPerVertex);
+        std::printf("%-14s %10zu %14.3f %14.3f %16.5f\n", name, vertices.size() / VertexQuantizer::FloatsPerVertex,
+                    error.position, error.texCoord, error.normalDegrees);
+        if (error.position > 1.0 || error.texCoord > 1.0 || error.normalDegrees > MaxNormalErrorDegrees) {
+            std::printf("FAIL: %s quantization error exceeds its bound\n", name);
+            return false;
+        }
+        return true;
+    }
+
+    void PushVertex(std::vector<float>& vertices, float x, float y, float z, float nx, float ny, float nz, float u, float v) {
+        float vertex[8] = { x, y, z, nx, ny, nz, u, v };
+        vertices.insert(vertices.end(), vertex, vertex + 8);
+    }
+
+    bool CheckSyntheticMeshes() {
+        std::mt19937 rng(13);
+        std::normal_distribution<float> gaussian(0.0f, 1.0f);
+
+        // Сфера: нормали совпадают с позициями, UV в [0, 1]
+        std::vector<float> sphere;
+        for (int ring = 0; ring <= 64; ++ring) {
+            for (int segment = 0; segment <= 128; ++segment) {
+                float theta = 3.14159265f * ring / 64, phi = 6.2831853f * segment / 128;
+                float x = std::sin(theta) * std::cos(phi), y = std::cos(theta), z = std::sin(theta) * std::sin(phi);
+                PushVertex(sphere, x, y, z, x, y, z, float(segment) / 128, float(ring) / 64);
+            }
+        }
+
+        // Протяжённое облако со смещённым центром и UV далеко за [0, 1]: проверка относительной точности
+        std::vector<float> cloud;
+        std::uniform_real_distribution<float> wide(-500.0f, 500.0f), thin(10.0f, 13.0f), uv(-3.0f, 7.0f);
+        for (int i = 0; i < 100000; ++i) {
+            float nx = gaussian(rng), ny = gaussian(rng), nz = gaussian(rng);
+            PushVertex(cloud, wide(rng) + 2000.0f, thin(rng), wide(rng), nx, ny, nz, uv(rng), uv(rng));
+        }
+
+        // Плоскость: нулевая протяжённость по y и по v должна восстанавливаться точно
+        std::vector<float> plane;
+        for (int i = 0; i < 1000; ++i) {
+            PushVertex(plane, float(i % 37), 0.5f, float(i / 37), 0.0f, 1.0f, 0.0f, float(i % 37) / 36.0f, 0.25f);
+        }
+
+        // Нормали по всей сфере направлений, включая оси и рёбра октаэдра
+        std::vector<float> normals;
+        for (int i = 0; i < 1000000; ++i) {
+            float nx = gaussian(rng), ny = gaussian(rng), nz = gaussian(rng);
+            if (i % 4 == 1) nx = 0.0f;
+            if (i % 8 == 2) nz = 0.0f;
+            PushVertex(normals, 0.0f, 0.0f, 0.0f, nx, ny, nz, 0.0f, 0.0f);
+        }
+        const float axes[6][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+        for (const float* axis : axes) PushVertex(normals, 0.0f, 0.0f, 0.0f, axis[0], axis[1], axis[2], 0.0f, 0.0f);
+
+        std::printf("%-14s %10s %14s %14s %16s\n", "mesh", "vertices", "pos err/bound", "uv err/bound", "normal err, deg");
+        return Check("sphere", sphere) && Check("wide cloud", cloud) && Check("flat plane", plane) &&
+               Check("normals", normals);
+    }
+
+    bool ReportModel(const std::string& path) {
+        ModelLoader loader;
+        if (!loader.LoadModel(path)) {
+            std::printf("FAIL: could not load %s\n", path.c_str());
+            return false;
+        }
+        size_t vertexCount = loader.GetVertexFloatCount() / VertexQuantizer::FloatsPerVertex;
+        size_t floatBytes = vertexCount * VertexQuantizer::GetStride(VertexFormat::Float32);
+        size_t compactBytes = vertexCount * VertexQuantizer::GetStride(VertexFormat::Compact);
+        QuantizationError error = Measure(loader.GetVertexData(), vertexCount);
+
+        // Чтение вершин на один вызов отрисовки базового уровня: каждая вершина выбирается хотя бы раз
+        std::printf("%s\n", path.c_str());
+        std::printf("  vertices: %zu, vertex buffer: %zu -> %zu bytes (saved %zu, %.0f%%)\n", vertexCount, floatBytes,
+                    compactBytes, floatBytes - compactBytes, 100.0 * double(floatBytes - compactBytes) / double(floatBytes));
+        std::printf("  vertex fetch per draw: %zu -> %zu bytes\n", floatBytes, compactBytes);
+        std::printf("  error: position %.3f, uv %.3f of bound, normal %.5f deg\n", error.position, error.texCoord,
+                    error.normalDegrees);
+        if (error.position > 1.0 || error.texCoord > 1.0 || error.normalDegrees > MaxNormalErrorDegrees) {
+            std::printf("FAIL: %s quantization error exceeds its bound\n", path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // Кадр сцены по умолчанию с телами в заданном формате; LOD выключен, чтобы сравнивались только вершины
+    bool RenderScene(VertexFormat format, std::vector<uint32_t>& pixels, size_t& covered, size_t& vertexBytes) {
+#ifdef _WIN32
+        AssetLoader assetLoader(1, [] { CoInitializeEx(nullptr, COINIT_MULTITHREADED); });
+#else
+        AssetLoader assetLoader(1);
+#endif
+        SoftwareRenderDevice device(800, 600);
+        Render render(device);
+        if (!render.Initialize()) return false;
+        render.SetLodEnabled(false);
+        render.SetInstancingEnabled(true);
+
+        Ground ground(device, assetLoader, "Textures/ground.obj");
+        assetLoader.Flush();
+        assetLoader.PumpUploads(AssetUploadBudget{ 1e9, size_t(-1) });
+
+        KatamariWorld world;
+        world.PopulateDefaultScene();
+        world.Step(KatamariInput());
+        std::vector<MeshHandle> bodyMeshes;
+        vertexBytes = 0;
+        for (const auto& body : world.GetBodies()) {
+            bodyMeshes.push_back(meshRegistry.Acquire(device, body->modelPath, format));
+            if (!bodyMeshes.back() || !bodyMeshes.back()->IsReady()) return false;
+            if (bodyMeshes.back()->vertexFormat != format) {
+                std::printf("FAIL: mesh was created in the wrong vertex format\n");
+                return false;
+            }
+        }
+        for (const MeshHandle& mesh : bodyMeshes) {
+            vertexBytes += mesh->loader.GetVertexFloatCount() / VertexQuantizer::FloatsPerVertex *
+                           VertexQuantizer::GetStride(format);
+        }
+
+        FollowCamera& camera = world.GetCamera();
+        render.RenderScene(world.GetBodies(), bodyMeshes, &ground, camera.GetViewProjMatrix(), camera.GetPosition());
+        pixels.clear();
+        for (uint32_t y = 0; y < device.GetHeight(); ++y) {
+            for (uint32_t x = 0; x < device.GetWidth(); ++x) pixels.push_back(device.GetPixel(x, y));
+        }
+        covered = device.CountCoveredPixels();
+        return true;
+    }
+
+    bool CompareFrames() {
+        std::vector<uint32_t> floatPixels, compactPixels;
+        size_t floatCovered = 0, compactCovered = 0, floatBytes = 0, compactBytes = 0;
+        if (!RenderScene(VertexFormat::Float32, floatPixels, floatCovered, floatBytes) ||
+            !RenderScene(VertexFormat::Compact, compactPixels, compactCovered, compactBytes)) {
+            std::printf("FAIL: the default scene could not be rendered (run from the directory containing Textures/)\n");
+            return false;
+        }
+
+        // Сдвиг вершин на доли тысячной радиуса меняет только отдельные пиксели на силуэтах
+        size_t differing = 0;
+        for (size_t i = 0; i < floatPixels.size(); ++i) {
+            int maxDelta = 0;
+            for (int shift = 0; shift < 24; shift += 8) {
+                int a = (floatPixels[i] >> shift) & 0xFF, b = (compactPixels[i] >> shift) & 0xFF;
+                maxDelta = std::max(maxDelta, std::abs(a - b));
+            }
+            if (maxDelta > 8) ++differing;
+        }
+        std::printf("default scene: body vertex buffers %zu -> %zu bytes per frame fetched in full, "
+                    "pixels differing by more than 8/255: %zu of %zu covered\n",
+                    floatBytes, compactBytes, differing, floatCovered);
+        if (floatCovered == 0 || differing * 1000 > floatCovered) {
+            std::printf("FAIL: compact vertices change more than 0.1%% of the covered pixels\n");
+            return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+#ifdef _WIN32
+    CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+#endif
+    std::vector<std::string> models;
+    // Проверки здесь быстрые: --check ничего не сокращает
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--check")) models.push_back(argv[i]);
+    }
+    if (models.empty()) models.push_back("Textures/soccer_ball.obj");
+
+    if (!CheckSyntheticMeshes()) return 1;
+    for (const std::string& model : models) {
+        if (!ReportModel(model)) return 1;
+    }
+    if (!CompareFrames()) return 1;
+    std::printf("OK\n");
+    return 0;
+}
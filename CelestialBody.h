@@ -1,47 +1,43 @@
 #pragma once
-#include <d3d11.h>
 #include <vector>
 #include <DirectXMath.h>
 #include <memory>
+#include <string>
 
-#include "ModelLoader.h"
+#include "TransformHierarchy.h"
 
+class MeshBvh;
+
+// Состояние тела для симуляции; меш и отрисовка живут на стороне рендера
 class CelestialBody {
 public:
-    CelestialBody(ID3D11Device* device, const std::string& modelPath, DirectX::XMFLOAT3 pos,
+    CelestialBody(TransformHierarchy& hierarchy, const std::string& modelPath, DirectX::XMFLOAT3 pos,
                   DirectX::XMFLOAT4 col, float rad, bool useTex, DirectX::XMFLOAT3 emissiveCol);
     ~CelestialBody();
+    CelestialBody(const CelestialBody&) = delete;
+    CelestialBody& operator=(const CelestialBody&) = delete;
 
-    void Draw(ID3D11DeviceContext* context, ID3D11Buffer* constantBuffer, DirectX::XMMATRIX viewProj,
-              DirectX::XMFLOAT3 cameraPos) const;
     void UpdatePosition(DirectX::XMVECTOR velocity, float deltaTime);
-    void Update();
+    void Rotate(DirectX::XMVECTOR deltaRotation);
     DirectX::XMMATRIX GetWorldMatrix() const;
+    // Сфера radius этого тела против другого: его сферы, а если задан collisionMesh - его треугольников
     const CelestialBody* CheckCollision(const CelestialBody* other, DirectX::XMVECTOR& attachmentPoint) const;
+    // Радиус сферы, в которую входит тело в мире: для широкой фазы и первой проверки в CheckCollision
+    float GetCollisionRadius() const;
     void AttachChild(CelestialBody* child);
-    DirectX::XMFLOAT3 GetPosition() const { return position; }
+    DirectX::XMFLOAT3 GetPosition() const { return transforms->GetWorldPosition(node); }
+    DirectX::XMFLOAT4 GetRotation() const { return transforms->GetWorldRotation(node); }
     const std::vector<CelestialBody*>& GetChildren() const { return children; }
 
-
-    void InitializeBuffers(ID3D11Device* device);
-    void LoadTexture(ID3D11Device* device, const std::string& texturePath);
-
-    DirectX::XMFLOAT3 position;
+    std::string modelPath;
     DirectX::XMFLOAT4 color;
     float radius;
     bool useTexture;
     DirectX::XMFLOAT3 emissiveColor;
-    DirectX::XMFLOAT4 rotation;
-    DirectX::XMMATRIX relativeTransform;
-
-    ID3D11Buffer* vertexBuffer;
-    ID3D11Buffer* indexBuffer;
-    ID3D11ShaderResourceView* textureSRV;
-
-    std::vector<float> vertices;
-    std::vector<unsigned int> indices;
-    std::unique_ptr<ModelLoader> modelLoader;
+    std::shared_ptr<const MeshBvh> collisionMesh; // форма модели для точного подбора; пусто - тело считается сферой
+    TransformHierarchy* transforms;
+    TransformHierarchy::NodeId node;
 
     CelestialBody* parent;
     std::vector<CelestialBody*> children;
-};
\ No newline at end of file
+};
@@ -0,0 +1,23 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+
+// Раскладка cbuffer ConstantBuffer из shader.hlsl (регистр b0). Матрицы передаются транспонированными.
+struct ConstantBufferData {
+    DirectX::XMMATRIX worldViewProj;
+    DirectX::XMMATRIX world;
+    DirectX::XMFLOAT4 color;
+    int32_t useTexture; // BOOL в HLSL
+    DirectX::XMFLOAT3 lightPos; // в шейдере - направление света lightDir
+    DirectX::XMFLOAT3 lightColor;
+    DirectX::XMFLOAT3 materialDiffuse;
+    DirectX::XMFLOAT3 materialSpecular;
+    float shininess;
+    DirectX::XMFLOAT3 emissiveColor;
+    DirectX::XMFLOAT3 cameraPos;
+    float padding;
+    // VertexQuantization меша для конвейеров *Compact: xyz - позиция, w не используется
+    DirectX::XMFLOAT4 positionOffset;
+    DirectX::XMFLOAT4 positionScale;
+    DirectX::XMFLOAT4 texCoordTransform; // xy - смещение, zw - масштаб
+};
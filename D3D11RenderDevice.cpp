@@ -0,0 +1,522 @@
+#include "D3D11RenderDevice.h"
+#include "Logger.h"
+#include <d3dcompiler.h>
+#include <cstring>
+#include <vector>
+
+D3D11RenderDevice::D3D11RenderDevice(HWND hwnd) : hwnd(hwnd), device(nullptr), context(nullptr), swapChain(nullptr),
+    renderTargetView(nullptr), depthStencilView(nullptr), depthStencilState(nullptr), depthStencilBuffer(nullptr),
+    vertexShader(nullptr), pixelShaderTextured(nullptr), pixelShaderColored(nullptr), inputLayout(nullptr),
+    samplerState(nullptr), vertexShaderInstanced(nullptr), inputLayoutInstanced(nullptr), instancingSupported(false),
+    vertexShaderCompact(nullptr), inputLayoutCompact(nullptr), vertexShaderInstancedCompact(nullptr),
+    inputLayoutInstancedCompact(nullptr), compactSupported(false) {
+    LOG_INFO << "[D3D11RenderDevice] Создан объект D3D11RenderDevice" << std::endl;
+}
+
+D3D11RenderDevice::~D3D11RenderDevice() {
+    for (auto& entry : buffers) entry.second.buffer->Release();
+    for (auto& entry : textures) entry.second->Release();
+    if (!buffers.empty() || !textures.empty()) {
+        LOG_INFO << "[D3D11RenderDevice] Освобождено ресурсов, переживших устройство: " << buffers.size() + textures.size() << std::endl;
+    }
+    if (inputLayoutInstancedCompact) inputLayoutInstancedCompact->Release();
+    if (vertexShaderInstancedCompact) vertexShaderInstancedCompact->Release();
+    if (inputLayoutCompact) inputLayoutCompact->Release();
+    if (vertexShaderCompact) vertexShaderCompact->Release();
+    if (inputLayoutInstanced) inputLayoutInstanced->Release();
+    if (vertexShaderInstanced) vertexShaderInstanced->Release();
+    if (samplerState) samplerState->Release();
+    if (inputLayout) inputLayout->Release();
+    if (pixelShaderTextured) pixelShaderTextured->Release();
+    if (pixelShaderColored) pixelShaderColored->Release();
+    if (vertexShader) vertexShader->Release();
+    if (depthStencilState) depthStencilState->Release();
+    if (depthStencilView) depthStencilView->Release();
+    if (depthStencilBuffer) depthStencilBuffer->Release();
+    if (renderTargetView) renderTargetView->Release();
+    if (swapChain) swapChain->Release();
+    if (context) context->Release();
+    if (device) device->Release();
+    LOG_INFO << "[D3D11RenderDevice] Объект D3D11RenderDevice уничтожен" << std::endl;
+}
+
+bool D3D11RenderDevice::Initialize() {
+    LOG_INFO << "[D3D11RenderDevice] Начало инициализации устройства" << std::endl;
+
+    DXGI_SWAP_CHAIN_DESC scd = {};
+    scd.BufferCount = 1;
+    scd.BufferDesc.Width = 800;
+    scd.BufferDesc.Height = 600;
+    scd.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    scd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+    scd.OutputWindow = hwnd;
+    scd.SampleDesc.Count = 1;
+    scd.Windowed = TRUE;
+
+    HRESULT hr = D3D11CreateDeviceAndSwapChain(nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr, 0, nullptr, 0,
+        D3D11_SDK_VERSION, &scd, &swapChain, &device, nullptr, &context);
+    if (FAILED(hr)) {
+        LOG_ERROR << "[D3D11RenderDevice] Ошибка: не удалось создать устройство и цепочку обмена" << std::endl;
+        return false;
+    }
+    LOG_DEBUG << "[D3D11RenderDevice] Устройство и цепочка обмена созданы" << std::endl;
+
+    ID3D11Texture2D* backBuffer;
+    swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), (void**)&backBuffer);
+    hr = device->CreateRenderTargetView(backBuffer, nullptr, &renderTargetView);
+    backBuffer->Release();
+    if (FAILED(hr)) {
+        LOG_ERROR << "[D3D11RenderDevice] Ошибка: не удалось создать RenderTargetView" << std::endl;
+        return false;
+    }
+    LOG_DEBUG << "[D3D11RenderDevice] RenderTargetView создан" << std::endl;
+
+    D3D11_TEXTURE2D_DESC depthDesc = {};
+    depthDesc.Width = 800;
+    depthDesc.Height = 600;
+    depthDesc.MipLevels = 1;
+    depthDesc.ArraySize = 1;
+    depthDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+    depthDesc.SampleDesc.Count = 1;
+    depthDesc.Usage = D3D11_USAGE_DEFAULT;
+    depthDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+
+    hr = device->CreateTexture2D(&depthDesc, nullptr, &depthStencilBuffer);
+    if (FAILED(hr)) {
+        LOG_ERROR << "[D3D11RenderDevice] Ошибка: не удалось создать буфер глубины" << std::endl;
+        return false;
+    }
+    LOG_DEBUG << "[D3D11RenderDevice] Буфер глубины создан" << std::endl;
+
+    hr = device->CreateDepthStencilView(depthStencilBuffer, nullptr, &depthStencilView);
+    if (FAILED(hr)) {
+        LOG_ERROR << "[D3D11RenderDevice] Ошибка: не удалось создать DepthStencilView" << std::endl;
+        return false;
+    }
+    LOG_DEBUG << "[D3D11RenderDevice] DepthStencilView создан" << std::endl;
+
+    D3D11_DEPTH_STENCIL_DESC dsDesc = {};
+    dsDesc.DepthEnable = TRUE;
+    dsDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+    dsDesc.DepthFunc = D3D11_COMPARISON_LESS;
+    dsDesc.StencilEnable = FALSE;
+
+    hr = device->CreateDepthStencilState(&dsDesc, &depthStencilState);
+    if (FAILED(hr)) {
+        LOG_ERROR << "[D3D11RenderDevice] Ошибка: не удалось создать DepthStencilState" << std::endl;
+        return false;
+    }
+    LOG_DEBUG << "[D3D11RenderDevice] DepthStencilState создан" << std::endl;
+
+    context->OMSetRenderTargets(1, &renderTargetView, depthStencilView);
+    context->OMSetDepthStencilState(depthStencilState, 1);
+    LOG_DEBUG << "[D3D11RenderDevice] RenderTargets и DepthStencilState установлены" << std::endl;
+
+    D3D11_VIEWPORT viewport = {};
+    viewport.Width = 800.0f;
+    viewport.Height = 600.0f;
+    viewport.MinDepth = 0.0f;
+    viewport.MaxDepth = 1.0f;
+    context->RSSetViewports(1, &viewport);
+    LOG_DEBUG << "[D3D11RenderDevice] Viewport установлен" << std::endl;
+
+    ID3DBlob* vsBlob, *psTexturedBlob, *psColoredBlob, *errorBlob;
+    hr = D3DCompileFromFile(L"shader.hlsl", nullptr, nullptr, "VSMain", "vs_5_0", 0, 0, &vsBlob, &errorBlob);
+    if (FAILED(hr)) {
+        if (errorBlob) {
+            LOG_ERROR << "[D3D11RenderDevice] Ошибка компиляции вершинного шейдера: " << (const char*)errorBlob->GetBufferPointer() << std::endl;
+            errorBlob->Release();
+        }
+        return false;
+    }
+    LOG_DEBUG << "[D3D11RenderDevice] Вершинный шейдер скомпилирован" << std::endl;
+
+    hr = D3DCompileFromFile(L"shader.hlsl", nullptr, nullptr, "PSMainTextured", "ps_5_0", 0, 0, &psTexturedBlob, &errorBlob);
+    if (FAILED(hr)) {
+        if (errorBlob) {
+            LOG_ERROR << "[D3D11RenderDevice] Ошибка компиляции пиксельного шейдера (Textured): " << (const char*)errorBlob->GetBufferPointer() << std::endl;
+            errorBlob->Release();
+        }
+        vsBlob->Release();
+        return false;
+    }
+    LOG_DEBUG << "[D3D11RenderDevice] Пиксельный шейдер (Textured) скомпилирован" << std::endl;
+
+    hr = D3DCompileFromFile(L"shader.hlsl", nullptr, nullptr, "PSMainColored", "ps_5_0", 0, 0, &psColoredBlob, &errorBlob);
+    if (FAILED(hr)) {
+        if (errorBlob) {
+            LOG_ERROR << "[D3D11RenderDevice] Ошибка компиляции пиксельного шейдера (Colored): " << (const char*)errorBlob->GetBufferPointer() << std::endl;
+            errorBlob->Release();
+        }
+        vsBlob->Release();
+        psTexturedBlob->Release();
+        return false;
+    }
+    LOG_DEBUG << "[D3D11RenderDevice] Пиксельный шейдер (Colored) скомпилирован" << std::endl;
+
+    hr = device->CreateVertexShader(vsBlob->GetBufferPointer(), vsBlob->GetBufferSize(), nullptr, &vertexShader);
+    if (FAILED(hr)) {
+        LOG_ERROR << "[D3D11RenderDevice] Ошибка: не удалось создать вершинный шейдер" << std::endl;
+        return false;
+    }
+    LOG_DEBUG << "[D3D11RenderDevice] Вершинный шейдер создан" << std::endl;
+
+    hr = device->CreatePixelShader(psTexturedBlob->GetBufferPointer(), psTexturedBlob->GetBufferSize(), nullptr, &pixelShaderTextured);
+    if (FAILED(hr)) {
+        LOG_ERROR << "[D3D11RenderDevice] Ошибка: не удалось создать пиксельный шейдер (Textured)" << std::endl;
+        return false;
+    }
+    LOG_DEBUG << "[D3D11RenderDevice] Пиксельный шейдер (Textured) создан" << std::endl;
+
+    hr = device->CreatePixelShader(psColoredBlob->GetBufferPointer(), psColoredBlob->GetBufferSize(), nullptr, &pixelShaderColored);
+    if (FAILED(hr)) {
+        LOG_ERROR << "[D3D11RenderDevice] Ошибка: не удалось создать пиксельный шейдер (Colored)" << std::endl;
+        return false;
+    }
+    LOG_DEBUG << "[D3D11RenderDevice] Пиксельный шейдер (Colored) создан" << std::endl;
+
+    D3D11_INPUT_ELEMENT_DESC layout[] = {
+        {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0},
+    };
+    hr = device->CreateInputLayout(layout, 3, vsBlob->GetBufferPointer(), vsBlob->GetBufferSize(), &inputLayout);
+    if (FAILED(hr)) {
+        LOG_ERROR << "[D3D11RenderDevice] Ошибка: не удалось создать InputLayout" << std::endl;
+        vsBlob->Release();
+        psTexturedBlob->Release();
+        psColoredBlob->Release();
+        return false;
+    }
+    LOG_DEBUG << "[D3D11RenderDevice] InputLayout создан" << std::endl;
+
+    vsBlob->Release();
+    psTexturedBlob->Release();
+    psColoredBlob->Release();
+
+    // Инстансный вариант вершинного шейдера; без него тела рисуются по одному
+    ID3DBlob* vsInstancedBlob = nullptr;
+    hr = D3DCompileFromFile(L"shader.hlsl", nullptr, nullptr, "VSMainInstanced", "vs_5_0", 0, 0, &vsInstancedBlob, &errorBlob);
+    if (SUCCEEDED(hr)) {
+        D3D11_INPUT_ELEMENT_DESC instancedLayout[] = {
+            {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+            {"NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0},
+            {"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0},
+            {"INSTANCE_WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+            {"INSTANCE_WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+            {"INSTANCE_WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+            {"INSTANCE_WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+            {"INSTANCE_COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 64, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+            {"INSTANCE_EMISSIVE", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 80, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        };
+        hr = device->CreateVertexShader(vsInstancedBlob->GetBufferPointer(), vsInstancedBlob->GetBufferSize(), nullptr,
+                                        &vertexShaderInstanced);
+        if (SUCCEEDED(hr)) {
+            hr = device->CreateInputLayout(instancedLayout, 9, vsInstancedBlob->GetBufferPointer(),
+                                           vsInstancedBlob->GetBufferSize(), &inputLayoutInstanced);
+        }
+        vsInstancedBlob->Release();
+    } else if (errorBlob) {
+        LOG_ERROR << "[D3D11RenderDevice] Ошибка компиляции инстансного вершинного шейдера: " << (const char*)errorBlob->GetBufferPointer() << std::endl;
+        errorBlob->Release();
+    }
+    if (FAILED(hr)) {
+        LOG_WARNING << "[D3D11RenderDevice] Инстансный конвейер недоступен" << std::endl;
+        instancingSupported = false;
+    } else {
+        instancingSupported = true;
+        LOG_INFO << "[D3D11RenderDevice] Инстансный вершинный шейдер и InputLayout созданы" << std::endl;
+    }
+
+    // Вершинные шейдеры для сжатых вершин; без них меши загружаются в формате Float32
+    compactSupported = CreateCompactPipelines();
+    if (compactSupported) {
+        LOG_INFO << "[D3D11RenderDevice] Конвейеры для сжатых вершин созданы" << std::endl;
+    } else {
+        LOG_WARNING << "[D3D11RenderDevice] Конвейеры для сжатых вершин недоступны" << std::endl;
+    }
+
+    D3D11_SAMPLER_DESC sampDesc = {};
+    sampDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+    sampDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
+    sampDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
+    sampDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
+    sampDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+    sampDesc.MinLOD = 0;
+    sampDesc.MaxLOD = D3D11_FLOAT32_MAX;
+    hr = device->CreateSamplerState(&sampDesc, &samplerState);
+    if (FAILED(hr)) {
+        LOG_ERROR << "[D3D11RenderDevice] Ошибка: не удалось создать SamplerState" << std::endl;
+        return false;
+    }
+    LOG_DEBUG << "[D3D11RenderDevice] SamplerState создан" << std::endl;
+
+    context->PSSetSamplers(0, 1, &samplerState);
+    LOG_DEBUG << "[D3D11RenderDevice] Сэмплер установлен" << std::endl;
+
+    LOG_INFO << "[D3D11RenderDevice] Инициализация устройства завершена успешно" << std::endl;
+    return true;
+}
+
+bool D3D11RenderDevice::CreateCompactPipelines() {
+    ID3DBlob* vsBlob = nullptr;
+    ID3DBlob* errorBlob = nullptr;
+    HRESULT hr = D3DCompileFromFile(L"shader.hlsl", nullptr, nullptr, "VSMainCompact", "vs_5_0", 0, 0, &vsBlob, &errorBlob);
+    if (FAILED(hr)) {
+        if (errorBlob) {
+            LOG_ERROR << "[D3D11RenderDevice] Ошибка компиляции вершинного шейдера (Compact): " << (const char*)errorBlob->GetBufferPointer() << std::endl;
+            errorBlob->Release();
+        }
+        return false;
+    }
+
+    // CompactVertex: позиция R16G16B16A16_UNORM, нормаль R16G16_SNORM, texCoord R16G16_UNORM
+    D3D11_INPUT_ELEMENT_DESC layout[] = {
+        {"POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"TEXCOORD", 0, DXGI_FORMAT_R16G16_UNORM, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0},
+    };
+    hr = device->CreateVertexShader(vsBlob->GetBufferPointer(), vsBlob->GetBufferSize(), nullptr, &vertexShaderCompact);
+    if (SUCCEEDED(hr)) {
+        hr = device->CreateInputLayout(layout, 3, vsBlob->GetBufferPointer(), vsBlob->GetBufferSize(), &inputLayoutCompact);
+    }
+    vsBlob->Release();
+    if (FAILED(hr)) {
+        LOG_ERROR << "[D3D11RenderDevice] Ошибка: не удалось создать вершинный шейдер или InputLayout (Compact)" << std::endl;
+        return false;
+    }
+    if (!instancingSupported) return true;
+
+    ID3DBlob* vsInstancedBlob = nullptr;
+    hr = D3DCompileFromFile(L"shader.hlsl", nullptr, nullptr, "VSMainInstancedCompact", "vs_5_0", 0, 0, &vsInstancedBlob, &errorBlob);
+    if (FAILED(hr)) {
+        if (errorBlob) {
+            LOG_ERROR << "[D3D11RenderDevice] Ошибка компиляции инстансного вершинного шейдера (Compact): " << (const char*)errorBlob->GetBufferPointer() << std::endl;
+            errorBlob->Release();
+        }
+        return false;
+    }
+    D3D11_INPUT_ELEMENT_DESC instancedLayout[] = {
+        {"POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"TEXCOORD", 0, DXGI_FORMAT_R16G16_UNORM, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"INSTANCE_WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        {"INSTANCE_WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        {"INSTANCE_WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        {"INSTANCE_WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        {"INSTANCE_COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 64, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        {"INSTANCE_EMISSIVE", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 80, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+    };
+    hr = device->CreateVertexShader(vsInstancedBlob->GetBufferPointer(), vsInstancedBlob->GetBufferSize(), nullptr,
+                                    &vertexShaderInstancedCompact);
+    if (SUCCEEDED(hr)) {
+        hr = device->CreateInputLayout(instancedLayout, 9, vsInstancedBlob->GetBufferPointer(),
+                                       vsInstancedBlob->GetBufferSize(), &inputLayoutInstancedCompact);
+    }
+    vsInstancedBlob->Release();
+    if (FAILED(hr)) {
+        LOG_ERROR << "[D3D11RenderDevice] Ошибка: не удалось создать инстансный вершинный шейдер или InputLayout (Compact)" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool D3D11RenderDevice::SupportsPipeline(RenderPipeline pipeline) const {
+    switch (pipeline) {
+        case RenderPipeline::Textured:
+        case RenderPipeline::Colored:
+            return vertexShader && inputLayout;
+        case RenderPipeline::TexturedInstanced:
+        case RenderPipeline::ColoredInstanced:
+            return instancingSupported;
+        case RenderPipeline::TexturedCompact:
+        case RenderPipeline::ColoredCompact:
+            return compactSupported;
+        case RenderPipeline::TexturedInstancedCompact:
+        case RenderPipeline::ColoredInstancedCompact:
+            return compactSupported && instancingSupported;
+        default:
+            return false;
+    }
+}
+
+bool D3D11RenderDevice::DoCreateBuffer(RenderBufferId id, RenderBufferType type, RenderBufferUsage usage,
+                                       size_t byteSize, const void* initialData) {
+    D3D11_BUFFER_DESC desc = {};
+    desc.ByteWidth = static_cast<UINT>(byteSize);
+    switch (type) {
+        case RenderBufferType::Vertex: desc.BindFlags = D3D11_BIND_VERTEX_BUFFER; break;
+        case RenderBufferType::Index: desc.BindFlags = D3D11_BIND_INDEX_BUFFER; break;
+        case RenderBufferType::Constant: desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER; break;
+    }
+    switch (usage) {
+        case RenderBufferUsage::Immutable: desc.Usage = D3D11_USAGE_IMMUTABLE; break;
+        case RenderBufferUsage::Default: desc.Usage = D3D11_USAGE_DEFAULT; break;
+        case RenderBufferUsage::Dynamic:
+            desc.Usage = D3D11_USAGE_DYNAMIC;
+            desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+            break;
+    }
+
+    D3D11_SUBRESOURCE_DATA data = {};
+    data.pSysMem = initialData;
+
+    ID3D11Buffer* buffer = nullptr;
+    HRESULT hr = device->CreateBuffer(&desc, initialData ? &data : nullptr, &buffer);
+    if (FAILED(hr)) {
+        LOG_ERROR << "[D3D11RenderDevice] Ошибка: не удалось создать буфер на " << byteSize << " байт" << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(resourceMutex);
+    buffers[id] = { buffer, usage, byteSize };
+    return true;
+}
+
+void D3D11RenderDevice::DoDestroyBuffer(RenderBufferId id) {
+    std::lock_guard<std::mutex> lock(resourceMutex);
+    auto it = buffers.find(id);
+    if (it == buffers.end()) return;
+    it->second.buffer->Release();
+    buffers.erase(it);
+}
+
+bool D3D11RenderDevice::DoUpdateBuffer(RenderBufferId id, const void* data, size_t byteSize) {
+    Buffer buffer;
+    {
+        std::lock_guard<std::mutex> lock(resourceMutex);
+        auto it = buffers.find(id);
+        if (it == buffers.end()) return false;
+        buffer = it->second;
+    }
+    if (byteSize > buffer.byteSize || buffer.usage == RenderBufferUsage::Immutable) {
+        LOG_ERROR << "[D3D11RenderDevice] Ошибка: буфер нельзя обновить этими данными" << std::endl;
+        return false;
+    }
+
+    if (buffer.usage == RenderBufferUsage::Dynamic) {
+        D3D11_MAPPED_SUBRESOURCE mapped;
+        HRESULT hr = context->Map(buffer.buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+        if (FAILED(hr)) {
+            LOG_ERROR << "[D3D11RenderDevice] Ошибка: не удалось отобразить динамический буфер" << std::endl;
+            return false;
+        }
+        memcpy(mapped.pData, data, byteSize);
+        context->Unmap(buffer.buffer, 0);
+    } else {
+        context->UpdateSubresource(buffer.buffer, 0, nullptr, data, 0, 0);
+    }
+    return true;
+}
+
+bool D3D11RenderDevice::DoCreateTexture(RenderTextureId id, const RenderTextureLevel* levels, uint32_t levelCount) {
+    D3D11_TEXTURE2D_DESC desc = {};
+    desc.Width = levels[0].width;
+    desc.Height = levels[0].height;
+    desc.MipLevels = levelCount;
+    desc.ArraySize = 1;
+    desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    desc.SampleDesc.Count = 1;
+    desc.Usage = D3D11_USAGE_IMMUTABLE;
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+    std::vector<D3D11_SUBRESOURCE_DATA> data(levelCount);
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        data[level].pSysMem = levels[level].pixels;
+        data[level].SysMemPitch = levels[level].rowPitch;
+    }
+
+    ID3D11Texture2D* texture = nullptr;
+    HRESULT hr = device->CreateTexture2D(&desc, data.data(), &texture);
+    if (FAILED(hr)) {
+        LOG_ERROR << "[D3D11RenderDevice] Ошибка: не удалось создать ресурс текстуры" << std::endl;
+        return false;
+    }
+
+    ID3D11ShaderResourceView* srv = nullptr;
+    hr = device->CreateShaderResourceView(texture, nullptr, &srv);
+    texture->Release();
+    if (FAILED(hr)) {
+        LOG_ERROR << "[D3D11RenderDevice] Ошибка: не удалось создать SRV для текстуры" << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(resourceMutex);
+    textures[id] = srv;
+    return true;
+}
+
+void D3D11RenderDevice::DoDestroyTexture(RenderTextureId id) {
+    std::lock_guard<std::mutex> lock(resourceMutex);
+    auto it = textures.find(id);
+    if (it == textures.end()) return;
+    it->second->Release();
+    textures.erase(it);
+}
+
+void D3D11RenderDevice::DoBeginFrame(const float clearColor[4]) {
+    context->ClearRenderTargetView(renderTargetView, clearColor);
+    context->ClearDepthStencilView(depthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+}
+
+void D3D11RenderDevice::DoEndFrame() {
+    swapChain->Present(1, 0);
+}
+
+void D3D11RenderDevice::DoSetPipeline(RenderPipeline pipeline) {
+    bool instanced = IsInstancedPipeline(pipeline);
+    if (IsCompactPipeline(pipeline)) {
+        context->VSSetShader(instanced ? vertexShaderInstancedCompact : vertexShaderCompact, nullptr, 0);
+        context->IASetInputLayout(instanced ? inputLayoutInstancedCompact : inputLayoutCompact);
+    } else {
+        context->VSSetShader(instanced ? vertexShaderInstanced : vertexShader, nullptr, 0);
+        context->IASetInputLayout(instanced ? inputLayoutInstanced : inputLayout);
+    }
+    context->PSSetShader(IsTexturedPipeline(pipeline) ? pixelShaderTextured : pixelShaderColored, nullptr, 0);
+}
+
+void D3D11RenderDevice::DoSetConstantBuffer(RenderBufferId id) {
+    ID3D11Buffer* buffer = FindBuffer(id);
+    context->VSSetConstantBuffers(0, 1, &buffer);
+    context->PSSetConstantBuffers(0, 1, &buffer);
+}
+
+void D3D11RenderDevice::DoSetVertexBuffer(uint32_t slot, RenderBufferId id, uint32_t stride) {
+    ID3D11Buffer* buffer = FindBuffer(id);
+    UINT offset = 0;
+    context->IASetVertexBuffers(slot, 1, &buffer, &stride, &offset);
+}
+
+void D3D11RenderDevice::DoSetIndexBuffer(RenderBufferId id, RenderIndexFormat format) {
+    context->IASetIndexBuffer(FindBuffer(id), format == RenderIndexFormat::UInt16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, 0);
+}
+
+void D3D11RenderDevice::DoSetTopology(RenderTopology topology) {
+    context->IASetPrimitiveTopology(topology == RenderTopology::LineList ? D3D11_PRIMITIVE_TOPOLOGY_LINELIST
+                                                                         : D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
+
+void D3D11RenderDevice::DoSetTexture(RenderTextureId id) {
+    ID3D11ShaderResourceView* srv = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(resourceMutex);
+        auto it = textures.find(id);
+        if (it != textures.end()) srv = it->second;
+    }
+    context->PSSetShaderResources(0, 1, &srv);
+}
+
+void D3D11RenderDevice::DoDrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex) {
+    context->DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+void D3D11RenderDevice::DoDrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex,
+                                               int32_t baseVertex, uint32_t startInstance) {
+    context->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+ID3D11Buffer* D3D11RenderDevice::FindBuffer(RenderBufferId id) const {
+    std::lock_guard<std::mutex> lock(resourceMutex);
+    auto it = buffers.find(id);
+    return it != buffers.end() ? it->second.buffer : nullptr;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <d3d11.h>
+#include <mutex>
+#include <unordered_map>
+
+#include "RenderDevice.h"
+
+// Бэкенд RenderDevice поверх D3D11: окно, цепочка обмена, шейдеры из shader.hlsl и ресурсы по идентификаторам.
+class D3D11RenderDevice : public RenderDevice {
+public:
+    explicit D3D11RenderDevice(HWND hwnd);
+    ~D3D11RenderDevice() override;
+    D3D11RenderDevice(const D3D11RenderDevice&) = delete;
+    D3D11RenderDevice& operator=(const D3D11RenderDevice&) = delete;
+
+    bool Initialize();
+    bool SupportsPipeline(RenderPipeline pipeline) const override;
+
+protected:
+    bool DoCreateBuffer(RenderBufferId id, RenderBufferType type, RenderBufferUsage usage, size_t byteSize,
+                        const void* initialData) override;
+    void DoDestroyBuffer(RenderBufferId id) override;
+    bool DoUpdateBuffer(RenderBufferId id, const void* data, size_t byteSize) override;
+    bool DoCreateTexture(RenderTextureId id, const RenderTextureLevel* levels, uint32_t levelCount) override;
+    void DoDestroyTexture(RenderTextureId id) override;
+
+    void DoBeginFrame(const float clearColor[4]) override;
+    void DoEndFrame() override;
+
+    void DoSetPipeline(RenderPipeline pipeline) override;
+    void DoSetConstantBuffer(RenderBufferId buffer) override;
+    void DoSetVertexBuffer(uint32_t slot, RenderBufferId buffer, uint32_t stride) override;
+    void DoSetIndexBuffer(RenderBufferId buffer, RenderIndexFormat format) override;
+    void DoSetTopology(RenderTopology topology) override;
+    void DoSetTexture(RenderTextureId texture) override;
+
+    void DoDrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex) override;
+    void DoDrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex,
+                                uint32_t startInstance) override;
+
+private:
+    struct Buffer {
+        ID3D11Buffer* buffer;
+        RenderBufferUsage usage;
+        size_t byteSize;
+    };
+
+    ID3D11Buffer* FindBuffer(RenderBufferId id) const;
+    bool CreateCompactPipelines();
+
+    HWND hwnd;
+    ID3D11Device* device;
+    ID3D11DeviceContext* context;
+    IDXGISwapChain* swapChain;
+    ID3D11RenderTargetView* renderTargetView;
+    ID3D11DepthStencilView* depthStencilView;
+    ID3D11DepthStencilState* depthStencilState;
+    ID3D11Texture2D* depthStencilBuffer;
+    ID3D11VertexShader* vertexShader;
+    ID3D11PixelShader* pixelShaderTextured;
+    ID3D11PixelShader* pixelShaderColored;
+    ID3D11InputLayout* inputLayout;
+    ID3D11SamplerState* samplerState;
+    ID3D11VertexShader* vertexShaderInstanced;
+    ID3D11InputLayout* inputLayoutInstanced;
+    bool instancingSupported;
+    ID3D11VertexShader* vertexShaderCompact;
+    ID3D11InputLayout* inputLayoutCompact;
+    ID3D11VertexShader* vertexShaderInstancedCompact;
+    ID3D11InputLayout* inputLayoutInstancedCompact;
+    bool compactSupported;
+
+    // Ресурсы могут освобождаться из любого потока, отпустившего последний хэндл
+    mutable std::mutex resourceMutex;
+    std::unordered_map<RenderBufferId, Buffer> buffers;
+    std::unordered_map<RenderTextureId, ID3D11ShaderResourceView*> textures;
+};
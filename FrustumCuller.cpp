@@ -0,0 +1,96 @@
+#include "FrustumCuller.h"
+#include <cfloat>
+
+void FrustumCuller::ExtractPlanes(DirectX::FXMMATRIX viewProj, DirectX::XMFLOAT4 planes[6]) {
+    using namespace DirectX;
+
+    // clip = p * viewProj, поэтому плоскости собираются из столбцов матрицы
+    XMFLOAT4X4 m;
+    XMStoreFloat4x4(&m, viewProj);
+    XMVECTOR column0 = XMVectorSet(m._11, m._21, m._31, m._41);
+    XMVECTOR column1 = XMVectorSet(m._12, m._22, m._32, m._42);
+    XMVECTOR column2 = XMVectorSet(m._13, m._23, m._33, m._43);
+    XMVECTOR column3 = XMVectorSet(m._14, m._24, m._34, m._44);
+
+    XMVECTOR extracted[6] = {
+        XMVectorAdd(column3, column0),      // left:   x >= -w
+        XMVectorSubtract(column3, column0), // right:  x <= w
+        XMVectorAdd(column3, column1),      // bottom: y >= -w
+        XMVectorSubtract(column3, column1), // top:    y <= w
+        column2,                            // near:   z >= 0
+        XMVectorSubtract(column3, column2)  // far:    z <= w
+    };
+    for (int i = 0; i < 6; ++i) {
+        XMStoreFloat4(&planes[i], XMPlaneNormalize(extracted[i]));
+    }
+}
+
+void FrustumCuller::Begin() {
+    centersX.clear();
+    centersY.clear();
+    centersZ.clear();
+    radii.clear();
+    visible.clear();
+    sphereCount = 0;
+}
+
+void FrustumCuller::Add(DirectX::XMFLOAT3 center, float radius) {
+    centersX.push_back(center.x);
+    centersY.push_back(center.y);
+    centersZ.push_back(center.z);
+    radii.push_back(radius);
+    ++sphereCount;
+}
+
+const std::vector<uint32_t>& FrustumCuller::Cull(DirectX::FXMMATRIX viewProj) {
+    using namespace DirectX;
+
+    XMFLOAT4 planes[6];
+    ExtractPlanes(viewProj, planes);
+    XMVECTOR planeX[6], planeY[6], planeZ[6], planeW[6];
+    for (int i = 0; i < 6; ++i) {
+        planeX[i] = XMVectorReplicate(planes[i].x);
+        planeY[i] = XMVectorReplicate(planes[i].y);
+        planeZ[i] = XMVectorReplicate(planes[i].z);
+        planeW[i] = XMVectorReplicate(planes[i].w);
+    }
+
+    // Хвост дополняется до кратного четырём сферами, которые не видны ни при каком положении камеры
+    size_t paddedCount = (sphereCount + 3) & ~size_t(3);
+    centersX.resize(paddedCount, 0.0f);
+    centersY.resize(paddedCount, 0.0f);
+    centersZ.resize(paddedCount, 0.0f);
+    radii.resize(paddedCount, -FLT_MAX);
+
+    visible.resize(paddedCount);
+    size_t visibleCount = 0;
+    for (size_t i = 0; i < paddedCount; i += 4) {
+        XMVECTOR x = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&centersX[i]));
+        XMVECTOR y = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&centersY[i]));
+        XMVECTOR z = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&centersZ[i]));
+        XMVECTOR negativeRadius = XMVectorNegate(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&radii[i])));
+
+        // Сфера видима, если ни одна плоскость не оставляет её целиком снаружи
+        XMVECTOR inside = XMVectorTrueInt();
+        for (int plane = 0; plane < 6; ++plane) {
+            XMVECTOR distance = XMVectorMultiplyAdd(planeX[plane], x,
+                                XMVectorMultiplyAdd(planeY[plane], y,
+                                XMVectorMultiplyAdd(planeZ[plane], z, planeW[plane])));
+            inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(distance, negativeRadius));
+        }
+
+        uint32_t mask[4];
+        XMStoreInt4(mask, inside);
+        for (uint32_t lane = 0; lane < 4; ++lane) {
+            visible[visibleCount] = static_cast<uint32_t>(i + lane);
+            visibleCount += mask[lane] & 1u;
+        }
+    }
+    visible.resize(visibleCount);
+
+    centersX.resize(sphereCount);
+    centersY.resize(sphereCount);
+    centersZ.resize(sphereCount);
+    radii.resize(sphereCount);
+    return visible;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Отсечение ограничивающих сфер по пирамиде видимости.
+// Центры и радиусы хранятся упакованными массивами (SoA), сферы проверяются по четыре за раз.
+class FrustumCuller {
+public:
+    // Плоскости left, right, bottom, top, near, far из viewProj (вектор-строка, клип D3D: 0 <= z <= w).
+    // Нормали смотрят внутрь и нормированы: расстояние до плоскости - dot(plane.xyz, p) + plane.w
+    static void ExtractPlanes(DirectX::FXMMATRIX viewProj, DirectX::XMFLOAT4 planes[6]);
+
+    void Begin();
+    // Индекс сферы - порядковый номер Add с последнего Begin
+    void Add(DirectX::XMFLOAT3 center, float radius);
+    // Индексы видимых сфер по возрастанию; сфера, касающаяся плоскости, считается видимой
+    const std::vector<uint32_t>& Cull(DirectX::FXMMATRIX viewProj);
+
+    size_t GetSphereCount() const { return sphereCount; }
+    size_t GetVisibleCount() const { return visible.size(); }
+    size_t GetCulledCount() const { return sphereCount - visible.size(); }
+
+private:
+    std::vector<float> centersX;
+    std::vector<float> centersY;
+    std::vector<float> centersZ;
+    std::vector<float> radii;
+    std::vector<uint32_t> visible;
+    size_t sphereCount = 0;
+};
@@ -2,6 +2,8 @@
 
 #include "Logger.h"
 
+#include "ConstantBufferData.h"
+
 
 
 struct Vertex {
@@ -14,11 +16,11 @@ struct Vertex {
 
 
 
-Grid::Grid(ID3D11Device* device, float size, int divisions)
+Grid::Grid(RenderDevice& device, float size, int divisions)
 
-    : size(size), divisions(divisions), vertexBuffer(nullptr), indexBuffer(nullptr) {
+    : size(size), divisions(divisions), device(&device), vertexBuffer(InvalidRenderBuffer), indexBuffer(InvalidRenderBuffer) {
 
-    logger << "[Grid] Constructor called: size=" << size << ", divisions=" << divisions << std::endl;
+    LOG_INFO << "[Grid] Constructor called: size=" << size << ", divisions=" << divisions << std::endl;
 
 
 
@@ -108,7 +110,7 @@ Grid::Grid(ID3D11Device* device, float size, int divisions)
 
 
 
-    InitializeBuffers(device);
+    InitializeBuffers();
 
 }
 
@@ -116,41 +118,29 @@ Grid::Grid(ID3D11Device* device, float size, int divisions)
 
 Grid::~Grid() {
 
-    if (vertexBuffer) vertexBuffer->Release();
+    device->DestroyBuffer(vertexBuffer);
 
-    if (indexBuffer) indexBuffer->Release();
+    device->DestroyBuffer(indexBuffer);
 
 }
 
 
 
-void Grid::InitializeBuffers(ID3D11Device* device) {
-
-    // Create vertex buffer
-
-    D3D11_BUFFER_DESC vbDesc = {};
-
-    vbDesc.Usage = D3D11_USAGE_DEFAULT;
-
-    vbDesc.ByteWidth = vertices.size() * sizeof(float);
-
-    vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 
-    vbDesc.CPUAccessFlags = 0;
 
 
 
-    D3D11_SUBRESOURCE_DATA vbData = {};
-
-    vbData.pSysMem = vertices.data();
+void Grid::InitializeBuffers() {
 
+    // Create vertex buffer
 
+    vertexBuffer = device->CreateBuffer(RenderBufferType::Vertex, RenderBufferUsage::Immutable,
 
-    HRESULT hr = device->CreateBuffer(&vbDesc, &vbData, &vertexBuffer);
+                                        vertices.size() * sizeof(float), vertices.data());
 
-    if (FAILED(hr)) {
+    if (vertexBuffer == InvalidRenderBuffer) {
 
-        logger << "[Grid] Failed to create vertex buffer" << std::endl;
+        LOG_ERROR << "[Grid] Failed to create vertex buffer" << std::endl;
 
     }
 
@@ -158,39 +148,27 @@ void Grid::InitializeBuffers(ID3D11Device* device) {
 
     // Create index buffer
 
-    D3D11_BUFFER_DESC ibDesc = {};
-
-    ibDesc.Usage = D3D11_USAGE_DEFAULT;
-
-    ibDesc.ByteWidth = indices.size() * sizeof(unsigned int);
-
-    ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-
-    ibDesc.CPUAccessFlags = 0;
+    indexBuffer = device->CreateBuffer(RenderBufferType::Index, RenderBufferUsage::Immutable,
 
+                                       indices.size() * sizeof(unsigned int), indices.data());
 
+    if (indexBuffer == InvalidRenderBuffer) {
 
-    D3D11_SUBRESOURCE_DATA ibData = {};
+        LOG_ERROR << "[Grid] Failed to create index buffer" << std::endl;
 
-    ibData.pSysMem = indices.data();
+    }
 
+}
 
 
-    hr = device->CreateBuffer(&ibDesc, &ibData, &indexBuffer);
 
-    if (FAILED(hr)) {
 
-        logger << "[Grid] Failed to create index buffer" << std::endl;
 
-    }
 
-}
 
+void Grid::Draw(RenderDevice& device, RenderBufferId constantBuffer, DirectX::XMMATRIX viewProj) const {
 
-
-void Grid::Draw(ID3D11DeviceContext* context, ID3D11Buffer* constantBuffer, DirectX::XMMATRIX viewProj) const {
-
-    logger << "[Grid] Drawing grid: size=" << size << ", divisions=" << divisions << std::endl;
+    LOG_TRACE << "[Grid] Drawing grid: size=" << size << ", divisions=" << divisions << std::endl;
 
 
 
@@ -202,44 +180,38 @@ void Grid::Draw(ID3D11DeviceContext* context, ID3D11Buffer* constantBuffer, Dire
 
 
 
-    // Update constant buffer
-
-    struct ConstantBufferData {
+    // Update constant buffer: full emissive makes the colored shader output the flat grid color
 
-        DirectX::XMMATRIX worldViewProj;
-
-        DirectX::XMFLOAT4 color;
-
-        BOOL useTexture;
-
-    } cbData;
+    ConstantBufferData cbData = {};
 
     cbData.worldViewProj = DirectX::XMMatrixTranspose(worldViewProj);
 
+    cbData.world = DirectX::XMMatrixTranspose(world);
+
     cbData.color = DirectX::XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f);  // Gray color for grid
 
-    cbData.useTexture = FALSE;
+    cbData.useTexture = 0;
 
-    context->UpdateSubresource(constantBuffer, 0, nullptr, &cbData, 0, 0);
+    cbData.emissiveColor = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f);
 
+    device.UpdateBuffer(constantBuffer, &cbData, sizeof(cbData));
 
 
-    // Set vertex buffer
 
-    UINT stride = 6 * sizeof(float);  // Position + Normal
+    // Set vertex buffer
 
-    UINT offset = 0;
+    device.SetPipeline(RenderPipeline::Colored);
 
-    context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+    device.SetVertexBuffer(0, vertexBuffer, 6 * sizeof(float));  // Position + Normal
 
-    context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+    device.SetIndexBuffer(indexBuffer);
 
-    context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
+    device.SetTopology(RenderTopology::LineList);
 
 
 
     // Draw
 
-    context->DrawIndexed(indices.size(), 0, 0);
+    device.DrawIndexed(static_cast<uint32_t>(indices.size()), 0, 0);
 
 }
\ No newline at end of file
@@ -1,30 +1,31 @@
 #pragma once
-#include <d3d11.h>
 #include <vector>
 #include <DirectXMath.h>
 #include <memory>
 
-#include "ModelLoader.h"
+#include "AssetLoader.h"
+#include "GroundSurface.h"
+#include "MeshRegistry.h"
+#include "RenderDevice.h"
 
-class Ground {
+class Ground : public GroundSurface {
 public:
-    Ground(ID3D11Device* device, const std::string& modelPath);
-    ~Ground();
+    Ground(RenderDevice& device, AssetLoader& assetLoader, const std::string& modelPath);
+    ~Ground() override;
 
-    void Draw(ID3D11DeviceContext* context, ID3D11Buffer* constantBuffer, DirectX::XMMATRIX viewProj,
-              DirectX::XMFLOAT3 cameraPos) const;
+    void Draw(RenderDevice& device, RenderBufferId constantBuffer, DirectX::XMMATRIX viewProj,
+              DirectX::XMFLOAT3 cameraPos) const override;
     bool HasTexture() const;
 
 private:
-    void InitializeBuffers(ID3D11Device* device);
-    void LoadTexture(ID3D11Device* device, const std::string& texturePath);
+    void InitializeBuffers(const float* vertexData, size_t vertexFloatCount,
+                           const unsigned int* indexData, size_t indexCount);
 
     DirectX::XMFLOAT3 position;
     DirectX::XMFLOAT4 color;
-    ID3D11Buffer* vertexBuffer;
-    ID3D11Buffer* indexBuffer;
-    ID3D11ShaderResourceView* textureSRV;
-    std::vector<float> vertices;
-    std::vector<unsigned int> indices;
-    std::unique_ptr<ModelLoader> modelLoader;
+    RenderDevice* device;
+    RenderBufferId vertexBuffer;
+    RenderBufferId indexBuffer;
+    size_t indexCount;
+    MeshHandle mesh;
 };
\ No newline at end of file
@@ -0,0 +1,12 @@
+#pragma once
+#include <DirectXMath.h>
+
+#include "RenderDevice.h"
+
+// Поверхность под телами: плоскость Ground или потоковый Terrain. Render рисует её первой в кадре
+class GroundSurface {
+public:
+    virtual ~GroundSurface() = default;
+    virtual void Draw(RenderDevice& device, RenderBufferId constantBuffer, DirectX::XMMATRIX viewProj,
+                      DirectX::XMFLOAT3 cameraPos) const = 0;
+};
@@ -0,0 +1,216 @@
+// Прогон симуляции катамари без окна и GPU: N тиков по сценарию ввода с максимальной скоростью.
+// Запуск: KatamariHeadless [--ticks N] [--script файл] [--pickups N] [--seed S] [--spawner] [--threads N]
+//                          [--profile trace.json]
+// С --spawner мячи исходной сцены заменяет PickupSpawner с тем же seed: бесконечный мир, живы регионы у катамари.
+// С --threads мировые трансформации считаются TaskScheduler на N потоках; хеш состояния не меняется.
+// Сценарий - строки "<тиков> <клавиши>", клавиши из WASD или "-" для отсутствия ввода; сценарий повторяется по кругу.
+// С --profile тик считается кадром: печатается статистика зон и пишется трасса Chrome.
+#include "KatamariWorld.h"
+#include "PickupSpawner.h"
+#include "Profiler.h"
+#include "TaskScheduler.h"
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    struct ScriptEntry {
+        uint64_t ticks;
+        KatamariInput input;
+    };
+
+    bool ParseKeys(const std::string& keys, KatamariInput& input) {
+        input = KatamariInput();
+        if (keys == "-") return true;
+        for (char key : keys) {
+            switch (key) {
+                case 'W': case 'w': input.forward = true; break;
+                case 'S': case 's': input.backward = true; break;
+                case 'A': case 'a': input.left = true; break;
+                case 'D': case 'd': input.right = true; break;
+                default: return false;
+            }
+        }
+        return true;
+    }
+
+    bool LoadScript(const char* path, std::vector<ScriptEntry>& script) {
+        std::ifstream file(path);
+        if (!file.is_open()) {
+            std::fprintf(stderr, "cannot open script %s\n", path);
+            return false;
+        }
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(file, line)) {
+            ++lineNumber;
+            if (line.empty() || line[0] == '#') continue;
+            std::istringstream stream(line);
+            ScriptEntry entry;
+            std::string keys;
+            if (!(stream >> entry.ticks >> keys) || entry.ticks == 0 || !ParseKeys(keys, entry.input)) {
+                std::fprintf(stderr, "%s:%d: expected \"<ticks> <WASD|->\"\n", path, lineNumber);
+                return false;
+            }
+            script.push_back(entry);
+        }
+        if (script.empty()) {
+            std::fprintf(stderr, "script %s is empty\n", path);
+            return false;
+        }
+        return true;
+    }
+
+    // Обход по квадрату с диагоналями и паузами: проходит через все мячи исходной сцены
+    std::vector<ScriptEntry> DefaultScript() {
+        const char* steps[][2] = {
+            {"120", "W"}, {"90", "D"}, {"30", "-"}, {"180", "S"}, {"120", "A"},
+            {"60", "WA"}, {"150", "W"}, {"90", "SD"}, {"30", "-"},
+        };
+        std::vector<ScriptEntry> script;
+        for (const auto& step : steps) {
+            ScriptEntry entry;
+            entry.ticks = std::strtoull(step[0], nullptr, 10);
+            ParseKeys(step[1], entry.input);
+            script.push_back(entry);
+        }
+        return script;
+    }
+
+    // Дополнительные мячи для нагрузочных прогонов: равномерно вокруг старта, детерминированно по seed
+    void ScatterPickups(KatamariWorld& world, size_t count, uint32_t seed) {
+        std::mt19937 rng(seed);
+        float halfExtent = 5.0f + 0.5f * std::sqrt(static_cast<float>(count));
+        std::uniform_real_distribution<float> coordinate(-halfExtent, halfExtent);
+        std::uniform_real_distribution<float> size(0.2f, 0.6f);
+        for (size_t i = 0; i < count; ++i) {
+            float radius = size(rng);
+            float x = coordinate(rng);
+            float z = coordinate(rng);
+            world.AddPickup("Textures/soccer_ball.obj", DirectX::XMFLOAT3(x, radius, z),
+                            DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), radius, true,
+                            DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f));
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    uint64_t ticks = 100000;
+    size_t pickups = 0;
+    uint32_t seed = 1;
+    const char* scriptPath = nullptr;
+    const char* tracePath = nullptr;
+    bool useSpawner = false;
+    size_t threads = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!std::strcmp(argv[i], "--ticks") && hasValue) ticks = std::strtoull(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "--pickups") && hasValue) pickups = std::strtoull(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "--seed") && hasValue) seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (!std::strcmp(argv[i], "--script") && hasValue) scriptPath = argv[++i];
+        else if (!std::strcmp(argv[i], "--spawner")) useSpawner = true;
+        else if (!std::strcmp(argv[i], "--threads") && hasValue) threads = std::strtoull(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "--profile") && hasValue) tracePath = argv[++i];
+        else {
+            std::fprintf(stderr, "usage: %s [--ticks N] [--script file] [--pickups N] [--seed S] [--spawner] "
+                         "[--threads N] [--profile trace.json]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<ScriptEntry> script;
+    if (scriptPath) {
+        if (!LoadScript(scriptPath, script)) return 2;
+    } else {
+        script = DefaultScript();
+    }
+
+    // Без --profile зоны не пишутся, чтобы не влиять на замер тиков в секунду
+    profiler.SetEnabled(tracePath != nullptr);
+    profiler.SetThreadName("Main");
+    // Прогон конечен: окно статистики покрывает все тики
+    if (tracePath) profiler.SetHistoryFrames(static_cast<size_t>(ticks));
+
+    KatamariWorld world;
+    std::unique_ptr<PickupSpawner> spawner;
+    if (useSpawner) {
+        world.AddDefaultKatamari();
+        spawner = std::make_unique<PickupSpawner>(world, seed);
+        spawner->Update();
+    } else {
+        world.PopulateDefaultScene();
+    }
+    ScatterPickups(world, pickups, seed);
+    std::unique_ptr<TaskScheduler> scheduler;
+    if (threads > 0) {
+        scheduler = std::make_unique<TaskScheduler>(threads);
+        world.SetTaskScheduler(scheduler.get());
+    }
+
+    std::vector<KatamariAttachEvent> attachEvents;
+    size_t scriptIndex = 0;
+    uint64_t scriptTicksLeft = script[0].ticks;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t tick = 0; tick < ticks; ++tick) {
+        if (scriptTicksLeft == 0) {
+            scriptIndex = (scriptIndex + 1) % script.size();
+            scriptTicksLeft = script[scriptIndex].ticks;
+        }
+        --scriptTicksLeft;
+
+        world.Step(script[scriptIndex].input);
+        if (spawner) spawner->Update();
+        const std::vector<KatamariAttachEvent>& events = world.GetAttachEvents();
+        attachEvents.insert(attachEvents.end(), events.begin(), events.end());
+        PROFILE_FRAME();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (const KatamariAttachEvent& event : attachEvents) {
+        std::printf("attach tick=%" PRIu64 " body=%u point=(%.3f, %.3f, %.3f)\n", event.tick, event.body,
+                    event.attachmentPoint.x, event.attachmentPoint.y, event.attachmentPoint.z);
+    }
+
+    DirectX::XMFLOAT3 position = world.GetKatamari()->GetPosition();
+    std::printf("bodies:        %zu\n", world.GetBodies().size());
+    if (spawner) {
+        std::printf("live bodies:   %zu (%zu regions awake, %zu woken, %zu slept)\n", world.GetLiveBodyCount(),
+                    spawner->GetActiveRegionCount(), spawner->GetWokenRegionCount(), spawner->GetSleptRegionCount());
+    }
+    std::printf("ticks:         %" PRIu64 "\n", ticks);
+    std::printf("seconds:       %.3f\n", seconds);
+    std::printf("ticks/second:  %.0f\n", seconds > 0.0 ? ticks / seconds : 0.0);
+    std::printf("attached:      %zu\n", attachEvents.size());
+    std::printf("katamari:      (%.3f, %.3f, %.3f)\n", position.x, position.y, position.z);
+    std::printf("state hash:    %016" PRIx64 "\n", world.ComputeStateHash());
+
+    if (tracePath) {
+#if KATAMARI_PROFILER
+        std::printf("\n%-42s %8s %10s %10s %10s %10s\n", "zone", "calls", "mean ms", "p50 ms", "p95 ms", "p99 ms");
+        for (const ProfileZoneStats& stats : profiler.GetZoneStats()) {
+            std::printf("%-42s %8.2f %10.5f %10.5f %10.5f %10.5f\n", stats.name.c_str(), stats.callsPerFrame,
+                        stats.meanMs, stats.p50Ms, stats.p95Ms, stats.p99Ms);
+        }
+        if (!profiler.WriteChromeTrace(tracePath)) {
+            std::fprintf(stderr, "cannot write trace %s\n", tracePath);
+            return 1;
+        }
+        std::printf("trace:         %s (%zu events, %zu not stored)\n", tracePath, profiler.GetTraceEventCount(),
+                    profiler.GetDroppedTraceEvents());
+#else
+        std::fprintf(stderr, "profiler is compiled out (KATAMARI_PROFILER=0)\n");
+#endif
+    }
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include "InstanceBatcher.h"
+
+void InstanceBatcher::Begin() {
+    batchLookup.clear();
+    batches.clear();
+    pending.clear();
+    pendingBatches.clear();
+    instances.clear();
+    lastKey = { nullptr, 0, false };
+}
+
+uint32_t InstanceBatcher::FindBatch(const void* mesh, uint32_t lod, bool textured) {
+    BatchKey key = { mesh, lod, textured };
+    if (!batches.empty() && key == lastKey) return lastBatch;
+    auto found = batchLookup.find(key);
+    uint32_t batch;
+    if (found == batchLookup.end()) {
+        batch = static_cast<uint32_t>(batches.size());
+        batchLookup.emplace(key, batch);
+        batches.push_back({ mesh, lod, textured, 0, 0 });
+    } else {
+        batch = found->second;
+    }
+    lastKey = key;
+    lastBatch = batch;
+    return batch;
+}
+
+void InstanceBatcher::Add(const void* mesh, uint32_t lod, bool textured, DirectX::FXMMATRIX world, DirectX::XMFLOAT4 color,
+                          DirectX::XMFLOAT3 emissive) {
+    Reserve(mesh, lod, textured);
+
+    InstanceData data;
+    DirectX::XMStoreFloat4x4(&data.world, world);
+    data.color = color;
+    data.emissive = DirectX::XMFLOAT4(emissive.x, emissive.y, emissive.z, 0.0f);
+    pending.push_back(data);
+}
+
+void InstanceBatcher::Reserve(const void* mesh, uint32_t lod, bool textured) {
+    uint32_t batch = FindBatch(mesh, lod, textured);
+    ++batches[batch].instanceCount;
+    pendingBatches.push_back(batch);
+}
+
+void InstanceBatcher::Build() {
+    uint32_t offset = 0;
+    for (InstanceBatch& batch : batches) {
+        batch.firstInstance = offset;
+        offset += batch.instanceCount;
+    }
+
+    instances.resize(pendingBatches.size());
+    slots.resize(pendingBatches.size());
+    cursors.resize(batches.size());
+    for (size_t i = 0; i < batches.size(); ++i) cursors[i] = batches[i].firstInstance;
+    for (size_t i = 0; i < pendingBatches.size(); ++i) {
+        slots[i] = cursors[pendingBatches[i]]++;
+    }
+    for (size_t i = 0; i < pending.size(); ++i) {
+        instances[slots[i]] = pending[i];
+    }
+}
+
+void InstanceBatcher::SetInstance(size_t index, DirectX::FXMMATRIX world, DirectX::XMFLOAT4 color,
+                                  DirectX::XMFLOAT3 emissive) {
+    InstanceData& data = instances[slots[index]];
+    DirectX::XMStoreFloat4x4(&data.world, world);
+    data.color = color;
+    data.emissive = DirectX::XMFLOAT4(emissive.x, emissive.y, emissive.z, 0.0f);
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+// Данные одного экземпляра для инстансного вершинного шейдера (слот 1 входного layout).
+// Матрица хранится построчно без транспонирования: шейдер собирает её из четырёх float4.
+struct InstanceData {
+    DirectX::XMFLOAT4X4 world;
+    DirectX::XMFLOAT4 color;
+    DirectX::XMFLOAT4 emissive; // w не используется
+};
+
+// Группа экземпляров с одним мешем, уровнем детализации и материалом: рисуется одним DrawIndexedInstanced
+struct InstanceBatch {
+    const void* mesh;
+    uint32_t lod;
+    bool textured;
+    uint32_t firstInstance;
+    uint32_t instanceCount;
+};
+
+// Группирует тела по мешу, уровню детализации и материалу и раскладывает их данные в один непрерывный массив.
+// Меш передаётся как непрозрачный указатель, поэтому сборщик не зависит от D3D и проверяется без GPU.
+class InstanceBatcher {
+public:
+    void Begin();
+    void Add(const void* mesh, uint32_t lod, bool textured, DirectX::FXMMATRIX world, DirectX::XMFLOAT4 color,
+             DirectX::XMFLOAT3 emissive);
+    // Место под экземпляр без данных: данные пишет SetInstance после Build, в том числе из разных потоков,
+    // так как у каждого экземпляра свой слот. В одном кадре не смешивается с Add
+    void Reserve(const void* mesh, uint32_t lod, bool textured);
+    // Сортировка подсчётом по группам; порядок внутри группы совпадает с порядком Add и Reserve
+    void Build();
+    // index - порядковый номер Reserve с последнего Begin
+    void SetInstance(size_t index, DirectX::FXMMATRIX world, DirectX::XMFLOAT4 color, DirectX::XMFLOAT3 emissive);
+
+    const std::vector<InstanceBatch>& GetBatches() const { return batches; }
+    const std::vector<InstanceData>& GetInstances() const { return instances; }
+
+private:
+    struct BatchKey {
+        const void* mesh;
+        uint32_t lod;
+        bool textured;
+        bool operator==(const BatchKey& other) const {
+            return mesh == other.mesh && lod == other.lod && textured == other.textured;
+        }
+    };
+    struct BatchKeyHash {
+        size_t operator()(const BatchKey& key) const {
+            return std::hash<const void*>()(key.mesh) ^ (size_t(key.lod) * 0x632BE59BD9B4E019ull) ^
+                   (key.textured ? 0x9E3779B97F4A7C15ull : 0);
+        }
+    };
+
+    uint32_t FindBatch(const void* mesh, uint32_t lod, bool textured);
+
+    std::unordered_map<BatchKey, uint32_t, BatchKeyHash> batchLookup;
+    std::vector<InstanceBatch> batches;
+    std::vector<InstanceData> pending;
+    std::vector<uint32_t> pendingBatches;
+    std::vector<uint32_t> cursors;
+    std::vector<uint32_t> slots; // по порядку Add и Reserve: индекс экземпляра в instances
+    std::vector<InstanceData> instances;
+    BatchKey lastKey = { nullptr, 0, false }; // соседние тела обычно из одной группы: без поиска в таблице
+    uint32_t lastBatch = 0;
+};
@@ -0,0 +1,225 @@
+#include "KatamariWorld.h"
+#include "Logger.h"
+#include "Profiler.h"
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+    constexpr uint64_t FnvOffset = 14695981039346656037ull;
+    constexpr uint64_t FnvPrime = 1099511628211ull;
+
+    template<typename T>
+    uint64_t HashValue(uint64_t hash, const T& value) {
+        unsigned char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        for (unsigned char byte : bytes) {
+            hash ^= byte;
+            hash *= FnvPrime;
+        }
+        return hash;
+    }
+
+    constexpr float MoveSpeed = 5.0f;
+    constexpr float RollSpeed = 2.0f;
+}
+
+KatamariWorld::KatamariWorld()
+    : katamari(nullptr), katamariIndex(0), ground(nullptr), pickupHash(2.0f),
+      camera(DirectX::XMFLOAT3(0.0f, 5.0f, -10.0f), DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f)),
+      velocity(0.0f, 0.0f, 0.0f), tickCount(0) {
+}
+
+KatamariWorld::~KatamariWorld() {
+    // Тела уничтожаются до иерархии, в которой живут их узлы
+    bodies.clear();
+}
+
+uint32_t KatamariWorld::AddBody(const std::string& modelPath, DirectX::XMFLOAT3 pos, DirectX::XMFLOAT4 col, float rad,
+                                bool useTex, DirectX::XMFLOAT3 emissiveCol) {
+    auto body = std::make_unique<CelestialBody>(transforms, modelPath, pos, col, rad, useTex, emissiveCol);
+    if (!freeBodies.empty()) {
+        uint32_t id = freeBodies.back();
+        freeBodies.pop_back();
+        bodies[id] = std::move(body);
+        return id;
+    }
+    bodies.push_back(std::move(body));
+    return static_cast<uint32_t>(bodies.size() - 1);
+}
+
+DirectX::XMFLOAT3 KatamariWorld::PlaceOnGround(DirectX::XMFLOAT3 pos) const {
+    if (ground) pos.y += ground->GetHeight(pos.x, pos.z);
+    return pos;
+}
+
+uint32_t KatamariWorld::AddKatamari(const std::string& modelPath, DirectX::XMFLOAT3 pos, DirectX::XMFLOAT4 col,
+                                    float rad, bool useTex, DirectX::XMFLOAT3 emissiveCol) {
+    if (katamari) {
+        LOG_ERROR << "[KatamariWorld] Ошибка: катамари уже добавлен" << std::endl;
+        return katamariIndex;
+    }
+    katamariIndex = AddBody(modelPath, PlaceOnGround(pos), col, rad, useTex, emissiveCol);
+    katamari = bodies[katamariIndex].get();
+    return katamariIndex;
+}
+
+uint32_t KatamariWorld::AddPickup(const std::string& modelPath, DirectX::XMFLOAT3 pos, DirectX::XMFLOAT4 col,
+                                  float rad, bool useTex, DirectX::XMFLOAT3 emissiveCol) {
+    pos = PlaceOnGround(pos);
+    uint32_t id = AddBody(modelPath, pos, col, rad, useTex, emissiveCol);
+    pickupHash.Insert(id, pos, rad);
+    return id;
+}
+
+bool KatamariWorld::RemovePickup(uint32_t id) {
+    if (id >= bodies.size() || !bodies[id]) return false;
+    // Подобранное тело - часть кучи катамари, его уже не убрать
+    if (bodies[id].get() == katamari || bodies[id]->parent) {
+        LOG_ERROR << "[KatamariWorld] Ошибка: тело " << id << " не свободно и не может быть удалено" << std::endl;
+        return false;
+    }
+    pickupHash.Remove(id);
+    bodies[id].reset();
+    freeBodies.push_back(id);
+    return true;
+}
+
+bool KatamariWorld::SetCollisionMesh(uint32_t id, std::shared_ptr<const MeshBvh> mesh) {
+    if (id >= bodies.size() || !bodies[id]) {
+        LOG_ERROR << "[KatamariWorld] Ошибка: тела " << id << " нет, форма для подбора не задана" << std::endl;
+        return false;
+    }
+    CelestialBody& body = *bodies[id];
+    body.collisionMesh = std::move(mesh);
+    // Свободное тело широкая фаза ищет по радиусу его формы
+    if (pickupHash.Contains(id)) pickupHash.Update(id, transforms.GetLocalPosition(body.node), body.GetCollisionRadius());
+    return true;
+}
+
+uint32_t KatamariWorld::AddDefaultKatamari() {
+    // Katamari (основной объект)
+    return AddKatamari("Textures/soccer_ball.obj",
+                DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f),
+                DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f),
+                1.0f,
+                true,
+                DirectX::XMFLOAT3(0.5f, 0.5f, 0.5f)); // Увеличиваем свечение
+}
+
+void KatamariWorld::PopulateDefaultScene() {
+    AddDefaultKatamari();
+
+    // Дополнительные мячи для налипания
+    AddPickup("Textures/soccer_ball.obj",
+              DirectX::XMFLOAT3(5.0f, 1.0f, 5.0f),
+              DirectX::XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f),
+              0.5f,
+              true,
+              DirectX::XMFLOAT3(0.8f, 0.0f, 0.0f)); // Красное свечение
+    AddPickup("Textures/soccer_ball.obj",
+              DirectX::XMFLOAT3(-5.0f, 1.0f, -5.0f),
+              DirectX::XMFLOAT4(0.0f, 1.0f, 0.0f, 1.0f),
+              0.5f,
+              true,
+              DirectX::XMFLOAT3(0.0f, 0.8f, 0.0f)); // Зеленое свечение
+    AddPickup("Textures/soccer_ball.obj",
+              DirectX::XMFLOAT3(3.0f, 1.0f, -3.0f),
+              DirectX::XMFLOAT4(0.0f, 0.0f, 1.0f, 1.0f),
+              0.5f,
+              true,
+              DirectX::XMFLOAT3(0.0f, 0.0f, 0.8f)); // Синее свечение
+    AddPickup("Textures/soccer_ball.obj",
+              DirectX::XMFLOAT3(-3.0f, 1.0f, 4.0f),
+              DirectX::XMFLOAT4(1.0f, 1.0f, 0.0f, 1.0f),
+              0.5f,
+              true,
+              DirectX::XMFLOAT3(0.5f, 0.5f, 0.0f)); // Желтое свечение
+}
+
+void KatamariWorld::Step(const KatamariInput& input, float deltaTime) {
+    PROFILE_ZONE("KatamariWorld::Step");
+    attachEvents.clear();
+    ++tickCount;
+    if (!katamari) return;
+
+    // Скорость задаёт последняя из нажатых клавиш, вращения от всех нажатых складываются
+    if (input.forward) {
+        velocity = DirectX::XMFLOAT3(0.0f, 0.0f, MoveSpeed);
+        katamari->Rotate(DirectX::XMQuaternionRotationAxis(DirectX::XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f), deltaTime * RollSpeed));
+    }
+    if (input.backward) {
+        velocity = DirectX::XMFLOAT3(0.0f, 0.0f, -MoveSpeed);
+        katamari->Rotate(DirectX::XMQuaternionRotationAxis(DirectX::XMVectorSet(-1.0f, 0.0f, 0.0f, 0.0f), deltaTime * RollSpeed));
+    }
+    if (input.left) {
+        velocity = DirectX::XMFLOAT3(-MoveSpeed, 0.0f, 0.0f);
+        katamari->Rotate(DirectX::XMQuaternionRotationAxis(DirectX::XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), deltaTime * RollSpeed));
+    }
+    if (input.right) {
+        velocity = DirectX::XMFLOAT3(MoveSpeed, 0.0f, 0.0f);
+        katamari->Rotate(DirectX::XMQuaternionRotationAxis(DirectX::XMVectorSet(0.0f, 0.0f, -1.0f, 0.0f), deltaTime * RollSpeed));
+    }
+
+    katamari->UpdatePosition(DirectX::XMLoadFloat3(&velocity), deltaTime);
+    if (ground) {
+        // Катамари катится по рельефу: центр держится на радиус выше земли
+        DirectX::XMFLOAT3 position = transforms.GetLocalPosition(katamari->node);
+        position.y = ground->GetHeight(position.x, position.z) + katamari->radius;
+        transforms.SetLocalPosition(katamari->node, position);
+    }
+    {
+        PROFILE_ZONE("TransformHierarchy::UpdateWorldTransforms");
+        // Один линейный проход по всей иерархии вместо рекурсивных Update у каждого тела
+        transforms.UpdateWorldTransforms();
+    }
+
+    {
+        PROFILE_ZONE("KatamariWorld::Collisions");
+        // Широкая фаза: только тела из соседних ячеек сетки идут на точную проверку
+        pickupHash.Query(katamari->GetPosition(), katamari->radius, pickupCandidates);
+        for (uint32_t id : pickupCandidates) {
+            CelestialBody* obj = bodies[id].get();
+            DirectX::XMVECTOR attachmentPoint;
+            const CelestialBody* collidedBody = katamari->CheckCollision(obj, attachmentPoint);
+            if (collidedBody) {
+                LOG_DEBUG << "[KatamariWorld] Столкновение обнаружено, прикрепляем объект" << std::endl;
+                katamari->AttachChild(obj);
+                pickupHash.Remove(id);
+
+                KatamariAttachEvent event;
+                event.tick = tickCount;
+                event.body = id;
+                DirectX::XMStoreFloat3(&event.attachmentPoint, attachmentPoint);
+                attachEvents.push_back(event);
+            }
+        }
+    }
+
+    {
+        PROFILE_ZONE("FollowCamera::Update");
+        camera.Update(katamari->GetPosition(), static_cast<float>(katamari->GetChildren().size()));
+    }
+
+    // Как и раньше, скорость сохраняется, пока удерживается хоть одна клавиша
+    if (!input.Any()) {
+        velocity = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+    }
+}
+
+uint64_t KatamariWorld::ComputeStateHash() const {
+    std::unordered_map<const CelestialBody*, uint32_t> indices;
+    indices.reserve(bodies.size());
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        if (bodies[i]) indices.emplace(bodies[i].get(), static_cast<uint32_t>(i));
+    }
+
+    uint64_t hash = FnvOffset;
+    for (const auto& body : bodies) {
+        if (!body) continue;
+        hash = HashValue(hash, body->GetPosition());
+        hash = HashValue(hash, body->GetRotation());
+        uint32_t parentIndex = body->parent ? indices[body->parent] : 0xFFFFFFFFu;
+        hash = HashValue(hash, parentIndex);
+    }
+    return hash;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CelestialBody.h"
+#include "FollowCamera.h"
+#include "SpatialHash.h"
+#include "TerrainHeightfield.h"
+#include "TransformHierarchy.h"
+
+// Нажатые клавиши управления за один тик
+struct KatamariInput {
+    bool forward = false;
+    bool backward = false;
+    bool left = false;
+    bool right = false;
+
+    bool Any() const { return forward || backward || left || right; }
+};
+
+struct KatamariAttachEvent {
+    uint64_t tick;
+    uint32_t body;
+    DirectX::XMFLOAT3 attachmentPoint;
+};
+
+// Мир катамари без зависимостей от D3D и Win32: тела, иерархия, широкая фаза и камера.
+// Индекс тела используется как id в широкой фазе и у рендера. Пока тела не удаляются, он совпадает с порядком
+// добавления; слот удалённого свободного тела пуст (nullptr) до следующего добавления, которое его займёт.
+class KatamariWorld {
+public:
+    static constexpr float DefaultTickSeconds = 1.0f / 60.0f;
+
+    KatamariWorld();
+    ~KatamariWorld();
+    KatamariWorld(const KatamariWorld&) = delete;
+    KatamariWorld& operator=(const KatamariWorld&) = delete;
+
+    uint32_t AddKatamari(const std::string& modelPath, DirectX::XMFLOAT3 pos, DirectX::XMFLOAT4 col, float rad,
+                         bool useTex, DirectX::XMFLOAT3 emissiveCol);
+    uint32_t AddPickup(const std::string& modelPath, DirectX::XMFLOAT3 pos, DirectX::XMFLOAT4 col, float rad,
+                       bool useTex, DirectX::XMFLOAT3 emissiveCol);
+    // Убирает ещё не подобранное тело из мира; его индекс освобождается для следующего добавления
+    bool RemovePickup(uint32_t id);
+    // Точная форма тела для подбора - BVH его модели, общий у всех тел с этим мешем; nullptr - снова сфера radius
+    bool SetCollisionMesh(uint32_t id, std::shared_ptr<const MeshBvh> mesh);
+    // Катамари исходной сцены в начале координат
+    uint32_t AddDefaultKatamari();
+    // Катамари и четыре цветных мяча исходной сцены
+    void PopulateDefaultScene();
+    // Рельеф под телами: pos.y в AddKatamari и AddPickup отсчитывается от его высоты, катамари катится по нему.
+    // Задаётся до добавления тел; nullptr - плоскость y = 0
+    void SetGround(const TerrainHeightfield* heightfield) { ground = heightfield; }
+    const TerrainHeightfield* GetGround() const { return ground; }
+    // Мировые трансформации пересчитываются по уровням иерархии в нескольких потоках; nullptr - в одном потоке.
+    // Состояние мира от числа потоков не зависит
+    void SetTaskScheduler(TaskScheduler* scheduler) { transforms.SetTaskScheduler(scheduler); }
+
+    // Ввод, движение, мировые трансформации, подбор тел и камера за один тик
+    void Step(const KatamariInput& input, float deltaTime = DefaultTickSeconds);
+
+    // Прикрепления за последний Step
+    const std::vector<KatamariAttachEvent>& GetAttachEvents() const { return attachEvents; }
+    // FNV-1a по мировым трансформациям и родителям всех тел; совпадает у детерминированных прогонов
+    uint64_t ComputeStateHash() const;
+
+    CelestialBody* GetKatamari() const { return katamari; }
+    uint32_t GetKatamariIndex() const { return katamariIndex; }
+    // Может содержать пустые слоты удалённых тел
+    const std::vector<std::unique_ptr<CelestialBody>>& GetBodies() const { return bodies; }
+    size_t GetLiveBodyCount() const { return bodies.size() - freeBodies.size(); }
+    TransformHierarchy& GetTransforms() { return transforms; }
+    FollowCamera& GetCamera() { return camera; }
+    const FollowCamera& GetCamera() const { return camera; }
+    uint64_t GetTickCount() const { return tickCount; }
+
+private:
+    uint32_t AddBody(const std::string& modelPath, DirectX::XMFLOAT3 pos, DirectX::XMFLOAT4 col, float rad,
+                     bool useTex, DirectX::XMFLOAT3 emissiveCol);
+    DirectX::XMFLOAT3 PlaceOnGround(DirectX::XMFLOAT3 pos) const;
+
+    // Иерархия объявлена раньше тел: тела освобождают свои узлы в деструкторе
+    TransformHierarchy transforms;
+    std::vector<std::unique_ptr<CelestialBody>> bodies;
+    std::vector<uint32_t> freeBodies; // пустые слоты bodies, занимаются с конца
+    CelestialBody* katamari;
+    uint32_t katamariIndex;
+    const TerrainHeightfield* ground;
+
+    // Свободные тела не двигаются, пока их не подберут, поэтому сетка обновляется только при прикреплении
+    SpatialHash pickupHash;
+    std::vector<uint32_t> pickupCandidates;
+    std::vector<KatamariAttachEvent> attachEvents;
+
+    FollowCamera camera;
+    DirectX::XMFLOAT3 velocity;
+    uint64_t tickCount;
+};
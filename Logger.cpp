@@ -1,3 +1,340 @@
 #include "Logger.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
 
-Logger logger;
\ No newline at end of file
+Logger logger;
+
+namespace {
+    // Заголовок записи в кольце; текст выравнивается до 8 байт, чтобы заголовки не пересекали границу слова
+    constexpr size_t RecordHeaderSize = sizeof(uint32_t);
+
+    size_t RecordBytes(size_t size) {
+        return (RecordHeaderSize + size + 7) & ~size_t(7);
+    }
+
+    // Буфер форматирования записи: поток пишет в массив и сбрасывает его в строку только при переполнении
+    class RecordBuffer : public std::streambuf {
+    public:
+        RecordBuffer() { setp(chunk, chunk + sizeof(chunk)); }
+
+        std::string& Text() {
+            Spill();
+            return text;
+        }
+
+    protected:
+        int_type overflow(int_type ch) override {
+            Spill();
+            if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+                *pptr() = traits_type::to_char_type(ch);
+                pbump(1);
+            }
+            return traits_type::not_eof(ch);
+        }
+
+        std::streamsize xsputn(const char* s, std::streamsize n) override {
+            if (n > epptr() - pptr()) {
+                Spill();
+                text.append(s, static_cast<size_t>(n));
+                return n;
+            }
+            std::memcpy(pptr(), s, static_cast<size_t>(n));
+            pbump(static_cast<int>(n));
+            return n;
+        }
+
+    private:
+        void Spill() {
+            text.append(pbase(), pptr());
+            setp(chunk, chunk + sizeof(chunk));
+        }
+
+        char chunk[256];
+        std::string text;
+    };
+
+    struct ThreadRecordStream {
+        RecordBuffer buffer;
+        std::ostream stream{ &buffer };
+    };
+
+    ThreadRecordStream& GetRecordStream() {
+        thread_local ThreadRecordStream recordStream;
+        return recordStream;
+    }
+
+    // Кольцо потока живёт, пока его держит либо поток, либо Logger; при выходе потока кольцо дочитывается и удаляется
+    struct ThreadRing {
+        const Logger* owner = nullptr;
+        std::shared_ptr<LogRing> ring;
+
+        ~ThreadRing() {
+            if (ring) ring->abandoned.store(true, std::memory_order_release);
+        }
+    };
+
+    LogLevel ParseLevel(const char* name, LogLevel fallback) {
+        if (!name) return fallback;
+        std::string value(name);
+        std::transform(value.begin(), value.end(), value.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (value == "trace") return LogLevel::Trace;
+        if (value == "debug") return LogLevel::Debug;
+        if (value == "info") return LogLevel::Info;
+        if (value == "warning") return LogLevel::Warning;
+        if (value == "error") return LogLevel::Error;
+        if (value == "off") return LogLevel::Off;
+        return fallback;
+    }
+
+    constexpr auto WriterInterval = std::chrono::milliseconds(10);
+}
+
+LogRing::LogRing(size_t capacity)
+    : abandoned(false), data(new char[capacity]), mask(capacity - 1), head(0), tail(0) {
+}
+
+void LogRing::CopyIn(uint64_t position, const void* source, size_t size) {
+    size_t offset = static_cast<size_t>(position) & mask;
+    size_t first = std::min(size, mask + 1 - offset);
+    std::memcpy(data.get() + offset, source, first);
+    std::memcpy(data.get(), static_cast<const char*>(source) + first, size - first);
+}
+
+void LogRing::CopyOut(uint64_t position, void* target, size_t size) const {
+    size_t offset = static_cast<size_t>(position) & mask;
+    size_t first = std::min(size, mask + 1 - offset);
+    std::memcpy(target, data.get() + offset, first);
+    std::memcpy(static_cast<char*>(target) + first, data.get(), size - first);
+}
+
+bool LogRing::TryPush(const char* text, size_t size) {
+    uint64_t position = head.load(std::memory_order_relaxed);
+    size_t bytes = RecordBytes(size);
+    if (position + bytes - tail.load(std::memory_order_acquire) > mask + 1) return false;
+
+    uint32_t header = static_cast<uint32_t>(size);
+    CopyIn(position, &header, RecordHeaderSize);
+    CopyIn(position + RecordHeaderSize, text, size);
+    head.store(position + bytes, std::memory_order_release);
+    return true;
+}
+
+size_t LogRing::Drain(std::string& out) {
+    uint64_t position = tail.load(std::memory_order_relaxed);
+    uint64_t end = head.load(std::memory_order_acquire);
+    size_t count = 0;
+    while (position < end) {
+        uint32_t size = 0;
+        CopyOut(position, &size, RecordHeaderSize);
+        size_t offset = out.size();
+        out.resize(offset + size);
+        CopyOut(position + RecordHeaderSize, &out[offset], size);
+        position += RecordBytes(size);
+        ++count;
+    }
+    tail.store(position, std::memory_order_release);
+    return count;
+}
+
+size_t LogRing::GetUsedBytes() const {
+    return static_cast<size_t>(head.load(std::memory_order_relaxed) - tail.load(std::memory_order_relaxed));
+}
+
+// Конструктор не открывает файл и не бросает исключений: файл открывает поток записи при первой записи
+Logger::Logger()
+    : minimumLevel(static_cast<uint8_t>(ParseLevel(std::getenv("KATAMARI_LOG_LEVEL"), LogLevel::Info))),
+      droppedRecords(0), urgent(false), stopping(false), flushRequested(0), flushCompleted(0),
+      sinkPath(LOGGER_FILE_PATH), sinkChanged(true) {
+    if (const char* path = std::getenv("KATAMARI_LOG_FILE")) {
+        if (*path) sinkPath = path;
+    }
+}
+
+Logger::~Logger() {
+    SetLevel(LogLevel::Off);
+    {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        stopping = true;
+    }
+    wakeup.notify_one();
+    if (writer.joinable()) writer.join();
+}
+
+void Logger::SetSinkPath(const std::string& path) {
+    std::lock_guard<std::mutex> lock(writerMutex);
+    sinkPath = path;
+    sinkChanged = true;
+}
+
+std::string Logger::GetSinkPath() const {
+    std::lock_guard<std::mutex> lock(writerMutex);
+    return sinkPath;
+}
+
+void Logger::Flush() {
+    std::unique_lock<std::mutex> lock(writerMutex);
+    // Поток записи запускается первой записью; без него в очереди ничего нет
+    if (!writer.joinable() || stopping) return;
+    uint64_t ticket = ++flushRequested;
+    wakeup.notify_one();
+    flushed.wait(lock, [&] { return flushCompleted >= ticket || stopping; });
+}
+
+void Logger::Commit(LogLevel level, const char* text, size_t size) {
+    size = std::min(size, MaxRecordSize);
+    LogRing& ring = GetThreadRing();
+    if (ring.TryPush(text, size)) {
+        // Предупреждения и наполовину заполненное кольцо будят поток записи раньше срока. Флаг ставится без
+        // мьютекса, и пробуждение может потеряться, поэтому заполненное кольцо будит поток при каждой записи
+        if (ring.GetUsedBytes() > RingCapacity / 2) {
+            urgent.store(true, std::memory_order_relaxed);
+            wakeup.notify_one();
+        } else if (level >= LogLevel::Warning && !urgent.exchange(true, std::memory_order_relaxed)) {
+            wakeup.notify_one();
+        }
+        return;
+    }
+
+    if (level < LogLevel::Warning) {
+        droppedRecords.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    while (!ring.TryPush(text, size)) {
+        if (GetLevel() == LogLevel::Off) return; // Logger уже разрушается
+        urgent.store(true, std::memory_order_relaxed);
+        wakeup.notify_one();
+        std::this_thread::yield();
+    }
+}
+
+LogRing& Logger::GetThreadRing() {
+    thread_local ThreadRing local;
+    if (local.owner != this) {
+        if (local.ring) local.ring->abandoned.store(true, std::memory_order_release);
+        local.ring = std::make_shared<LogRing>(RingCapacity);
+        local.owner = this;
+        {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            rings.push_back(local.ring);
+        }
+        std::call_once(writerStarted, [this] { StartWriter(); });
+    }
+    return *local.ring;
+}
+
+void Logger::StartWriter() {
+    std::lock_guard<std::mutex> lock(writerMutex);
+    writer = std::thread(&Logger::WriterLoop, this);
+}
+
+bool Logger::DrainRings(std::string& batch) {
+    std::vector<std::shared_ptr<LogRing>> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        snapshot = rings;
+    }
+
+    size_t drained = 0;
+    bool hasAbandoned = false;
+    for (const auto& ring : snapshot) {
+        // Флаг читается до дочитывания: всё, что поток успел записать перед выходом, попадёт в этот проход
+        bool abandoned = ring->abandoned.load(std::memory_order_acquire);
+        drained += ring->Drain(batch);
+        hasAbandoned = hasAbandoned || abandoned;
+    }
+
+    if (hasAbandoned) {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        rings.erase(std::remove_if(rings.begin(), rings.end(),
+                                   [](const std::shared_ptr<LogRing>& ring) {
+                                       return ring->abandoned.load(std::memory_order_acquire) &&
+                                              ring->GetUsedBytes() == 0;
+                                   }),
+                    rings.end());
+    }
+    return drained > 0;
+}
+
+void Logger::WriterLoop() {
+    std::ofstream file;
+    std::string openedPath;
+    bool reportedFailure = false;
+    std::string batch;
+    uint64_t reportedDrops = 0;
+
+    while (true) {
+        uint64_t flushTarget;
+        bool stop;
+        std::string path;
+        bool reopen;
+        {
+            std::unique_lock<std::mutex> lock(writerMutex);
+            wakeup.wait_for(lock, WriterInterval, [&] {
+                return stopping || flushRequested != flushCompleted || urgent.load(std::memory_order_relaxed);
+            });
+            flushTarget = flushRequested;
+            stop = stopping;
+            reopen = sinkChanged;
+            sinkChanged = false;
+            path = sinkPath;
+        }
+        urgent.store(false, std::memory_order_relaxed);
+
+        if (reopen && path != openedPath) {
+            if (file.is_open()) file.close();
+            file.open(path, std::ios::out | std::ios::app | std::ios::binary);
+            openedPath = path;
+            reportedFailure = false;
+        }
+        if (!file.is_open() && !reportedFailure) {
+            std::cerr << "[Logger] Не удалось открыть файл логов: " << path << std::endl;
+            reportedFailure = true;
+        }
+
+        // При остановке кольца дочитываются до конца: записи, сделанные во время прохода, тоже попадут в файл
+        batch.clear();
+        while (DrainRings(batch) && stop) {
+        }
+        uint64_t dropped = droppedRecords.load(std::memory_order_relaxed);
+        if (dropped != reportedDrops) {
+            batch += "[Logger] Пропущено записей из-за переполнения буфера: " + std::to_string(dropped - reportedDrops) + "\n";
+            reportedDrops = dropped;
+        }
+        if (!batch.empty() && file.is_open()) {
+            file.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+            file.flush();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(writerMutex);
+            flushCompleted = flushTarget;
+        }
+        flushed.notify_all();
+        if (stop) break;
+    }
+}
+
+LogRecord::LogRecord(LogLevel level) : level(level), stream(GetRecordStream().stream) {
+    std::string& text = GetRecordStream().buffer.Text();
+    start = text.size();
+    // Форматирование не переходит из записи в запись, как и в отдельном ostream на каждую строку
+    if (start == 0) {
+        stream.clear();
+        stream.flags(std::ios_base::dec | std::ios_base::skipws);
+        stream.precision(6);
+        stream.width(0);
+        stream.fill(' ');
+    }
+}
+
+LogRecord::~LogRecord() {
+    std::string& text = GetRecordStream().buffer.Text();
+    logger.Commit(level, text.data() + start, text.size() - start);
+    text.resize(start);
+}
@@ -1,45 +1,153 @@
 #pragma once
-#include <fstream>
-#include <string>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Путь по умолчанию; переопределяется переменной окружения KATAMARI_LOG_FILE или Logger::SetSinkPath
+#define LOGGER_FILE_PATH "labalog.txt"
+
+enum class LogLevel : uint8_t {
+    Trace,   // каждый вызов отрисовки и другие сообщения из покадровых путей
+    Debug,   // подробности загрузки и жизненного цикла объектов
+    Info,
+    Warning,
+    Error,
+    Off
+};
+
+// Уровни ниже KATAMARI_LOG_MIN_LEVEL вырезаются при компиляции вместе с вычислением аргументов
+#ifndef KATAMARI_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define KATAMARI_LOG_MIN_LEVEL 1
+#else
+#define KATAMARI_LOG_MIN_LEVEL 0
+#endif
+#endif
+
+// Кольцевой буфер записей одного потока: пишет только владелец, читает только поток записи лога
+class LogRing {
+public:
+    explicit LogRing(size_t capacity);
 
+    bool TryPush(const char* text, size_t size);
+    // Дописывает текст всех готовых записей в out; возвращает число записей
+    size_t Drain(std::string& out);
+    size_t GetUsedBytes() const;
+
+    std::atomic<bool> abandoned; // поток-владелец завершился
+
+private:
+    void CopyIn(uint64_t position, const void* source, size_t size);
+    void CopyOut(uint64_t position, void* target, size_t size) const;
+
+    std::unique_ptr<char[]> data;
+    size_t mask;
+    alignas(64) std::atomic<uint64_t> head; // позиция записи, двигает владелец
+    alignas(64) std::atomic<uint64_t> tail; // позиция чтения, двигает поток записи
+};
+
+// Асинхронный лог: запись форматируется в потоке вызова и кладётся в его кольцевой буфер без блокировок,
+// в файл её переносит фоновый поток. Порядок сохраняется в пределах одного потока.
+// Когда буфер полон, Trace/Debug/Info отбрасываются (счётчик в GetDroppedCount), Warning/Error ждут места.
 class Logger {
 public:
-    Logger() {
-        logFile.open("C:\\Users\\Stalker\\Desktop\\labalog.txt", std::ios::out | std::ios::app);
-        if (!logFile.is_open()) {
-            throw std::runtime_error("Не удалось открыть файл логов: C:\\Users\\Stalker\\Desktop\\labalog.txt");
-        }
-    }
+    static constexpr size_t RingCapacity = 256 * 1024;
+    static constexpr size_t MaxRecordSize = 16 * 1024;
 
-    ~Logger() {
-        if (logFile.is_open()) {
-            logFile.close();
-        }
+    Logger();
+    ~Logger();
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    bool IsEnabled(LogLevel level) const {
+        return static_cast<uint8_t>(level) >= minimumLevel.load(std::memory_order_relaxed);
     }
 
+    // Уровень по умолчанию - Info или значение KATAMARI_LOG_LEVEL (trace, debug, info, warning, error, off)
+    void SetLevel(LogLevel level) { minimumLevel.store(static_cast<uint8_t>(level), std::memory_order_relaxed); }
+    LogLevel GetLevel() const { return static_cast<LogLevel>(minimumLevel.load(std::memory_order_relaxed)); }
+    // Файл открывается потоком записи на дописывание; записи, уже стоящие в очереди, уйдут в новый файл
+    void SetSinkPath(const std::string& path);
+    std::string GetSinkPath() const;
+
+    // Ждёт, пока всё, что поставлено в очередь до вызова, окажется в файле
+    void Flush();
+    uint64_t GetDroppedCount() const { return droppedRecords.load(std::memory_order_relaxed); }
+
+    void Commit(LogLevel level, const char* text, size_t size);
+
+private:
+    LogRing& GetThreadRing();
+    void StartWriter();
+    void WriterLoop();
+    bool DrainRings(std::string& batch);
+
+    std::atomic<uint8_t> minimumLevel;
+    std::atomic<uint64_t> droppedRecords;
+    std::atomic<bool> urgent; // есть Warning/Error или ожидающий места поток: писать без задержки
+
+    mutable std::mutex ringsMutex;
+    std::vector<std::shared_ptr<LogRing>> rings;
+
+    mutable std::mutex writerMutex;
+    std::condition_variable wakeup;
+    std::condition_variable flushed;
+    std::once_flag writerStarted;
+    std::thread writer;
+    bool stopping;
+    uint64_t flushRequested;
+    uint64_t flushCompleted;
+    std::string sinkPath;
+    bool sinkChanged;
+};
+
+extern Logger logger;
+
+// Одна запись лога: текст собирается в буфере потока и уходит в лог целиком в конце выражения
+class LogRecord {
+public:
+    explicit LogRecord(LogLevel level);
+    ~LogRecord();
+    LogRecord(const LogRecord&) = delete;
+    LogRecord& operator=(const LogRecord&) = delete;
+
     template<typename T>
-    Logger& operator<<(const T& value) {
-        std::lock_guard<std::mutex> lock(logMutex);
-        if (logFile.is_open()) {
-            logFile << value;
-            logFile.flush();
-        }
+    LogRecord& operator<<(const T& value) {
+        stream << value;
         return *this;
     }
 
-    Logger& operator<<(std::ostream& (*manip)(std::ostream&)) {
-        std::lock_guard<std::mutex> lock(logMutex);
-        if (logFile.is_open()) {
-            logFile << manip;
-            logFile.flush();
-        }
+    LogRecord& operator<<(std::ostream& (*manip)(std::ostream&)) {
+        stream << manip;
         return *this;
     }
 
 private:
-    std::ofstream logFile;
-    std::mutex logMutex;
+    LogLevel level;
+    std::ostream& stream;
+    size_t start; // начало записи в буфере потока: запись может начаться, пока собирается другая
 };
 
-extern Logger logger;
\ No newline at end of file
+// if/else вместо условного выражения: при отключённом уровне аргументы не вычисляются,
+// а при уровне ниже KATAMARI_LOG_MIN_LEVEL ветка удаляется компилятором.
+// При нулевом пороге сравнение не подставляется: оно всегда ложно и даёт -Wtype-limits в каждом файле
+#if KATAMARI_LOG_MIN_LEVEL > 0
+#define KATAMARI_LOG(level) \
+    if (static_cast<int>(level) < KATAMARI_LOG_MIN_LEVEL || !logger.IsEnabled(level)) {} else LogRecord(level)
+#else
+#define KATAMARI_LOG(level) \
+    if (!logger.IsEnabled(level)) {} else LogRecord(level)
+#endif
+
+#define LOG_TRACE KATAMARI_LOG(LogLevel::Trace)
+#define LOG_DEBUG KATAMARI_LOG(LogLevel::Debug)
+#define LOG_INFO KATAMARI_LOG(LogLevel::Info)
+#define LOG_WARNING KATAMARI_LOG(LogLevel::Warning)
+#define LOG_ERROR KATAMARI_LOG(LogLevel::Error)
@@ -0,0 +1,436 @@
+#include "MeshBvh.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+    const uint32_t BinCount = 16;
+    // Стоимости SAH в единицах проверки одной четвёрки треугольников
+    const float TraversalCost = 1.0f;
+    const float PacketCost = 1.0f;
+
+    struct Bounds {
+        float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+        float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+        void Grow(const float point[3]) {
+            for (int axis = 0; axis < 3; ++axis) {
+                min[axis] = std::min(min[axis], point[axis]);
+                max[axis] = std::max(max[axis], point[axis]);
+            }
+        }
+        void Grow(const Bounds& other) {
+            for (int axis = 0; axis < 3; ++axis) {
+                min[axis] = std::min(min[axis], other.min[axis]);
+                max[axis] = std::max(max[axis], other.max[axis]);
+            }
+        }
+        // Половина площади поверхности: SAH сравнивает только отношения
+        float Area() const {
+            if (max[0] < min[0]) return 0.0f;
+            float dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+            return dx * dy + dy * dz + dz * dx;
+        }
+    };
+
+    struct BuildTriangle {
+        Bounds bounds;
+        float centroid[3];
+    };
+
+    struct Bin {
+        Bounds bounds;
+        uint32_t count = 0;
+    };
+
+    uint32_t GetPacketCount(size_t triangles) {
+        return static_cast<uint32_t>((triangles + 3) / 4);
+    }
+
+    // Рекурсивное построение сверху вниз; узлы и четвёрки треугольников пишутся сразу в итоговом порядке
+    class BvhBuilder {
+    public:
+        BvhBuilder(const std::vector<BuildTriangle>& triangles, const std::vector<DirectX::XMFLOAT3>& corners,
+                   std::vector<MeshBvhNode>& nodes, std::vector<MeshBvhPacket>& packets)
+            : triangles(triangles), corners(corners), nodes(nodes), packets(packets), order(triangles.size()) {
+            for (size_t i = 0; i < order.size(); ++i) order[i] = static_cast<uint32_t>(i);
+        }
+
+        void BuildNode(uint32_t begin, uint32_t end, uint32_t level) {
+            uint32_t nodeIndex = static_cast<uint32_t>(nodes.size());
+            nodes.push_back(MeshBvhNode());
+            depth = std::max(depth, level + 1);
+
+            Bounds bounds, centroidBounds;
+            for (uint32_t i = begin; i < end; ++i) {
+                bounds.Grow(triangles[order[i]].bounds);
+                centroidBounds.Grow(triangles[order[i]].centroid);
+            }
+            nodes[nodeIndex].boundsMin = DirectX::XMFLOAT3(bounds.min[0], bounds.min[1], bounds.min[2]);
+            nodes[nodeIndex].boundsMax = DirectX::XMFLOAT3(bounds.max[0], bounds.max[1], bounds.max[2]);
+
+            uint32_t count = end - begin;
+            uint32_t mid = begin;
+            if (count > 1 && level + 1 < MeshBvh::MaxDepth) {
+                int axis = 0;
+                uint32_t splitBin = 0;
+                float splitCost = 0.0f;
+                if (FindSahSplit(begin, end, bounds, centroidBounds, axis, splitBin, splitCost) &&
+                    (count > MeshBvh::MaxLeafTriangles || splitCost < PacketCost * GetPacketCount(count) * bounds.Area())) {
+                    float binScale = BinCount / (centroidBounds.max[axis] - centroidBounds.min[axis]);
+                    float binOrigin = centroidBounds.min[axis];
+                    mid = static_cast<uint32_t>(
+                        std::partition(order.begin() + begin, order.begin() + end, [&](uint32_t triangle) {
+                            return GetBin(triangles[triangle].centroid[axis], binOrigin, binScale) <= splitBin;
+                        }) - order.begin());
+                } else if (count > MeshBvh::MaxLeafTriangles) {
+                    // Центроиды совпадают: SAH делить нечем, делим пополам по числу треугольников
+                    axis = 0;
+                    for (int i = 1; i < 3; ++i) {
+                        float extent = centroidBounds.max[i] - centroidBounds.min[i];
+                        if (extent > centroidBounds.max[axis] - centroidBounds.min[axis]) axis = i;
+                    }
+                    mid = begin + count / 2;
+                    std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                                     [&](uint32_t a, uint32_t b) {
+                                         return triangles[a].centroid[axis] < triangles[b].centroid[axis];
+                                     });
+                }
+            }
+
+            if (mid == begin) {
+                nodes[nodeIndex].first = static_cast<uint32_t>(packets.size());
+                nodes[nodeIndex].triangleCount = count;
+                EmitPackets(begin, end);
+                return;
+            }
+            BuildNode(begin, mid, level + 1);
+            nodes[nodeIndex].first = static_cast<uint32_t>(nodes.size());
+            nodes[nodeIndex].triangleCount = 0;
+            BuildNode(mid, end, level + 1);
+        }
+
+        uint32_t GetDepth() const { return depth; }
+
+    private:
+        static uint32_t GetBin(float centroid, float origin, float scale) {
+            return std::min(BinCount - 1, static_cast<uint32_t>((centroid - origin) * scale));
+        }
+
+        // Лучшая по SAH граница между корзинами по всем трём осям; левая часть - корзины 0..splitBin
+        bool FindSahSplit(uint32_t begin, uint32_t end, const Bounds& bounds, const Bounds& centroidBounds, int& bestAxis,
+                          uint32_t& bestBin, float& bestCost) const {
+            bestCost = FLT_MAX;
+            bestAxis = -1;
+            for (int axis = 0; axis < 3; ++axis) {
+                float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+                if (!(extent > 0.0f)) continue;
+                float binScale = BinCount / extent;
+
+                Bin bins[BinCount];
+                for (uint32_t i = begin; i < end; ++i) {
+                    const BuildTriangle& triangle = triangles[order[i]];
+                    Bin& bin = bins[GetBin(triangle.centroid[axis], centroidBounds.min[axis], binScale)];
+                    bin.bounds.Grow(triangle.bounds);
+                    ++bin.count;
+                }
+
+                float rightArea[BinCount - 1];
+                uint32_t rightCount[BinCount - 1];
+                Bounds right;
+                uint32_t rightTriangles = 0;
+                for (uint32_t i = BinCount - 1; i > 0; --i) {
+                    right.Grow(bins[i].bounds);
+                    rightTriangles += bins[i].count;
+                    rightArea[i - 1] = right.Area();
+                    rightCount[i - 1] = rightTriangles;
+                }
+
+                Bounds left;
+                uint32_t leftTriangles = 0;
+                for (uint32_t i = 0; i + 1 < BinCount; ++i) {
+                    left.Grow(bins[i].bounds);
+                    leftTriangles += bins[i].count;
+                    if (leftTriangles == 0 || rightCount[i] == 0) continue;
+                    // Стоимость без деления на площадь родителя: она общая для всех вариантов и для листа
+                    float cost = left.Area() * GetPacketCount(leftTriangles) + rightArea[i] * GetPacketCount(rightCount[i]);
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestBin = i;
+                    }
+                }
+            }
+            if (bestAxis < 0) return false;
+            bestCost = TraversalCost * bounds.Area() + PacketCost * bestCost;
+            return true;
+        }
+
+        void EmitPackets(uint32_t begin, uint32_t end) {
+            for (uint32_t first = begin; first < end; first += 4) {
+                MeshBvhPacket packet;
+                for (uint32_t lane = 0; lane < 4; ++lane) {
+                    uint32_t triangle = order[std::min(first + lane, end - 1)];
+                    const DirectX::XMFLOAT3& a = corners[triangle * 3];
+                    const DirectX::XMFLOAT3& b = corners[triangle * 3 + 1];
+                    const DirectX::XMFLOAT3& c = corners[triangle * 3 + 2];
+                    packet.ax[lane] = a.x; packet.ay[lane] = a.y; packet.az[lane] = a.z;
+                    packet.bx[lane] = b.x; packet.by[lane] = b.y; packet.bz[lane] = b.z;
+                    packet.cx[lane] = c.x; packet.cy[lane] = c.y; packet.cz[lane] = c.z;
+                }
+                packets.push_back(packet);
+            }
+        }
+
+        const std::vector<BuildTriangle>& triangles;
+        const std::vector<DirectX::XMFLOAT3>& corners;
+        std::vector<MeshBvhNode>& nodes;
+        std::vector<MeshBvhPacket>& packets;
+        std::vector<uint32_t> order;
+        uint32_t depth = 0;
+    };
+
+    float BoxDistanceSq(const MeshBvhNode& node, DirectX::FXMVECTOR point) {
+        using namespace DirectX;
+        XMVECTOR boundsMin = XMLoadFloat3(&node.boundsMin);
+        XMVECTOR boundsMax = XMLoadFloat3(&node.boundsMax);
+        XMVECTOR outside = XMVectorMax(XMVectorMax(XMVectorSubtract(boundsMin, point), XMVectorSubtract(point, boundsMax)),
+                                       XMVectorZero());
+        return XMVectorGetX(XMVector3LengthSq(outside));
+    }
+
+    DirectX::XMVECTOR Dot(DirectX::FXMVECTOR ax, DirectX::FXMVECTOR ay, DirectX::FXMVECTOR az, DirectX::GXMVECTOR bx,
+                          DirectX::HXMVECTOR by, DirectX::HXMVECTOR bz) {
+        using namespace DirectX;
+        return XMVectorMultiplyAdd(ax, bx, XMVectorMultiplyAdd(ay, by, XMVectorMultiply(az, bz)));
+    }
+
+    // Ближайшие к точке p точки четырёх треугольников (Ericson, Real-Time Collision Detection, 5.1.5) без ветвлений:
+    // считаются проекция на плоскость и ближайшие точки трёх рёбер, затем выбирается нужная по маскам
+    void ClosestPointsOnPacket(const MeshBvhPacket& packet, DirectX::FXMVECTOR px, DirectX::FXMVECTOR py,
+                               DirectX::FXMVECTOR pz, DirectX::XMVECTOR& distanceSq, DirectX::XMVECTOR& qx,
+                               DirectX::XMVECTOR& qy, DirectX::XMVECTOR& qz) {
+        using namespace DirectX;
+        XMVECTOR ax = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(packet.ax));
+        XMVECTOR ay = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(packet.ay));
+        XMVECTOR az = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(packet.az));
+        XMVECTOR bx = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(packet.bx));
+        XMVECTOR by = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(packet.by));
+        XMVECTOR bz = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(packet.bz));
+        XMVECTOR cx = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(packet.cx));
+        XMVECTOR cy = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(packet.cy));
+        XMVECTOR cz = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(packet.cz));
+
+        XMVECTOR abx = XMVectorSubtract(bx, ax), aby = XMVectorSubtract(by, ay), abz = XMVectorSubtract(bz, az);
+        XMVECTOR acx = XMVectorSubtract(cx, ax), acy = XMVectorSubtract(cy, ay), acz = XMVectorSubtract(cz, az);
+        XMVECTOR bcx = XMVectorSubtract(cx, bx), bcy = XMVectorSubtract(cy, by), bcz = XMVectorSubtract(cz, bz);
+        XMVECTOR apx = XMVectorSubtract(px, ax), apy = XMVectorSubtract(py, ay), apz = XMVectorSubtract(pz, az);
+        XMVECTOR bpx = XMVectorSubtract(px, bx), bpy = XMVectorSubtract(py, by), bpz = XMVectorSubtract(pz, bz);
+
+        XMVECTOR abab = Dot(abx, aby, abz, abx, aby, abz);
+        XMVECTOR abac = Dot(abx, aby, abz, acx, acy, acz);
+        XMVECTOR acac = Dot(acx, acy, acz, acx, acy, acz);
+        XMVECTOR apab = Dot(apx, apy, apz, abx, aby, abz);
+        XMVECTOR apac = Dot(apx, apy, apz, acx, acy, acz);
+        XMVECTOR bpbc = Dot(bpx, bpy, bpz, bcx, bcy, bcz);
+        XMVECTOR bcbc = Dot(bcx, bcy, bcz, bcx, bcy, bcz);
+        XMVECTOR tiny = XMVectorReplicate(FLT_MIN);
+
+        // Рёбра ab, ac и bc: параметр проекции на отрезок зажат в [0, 1]; у вырожденного ребра он 0
+        XMVECTOR t = XMVectorSaturate(XMVectorDivide(apab, XMVectorMax(abab, tiny)));
+        qx = XMVectorMultiplyAdd(t, abx, ax);
+        qy = XMVectorMultiplyAdd(t, aby, ay);
+        qz = XMVectorMultiplyAdd(t, abz, az);
+        XMVECTOR dx = XMVectorSubtract(px, qx), dy = XMVectorSubtract(py, qy), dz = XMVectorSubtract(pz, qz);
+        distanceSq = Dot(dx, dy, dz, dx, dy, dz);
+
+        t = XMVectorSaturate(XMVectorDivide(apac, XMVectorMax(acac, tiny)));
+        XMVECTOR ex = XMVectorMultiplyAdd(t, acx, ax);
+        XMVECTOR ey = XMVectorMultiplyAdd(t, acy, ay);
+        XMVECTOR ez = XMVectorMultiplyAdd(t, acz, az);
+        dx = XMVectorSubtract(px, ex); dy = XMVectorSubtract(py, ey); dz = XMVectorSubtract(pz, ez);
+        XMVECTOR edgeSq = Dot(dx, dy, dz, dx, dy, dz);
+        XMVECTOR closer = XMVectorLess(edgeSq, distanceSq);
+        qx = XMVectorSelect(qx, ex, closer);
+        qy = XMVectorSelect(qy, ey, closer);
+        qz = XMVectorSelect(qz, ez, closer);
+        distanceSq = XMVectorMin(distanceSq, edgeSq);
+
+        t = XMVectorSaturate(XMVectorDivide(bpbc, XMVectorMax(bcbc, tiny)));
+        ex = XMVectorMultiplyAdd(t, bcx, bx);
+        ey = XMVectorMultiplyAdd(t, bcy, by);
+        ez = XMVectorMultiplyAdd(t, bcz, bz);
+        dx = XMVectorSubtract(px, ex); dy = XMVectorSubtract(py, ey); dz = XMVectorSubtract(pz, ez);
+        edgeSq = Dot(dx, dy, dz, dx, dy, dz);
+        closer = XMVectorLess(edgeSq, distanceSq);
+        qx = XMVectorSelect(qx, ex, closer);
+        qy = XMVectorSelect(qy, ey, closer);
+        qz = XMVectorSelect(qz, ez, closer);
+        distanceSq = XMVectorMin(distanceSq, edgeSq);
+
+        // Проекция на плоскость внутри треугольника (барицентрические v, w >= 0, v + w <= 1) ближе любого ребра.
+        // denom = |ab x ac|^2; у вырожденного треугольника он 0, и остаются рёбра
+        XMVECTOR denom = XMVectorNegativeMultiplySubtract(abac, abac, XMVectorMultiply(abab, acac));
+        XMVECTOR inverseDenom = XMVectorReciprocal(XMVectorMax(denom, tiny));
+        XMVECTOR v = XMVectorMultiply(XMVectorNegativeMultiplySubtract(abac, apac, XMVectorMultiply(acac, apab)), inverseDenom);
+        XMVECTOR w = XMVectorMultiply(XMVectorNegativeMultiplySubtract(abac, apab, XMVectorMultiply(abab, apac)), inverseDenom);
+        XMVECTOR zero = XMVectorZero();
+        XMVECTOR inside = XMVectorAndInt(XMVectorGreater(denom, tiny),
+                          XMVectorAndInt(XMVectorAndInt(XMVectorGreaterOrEqual(v, zero), XMVectorGreaterOrEqual(w, zero)),
+                                         XMVectorLessOrEqual(XMVectorAdd(v, w), XMVectorSplatOne())));
+        ex = XMVectorMultiplyAdd(w, acx, XMVectorMultiplyAdd(v, abx, ax));
+        ey = XMVectorMultiplyAdd(w, acy, XMVectorMultiplyAdd(v, aby, ay));
+        ez = XMVectorMultiplyAdd(w, acz, XMVectorMultiplyAdd(v, abz, az));
+        dx = XMVectorSubtract(px, ex); dy = XMVectorSubtract(py, ey); dz = XMVectorSubtract(pz, ez);
+        XMVECTOR planeSq = Dot(dx, dy, dz, dx, dy, dz);
+        qx = XMVectorSelect(qx, ex, inside);
+        qy = XMVectorSelect(qy, ey, inside);
+        qz = XMVectorSelect(qz, ez, inside);
+        distanceSq = XMVectorSelect(distanceSq, planeSq, inside);
+    }
+}
+
+bool MeshBvh::Build(const float* vertices, size_t vertexStride, size_t vertexCount, const void* indices, size_t indexSize,
+                    size_t indexCount) {
+    nodes.clear();
+    packets.clear();
+    triangleCount = 0;
+    depth = 0;
+    boundingRadius = 0.0f;
+
+    if (indexSize != sizeof(uint16_t) && indexSize != sizeof(uint32_t)) {
+        LOG_ERROR << "[MeshBvh] Ошибка: неподдерживаемый размер индекса: " << indexSize << std::endl;
+        return false;
+    }
+    if (!vertices || !indices || vertexStride < 3 || indexCount % 3 != 0) {
+        LOG_ERROR << "[MeshBvh] Ошибка: некорректные данные меша" << std::endl;
+        return false;
+    }
+    if (indexCount == 0) {
+        LOG_WARNING << "[MeshBvh] Меш без треугольников, BVH не построен" << std::endl;
+        return false;
+    }
+
+    size_t count = indexCount / 3;
+    std::vector<DirectX::XMFLOAT3> corners(indexCount);
+    float radiusSq = 0.0f;
+    for (size_t i = 0; i < indexCount; ++i) {
+        size_t index = indexSize == sizeof(uint16_t) ? static_cast<const uint16_t*>(indices)[i]
+                                                     : static_cast<const uint32_t*>(indices)[i];
+        if (index >= vertexCount) {
+            LOG_ERROR << "[MeshBvh] Ошибка: индекс вершины " << index << " вне меша из " << vertexCount << " вершин"
+                      << std::endl;
+            return false;
+        }
+        const float* position = vertices + index * vertexStride;
+        corners[i] = DirectX::XMFLOAT3(position[0], position[1], position[2]);
+        radiusSq = std::max(radiusSq, position[0] * position[0] + position[1] * position[1] + position[2] * position[2]);
+    }
+
+    std::vector<BuildTriangle> triangles(count);
+    for (size_t i = 0; i < count; ++i) {
+        BuildTriangle& triangle = triangles[i];
+        for (size_t corner = 0; corner < 3; ++corner) {
+            const DirectX::XMFLOAT3& position = corners[i * 3 + corner];
+            float point[3] = { position.x, position.y, position.z };
+            triangle.bounds.Grow(point);
+        }
+        for (int axis = 0; axis < 3; ++axis) {
+            triangle.centroid[axis] = (triangle.bounds.min[axis] + triangle.bounds.max[axis]) * 0.5f;
+        }
+    }
+
+    // Листья в среднем по 4-8 треугольников: узлов около count / 2, четвёрок чуть больше count / 4
+    nodes.reserve(count / 2 + 1);
+    packets.reserve(count / 4 + count / 8 + 1);
+    BvhBuilder builder(triangles, corners, nodes, packets);
+    builder.BuildNode(0, static_cast<uint32_t>(count), 0);
+    nodes.shrink_to_fit();
+    packets.shrink_to_fit();
+
+    triangleCount = count;
+    depth = builder.GetDepth();
+    boundingRadius = std::sqrt(radiusSq);
+    LOG_DEBUG << "[MeshBvh] BVH построен: треугольников=" << triangleCount << ", узлов=" << nodes.size()
+              << ", глубина=" << depth << ", байт=" << GetByteSize() << std::endl;
+    return true;
+}
+
+bool MeshBvh::IntersectSphere(DirectX::XMFLOAT3 center, float radius, DirectX::XMFLOAT3& closestPoint) const {
+    using namespace DirectX;
+    if (nodes.empty() || !(radius > 0.0f)) return false;
+
+    XMVECTOR point = XMLoadFloat3(&center);
+    XMVECTOR px = XMVectorReplicate(center.x);
+    XMVECTOR py = XMVectorReplicate(center.y);
+    XMVECTOR pz = XMVectorReplicate(center.z);
+    float bestSq = radius * radius;
+    bool hit = false;
+    if (BoxDistanceSq(nodes[0], point) >= bestSq) return false;
+
+    // Глубина дерева не больше MaxDepth, и на каждом уровне в стек кладётся не больше одного узла
+    uint32_t stack[MaxDepth];
+    float stackDistanceSq[MaxDepth];
+    size_t stackSize = 0;
+    uint32_t index = 0;
+    for (;;) {
+        const MeshBvhNode& node = nodes[index];
+        if (node.triangleCount > 0) {
+            uint32_t packetEnd = node.first + GetPacketCount(node.triangleCount);
+            for (uint32_t i = node.first; i < packetEnd; ++i) {
+                XMVECTOR distanceSq, qx, qy, qz;
+                ClosestPointsOnPacket(packets[i], px, py, pz, distanceSq, qx, qy, qz);
+                // Обычно ни один из четырёх не ближе найденного: одна проверка маски вместо четырёх сравнений
+                XMVECTOR closer = XMVectorLess(distanceSq, XMVectorReplicate(bestSq));
+                if (XMVector4EqualInt(closer, XMVectorFalseInt())) continue;
+
+                XMFLOAT4 laneDistanceSq, laneX, laneY, laneZ;
+                XMStoreFloat4(&laneDistanceSq, distanceSq);
+                XMStoreFloat4(&laneX, qx);
+                XMStoreFloat4(&laneY, qy);
+                XMStoreFloat4(&laneZ, qz);
+                const float* distances = &laneDistanceSq.x;
+                for (int lane = 0; lane < 4; ++lane) {
+                    if (distances[lane] < bestSq) {
+                        bestSq = distances[lane];
+                        closestPoint = XMFLOAT3((&laneX.x)[lane], (&laneY.x)[lane], (&laneZ.x)[lane]);
+                        hit = true;
+                    }
+                }
+            }
+        } else {
+            // Сначала ближний ребёнок: найденная в нём точка отсекает больше узлов дальнего
+            uint32_t nearChild = index + 1;
+            uint32_t farChild = node.first;
+            float nearSq = BoxDistanceSq(nodes[nearChild], point);
+            float farSq = BoxDistanceSq(nodes[farChild], point);
+            if (farSq < nearSq) {
+                std::swap(nearChild, farChild);
+                std::swap(nearSq, farSq);
+            }
+            if (nearSq < bestSq) {
+                if (farSq < bestSq) {
+                    stack[stackSize] = farChild;
+                    stackDistanceSq[stackSize] = farSq;
+                    ++stackSize;
+                }
+                index = nearChild;
+                continue;
+            }
+        }
+
+        // Узел из стека мог стать дальше найденной с тех пор точки
+        bool found = false;
+        while (stackSize > 0) {
+            --stackSize;
+            if (stackDistanceSq[stackSize] < bestSq) {
+                index = stack[stackSize];
+                found = true;
+                break;
+            }
+        }
+        if (!found) break;
+    }
+    return hit;
+}
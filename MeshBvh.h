@@ -0,0 +1,53 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Узел плоского BVH, 32 байта - два узла в строке кэша. Узлы лежат в порядке обхода в глубину:
+// левый ребёнок внутреннего узла - следующий узел, хранится только индекс правого
+struct MeshBvhNode {
+    DirectX::XMFLOAT3 boundsMin;
+    uint32_t first;         // лист - первая четвёрка треугольников, внутренний узел - правый ребёнок
+    DirectX::XMFLOAT3 boundsMax;
+    uint32_t triangleCount; // 0 - внутренний узел
+};
+
+// Четыре треугольника листа в раскладке SoA: проверяются за один проход SIMD.
+// Недостающие места в последней четвёрке листа - копии его последнего треугольника
+struct MeshBvhPacket {
+    float ax[4], ay[4], az[4];
+    float bx[4], by[4], bz[4];
+    float cx[4], cy[4], cz[4];
+};
+
+// BVH треугольников меша в пространстве модели для точной проверки сферы против меша.
+// Строится по SAH с разбиением центроидов на корзины один раз на уникальный меш при импорте.
+// Не зависит от D3D, поэтому живёт в ядре симуляции рядом с CelestialBody.
+class MeshBvh {
+public:
+    // Больше треугольников в листе бывает только на предельной глубине
+    static constexpr uint32_t MaxLeafTriangles = 8;
+    static constexpr uint32_t MaxDepth = 64;
+
+    // vertexStride - float на вершину, позиция - первые три; indexSize - 2 или 4 байта
+    bool Build(const float* vertices, size_t vertexStride, size_t vertexCount, const void* indices, size_t indexSize,
+               size_t indexCount);
+    // Ближайшая к center точка поверхности, если до неё меньше radius; false - сфера не касается меша
+    bool IntersectSphere(DirectX::XMFLOAT3 center, float radius, DirectX::XMFLOAT3& closestPoint) const;
+
+    bool IsEmpty() const { return nodes.empty(); }
+    size_t GetTriangleCount() const { return triangleCount; }
+    size_t GetNodeCount() const { return nodes.size(); }
+    size_t GetByteSize() const { return nodes.size() * sizeof(MeshBvhNode) + packets.size() * sizeof(MeshBvhPacket); }
+    uint32_t GetDepth() const { return depth; }
+    // Радиус сферы вокруг начала координат модели, в которую входит меш
+    float GetBoundingRadius() const { return boundingRadius; }
+
+private:
+    std::vector<MeshBvhNode> nodes;
+    std::vector<MeshBvhPacket> packets;
+    size_t triangleCount = 0;
+    uint32_t depth = 0;
+    float boundingRadius = 0.0f;
+};
@@ -0,0 +1,312 @@
+#include "MeshCache.h"
+#include "Logger.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    constexpr uint64_t FnvOffset = 14695981039346656037ull;
+    constexpr uint64_t FnvPrime = 1099511628211ull;
+
+    uint64_t HashBytes(uint64_t hash, const char* bytes, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            hash ^= static_cast<unsigned char>(bytes[i]);
+            hash *= FnvPrime;
+        }
+        return hash;
+    }
+
+    bool ReadFile(const std::filesystem::path& path, std::string& contents) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) return false;
+        std::ostringstream stream;
+        stream << file.rdbuf();
+        contents = stream.str();
+        return true;
+    }
+
+    uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+MeshCache::MeshCache() : data(nullptr), size(0),
+#ifdef _WIN32
+    fileHandle(nullptr), mappingHandle(nullptr) {
+#else
+    fileDescriptor(-1) {
+#endif
+}
+
+MeshCache::~MeshCache() {
+    Close();
+}
+
+std::string MeshCache::GetCachePath(const std::string& modelPath) {
+    return modelPath + ".meshcache";
+}
+
+bool MeshCache::HashSource(const std::string& modelPath, uint64_t& hash) {
+    std::string source;
+    if (!ReadFile(modelPath, source)) {
+        LOG_WARNING << "[MeshCache] Не удалось прочитать исходник модели: " << modelPath << std::endl;
+        return false;
+    }
+
+    hash = HashBytes(FnvOffset, source.data(), source.size());
+
+    // Материалы влияют на путь к текстуре, поэтому хешируем и все подключённые .mtl
+    std::filesystem::path directory = std::filesystem::path(modelPath).parent_path();
+    std::istringstream lines(source);
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (line.compare(0, 7, "mtllib ") != 0) continue;
+        std::string mtlName = line.substr(7);
+        while (!mtlName.empty() && (mtlName.back() == '\r' || mtlName.back() == ' ')) mtlName.pop_back();
+
+        std::string material;
+        if (ReadFile(directory / mtlName, material)) {
+            hash = HashBytes(hash, material.data(), material.size());
+        } else {
+            hash = HashBytes(hash, mtlName.data(), mtlName.size());
+        }
+    }
+    return true;
+}
+
+bool MeshCache::Write(const std::string& cachePath, uint64_t sourceHash,
+                      const float* vertices, size_t vertexFloatCount,
+                      const void* indices, size_t indexCount, size_t indexSize,
+                      const std::vector<MeshLod>& lods, const std::vector<MeshSubmesh>& submeshes,
+                      const std::vector<std::string>& materialTextures) {
+    std::string materialTable;
+    for (const std::string& texturePath : materialTextures) {
+        uint32_t length = static_cast<uint32_t>(texturePath.size());
+        materialTable.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        materialTable.append(texturePath);
+    }
+
+    MeshCacheHeader header = {};
+    header.magic = Magic;
+    header.version = Version;
+    header.sourceHash = sourceHash;
+    header.floatsPerVertex = FloatsPerVertex;
+    header.vertexCount = static_cast<uint32_t>(vertexFloatCount / FloatsPerVertex);
+    header.indexCount = static_cast<uint32_t>(indexCount);
+    header.lodCount = static_cast<uint32_t>(lods.size());
+    header.indexSize = static_cast<uint32_t>(indexSize);
+    header.submeshCount = lods.empty() ? 0 : static_cast<uint32_t>(submeshes.size() / lods.size());
+    header.materialCount = static_cast<uint32_t>(materialTextures.size());
+    header.materialBytes = static_cast<uint32_t>(materialTable.size());
+    header.vertexOffset = AlignUp(sizeof(MeshCacheHeader), 16);
+    header.indexOffset = AlignUp(header.vertexOffset + vertexFloatCount * sizeof(float), 16);
+    header.lodOffset = AlignUp(header.indexOffset + indexCount * indexSize, alignof(MeshLod));
+    header.submeshOffset = AlignUp(header.lodOffset + lods.size() * sizeof(MeshLod), alignof(MeshSubmesh));
+    header.materialOffset = header.submeshOffset + submeshes.size() * sizeof(MeshSubmesh);
+
+    // Пишем во временный файл и переименовываем, чтобы не оставить наполовину записанный кэш.
+    // Имя временного файла уникально для потока: одну модель могут импортировать параллельно
+    std::string tempPath = cachePath + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            LOG_ERROR << "[MeshCache] Ошибка: не удалось создать файл кэша: " << tempPath << std::endl;
+            return false;
+        }
+
+        const char padding[16] = {};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(padding, header.vertexOffset - sizeof(header));
+        file.write(reinterpret_cast<const char*>(vertices), vertexFloatCount * sizeof(float));
+        file.write(padding, header.indexOffset - (header.vertexOffset + vertexFloatCount * sizeof(float)));
+        file.write(reinterpret_cast<const char*>(indices), indexCount * indexSize);
+        file.write(padding, header.lodOffset - (header.indexOffset + indexCount * indexSize));
+        file.write(reinterpret_cast<const char*>(lods.data()), lods.size() * sizeof(MeshLod));
+        file.write(padding, header.submeshOffset - (header.lodOffset + lods.size() * sizeof(MeshLod)));
+        file.write(reinterpret_cast<const char*>(submeshes.data()), submeshes.size() * sizeof(MeshSubmesh));
+        file.write(materialTable.data(), materialTable.size());
+        if (!file.good()) {
+            LOG_ERROR << "[MeshCache] Ошибка записи файла кэша: " << tempPath << std::endl;
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, cachePath, error);
+    if (error) {
+        LOG_ERROR << "[MeshCache] Ошибка: не удалось заменить файл кэша " << cachePath << ": " << error.message() << std::endl;
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    LOG_INFO << "[MeshCache] Кэш записан: " << cachePath << ", вершин=" << header.vertexCount
+           << ", индексов=" << header.indexCount << ", LOD=" << header.lodCount
+           << ", подмешей=" << header.submeshCount << ", материалов=" << header.materialCount << std::endl;
+    return true;
+}
+
+bool MeshCache::Open(const std::string& cachePath, uint64_t sourceHash) {
+    Close();
+
+#ifdef _WIN32
+    std::wstring wCachePath(cachePath.begin(), cachePath.end());
+    HANDLE file = CreateFileW(wCachePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(MeshCacheHeader))) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+
+    const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    data = view;
+    size = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int fd = ::open(cachePath.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size < static_cast<off_t>(sizeof(MeshCacheHeader))) {
+        ::close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+
+    fileDescriptor = fd;
+    data = view;
+    size = static_cast<size_t>(fileStat.st_size);
+#endif
+
+    const MeshCacheHeader* header = Header();
+    bool valid = header->magic == Magic && header->version == Version && header->sourceHash == sourceHash &&
+                 header->floatsPerVertex == FloatsPerVertex &&
+                 header->vertexOffset + uint64_t(header->vertexCount) * FloatsPerVertex * sizeof(float) <= size &&
+                 (header->indexSize == 2 || header->indexSize == 4) &&
+                 header->indexOffset + uint64_t(header->indexCount) * header->indexSize <= size &&
+                 header->lodCount > 0 && header->lodOffset % alignof(MeshLod) == 0 &&
+                 header->lodOffset + uint64_t(header->lodCount) * sizeof(MeshLod) <= size &&
+                 header->submeshCount > 0 && header->submeshOffset % alignof(MeshSubmesh) == 0 &&
+                 header->submeshOffset + uint64_t(header->lodCount) * header->submeshCount * sizeof(MeshSubmesh) <= size &&
+                 header->materialOffset + header->materialBytes <= size && ReadMaterials();
+    if (!valid) {
+        LOG_WARNING << "[MeshCache] Кэш устарел или повреждён: " << cachePath << std::endl;
+        Close();
+        return false;
+    }
+
+    LOG_INFO << "[MeshCache] Кэш отображён в память: " << cachePath << ", вершин=" << header->vertexCount
+           << ", индексов=" << header->indexCount << std::endl;
+    return true;
+}
+
+void MeshCache::Close() {
+#ifdef _WIN32
+    if (data) UnmapViewOfFile(data);
+    if (mappingHandle) CloseHandle(mappingHandle);
+    if (fileHandle) CloseHandle(fileHandle);
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    if (data) munmap(const_cast<void*>(data), size);
+    if (fileDescriptor >= 0) ::close(fileDescriptor);
+    fileDescriptor = -1;
+#endif
+    data = nullptr;
+    size = 0;
+    materialTextures.clear();
+}
+
+bool MeshCache::ReadMaterials() {
+    const MeshCacheHeader* header = Header();
+    const char* cursor = static_cast<const char*>(data) + header->materialOffset;
+    const char* end = cursor + header->materialBytes;
+    materialTextures.clear();
+    for (uint32_t i = 0; i < header->materialCount; ++i) {
+        uint32_t length = 0;
+        if (static_cast<size_t>(end - cursor) < sizeof(length)) return false;
+        std::memcpy(&length, cursor, sizeof(length));
+        cursor += sizeof(length);
+        if (static_cast<size_t>(end - cursor) < length) return false;
+        materialTextures.emplace_back(cursor, length);
+        cursor += length;
+    }
+
+    // Подмеш с материалом вне таблицы выбрал бы чужую текстуру при отрисовке
+    const MeshSubmesh* submeshes = GetSubmeshes();
+    for (size_t i = 0; i < GetSubmeshCount(); ++i) {
+        if (submeshes[i].material >= materialTextures.size()) return false;
+    }
+    return cursor == end;
+}
+
+const float* MeshCache::GetVertices() const {
+    if (!data) return nullptr;
+    return reinterpret_cast<const float*>(static_cast<const char*>(data) + Header()->vertexOffset);
+}
+
+size_t MeshCache::GetVertexFloatCount() const {
+    return data ? size_t(Header()->vertexCount) * FloatsPerVertex : 0;
+}
+
+const void* MeshCache::GetIndices() const {
+    if (!data) return nullptr;
+    return static_cast<const char*>(data) + Header()->indexOffset;
+}
+
+size_t MeshCache::GetIndexCount() const {
+    return data ? Header()->indexCount : 0;
+}
+
+size_t MeshCache::GetIndexSize() const {
+    return data ? Header()->indexSize : 0;
+}
+
+const MeshLod* MeshCache::GetLods() const {
+    if (!data) return nullptr;
+    return reinterpret_cast<const MeshLod*>(static_cast<const char*>(data) + Header()->lodOffset);
+}
+
+size_t MeshCache::GetLodCount() const {
+    return data ? Header()->lodCount : 0;
+}
+
+const MeshSubmesh* MeshCache::GetSubmeshes() const {
+    if (!data) return nullptr;
+    return reinterpret_cast<const MeshSubmesh*>(static_cast<const char*>(data) + Header()->submeshOffset);
+}
+
+size_t MeshCache::GetSubmeshCount() const {
+    return data ? size_t(Header()->lodCount) * Header()->submeshCount : 0;
+}
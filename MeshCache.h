@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MeshSimplifier.h"
+
+// Бинарный кэш импортированного меша (<модель>.meshcache рядом с исходником).
+// Файл отображается в память, и данные вершин/индексов передаются в CreateBuffer без копирования.
+struct MeshCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceHash;       // FNV-1a по содержимому .obj и всех его .mtl
+    uint32_t floatsPerVertex;  // позиция, нормаль, UV
+    uint32_t vertexCount;
+    uint32_t indexCount;       // базовый меш и все упрощённые уровни подряд
+    uint32_t lodCount;
+    uint32_t indexSize;        // 2 или 4 байта
+    uint32_t submeshCount;     // подмешей на уровень детализации
+    uint32_t materialCount;
+    uint32_t materialBytes;    // размер таблицы материалов
+    uint32_t reserved;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint64_t lodOffset;        // таблица MeshLod, lods[0] - базовый меш
+    uint64_t submeshOffset;    // таблица MeshSubmesh, lodCount * submeshCount записей
+    uint64_t materialOffset;   // пути к диффузным текстурам: uint32_t длина, затем символы
+};
+
+class MeshCache {
+public:
+    static constexpr uint32_t Magic = 0x48534D4B; // "KMSH"
+    static constexpr uint32_t Version = 4;
+    static constexpr uint32_t FloatsPerVertex = 8;
+
+    MeshCache();
+    ~MeshCache();
+    MeshCache(const MeshCache&) = delete;
+    MeshCache& operator=(const MeshCache&) = delete;
+
+    static std::string GetCachePath(const std::string& modelPath);
+    static bool HashSource(const std::string& modelPath, uint64_t& hash);
+    static bool Write(const std::string& cachePath, uint64_t sourceHash,
+                      const float* vertices, size_t vertexFloatCount,
+                      const void* indices, size_t indexCount, size_t indexSize,
+                      const std::vector<MeshLod>& lods, const std::vector<MeshSubmesh>& submeshes,
+                      const std::vector<std::string>& materialTextures);
+
+    bool Open(const std::string& cachePath, uint64_t sourceHash);
+    void Close();
+    bool IsOpen() const { return data != nullptr; }
+
+    const float* GetVertices() const;
+    size_t GetVertexFloatCount() const;
+    const void* GetIndices() const;
+    size_t GetIndexCount() const;
+    size_t GetIndexSize() const;
+    const MeshLod* GetLods() const;
+    size_t GetLodCount() const;
+    const MeshSubmesh* GetSubmeshes() const;
+    size_t GetSubmeshCount() const;
+    // Таблица материалов копируется при открытии, потому что строки в файле не выровнены
+    const std::vector<std::string>& GetMaterialTextures() const { return materialTextures; }
+
+private:
+    const MeshCacheHeader* Header() const { return static_cast<const MeshCacheHeader*>(data); }
+    bool ReadMaterials();
+
+    const void* data;
+    size_t size;
+    std::vector<std::string> materialTextures;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#else
+    int fileDescriptor;
+#endif
+};
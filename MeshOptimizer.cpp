@@ -0,0 +1,327 @@
+#include "MeshOptimizer.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace {
+    // Параметры оценки вершин из "Linear-Speed Vertex Cache Optimisation" (Forsyth)
+    constexpr size_t ScoringCacheSize = 32;
+    constexpr float CacheDecayPower = 1.5f;
+    constexpr float LastTriangleScore = 0.75f;
+    constexpr float ValenceBoostScale = 2.0f;
+    constexpr float ValenceBoostPower = 0.5f;
+    constexpr uint32_t MaxScoredValence = 32;
+    constexpr uint32_t NotCached = ~0u;
+
+    struct ScoreTables {
+        float cache[ScoringCacheSize];
+        float valence[MaxScoredValence + 1];
+
+        ScoreTables() {
+            for (size_t i = 0; i < ScoringCacheSize; ++i) {
+                // Вершины только что выведенного треугольника получают фиксированную оценку,
+                // чтобы не выводить подряд треугольники с общим ребром одного и того же направления
+                cache[i] = i < 3 ? LastTriangleScore
+                                 : std::pow(1.0f - float(i - 3) / float(ScoringCacheSize - 3), CacheDecayPower);
+            }
+            valence[0] = 0.0f;
+            for (uint32_t i = 1; i <= MaxScoredValence; ++i) {
+                valence[i] = ValenceBoostScale * std::pow(float(i), -ValenceBoostPower);
+            }
+        }
+
+        // Вершины с малым числом оставшихся треугольников поднимаются, чтобы не оставлять одиночные треугольники
+        float Vertex(uint32_t cachePosition, uint32_t liveTriangles) const {
+            if (liveTriangles == 0) return -1.0f;
+            float score = cachePosition == NotCached ? 0.0f : cache[cachePosition];
+            return score + valence[std::min(liveTriangles, MaxScoredValence)];
+        }
+    };
+
+    const ScoreTables& GetScoreTables() {
+        static const ScoreTables tables;
+        return tables;
+    }
+
+    // FIFO-кэш через метки времени: вершина в кэше, если её загрузили не раньше cacheSize промахов назад
+    class FifoCache {
+    public:
+        FifoCache(size_t vertexCount, size_t cacheSize) : timestamps(vertexCount, 0), size(uint32_t(cacheSize)),
+                                                          time(uint32_t(cacheSize) + 1) {}
+
+        bool Miss(uint32_t vertex) {
+            if (time - timestamps[vertex] <= size) return false;
+            timestamps[vertex] = time++;
+            return true;
+        }
+
+        void Reset() { time += size + 1; }
+
+    private:
+        std::vector<uint32_t> timestamps;
+        uint32_t size;
+        uint32_t time;
+    };
+
+    void Subtract(const float* a, const float* b, float out[3]) {
+        out[0] = a[0] - b[0];
+        out[1] = a[1] - b[1];
+        out[2] = a[2] - b[2];
+    }
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount) {
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2) return;
+    const ScoreTables& tables = GetScoreTables();
+
+    // Списки треугольников каждой вершины; живые треугольники держатся в начале списка
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i) ++liveTriangles[indices[i]];
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v) adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    {
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; ++i) adjacency[fill[indices[i]]++] = uint32_t(i / 3);
+    }
+
+    std::vector<uint32_t> cachePosition(vertexCount, NotCached);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) vertexScore[v] = tables.Vertex(NotCached, liveTriangles[v]);
+
+    std::vector<float> triangleScore(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+    }
+    std::vector<bool> emitted(triangleCount, false);
+
+    std::vector<uint32_t> result;
+    result.reserve(triangleCount * 3);
+    std::vector<uint32_t> cache, nextCache;
+    cache.reserve(ScoringCacheSize + 3);
+    nextCache.reserve(ScoringCacheSize + 3);
+
+    uint32_t best = uint32_t(std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin());
+    size_t cursor = 0;
+    for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount) {
+        if (best == NotCached) {
+            // В кэше не осталось вершин с живыми треугольниками - начинаем с первого невыведенного
+            while (emitted[cursor]) ++cursor;
+            best = uint32_t(cursor);
+        }
+        const uint32_t* triangle = indices + size_t(best) * 3;
+        result.insert(result.end(), triangle, triangle + 3);
+        emitted[best] = true;
+
+        for (int k = 0; k < 3; ++k) {
+            uint32_t vertex = triangle[k];
+            uint32_t* begin = adjacency.data() + adjacencyOffsets[vertex];
+            uint32_t* end = begin + liveTriangles[vertex];
+            uint32_t* found = std::find(begin, end, best);
+            if (found != end) {
+                std::swap(*found, *(end - 1));
+                --liveTriangles[vertex];
+            }
+        }
+
+        // Вершины треугольника встают в начало кэша, остальные сдвигаются; вытесненные теряют бонус кэша
+        nextCache.assign(triangle, triangle + 3);
+        if (nextCache[1] == nextCache[0]) nextCache.erase(nextCache.begin() + 1);
+        if (std::find(nextCache.begin(), nextCache.end() - 1, nextCache.back()) != nextCache.end() - 1) nextCache.pop_back();
+        for (uint32_t vertex : cache) {
+            if (std::find(nextCache.begin(), nextCache.end(), vertex) == nextCache.end()) nextCache.push_back(vertex);
+        }
+        for (size_t i = ScoringCacheSize; i < nextCache.size(); ++i) cachePosition[nextCache[i]] = NotCached;
+        if (nextCache.size() > ScoringCacheSize) nextCache.resize(ScoringCacheSize);
+        for (size_t i = 0; i < nextCache.size(); ++i) cachePosition[nextCache[i]] = uint32_t(i);
+
+        // Пересчитываем оценки вершин кэша и вытесненных, затем их живых треугольников
+        for (uint32_t vertex : cache) vertexScore[vertex] = tables.Vertex(cachePosition[vertex], liveTriangles[vertex]);
+        for (uint32_t vertex : nextCache) vertexScore[vertex] = tables.Vertex(cachePosition[vertex], liveTriangles[vertex]);
+
+        best = NotCached;
+        float bestScore = -1.0f;
+        for (uint32_t vertex : nextCache) {
+            const uint32_t* begin = adjacency.data() + adjacencyOffsets[vertex];
+            for (const uint32_t* it = begin; it != begin + liveTriangles[vertex]; ++it) {
+                const uint32_t* corners = indices + size_t(*it) * 3;
+                float score = vertexScore[corners[0]] + vertexScore[corners[1]] + vertexScore[corners[2]];
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = *it;
+                }
+            }
+        }
+        cache.swap(nextCache);
+    }
+
+    std::copy(result.begin(), result.end(), indices);
+}
+
+void MeshOptimizer::OptimizeOverdraw(const float* vertices, size_t vertexCount, size_t floatsPerVertex,
+                                     uint32_t* indices, size_t indexCount, float threshold) {
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2) return;
+
+    // Жёсткие границы - треугольники, у которых промахнулись все три вершины: там кэш и так начинается заново
+    std::vector<uint32_t> hardClusters;
+    std::vector<uint8_t> triangleMisses(triangleCount);
+    {
+        FifoCache cache(vertexCount, AnalysisCacheSize);
+        for (size_t t = 0; t < triangleCount; ++t) {
+            uint8_t misses = uint8_t(cache.Miss(indices[t * 3]) + cache.Miss(indices[t * 3 + 1]) + cache.Miss(indices[t * 3 + 2]));
+            triangleMisses[t] = misses;
+            if (t == 0 || misses == 3) hardClusters.push_back(uint32_t(t));
+        }
+    }
+    hardClusters.push_back(uint32_t(triangleCount));
+
+    // Мягкие границы внутри жёсткого кластера: режем, когда ACMR куска с холодного кэша укладывается в порог
+    std::vector<uint32_t> clusters;
+    for (size_t h = 0; h + 1 < hardClusters.size(); ++h) {
+        uint32_t begin = hardClusters[h];
+        uint32_t end = hardClusters[h + 1];
+        size_t hardMisses = 0;
+        for (uint32_t t = begin; t < end; ++t) hardMisses += triangleMisses[t];
+        float limit = threshold * float(hardMisses) / float(end - begin);
+
+        FifoCache cache(vertexCount, AnalysisCacheSize);
+        clusters.push_back(begin);
+        size_t misses = 0;
+        size_t triangles = 0;
+        for (uint32_t t = begin; t < end; ++t) {
+            misses += cache.Miss(indices[t * 3]) + cache.Miss(indices[t * 3 + 1]) + cache.Miss(indices[t * 3 + 2]);
+            ++triangles;
+            if (t + 1 < end && float(misses) <= limit * float(triangles)) {
+                clusters.push_back(t + 1);
+                cache.Reset();
+                misses = 0;
+                triangles = 0;
+            }
+        }
+    }
+    clusters.push_back(uint32_t(triangleCount));
+    size_t clusterCount = clusters.size() - 1;
+
+    // Центр меша, взвешенный площадью
+    double meshCenter[3] = { 0.0, 0.0, 0.0 };
+    double meshArea = 0.0;
+    std::vector<float> triangleNormals(triangleCount * 3);
+    std::vector<float> triangleCenters(triangleCount * 3);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        const float* p0 = vertices + size_t(indices[t * 3]) * floatsPerVertex;
+        const float* p1 = vertices + size_t(indices[t * 3 + 1]) * floatsPerVertex;
+        const float* p2 = vertices + size_t(indices[t * 3 + 2]) * floatsPerVertex;
+        float e1[3], e2[3];
+        Subtract(p1, p0, e1);
+        Subtract(p2, p0, e2);
+        float* normal = triangleNormals.data() + t * 3;
+        float* center = triangleCenters.data() + t * 3;
+        normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+        float area = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        for (int k = 0; k < 3; ++k) {
+            center[k] = (p0[k] + p1[k] + p2[k]) / 3.0f;
+            meshCenter[k] += double(center[k]) * area;
+        }
+        meshArea += area;
+    }
+    if (meshArea <= 0.0) return;
+    for (int k = 0; k < 3; ++k) meshCenter[k] /= meshArea;
+
+    // Ключ кластера - средняя по площади удалённость плоскостей его граней от центра меша.
+    // В отличие от центра и нормали кластера целиком не проседает у кластеров-поясов, огибающих меш.
+    // Кластеры с большим ключом лежат снаружи и рисуются первыми: для выпуклых частей они заслоняют остальные
+    std::vector<float> sortKey(clusterCount, 0.0f);
+    for (size_t c = 0; c < clusterCount; ++c) {
+        double support = 0.0;
+        double area = 0.0;
+        for (uint32_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+            const float* normal = triangleNormals.data() + size_t(t) * 3;
+            const float* center = triangleCenters.data() + size_t(t) * 3;
+            for (int k = 0; k < 3; ++k) support += (center[k] - meshCenter[k]) * normal[k];
+            area += std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        }
+        if (area > 0.0) sortKey[c] = float(support / area);
+    }
+    std::vector<uint32_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKey[a] > sortKey[b]; });
+
+    std::vector<uint32_t> result;
+    result.reserve(triangleCount * 3);
+    for (uint32_t c : order) {
+        result.insert(result.end(), indices + size_t(clusters[c]) * 3, indices + size_t(clusters[c + 1]) * 3);
+    }
+    std::copy(result.begin(), result.end(), indices);
+}
+
+size_t MeshOptimizer::OptimizeVertexFetch(float* vertices, size_t vertexCount, size_t floatsPerVertex,
+                                          uint32_t* indices, size_t indexCount) {
+    std::vector<uint32_t> remap(vertexCount, NotCached);
+    uint32_t nextVertex = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        uint32_t& target = remap[indices[i]];
+        if (target == NotCached) target = nextVertex++;
+        indices[i] = target;
+    }
+
+    std::vector<float> reordered(size_t(nextVertex) * floatsPerVertex);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        if (remap[v] == NotCached) continue;
+        std::copy(vertices + v * floatsPerVertex, vertices + (v + 1) * floatsPerVertex,
+                  reordered.begin() + size_t(remap[v]) * floatsPerVertex);
+    }
+    std::copy(reordered.begin(), reordered.end(), vertices);
+    return nextVertex;
+}
+
+void MeshOptimizer::Optimize(std::vector<float>& vertices, size_t floatsPerVertex, std::vector<uint32_t>& indices,
+                             const std::vector<MeshLod>& lods, const std::vector<MeshSubmesh>& submeshes) {
+    size_t vertexCount = vertices.size() / floatsPerVertex;
+    if (vertexCount == 0 || indices.empty()) return;
+
+    MeshLod base = lods.empty() ? MeshLod{ 0, static_cast<uint32_t>(indices.size()), 0.0f } : lods[0];
+    VertexCacheStats before = AnalyzeVertexCache(indices.data() + base.firstIndex, base.indexCount, vertexCount);
+
+    std::vector<MeshSubmesh> ranges = submeshes;
+    if (ranges.empty()) {
+        for (const MeshLod& lod : lods) ranges.push_back(MeshSubmesh{ lod.firstIndex, lod.indexCount, 0 });
+    }
+    if (ranges.empty()) ranges.push_back(MeshSubmesh{ 0, static_cast<uint32_t>(indices.size()), 0 });
+    for (const MeshSubmesh& range : ranges) {
+        OptimizeVertexCache(indices.data() + range.firstIndex, range.indexCount, vertexCount);
+        OptimizeOverdraw(vertices.data(), vertexCount, floatsPerVertex, indices.data() + range.firstIndex, range.indexCount);
+    }
+
+    size_t usedVertices = OptimizeVertexFetch(vertices.data(), vertexCount, floatsPerVertex, indices.data(), indices.size());
+    vertices.resize(usedVertices * floatsPerVertex);
+
+    VertexCacheStats after = AnalyzeVertexCache(indices.data() + base.firstIndex, base.indexCount, usedVertices);
+    LOG_INFO << "[MeshOptimizer] ACMR: " << before.acmr << " -> " << after.acmr << ", ATVR: " << before.atvr << " -> "
+           << after.atvr << ", неиспользуемых вершин удалено: " << vertexCount - usedVertices << std::endl;
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+                                                   size_t cacheSize) {
+    VertexCacheStats stats = { 0.0f, 0.0f };
+    if (indexCount < 3 || vertexCount == 0) return stats;
+
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<bool> used(vertexCount, false);
+    size_t misses = 0;
+    size_t usedVertices = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        misses += cache.Miss(indices[i]);
+        if (!used[indices[i]]) {
+            used[indices[i]] = true;
+            ++usedVertices;
+        }
+    }
+    stats.acmr = float(misses) / float(indexCount / 3);
+    stats.atvr = float(misses) / float(usedVertices);
+    return stats;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MeshSimplifier.h"
+
+// Статистика кэша вершин после преобразования для одного диапазона индексов
+struct VertexCacheStats {
+    float acmr; // промахи на треугольник: 3 - без повторного использования, около 0.5 - предел для регулярной сетки
+    float atvr; // промахи на использованную вершину: 1 - каждая вершина трансформируется один раз
+};
+
+// Переупорядочивание индексов и вершин при импорте.
+// Порядок треугольников - под кэш вершин (Forsyth) и затем кластерами от внешних к внутренним против перерисовки
+// (Sander, Nehab, Barczak), порядок вершин - по первому использованию.
+// Набор треугольников и их обход не меняются, поэтому изображение остаётся прежним.
+class MeshOptimizer {
+public:
+    // Размер FIFO-кэша, на который рассчитаны оценки; у современных GPU эффективный размер того же порядка
+    static constexpr size_t AnalysisCacheSize = 16;
+
+    // Переупорядочивает треугольники диапазона indices[0, indexCount) для кэша вершин
+    static void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+    // Делит уже оптимизированный под кэш диапазон на кластеры и выводит сначала обращённые наружу.
+    // Кластер режется, только если его ACMR не хуже threshold от ACMR диапазона
+    static void OptimizeOverdraw(const float* vertices, size_t vertexCount, size_t floatsPerVertex,
+                                 uint32_t* indices, size_t indexCount, float threshold = 1.05f);
+
+    // Нумерует вершины в порядке первого использования и отбрасывает неиспользуемые.
+    // Возвращает новое число вершин; vertices сжимается на месте
+    static size_t OptimizeVertexFetch(float* vertices, size_t vertexCount, size_t floatsPerVertex,
+                                      uint32_t* indices, size_t indexCount);
+
+    // Все три прохода для меша с уровнями детализации: каждый уровень оптимизируется отдельно,
+    // вершины нумеруются по базовому уровню, потому что упрощённые ссылаются на его подмножество.
+    // Если заданы подмеши, переупорядочивание идёт внутри каждого, и диапазоны материалов сохраняются
+    static void Optimize(std::vector<float>& vertices, size_t floatsPerVertex, std::vector<uint32_t>& indices,
+                         const std::vector<MeshLod>& lods, const std::vector<MeshSubmesh>& submeshes = {});
+
+    static VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+                                               size_t cacheSize = AnalysisCacheSize);
+};
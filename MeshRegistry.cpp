@@ -0,0 +1,265 @@
+#include "MeshRegistry.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+
+MeshRegistry meshRegistry;
+
+Mesh::Mesh() : device(nullptr), vertexBuffer(InvalidRenderBuffer), indexBuffer(InvalidRenderBuffer),
+               indexFormat(RenderIndexFormat::UInt32), vertexFormat(VertexFormat::Float32), quantization(), indexCount(0),
+               submeshCount(0), byteSize(0),
+               boundingRadius(0.0f), state(AssetState::Pending), pendingShares(0) {
+}
+
+Mesh::~Mesh() {
+    if (device) {
+        device->DestroyBuffer(vertexBuffer);
+        device->DestroyBuffer(indexBuffer);
+    }
+    LOG_DEBUG << "[MeshRegistry] Меш выгружен: " << path << std::endl;
+}
+
+const Texture* Mesh::GetMaterialTexture(uint32_t material) const {
+    if (material >= materialTextures.size()) return nullptr;
+    const TextureHandle& texture = materialTextures[material];
+    return texture && texture->IsReady() ? texture.get() : nullptr;
+}
+
+bool Mesh::HasReadyTexture() const {
+    for (const TextureHandle& texture : materialTextures) {
+        if (texture && texture->IsReady()) return true;
+    }
+    return false;
+}
+
+bool Mesh::HasPendingTexture() const {
+    for (const TextureHandle& texture : materialTextures) {
+        if (texture && texture->GetState() == AssetState::Pending) return true;
+    }
+    return false;
+}
+
+MeshHandle MeshRegistry::Acquire(RenderDevice& device, const std::string& modelPath, VertexFormat format) {
+    auto mesh = std::make_shared<Mesh>();
+    mesh->path = CanonicalPath(modelPath);
+    mesh->vertexFormat = format;
+    std::string key = MeshKey(mesh->path, format);
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        if (MeshHandle existing = FindShared(key)) return existing;
+        meshes[key] = mesh;
+    }
+
+    bool loaded = mesh->loader.LoadModel(modelPath);
+    if (loaded) BuildCollision(*mesh);
+    FinishLoad(device, *mesh, loaded);
+    if (loaded) {
+        mesh->materialTextures.resize(mesh->loader.GetMaterialCount());
+        for (size_t i = 0; i < mesh->materialTextures.size(); ++i) {
+            std::string texturePath = GetTextureFullPath(*mesh, i);
+            if (!texturePath.empty()) mesh->materialTextures[i] = textureCache.Acquire(device, texturePath);
+        }
+    }
+    return mesh;
+}
+
+MeshHandle MeshRegistry::AcquireAsync(AssetLoader& assetLoader, RenderDevice& device, const std::string& modelPath,
+                                      VertexFormat format) {
+    auto mesh = std::make_shared<Mesh>();
+    mesh->path = CanonicalPath(modelPath);
+    mesh->vertexFormat = format;
+    std::string key = MeshKey(mesh->path, format);
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        if (MeshHandle existing = FindShared(key)) return existing;
+        meshes[key] = mesh;
+    }
+
+    auto loaded = std::make_shared<bool>(false);
+    assetLoader.Submit(
+        [mesh, loaded, modelPath]() -> size_t {
+            *loaded = mesh->loader.LoadModel(modelPath);
+            if (!*loaded) return 0;
+            BuildCollision(*mesh);
+            return (mesh->loader.GetVertexFloatCount() * sizeof(float)) + (mesh->loader.GetIndexCount() * mesh->loader.GetIndexSize());
+        },
+        [this, mesh, loaded, &device, &assetLoader]() {
+            FinishLoad(device, *mesh, *loaded);
+            if (!*loaded) return;
+            mesh->materialTextures.resize(mesh->loader.GetMaterialCount());
+            for (size_t i = 0; i < mesh->materialTextures.size(); ++i) {
+                std::string texturePath = GetTextureFullPath(*mesh, i);
+                if (!texturePath.empty()) {
+                    mesh->materialTextures[i] = textureCache.AcquireAsync(assetLoader, device, texturePath);
+                }
+            }
+        });
+    return mesh;
+}
+
+MeshHandle MeshRegistry::FindShared(const std::string& key) {
+    auto it = meshes.find(key);
+    if (it == meshes.end()) return nullptr;
+
+    std::shared_ptr<Mesh> existing = it->second.lock();
+    if (!existing) return nullptr;
+
+    ++importsAvoided;
+    // Без реестра каждое тело держало бы свою копию вершин/индексов и на CPU, и на GPU.
+    // Пока меш грузится, его размер неизвестен, и экономия учитывается в FinishLoad
+    if (existing->IsReady()) {
+        bytesSaved += existing->byteSize * 2;
+    } else {
+        ++existing->pendingShares;
+    }
+    return existing;
+}
+
+void MeshRegistry::FinishLoad(RenderDevice& device, Mesh& mesh, bool loaded) {
+    if (!loaded) {
+        LOG_ERROR << "[MeshRegistry] Ошибка: не удалось загрузить модель: " << mesh.path << std::endl;
+        mesh.state.store(AssetState::Failed, std::memory_order_release);
+        return;
+    }
+    if (!CreateBuffers(device, mesh)) {
+        mesh.state.store(AssetState::Failed, std::memory_order_release);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        ++importCount;
+        bytesSaved += mesh.byteSize * 2 * mesh.pendingShares;
+        mesh.pendingShares = 0;
+        mesh.state.store(AssetState::Ready, std::memory_order_release);
+    }
+    LOG_INFO << "[MeshRegistry] Меш зарегистрирован: " << mesh.path << ", индексов=" << mesh.indexCount
+           << ", уровней детализации=" << mesh.lods.size() << ", подмешей=" << mesh.submeshCount
+           << ", материалов=" << mesh.loader.GetMaterialCount()
+           << ", узлов BVH=" << (mesh.collision ? mesh.collision->GetNodeCount() : 0)
+           << (mesh.vertexFormat == VertexFormat::Compact ? ", вершины сжаты" : "") << std::endl;
+}
+
+std::string MeshRegistry::CanonicalPath(const std::string& modelPath) {
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(modelPath, error);
+    return error ? modelPath : canonical.string();
+}
+
+std::string MeshRegistry::MeshKey(const std::string& canonicalPath, VertexFormat format) {
+    return format == VertexFormat::Compact ? canonicalPath + "#compact" : canonicalPath;
+}
+
+std::string MeshRegistry::GetTextureFullPath(const Mesh& mesh, size_t material) {
+    const std::string& texturePath = mesh.loader.GetMaterialTexture(material);
+    if (texturePath.empty()) return std::string();
+    return (std::filesystem::path(mesh.path).parent_path() / texturePath).string();
+}
+
+bool MeshRegistry::CreateBuffers(RenderDevice& device, Mesh& mesh) {
+    const ModelLoader& loader = mesh.loader;
+    mesh.lods.assign(loader.GetLodData(), loader.GetLodData() + loader.GetLodCount());
+    if (mesh.lods.empty()) mesh.lods.push_back(MeshLod{ 0, static_cast<uint32_t>(loader.GetIndexCount()), 0.0f });
+    mesh.indexCount = mesh.lods[0].indexCount;
+    // Без таблицы подмешей каждый уровень - один подмеш с первым материалом
+    mesh.submeshes.assign(loader.GetSubmeshData(), loader.GetSubmeshData() + loader.GetSubmeshCount());
+    if (mesh.submeshes.size() < mesh.lods.size()) {
+        mesh.submeshes.clear();
+        for (const MeshLod& lod : mesh.lods) mesh.submeshes.push_back(MeshSubmesh{ lod.firstIndex, lod.indexCount, 0 });
+    }
+    mesh.submeshCount = mesh.submeshes.size() / mesh.lods.size();
+    size_t vertexCount = loader.GetVertexFloatCount() / VertexQuantizer::FloatsPerVertex;
+    mesh.indexFormat = loader.GetIndexSize() == sizeof(uint16_t) ? RenderIndexFormat::UInt16 : RenderIndexFormat::UInt32;
+    size_t indexBytes = loader.GetIndexCount() * loader.GetIndexSize();
+
+    // Вершина - 8 float: позиция, нормаль, texCoord
+    const float* vertexData = loader.GetVertexData();
+    float radiusSq = 0.0f;
+    for (size_t i = 0; i + 2 < loader.GetVertexFloatCount(); i += 8) {
+        radiusSq = std::max(radiusSq, vertexData[i] * vertexData[i] + vertexData[i + 1] * vertexData[i + 1] +
+                                      vertexData[i + 2] * vertexData[i + 2]);
+    }
+    mesh.boundingRadius = std::sqrt(radiusSq);
+
+    if (mesh.vertexFormat == VertexFormat::Compact &&
+        !(device.SupportsPipeline(RenderPipeline::TexturedCompact) && device.SupportsPipeline(RenderPipeline::ColoredCompact))) {
+        LOG_WARNING << "[MeshRegistry] Устройство не поддерживает сжатые вершины, меш остаётся в Float32: " << mesh.path << std::endl;
+        mesh.vertexFormat = VertexFormat::Float32;
+    }
+
+    // Сжатые вершины живут только на GPU; исходные float остаются в загрузчике (или в отображённом кэше)
+    std::vector<CompactVertex> compactVertices;
+    const void* vertexSource = vertexData;
+    if (mesh.vertexFormat == VertexFormat::Compact) {
+        mesh.quantization = VertexQuantizer::ComputeQuantization(vertexData, vertexCount);
+        VertexQuantizer::Encode(vertexData, vertexCount, mesh.quantization, compactVertices);
+        vertexSource = compactVertices.data();
+    }
+    size_t vertexBytes = vertexCount * VertexQuantizer::GetStride(mesh.vertexFormat);
+    mesh.byteSize = vertexBytes + indexBytes;
+
+    mesh.device = &device;
+    mesh.vertexBuffer = device.CreateBuffer(RenderBufferType::Vertex, RenderBufferUsage::Immutable, vertexBytes,
+                                            vertexSource);
+    if (mesh.vertexBuffer == InvalidRenderBuffer) {
+        LOG_ERROR << "[MeshRegistry] Ошибка: не удалось создать вершинный буфер: " << mesh.path << std::endl;
+        return false;
+    }
+
+    mesh.indexBuffer = device.CreateBuffer(RenderBufferType::Index, RenderBufferUsage::Immutable, indexBytes,
+                                           loader.GetIndexData());
+    if (mesh.indexBuffer == InvalidRenderBuffer) {
+        LOG_ERROR << "[MeshRegistry] Ошибка: не удалось создать индексный буфер: " << mesh.path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void MeshRegistry::BuildCollision(Mesh& mesh) {
+    const ModelLoader& loader = mesh.loader;
+    size_t firstIndex = 0;
+    size_t indexCount = loader.GetIndexCount();
+    if (loader.GetLodCount() > 0) {
+        firstIndex = loader.GetLodData()[0].firstIndex;
+        indexCount = loader.GetLodData()[0].indexCount;
+    }
+    auto bvh = std::make_shared<MeshBvh>();
+    const char* indices = static_cast<const char*>(loader.GetIndexData()) + firstIndex * loader.GetIndexSize();
+    if (!bvh->Build(loader.GetVertexData(), VertexQuantizer::FloatsPerVertex,
+                    loader.GetVertexFloatCount() / VertexQuantizer::FloatsPerVertex, indices, loader.GetIndexSize(),
+                    indexCount)) {
+        LOG_WARNING << "[MeshRegistry] BVH не построен, тела с мешем подбираются по сфере: " << mesh.path << std::endl;
+        return;
+    }
+    mesh.collision = std::move(bvh);
+}
+
+size_t MeshRegistry::GetImportCount() const {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    return importCount;
+}
+
+size_t MeshRegistry::GetImportsAvoided() const {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    return importsAvoided;
+}
+
+size_t MeshRegistry::GetBytesSaved() const {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    return bytesSaved;
+}
+
+size_t MeshRegistry::GetLiveMeshCount() const {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    size_t live = 0;
+    for (const auto& entry : meshes) {
+        if (!entry.second.expired()) ++live;
+    }
+    return live;
+}
+
+void MeshRegistry::LogStats() const {
+    LOG_INFO << "[MeshRegistry] Импортов: " << GetImportCount() << ", повторных импортов избежано: " << GetImportsAvoided()
+           << ", сэкономлено байт: " << GetBytesSaved() << ", живых мешей: " << GetLiveMeshCount() << std::endl;
+}
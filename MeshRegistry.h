@@ -0,0 +1,89 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "AssetLoader.h"
+#include "MeshBvh.h"
+#include "ModelLoader.h"
+#include "RenderDevice.h"
+#include "TextureCache.h"
+#include "VertexQuantizer.h"
+
+// Импортированный меш: одна неизменяемая копия на CPU и одна пара буферов на GPU.
+struct Mesh {
+    Mesh();
+    ~Mesh();
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    bool IsReady() const { return state.load(std::memory_order_acquire) == AssetState::Ready; }
+    AssetState GetState() const { return state.load(std::memory_order_acquire); }
+    // Подмеши уровня детализации level, submeshCount штук подряд
+    const MeshSubmesh* GetSubmeshes(size_t level) const { return submeshes.data() + level * submeshCount; }
+    // Загруженная текстура материала или nullptr, если её нет или она ещё грузится
+    const Texture* GetMaterialTexture(uint32_t material) const;
+    bool HasReadyTexture() const;
+    // Хотя бы одна текстура материала ещё грузится
+    bool HasPendingTexture() const;
+
+    std::string path;
+    ModelLoader loader;
+    RenderDevice* device;
+    RenderBufferId vertexBuffer;
+    RenderBufferId indexBuffer;
+    RenderIndexFormat indexFormat; // 16-битные индексы, если вершин не больше 65535
+    VertexFormat vertexFormat; // формат вершинного буфера; сжатые вершины восстанавливаются через quantization
+    VertexQuantization quantization;
+    size_t indexCount;    // индексов базового уровня
+    std::vector<MeshLod> lods; // lods[0] - базовый меш, далее всё грубее; буферы общие
+    std::vector<MeshSubmesh> submeshes; // по submeshCount на уровень, в порядке lods
+    size_t submeshCount;
+    size_t byteSize;
+    float boundingRadius; // радиус сферы вокруг начала координат меша, для отсечения по пирамиде видимости
+    std::shared_ptr<const MeshBvh> collision; // BVH базового уровня для точного подбора; пусто, если не построен
+    std::vector<TextureHandle> materialTextures; // диффузные текстуры материалов модели; пустой хэндл - без текстуры
+    std::atomic<AssetState> state;
+    size_t pendingShares; // хэндлы, выданные до завершения загрузки
+};
+
+using MeshHandle = std::shared_ptr<const Mesh>;
+
+// Реестр мешей по каноническому пути. Меш живёт, пока на него есть хотя бы один хэндл.
+class MeshRegistry {
+public:
+    // Один путь в разных форматах - разные меши. Если устройство не поддерживает Compact, меш остаётся Float32
+    MeshHandle Acquire(RenderDevice& device, const std::string& modelPath, VertexFormat format = VertexFormat::Float32);
+    // Импорт выполняется в фоне; до готовности IsReady() возвращает false
+    MeshHandle AcquireAsync(AssetLoader& assetLoader, RenderDevice& device, const std::string& modelPath,
+                            VertexFormat format = VertexFormat::Float32);
+
+    size_t GetImportCount() const;
+    size_t GetImportsAvoided() const;
+    size_t GetBytesSaved() const;
+    size_t GetLiveMeshCount() const;
+    void LogStats() const;
+
+private:
+    static std::string CanonicalPath(const std::string& modelPath);
+    static std::string MeshKey(const std::string& canonicalPath, VertexFormat format);
+    static bool CreateBuffers(RenderDevice& device, Mesh& mesh);
+    // Строится при импорте, в потоке загрузки: в главном потоке остаётся только создание буферов
+    static void BuildCollision(Mesh& mesh);
+    static std::string GetTextureFullPath(const Mesh& mesh, size_t material);
+
+    MeshHandle FindShared(const std::string& key);
+    void FinishLoad(RenderDevice& device, Mesh& mesh, bool loaded);
+
+    mutable std::mutex registryMutex;
+    std::unordered_map<std::string, std::weak_ptr<Mesh>> meshes;
+    size_t importCount = 0;
+    size_t importsAvoided = 0;
+    size_t bytesSaved = 0;
+};
+
+extern MeshRegistry meshRegistry;
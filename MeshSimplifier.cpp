@@ -0,0 +1,382 @@
+#include "MeshSimplifier.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+
+namespace {
+    // Сумма квадратов расстояний до набора плоскостей, взвешенных площадью
+    struct Quadric {
+        double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+        double weight = 0;
+
+        void AddPlane(double a, double b, double c, double d, double w) {
+            a2 += w * a * a; ab += w * a * b; ac += w * a * c; ad += w * a * d;
+            b2 += w * b * b; bc += w * b * c; bd += w * b * d;
+            c2 += w * c * c; cd += w * c * d;
+            d2 += w * d * d;
+            weight += w;
+        }
+
+        void Add(const Quadric& other) {
+            a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+            b2 += other.b2; bc += other.bc; bd += other.bd;
+            c2 += other.c2; cd += other.cd;
+            d2 += other.d2;
+            weight += other.weight;
+        }
+
+        double Evaluate(const float* p) const {
+            double x = p[0], y = p[1], z = p[2];
+            return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x +
+                   b2 * y * y + 2 * bc * y * z + 2 * bd * y +
+                   c2 * z * z + 2 * cd * z + d2;
+        }
+    };
+
+    // Перенос вершины-группы from в позицию группы to
+    struct Collapse {
+        double cost;
+        uint32_t from;
+        uint32_t to;
+        uint32_t fromVersion;
+        uint32_t toVersion;
+        bool operator>(const Collapse& other) const { return cost > other.cost; }
+    };
+
+    struct PositionKey {
+        uint32_t bits[3];
+        bool operator==(const PositionKey& other) const {
+            return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2];
+        }
+    };
+
+    struct PositionKeyHash {
+        size_t operator()(const PositionKey& key) const {
+            return (size_t(key.bits[0]) * 73856093u) ^ (size_t(key.bits[1]) * 19349663u) ^ (size_t(key.bits[2]) * 83492791u);
+        }
+    };
+
+    void Cross(const float* a, const float* b, const float* c, double n[3]) {
+        double e1[3] = { double(b[0]) - a[0], double(b[1]) - a[1], double(b[2]) - a[2] };
+        double e2[3] = { double(c[0]) - a[0], double(c[1]) - a[1], double(c[2]) - a[2] };
+        n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+    }
+
+    constexpr double BorderWeight = 10.0;        // открытые края почти не сдвигаются
+    constexpr double MinNormalCosine = 0.25;     // схлопывание, поворачивающее грань сильнее, отклоняется
+    constexpr size_t MinLodTriangles = 16;
+}
+
+size_t MeshSimplifier::Simplify(const float* vertices, size_t vertexCount, size_t floatsPerVertex,
+                                const uint32_t* indices, size_t indexCount, size_t targetIndexCount,
+                                std::vector<uint32_t>& result, float& error) {
+    result.clear();
+    error = 0.0f;
+    if (indexCount <= targetIndexCount) {
+        result.assign(indices, indices + indexCount);
+        return result.size();
+    }
+    auto vertexPosition = [&](uint32_t vertex) { return vertices + size_t(vertex) * floatsPerVertex; };
+
+    // Вершины с одинаковой позицией (копии на швах нормалей и UV) схлопываются как одна группа
+    std::vector<uint32_t> vertexGroup(vertexCount);
+    std::vector<uint32_t> groupVertex;
+    std::unordered_map<PositionKey, uint32_t, PositionKeyHash> groupLookup;
+    groupLookup.reserve(vertexCount);
+    for (uint32_t vertex = 0; vertex < vertexCount; ++vertex) {
+        PositionKey key;
+        std::memcpy(key.bits, vertexPosition(vertex), sizeof(key.bits));
+        auto inserted = groupLookup.emplace(key, static_cast<uint32_t>(groupVertex.size()));
+        if (inserted.second) groupVertex.push_back(vertex);
+        vertexGroup[vertex] = inserted.first->second;
+    }
+    size_t groupCount = groupVertex.size();
+    auto groupPosition = [&](uint32_t group) { return vertexPosition(groupVertex[group]); };
+
+    std::vector<uint32_t> wedgeOffsets(groupCount + 1, 0);
+    for (uint32_t vertex = 0; vertex < vertexCount; ++vertex) ++wedgeOffsets[vertexGroup[vertex] + 1];
+    for (size_t group = 0; group < groupCount; ++group) wedgeOffsets[group + 1] += wedgeOffsets[group];
+    std::vector<uint32_t> wedges(vertexCount);
+    {
+        std::vector<uint32_t> cursor(wedgeOffsets.begin(), wedgeOffsets.end() - 1);
+        for (uint32_t vertex = 0; vertex < vertexCount; ++vertex) wedges[cursor[vertexGroup[vertex]]++] = vertex;
+    }
+    auto wedgeCount = [&](uint32_t group) { return wedgeOffsets[group + 1] - wedgeOffsets[group]; };
+
+    // Копия вершины в целевой группе с ближайшими UV и нормалью
+    auto nearestWedge = [&](uint32_t group, uint32_t vertex) {
+        uint32_t best = wedges[wedgeOffsets[group]];
+        if (floatsPerVertex < 8 || wedgeCount(group) == 1) return best;
+        const float* source = vertexPosition(vertex);
+        float bestDistance = 1e30f;
+        for (uint32_t i = wedgeOffsets[group]; i < wedgeOffsets[group + 1]; ++i) {
+            const float* candidate = vertexPosition(wedges[i]);
+            float du = candidate[6] - source[6];
+            float dv = candidate[7] - source[7];
+            float normalDot = candidate[3] * source[3] + candidate[4] * source[4] + candidate[5] * source[5];
+            float distance = du * du + dv * dv + (1.0f - normalDot);
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                best = wedges[i];
+            }
+        }
+        return best;
+    };
+
+    size_t triangleCount = indexCount / 3;
+    std::vector<uint32_t> corners(indices, indices + triangleCount * 3);
+    std::vector<uint32_t> cornerGroups(triangleCount * 3);
+    std::vector<char> triangleAlive(triangleCount, 1);
+    size_t aliveTriangles = 0;
+    for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+        uint32_t* groups = &cornerGroups[triangle * 3];
+        for (int k = 0; k < 3; ++k) groups[k] = vertexGroup[corners[triangle * 3 + k]];
+        if (groups[0] == groups[1] || groups[1] == groups[2] || groups[0] == groups[2]) {
+            triangleAlive[triangle] = 0;
+        } else {
+            ++aliveTriangles;
+        }
+    }
+
+    std::unordered_map<uint64_t, uint32_t> edgeUses;
+    auto edgeKey = [](uint32_t a, uint32_t b) { return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a; };
+    for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+        if (!triangleAlive[triangle]) continue;
+        const uint32_t* groups = &cornerGroups[triangle * 3];
+        for (int k = 0; k < 3; ++k) ++edgeUses[edgeKey(groups[k], groups[(k + 1) % 3])];
+    }
+
+    std::vector<Quadric> quadrics(groupCount);
+    std::vector<std::vector<uint32_t>> groupTriangles(groupCount);
+    for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+        if (!triangleAlive[triangle]) continue;
+        const uint32_t* groups = &cornerGroups[triangle * 3];
+        const float* p[3] = { groupPosition(groups[0]), groupPosition(groups[1]), groupPosition(groups[2]) };
+        for (int k = 0; k < 3; ++k) groupTriangles[groups[k]].push_back(static_cast<uint32_t>(triangle));
+
+        double normal[3];
+        Cross(p[0], p[1], p[2], normal);
+        double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (length <= 0.0) continue;
+        for (double& component : normal) component /= length;
+        double d = -(normal[0] * p[0][0] + normal[1] * p[0][1] + normal[2] * p[0][2]);
+        for (int k = 0; k < 3; ++k) quadrics[groups[k]].AddPlane(normal[0], normal[1], normal[2], d, 0.5 * length);
+
+        // Открытый край удерживается плоскостью, перпендикулярной грани
+        for (int k = 0; k < 3; ++k) {
+            uint32_t a = groups[k];
+            uint32_t b = groups[(k + 1) % 3];
+            if (edgeUses[edgeKey(a, b)] != 1) continue;
+            const float* pa = p[k];
+            const float* pb = p[(k + 1) % 3];
+            double edge[3] = { double(pb[0]) - pa[0], double(pb[1]) - pa[1], double(pb[2]) - pa[2] };
+            double edgeLengthSq = edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2];
+            double side[3] = { edge[1] * normal[2] - edge[2] * normal[1], edge[2] * normal[0] - edge[0] * normal[2],
+                               edge[0] * normal[1] - edge[1] * normal[0] };
+            double sideLength = std::sqrt(side[0] * side[0] + side[1] * side[1] + side[2] * side[2]);
+            if (sideLength <= 0.0) continue;
+            for (double& component : side) component /= sideLength;
+            double sideD = -(side[0] * pa[0] + side[1] * pa[1] + side[2] * pa[2]);
+            quadrics[a].AddPlane(side[0], side[1], side[2], sideD, BorderWeight * edgeLengthSq);
+            quadrics[b].AddPlane(side[0], side[1], side[2], sideD, BorderWeight * edgeLengthSq);
+        }
+    }
+
+    std::vector<uint32_t> versions(groupCount, 0);
+    std::vector<char> groupAlive(groupCount, 1);
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+    auto pushCollapse = [&](uint32_t from, uint32_t to) {
+        // Угол шва не двигается, а вершина шва сдвигается только в другую вершину шва
+        if (wedgeCount(from) > 2 || (wedgeCount(from) > 1 && wedgeCount(to) < 2)) return;
+        Quadric combined = quadrics[from];
+        combined.Add(quadrics[to]);
+        double cost = std::max(combined.Evaluate(groupPosition(to)), 0.0) / std::max(combined.weight, 1e-20);
+        queue.push(Collapse{ cost, from, to, versions[from], versions[to] });
+    };
+    for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+        if (!triangleAlive[triangle]) continue;
+        const uint32_t* groups = &cornerGroups[triangle * 3];
+        for (int k = 0; k < 3; ++k) {
+            pushCollapse(groups[k], groups[(k + 1) % 3]);
+            pushCollapse(groups[(k + 1) % 3], groups[k]);
+        }
+    }
+
+    double maxCost = 0.0;
+    std::vector<uint32_t> fromNeighbors;
+    std::vector<uint32_t> toNeighbors;
+    auto collectNeighbors = [&](uint32_t group, std::vector<uint32_t>& neighbors) {
+        neighbors.clear();
+        for (uint32_t triangle : groupTriangles[group]) {
+            if (!triangleAlive[triangle]) continue;
+            for (int k = 0; k < 3; ++k) {
+                uint32_t neighbor = cornerGroups[triangle * 3 + k];
+                if (neighbor != group) neighbors.push_back(neighbor);
+            }
+        }
+        std::sort(neighbors.begin(), neighbors.end());
+        neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+    };
+    auto containsGroup = [&](uint32_t triangle, uint32_t group) {
+        const uint32_t* groups = &cornerGroups[triangle * 3];
+        return groups[0] == group || groups[1] == group || groups[2] == group;
+    };
+
+    while (aliveTriangles * 3 > targetIndexCount && !queue.empty()) {
+        Collapse collapse = queue.top();
+        queue.pop();
+        uint32_t from = collapse.from;
+        uint32_t to = collapse.to;
+        if (!groupAlive[from] || !groupAlive[to] || versions[from] != collapse.fromVersion ||
+            versions[to] != collapse.toVersion) {
+            continue;
+        }
+
+        // Условие связности: общие соседи концов ребра - только вершины его треугольников
+        size_t sharedTriangles = 0;
+        for (uint32_t triangle : groupTriangles[from]) {
+            if (triangleAlive[triangle] && containsGroup(triangle, to)) ++sharedTriangles;
+        }
+        if (sharedTriangles == 0) continue;
+        collectNeighbors(from, fromNeighbors);
+        collectNeighbors(to, toNeighbors);
+        size_t commonNeighbors = 0;
+        for (size_t i = 0, j = 0; i < fromNeighbors.size() && j < toNeighbors.size();) {
+            if (fromNeighbors[i] < toNeighbors[j]) ++i;
+            else if (toNeighbors[j] < fromNeighbors[i]) ++j;
+            else { ++commonNeighbors; ++i; ++j; }
+        }
+        if (commonNeighbors > sharedTriangles) continue;
+
+        // Грани, которые остаются, не должны перевернуться или сильно повернуться
+        const float* target = groupPosition(to);
+        bool flips = false;
+        for (uint32_t triangle : groupTriangles[from]) {
+            if (!triangleAlive[triangle] || containsGroup(triangle, to)) continue;
+            const float* before[3];
+            const float* after[3];
+            for (int k = 0; k < 3; ++k) {
+                uint32_t group = cornerGroups[triangle * 3 + k];
+                before[k] = groupPosition(group);
+                after[k] = group == from ? target : before[k];
+            }
+            double normalBefore[3], normalAfter[3];
+            Cross(before[0], before[1], before[2], normalBefore);
+            Cross(after[0], after[1], after[2], normalAfter);
+            double dot = normalBefore[0] * normalAfter[0] + normalBefore[1] * normalAfter[1] + normalBefore[2] * normalAfter[2];
+            double lengths = std::sqrt((normalBefore[0] * normalBefore[0] + normalBefore[1] * normalBefore[1] +
+                                        normalBefore[2] * normalBefore[2]) *
+                                       (normalAfter[0] * normalAfter[0] + normalAfter[1] * normalAfter[1] +
+                                        normalAfter[2] * normalAfter[2]));
+            if (dot <= MinNormalCosine * lengths) {
+                flips = true;
+                break;
+            }
+        }
+        if (flips) continue;
+
+        maxCost = std::max(maxCost, collapse.cost);
+        groupAlive[from] = 0;
+        ++versions[to];
+        quadrics[to].Add(quadrics[from]);
+        for (uint32_t triangle : groupTriangles[from]) {
+            if (!triangleAlive[triangle]) continue;
+            if (containsGroup(triangle, to)) {
+                triangleAlive[triangle] = 0;
+                --aliveTriangles;
+                continue;
+            }
+            for (int k = 0; k < 3; ++k) {
+                size_t corner = triangle * 3 + k;
+                if (cornerGroups[corner] != from) continue;
+                cornerGroups[corner] = to;
+                corners[corner] = nearestWedge(to, corners[corner]);
+            }
+            groupTriangles[to].push_back(triangle);
+        }
+        std::vector<uint32_t>().swap(groupTriangles[from]);
+        std::vector<uint32_t>& toTriangles = groupTriangles[to];
+        toTriangles.erase(std::remove_if(toTriangles.begin(), toTriangles.end(),
+                                         [&](uint32_t triangle) { return !triangleAlive[triangle]; }),
+                          toTriangles.end());
+
+        collectNeighbors(to, toNeighbors);
+        for (uint32_t neighbor : toNeighbors) {
+            pushCollapse(to, neighbor);
+            pushCollapse(neighbor, to);
+        }
+    }
+
+    result.reserve(aliveTriangles * 3);
+    for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+        if (!triangleAlive[triangle]) continue;
+        result.insert(result.end(), corners.begin() + triangle * 3, corners.begin() + triangle * 3 + 3);
+    }
+    error = static_cast<float>(std::sqrt(maxCost));
+    return result.size();
+}
+
+void MeshSimplifier::BuildLodChain(const float* vertices, size_t vertexCount, size_t floatsPerVertex,
+                                   std::vector<uint32_t>& indices, std::vector<MeshLod>& lods, size_t maxLevels) {
+    std::vector<MeshSubmesh> submeshes = { MeshSubmesh{ 0, static_cast<uint32_t>(indices.size()), 0 } };
+    BuildLodChain(vertices, vertexCount, floatsPerVertex, indices, submeshes, lods, maxLevels);
+}
+
+void MeshSimplifier::BuildLodChain(const float* vertices, size_t vertexCount, size_t floatsPerVertex,
+                                   std::vector<uint32_t>& indices, std::vector<MeshSubmesh>& submeshes,
+                                   std::vector<MeshLod>& lods, size_t maxLevels) {
+    size_t submeshCount = submeshes.size();
+    lods.clear();
+    lods.push_back(MeshLod{ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+    if (submeshCount == 0) return;
+
+    // Каждый уровень строится из предыдущего; ошибки уровней складываются как верхняя оценка
+    std::vector<float> submeshErrors(submeshCount, 0.0f);
+    std::vector<uint32_t> simplified;
+    std::vector<MeshSubmesh> level(submeshCount);
+    while (lods.size() < maxLevels) {
+        MeshLod previous = lods.back();
+        size_t previousBase = (lods.size() - 1) * submeshCount;
+        size_t levelStart = indices.size();
+        float levelError = 0.0f;
+
+        for (size_t i = 0; i < submeshCount; ++i) {
+            MeshSubmesh source = submeshes[previousBase + i];
+            size_t target = source.indexCount / 6 * 3;
+            float error = 0.0f;
+            size_t count = 0;
+            if (target >= MinLodTriangles * 3) {
+                count = Simplify(vertices, vertexCount, floatsPerVertex, indices.data() + source.firstIndex,
+                                 source.indexCount, target, simplified, error);
+            }
+            if (count == 0 || count > size_t(source.indexCount) * 9 / 10) {
+                simplified.assign(indices.begin() + source.firstIndex,
+                                  indices.begin() + source.firstIndex + source.indexCount);
+                error = 0.0f;
+            }
+            level[i] = MeshSubmesh{ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(simplified.size()),
+                                    source.material };
+            indices.insert(indices.end(), simplified.begin(), simplified.end());
+            submeshErrors[i] += error;
+            levelError = std::max(levelError, submeshErrors[i]);
+        }
+
+        size_t count = indices.size() - levelStart;
+        if (count > size_t(previous.indexCount) * 9 / 10) {
+            indices.resize(levelStart);
+            break;
+        }
+
+        MeshLod lod{ static_cast<uint32_t>(levelStart), static_cast<uint32_t>(count), levelError };
+        lods.push_back(lod);
+        submeshes.insert(submeshes.end(), level.begin(), level.end());
+        LOG_DEBUG << "[MeshSimplifier] LOD " << lods.size() - 1 << ": треугольников " << count / 3
+               << ", ошибка " << lod.error << std::endl;
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Уровень детализации: диапазон в общем индексном буфере меша, вершинный буфер у всех уровней один
+struct MeshLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error; // наибольшее отклонение от исходной поверхности в единицах модели
+};
+
+// Часть уровня детализации с одним материалом. Подмеши уровня лежат в индексном буфере подряд,
+// таблица хранится по уровням: submeshes[level * submeshCount + i]
+struct MeshSubmesh {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    uint32_t material; // индекс в таблице материалов модели
+};
+
+// Упрощение по квадрикам ошибок (Garland-Heckbert) со схлопыванием ребра в одну из его вершин.
+// Новые вершины не создаются, поэтому все уровни ссылаются на исходный вершинный буфер.
+// Вершина - floatsPerVertex float, первые три - позиция, затем нормаль и texCoord (если есть).
+class MeshSimplifier {
+public:
+    // Упрощает треугольники до targetIndexCount индексов или до первого недопустимого схлопывания.
+    // Возвращает число индексов в result; error - отклонение от входной поверхности
+    static size_t Simplify(const float* vertices, size_t vertexCount, size_t floatsPerVertex,
+                           const uint32_t* indices, size_t indexCount, size_t targetIndexCount,
+                           std::vector<uint32_t>& result, float& error);
+
+    // Дописывает к indices цепочку уровней, каждый примерно вдвое меньше предыдущего.
+    // lods[0] - исходный меш; цепочка обрывается, когда упрощение перестаёт давать заметный выигрыш
+    static void BuildLodChain(const float* vertices, size_t vertexCount, size_t floatsPerVertex,
+                              std::vector<uint32_t>& indices, std::vector<MeshLod>& lods, size_t maxLevels = 5);
+    // То же для меша из нескольких подмешей: на входе submeshes - подмеши базового уровня, покрывающие indices.
+    // Каждый подмеш упрощается отдельно, поэтому границы материалов не размываются; подмеш, который
+    // уже не упрощается, переходит на следующий уровень без изменений
+    static void BuildLodChain(const float* vertices, size_t vertexCount, size_t floatsPerVertex,
+                              std::vector<uint32_t>& indices, std::vector<MeshSubmesh>& submeshes,
+                              std::vector<MeshLod>& lods, size_t maxLevels = 5);
+};
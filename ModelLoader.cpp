@@ -1,107 +1,244 @@
 #include "ModelLoader.h"
 #include "Logger.h"
+#include "MeshOptimizer.h"
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <unordered_map>
+
+namespace {
+    // Меш сцены вместе с накопленным преобразованием узла, который на него ссылается
+    struct MeshInstance {
+        const aiMesh* mesh;
+        aiMatrix4x4 transform;
+    };
+
+    void CollectMeshInstances(const aiScene* scene, const aiNode* node, const aiMatrix4x4& parentTransform,
+                              std::vector<MeshInstance>& instances) {
+        aiMatrix4x4 transform = parentTransform * node->mTransformation;
+        for (unsigned int i = 0; i < node->mNumMeshes; ++i) {
+            instances.push_back(MeshInstance{ scene->mMeshes[node->mMeshes[i]], transform });
+        }
+        for (unsigned int i = 0; i < node->mNumChildren; ++i) {
+            CollectMeshInstances(scene, node->mChildren[i], transform, instances);
+        }
+    }
+
+    std::string GetDiffuseTexture(const aiScene* scene, const aiMesh* mesh) {
+        if (!scene->HasMaterials() || mesh->mMaterialIndex >= scene->mNumMaterials) return std::string();
+        aiString path;
+        if (scene->mMaterials[mesh->mMaterialIndex]->GetTexture(aiTextureType_DIFFUSE, 0, &path) != AI_SUCCESS) {
+            return std::string();
+        }
+        return path.C_Str();
+    }
+}
 
-ModelLoader::ModelLoader() : texturePath("") {
-    logger << "[ModelLoader] Создан объект ModelLoader" << std::endl;
+ModelLoader::ModelLoader() {
+    LOG_DEBUG << "[ModelLoader] Создан объект ModelLoader" << std::endl;
 }
 
-bool ModelLoader::LoadModel(const std::string& filePath) {
-    logger << "[ModelLoader] Начало загрузки модели: " << filePath << std::endl;
+bool ModelLoader::LoadModel(const std::string& filePath, bool useCache, bool optimize) {
+    LOG_INFO << "[ModelLoader] Начало загрузки модели: " << filePath << std::endl;
+
+    vertices.clear();
+    indices.clear();
+    shortIndices.clear();
+    lods.clear();
+    submeshes.clear();
+    materialTextures.clear();
+    cache.Close();
+
+    uint64_t sourceHash = 0;
+    if (!useCache || !optimize || !MeshCache::HashSource(filePath, sourceHash)) {
+        return ImportWithAssimp(filePath, optimize);
+    }
+
+    std::string cachePath = MeshCache::GetCachePath(filePath);
+    if (cache.Open(cachePath, sourceHash)) {
+        materialTextures = cache.GetMaterialTextures();
+        LOG_INFO << "[ModelLoader] Модель загружена из кэша: " << cachePath << std::endl;
+        return true;
+    }
+
+    LOG_INFO << "[ModelLoader] Кэш отсутствует или устарел, импорт через Assimp" << std::endl;
+    if (!ImportWithAssimp(filePath, optimize)) {
+        return false;
+    }
+    MeshCache::Write(cachePath, sourceHash, vertices.data(), vertices.size(), GetIndexData(), GetIndexCount(), GetIndexSize(),
+                     lods, submeshes, materialTextures);
+    return true;
+}
 
+bool ModelLoader::ImportWithAssimp(const std::string& filePath, bool optimize) {
     Assimp::Importer importer;
-    logger << "[ModelLoader] Попытка загрузить файл: " << filePath << std::endl;
+    LOG_DEBUG << "[ModelLoader] Попытка загрузить файл: " << filePath << std::endl;
 
+    // OBJ-импортёр заводит отдельную вершину на каждый угол грани; без слияния одинаковых вершин
+    // соседние треугольники не связаны, и упрощение не может схлопнуть ни одного ребра
     const aiScene* scene = importer.ReadFile(filePath,
-        aiProcess_Triangulate | aiProcess_GenNormals | aiProcess_FlipUVs);
+        aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_GenNormals | aiProcess_FlipUVs);
 
     if (!scene) {
-        logger << "[ModelLoader] Ошибка: не удалось загрузить сцену: " << importer.GetErrorString() << std::endl;
+        LOG_ERROR << "[ModelLoader] Ошибка: не удалось загрузить сцену: " << importer.GetErrorString() << std::endl;
         return false;
     }
 
     if (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) {
-        logger << "[ModelLoader] Ошибка: сцена неполная: " << importer.GetErrorString() << std::endl;
+        LOG_ERROR << "[ModelLoader] Ошибка: сцена неполная: " << importer.GetErrorString() << std::endl;
         return false;
     }
 
     if (!scene->mRootNode) {
-        logger << "[ModelLoader] Ошибка: отсутствует корневой узел" << std::endl;
+        LOG_ERROR << "[ModelLoader] Ошибка: отсутствует корневой узел" << std::endl;
         return false;
     }
 
     if (!scene->HasMeshes()) {
-        logger << "[ModelLoader] Ошибка: меши отсутствуют в модели" << std::endl;
+        LOG_ERROR << "[ModelLoader] Ошибка: меши отсутствуют в модели" << std::endl;
         return false;
     }
 
-    logger << "[ModelLoader] Модель успешно разобрана, количество меш: " << scene->mNumMeshes << std::endl;
-
-    aiMesh* mesh = scene->mMeshes[0];
-    logger << "[ModelLoader] Обработка меша: вершины=" << mesh->mNumVertices << ", грани=" << mesh->mNumFaces << std::endl;
-
-    vertices.clear();
-    indices.clear();
-
-    for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
-        aiVector3D pos = mesh->mVertices[i];
-        aiVector3D norm = mesh->mNormals[i];
-        vertices.push_back(pos.x);
-        vertices.push_back(pos.y);
-        vertices.push_back(pos.z);
-        vertices.push_back(norm.x);
-        vertices.push_back(norm.y);
-        vertices.push_back(norm.z);
-        if (mesh->HasTextureCoords(0)) {
-            aiVector3D texCoord = mesh->mTextureCoords[0][i];
-            vertices.push_back(texCoord.x);
-            vertices.push_back(texCoord.y);
-        } else {
-            vertices.push_back(0.0f);
-            vertices.push_back(0.0f);
-            logger << "[ModelLoader] Текстурные координаты отсутствуют для вершины " << i << ", установлены в (0, 0)" << std::endl;
+    LOG_INFO << "[ModelLoader] Модель успешно разобрана, количество меш: " << scene->mNumMeshes << std::endl;
+
+    // Все меши всех узлов сливаются в один буфер; положения и нормали переводятся в систему корня
+    std::vector<MeshInstance> instances;
+    CollectMeshInstances(scene, scene->mRootNode, aiMatrix4x4(), instances);
+
+    // Материалы с одной и той же текстурой неразличимы при отрисовке, поэтому их меши попадают в один подмеш
+    std::vector<uint32_t> instanceMaterials;
+    std::unordered_map<std::string, uint32_t> materialByTexture;
+    for (const MeshInstance& instance : instances) {
+        std::string texture = GetDiffuseTexture(scene, instance.mesh);
+        auto inserted = materialByTexture.emplace(texture, static_cast<uint32_t>(materialTextures.size()));
+        if (inserted.second) {
+            materialTextures.push_back(texture);
+            LOG_DEBUG << "[ModelLoader] Материал " << inserted.first->second << ": "
+                   << (texture.empty() ? "без текстуры" : texture) << std::endl;
         }
+        instanceMaterials.push_back(inserted.first->second);
     }
-    logger << "[ModelLoader] Вершины обработаны, общее количество float: " << vertices.size() << std::endl;
 
-    for (unsigned int i = 0; i < mesh->mNumFaces; ++i) {
-        aiFace face = mesh->mFaces[i];
-        for (unsigned int j = 0; j < face.mNumIndices; ++j) {
-            indices.push_back(face.mIndices[j]);
+    for (uint32_t material = 0; material < materialTextures.size(); ++material) {
+        MeshSubmesh submesh{ static_cast<uint32_t>(indices.size()), 0, material };
+        for (size_t i = 0; i < instances.size(); ++i) {
+            if (instanceMaterials[i] != material) continue;
+            const aiMesh* mesh = instances[i].mesh;
+            const aiMatrix4x4& transform = instances[i].transform;
+            aiMatrix3x3 normalTransform = aiMatrix3x3(transform).Inverse().Transpose();
+            // Зеркальное преобразование выворачивает треугольники, обход приходится разворачивать
+            bool mirrored = transform.Determinant() < 0.0f;
+            uint32_t baseVertex = static_cast<uint32_t>(vertices.size() / MeshCache::FloatsPerVertex);
+            LOG_DEBUG << "[ModelLoader] Обработка меша: вершины=" << mesh->mNumVertices << ", грани=" << mesh->mNumFaces
+                   << ", материал=" << material << std::endl;
+            if (!mesh->HasTextureCoords(0)) {
+                LOG_DEBUG << "[ModelLoader] Текстурные координаты отсутствуют, установлены в (0, 0)" << std::endl;
+            }
+
+            for (unsigned int v = 0; v < mesh->mNumVertices; ++v) {
+                aiVector3D pos = transform * mesh->mVertices[v];
+                aiVector3D norm = mesh->HasNormals() ? (normalTransform * mesh->mNormals[v]).Normalize() : aiVector3D(0.0f, 1.0f, 0.0f);
+                vertices.push_back(pos.x);
+                vertices.push_back(pos.y);
+                vertices.push_back(pos.z);
+                vertices.push_back(norm.x);
+                vertices.push_back(norm.y);
+                vertices.push_back(norm.z);
+                if (mesh->HasTextureCoords(0)) {
+                    aiVector3D texCoord = mesh->mTextureCoords[0][v];
+                    vertices.push_back(texCoord.x);
+                    vertices.push_back(texCoord.y);
+                } else {
+                    vertices.push_back(0.0f);
+                    vertices.push_back(0.0f);
+                }
+            }
+
+            // Точки и линии, оставшиеся после триангуляции, не рисуются
+            for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
+                const aiFace& face = mesh->mFaces[f];
+                if (face.mNumIndices != 3) continue;
+                indices.push_back(baseVertex + face.mIndices[0]);
+                indices.push_back(baseVertex + face.mIndices[mirrored ? 2 : 1]);
+                indices.push_back(baseVertex + face.mIndices[mirrored ? 1 : 2]);
+            }
         }
+        submesh.indexCount = static_cast<uint32_t>(indices.size() - submesh.firstIndex);
+        if (submesh.indexCount > 0) submeshes.push_back(submesh);
     }
-    logger << "[ModelLoader] Индексы обработаны, общее количество: " << indices.size() << std::endl;
+    LOG_DEBUG << "[ModelLoader] Вершины обработаны, общее количество float: " << vertices.size() << std::endl;
+    LOG_DEBUG << "[ModelLoader] Индексы обработаны, общее количество: " << indices.size()
+           << ", подмешей: " << submeshes.size() << std::endl;
 
-    if (scene->HasMaterials()) {
-        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-        aiString path;
-        if (material->GetTexture(aiTextureType_DIFFUSE, 0, &path) == AI_SUCCESS) {
-            texturePath = path.C_Str();
-            logger << "[ModelLoader] Текстура найдена в модели: " << texturePath << std::endl;
-        } else {
-            logger << "[ModelLoader] Текстура в материале не найдена" << std::endl;
-        }
-    } else {
-        logger << "[ModelLoader] Материалы отсутствуют в модели" << std::endl;
+    if (indices.empty()) {
+        LOG_ERROR << "[ModelLoader] Ошибка: в модели нет треугольников" << std::endl;
+        return false;
+    }
+
+    // Упрощённые уровни дописываются в тот же индексный буфер и ссылаются на те же вершины.
+    // Каждый уровень повторяет набор подмешей базового
+    size_t vertexCount = vertices.size() / MeshCache::FloatsPerVertex;
+    MeshSimplifier::BuildLodChain(vertices.data(), vertexCount, MeshCache::FloatsPerVertex, indices, submeshes, lods);
+    LOG_INFO << "[ModelLoader] Построено уровней детализации: " << lods.size() << std::endl;
+
+    // Порядок треугольников под кэш вершин и против перерисовки, вершины - в порядке первого использования
+    if (optimize) {
+        MeshOptimizer::Optimize(vertices, MeshCache::FloatsPerVertex, indices, lods, submeshes);
+    }
+    if (vertices.size() / MeshCache::FloatsPerVertex <= 0xFFFF) {
+        shortIndices.assign(indices.begin(), indices.end());
+        indices.clear();
+        indices.shrink_to_fit();
+        LOG_DEBUG << "[ModelLoader] Индексы сохранены 16-битными" << std::endl;
     }
 
-    logger << "[ModelLoader] Загрузка модели завершена успешно" << std::endl;
+    LOG_INFO << "[ModelLoader] Загрузка модели завершена успешно" << std::endl;
     return true;
 }
 
-const std::vector<float>& ModelLoader::GetVertices() const {
-    logger << "[ModelLoader] Запрос вершин, размер: " << vertices.size() << std::endl;
-    return vertices;
+const float* ModelLoader::GetVertexData() const {
+    return cache.IsOpen() ? cache.GetVertices() : vertices.data();
+}
+
+size_t ModelLoader::GetVertexFloatCount() const {
+    return cache.IsOpen() ? cache.GetVertexFloatCount() : vertices.size();
+}
+
+const void* ModelLoader::GetIndexData() const {
+    if (cache.IsOpen()) return cache.GetIndices();
+    return shortIndices.empty() ? static_cast<const void*>(indices.data()) : shortIndices.data();
+}
+
+size_t ModelLoader::GetIndexCount() const {
+    if (cache.IsOpen()) return cache.GetIndexCount();
+    return shortIndices.empty() ? indices.size() : shortIndices.size();
+}
+
+size_t ModelLoader::GetIndexSize() const {
+    if (cache.IsOpen()) return cache.GetIndexSize();
+    return shortIndices.empty() ? sizeof(unsigned int) : sizeof(uint16_t);
+}
+
+const MeshLod* ModelLoader::GetLodData() const {
+    return cache.IsOpen() ? cache.GetLods() : lods.data();
+}
+
+size_t ModelLoader::GetLodCount() const {
+    return cache.IsOpen() ? cache.GetLodCount() : lods.size();
+}
+
+const MeshSubmesh* ModelLoader::GetSubmeshData() const {
+    return cache.IsOpen() ? cache.GetSubmeshes() : submeshes.data();
+}
+
+size_t ModelLoader::GetSubmeshCount() const {
+    return cache.IsOpen() ? cache.GetSubmeshCount() : submeshes.size();
 }
 
-const std::vector<unsigned int>& ModelLoader::GetIndices() const {
-    logger << "[ModelLoader] Запрос индексов, размер: " << indices.size() << std::endl;
-    return indices;
+size_t ModelLoader::GetMaterialCount() const {
+    return materialTextures.size();
 }
 
-const std::string& ModelLoader::GetTexturePath() const {
-    logger << "[ModelLoader] Запрос пути к текстуре: " << texturePath << std::endl;
-    return texturePath;
+const std::string& ModelLoader::GetMaterialTexture(size_t material) const {
+    return materialTextures[material];
 }
\ No newline at end of file
@@ -1,17 +1,42 @@
 #pragma once
+#include <cstdint>
 #include <string>
 #include <vector>
 
+#include "MeshCache.h"
+#include "MeshSimplifier.h"
+
 class ModelLoader {
 public:
     ModelLoader();
-    bool LoadModel(const std::string& filePath);
-    const std::vector<float>& GetVertices() const;
-    const std::vector<unsigned int>& GetIndices() const;
-    const std::string& GetTexturePath() const;
+    // optimize = false оставляет треугольники и вершины в порядке файла; кэш при этом не используется,
+    // потому что в нём хранится оптимизированный меш
+    bool LoadModel(const std::string& filePath, bool useCache = true, bool optimize = true);
+    const float* GetVertexData() const;
+    size_t GetVertexFloatCount() const;
+    // Индексы базового меша и всех упрощённых уровней подряд, GetIndexSize() байт на индекс:
+    // 16-битные, если все вершины в них помещаются, иначе 32-битные
+    const void* GetIndexData() const;
+    size_t GetIndexCount() const;
+    size_t GetIndexSize() const;
+    const MeshLod* GetLodData() const;
+    size_t GetLodCount() const;
+    // Таблица подмешей по уровням: GetLodCount() * (число подмешей уровня) записей
+    const MeshSubmesh* GetSubmeshData() const;
+    size_t GetSubmeshCount() const;
+    // Материал - путь к диффузной текстуре относительно модели; пустой путь - материал без текстуры
+    size_t GetMaterialCount() const;
+    const std::string& GetMaterialTexture(size_t material) const;
+    bool IsLoadedFromCache() const { return cache.IsOpen(); }
 
 private:
+    bool ImportWithAssimp(const std::string& filePath, bool optimize);
+
     std::vector<float> vertices;
     std::vector<unsigned int> indices;
-    std::string texturePath;
-};
\ No newline at end of file
+    std::vector<uint16_t> shortIndices; // заменяют indices, если вершин не больше 65535
+    std::vector<MeshLod> lods;
+    std::vector<MeshSubmesh> submeshes;
+    std::vector<std::string> materialTextures;
+    MeshCache cache;
+};
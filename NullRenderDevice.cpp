@@ -0,0 +1,45 @@
+#include "NullRenderDevice.h"
+#include "Logger.h"
+
+size_t NullRenderDevice::GetLiveBufferCount() const {
+    std::lock_guard<std::mutex> lock(resourceMutex);
+    return bufferSizes.size();
+}
+
+size_t NullRenderDevice::GetLiveTextureCount() const {
+    std::lock_guard<std::mutex> lock(resourceMutex);
+    return textureLevels.size();
+}
+
+bool NullRenderDevice::DoCreateBuffer(RenderBufferId id, RenderBufferType type, RenderBufferUsage usage,
+                                      size_t byteSize, const void* initialData) {
+    std::lock_guard<std::mutex> lock(resourceMutex);
+    bufferSizes[id] = byteSize;
+    return true;
+}
+
+void NullRenderDevice::DoDestroyBuffer(RenderBufferId id) {
+    std::lock_guard<std::mutex> lock(resourceMutex);
+    bufferSizes.erase(id);
+}
+
+bool NullRenderDevice::DoUpdateBuffer(RenderBufferId id, const void* data, size_t byteSize) {
+    std::lock_guard<std::mutex> lock(resourceMutex);
+    auto it = bufferSizes.find(id);
+    if (it == bufferSizes.end() || byteSize > it->second) {
+        LOG_ERROR << "[NullRenderDevice] Ошибка: обновление неизвестного буфера или выход за его размер" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool NullRenderDevice::DoCreateTexture(RenderTextureId id, const RenderTextureLevel* levels, uint32_t levelCount) {
+    std::lock_guard<std::mutex> lock(resourceMutex);
+    textureLevels[id] = levelCount;
+    return true;
+}
+
+void NullRenderDevice::DoDestroyTexture(RenderTextureId id) {
+    std::lock_guard<std::mutex> lock(resourceMutex);
+    textureLevels.erase(id);
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <mutex>
+#include <unordered_map>
+
+#include "RenderDevice.h"
+
+// Устройство без GPU: хранит только размеры ресурсов и записывает поток команд в счётчики RenderDevice.
+// Позволяет гонять путь отправки команд и проверять его стоимость на машинах без D3D11.
+class NullRenderDevice : public RenderDevice {
+public:
+    bool SupportsPipeline(RenderPipeline pipeline) const override { return pipeline != RenderPipeline::None; }
+
+    size_t GetLiveBufferCount() const;
+    size_t GetLiveTextureCount() const;
+    size_t GetFrameCount() const { return frameCount; }
+
+protected:
+    bool DoCreateBuffer(RenderBufferId id, RenderBufferType type, RenderBufferUsage usage, size_t byteSize,
+                        const void* initialData) override;
+    void DoDestroyBuffer(RenderBufferId id) override;
+    bool DoUpdateBuffer(RenderBufferId id, const void* data, size_t byteSize) override;
+    bool DoCreateTexture(RenderTextureId id, const RenderTextureLevel* levels, uint32_t levelCount) override;
+    void DoDestroyTexture(RenderTextureId id) override;
+
+    void DoBeginFrame(const float clearColor[4]) override {}
+    void DoEndFrame() override { ++frameCount; }
+
+    void DoSetPipeline(RenderPipeline pipeline) override {}
+    void DoSetConstantBuffer(RenderBufferId buffer) override {}
+    void DoSetVertexBuffer(uint32_t slot, RenderBufferId buffer, uint32_t stride) override {}
+    void DoSetIndexBuffer(RenderBufferId buffer, RenderIndexFormat format) override {}
+    void DoSetTopology(RenderTopology topology) override {}
+    void DoSetTexture(RenderTextureId texture) override {}
+
+    void DoDrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex) override {}
+    void DoDrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex,
+                                uint32_t startInstance) override {}
+
+private:
+    // Ресурсы могут освобождаться из любого потока, отпустившего последний хэндл
+    mutable std::mutex resourceMutex;
+    std::unordered_map<RenderBufferId, size_t> bufferSizes;
+    std::unordered_map<RenderTextureId, uint32_t> textureLevels;
+    size_t frameCount = 0;
+};
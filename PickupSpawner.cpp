@@ -0,0 +1,162 @@
+#include "PickupSpawner.h"
+#include "Logger.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+    constexpr uint32_t DefaultActiveRadius = 2;
+    constexpr uint32_t DefaultPickupsPerRegion = 12;
+
+    // Цвета мячей исходной сцены: красный, зелёный, синий, жёлтый
+    const DirectX::XMFLOAT4 PickupColors[] = {
+        DirectX::XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f), DirectX::XMFLOAT4(0.0f, 1.0f, 0.0f, 1.0f),
+        DirectX::XMFLOAT4(0.0f, 0.0f, 1.0f, 1.0f), DirectX::XMFLOAT4(1.0f, 1.0f, 0.0f, 1.0f),
+    };
+    const DirectX::XMFLOAT3 PickupEmissive[] = {
+        DirectX::XMFLOAT3(0.8f, 0.0f, 0.0f), DirectX::XMFLOAT3(0.0f, 0.8f, 0.0f),
+        DirectX::XMFLOAT3(0.0f, 0.0f, 0.8f), DirectX::XMFLOAT3(0.5f, 0.5f, 0.0f),
+    };
+
+    // splitmix64: поток случайных чисел региона зависит только от seed и координат
+    uint64_t NextRandom(uint64_t& state) {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    float NextUnit(uint64_t& state) {
+        return static_cast<float>(NextRandom(state) >> 40) / 16777216.0f;
+    }
+}
+
+PickupSpawner::PickupSpawner(KatamariWorld& world, uint32_t seed)
+    : world(world), seed(seed), activeRadius(DefaultActiveRadius), pickupsPerRegion(DefaultPickupsPerRegion),
+      modelPath("Textures/soccer_ball.obj"), focusX(0), focusZ(0), hasFocus(false), livePickupCount(0),
+      collectedCount(0), wokenRegionCount(0), sleptRegionCount(0) {
+    LOG_INFO << "[PickupSpawner] Создан объект PickupSpawner, seed: " << seed << std::endl;
+}
+
+void PickupSpawner::SetPickupsPerRegion(uint32_t count) {
+    if (count > MaxPickupsPerRegion) {
+        LOG_WARNING << "[PickupSpawner] Мячей в регионе не больше " << MaxPickupsPerRegion << ", запрошено "
+                    << count << std::endl;
+        count = MaxPickupsPerRegion;
+    }
+    pickupsPerRegion = count;
+}
+
+uint64_t PickupSpawner::RegionKey(int32_t x, int32_t z) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(z);
+}
+
+int32_t PickupSpawner::GetRegionCoord(float value) {
+    return static_cast<int32_t>(std::floor(value / RegionSize));
+}
+
+void PickupSpawner::GenerateRegion(int32_t regionX, int32_t regionZ, std::vector<PickupSpawn>& pickups) const {
+    pickups.clear();
+    uint64_t state = (static_cast<uint64_t>(seed) << 32) ^ RegionKey(regionX, regionZ) * 0xD6E8FEB86659FD93ull;
+    uint32_t minimum = pickupsPerRegion / 2;
+    uint32_t count = minimum + static_cast<uint32_t>(NextRandom(state) % (pickupsPerRegion - minimum + 1));
+    for (uint32_t i = 0; i < count; ++i) {
+        PickupSpawn pickup;
+        pickup.radius = 0.3f + 0.4f * NextUnit(state);
+        pickup.position.x = (regionX + NextUnit(state)) * RegionSize;
+        pickup.position.z = (regionZ + NextUnit(state)) * RegionSize;
+        pickup.position.y = pickup.radius; // лежит на земле
+        uint32_t palette = static_cast<uint32_t>(NextRandom(state) % 4);
+        pickup.color = PickupColors[palette];
+        pickup.emissiveColor = PickupEmissive[palette];
+        pickups.push_back(pickup);
+    }
+}
+
+void PickupSpawner::Update() {
+    PROFILE_ZONE("PickupSpawner::Update");
+    spawnedBodies.clear();
+    removedBodies.clear();
+
+    // Подобранный мяч переходит в кучу катамари и больше не принадлежит региону
+    for (const KatamariAttachEvent& event : world.GetAttachEvents()) {
+        if (event.body >= bodySources.size() || bodySources[event.body].slot == NoBody) continue;
+        BodySource& source = bodySources[event.body];
+        collectedMasks[source.region] |= 1ull << source.slot;
+        activeRegions[source.region].bodies[source.slot] = NoBody;
+        source.slot = NoBody;
+        --livePickupCount;
+        ++collectedCount;
+    }
+
+    const CelestialBody* katamari = world.GetKatamari();
+    if (!katamari) return;
+    DirectX::XMFLOAT3 position = katamari->GetPosition();
+    int32_t regionX = GetRegionCoord(position.x);
+    int32_t regionZ = GetRegionCoord(position.z);
+    if (hasFocus && regionX == focusX && regionZ == focusZ) return;
+    focusX = regionX;
+    focusZ = regionZ;
+    hasFocus = true;
+
+    // Засыпают регионы дальше радиуса плюс один: катамари на границе не будит и не усыпляет их каждый кадр
+    int32_t radius = static_cast<int32_t>(activeRadius);
+    sleeping.clear();
+    for (auto& entry : activeRegions) {
+        const ActiveRegion& region = entry.second;
+        int32_t ring = std::max(std::abs(region.x - focusX), std::abs(region.z - focusZ));
+        if (ring > radius + 1) sleeping.push_back(entry.first);
+    }
+    // Порядок удаления задаёт, какие индексы тел займут новые регионы; от порядка обхода хеш-таблицы он не зависит
+    std::sort(sleeping.begin(), sleeping.end());
+    for (uint64_t key : sleeping) {
+        auto it = activeRegions.find(key);
+        Sleep(it->second);
+        activeRegions.erase(it);
+    }
+
+    for (int32_t z = focusZ - radius; z <= focusZ + radius; ++z) {
+        for (int32_t x = focusX - radius; x <= focusX + radius; ++x) {
+            if (activeRegions.find(RegionKey(x, z)) == activeRegions.end()) Wake(x, z);
+        }
+    }
+    LOG_TRACE << "[PickupSpawner] Регион катамари (" << focusX << ", " << focusZ << "), живых регионов: "
+              << activeRegions.size() << ", живых мячей: " << livePickupCount << std::endl;
+}
+
+void PickupSpawner::Wake(int32_t regionX, int32_t regionZ) {
+    uint64_t key = RegionKey(regionX, regionZ);
+    auto found = collectedMasks.find(key);
+    uint64_t collected = found != collectedMasks.end() ? found->second : 0;
+
+    GenerateRegion(regionX, regionZ, generated);
+    ActiveRegion& region = activeRegions[key];
+    region.x = regionX;
+    region.z = regionZ;
+    region.bodies.assign(generated.size(), NoBody);
+    for (uint32_t slot = 0; slot < generated.size(); ++slot) {
+        if (collected & (1ull << slot)) continue;
+        const PickupSpawn& pickup = generated[slot];
+        uint32_t id = world.AddPickup(modelPath, pickup.position, pickup.color, pickup.radius, true,
+                                      pickup.emissiveColor);
+        if (id >= bodySources.size()) bodySources.resize(id + 1);
+        bodySources[id].region = key;
+        bodySources[id].slot = slot;
+        region.bodies[slot] = id;
+        spawnedBodies.push_back(id);
+        ++livePickupCount;
+    }
+    ++wokenRegionCount;
+}
+
+void PickupSpawner::Sleep(ActiveRegion& region) {
+    for (uint32_t id : region.bodies) {
+        if (id == NoBody) continue;
+        world.RemovePickup(id);
+        bodySources[id].slot = NoBody;
+        removedBodies.push_back(id);
+        --livePickupCount;
+    }
+    ++sleptRegionCount;
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "KatamariWorld.h"
+
+// Мяч региона в том виде, в каком его порождает seed; y отсчитывается от земли
+struct PickupSpawn {
+    DirectX::XMFLOAT3 position;
+    DirectX::XMFLOAT4 color;
+    DirectX::XMFLOAT3 emissiveColor;
+    float radius;
+};
+
+// Процедурное население бесконечного мира: мир разбит на квадратные регионы, содержимое региона - чистая функция
+// seed и его координат. Живыми телами KatamariWorld становятся только регионы вокруг катамари; уходя из радиуса,
+// регион удаляет свои тела и засыпает. От спящего региона остаётся лишь маска подобранных мячей (и то, если
+// что-то подобрано), поэтому при возвращении он порождается заново без них. Число живых тел и стоимость кадра
+// зависят от радиуса активации, а не от размера мира.
+class PickupSpawner {
+public:
+    static constexpr float RegionSize = 32.0f;          // метров по стороне региона
+    static constexpr uint32_t MaxPickupsPerRegion = 64; // по биту маски подобранных на мяч
+
+    explicit PickupSpawner(KatamariWorld& world, uint32_t seed = 1);
+    PickupSpawner(const PickupSpawner&) = delete;
+    PickupSpawner& operator=(const PickupSpawner&) = delete;
+
+    // Вызывается после каждого KatamariWorld::Step: учитывает подобранные мячи и, если катамари перешёл
+    // в другой регион, будит новые регионы в радиусе и усыпляет вышедшие за него с запасом в один регион
+    void Update();
+
+    // Регионы в радиусе (по Чебышёву, в регионах) вокруг региона катамари живые
+    void SetActiveRadius(uint32_t regions) { activeRadius = regions; hasFocus = false; }
+    uint32_t GetActiveRadius() const { return activeRadius; }
+    // Наибольшее число мячей в регионе; в каждом регионе их от половины до этого числа. Задаётся до первого Update
+    void SetPickupsPerRegion(uint32_t count);
+    uint32_t GetPickupsPerRegion() const { return pickupsPerRegion; }
+    void SetModelPath(const std::string& path) { modelPath = path; }
+
+    // Содержимое региона (x, z) по seed, без учёта подобранных
+    void GenerateRegion(int32_t regionX, int32_t regionZ, std::vector<PickupSpawn>& pickups) const;
+    static int32_t GetRegionCoord(float value);
+
+    // Тела, добавленные в мир и удалённые из него за последний Update; удалённые обрабатываются первыми,
+    // так как добавление может занять их освободившиеся индексы
+    const std::vector<uint32_t>& GetSpawnedBodies() const { return spawnedBodies; }
+    const std::vector<uint32_t>& GetRemovedBodies() const { return removedBodies; }
+
+    size_t GetActiveRegionCount() const { return activeRegions.size(); }
+    size_t GetLivePickupCount() const { return livePickupCount; }
+    // Регионы, о которых мир помнит что-то кроме seed: с подобранными мячами, спящие и живые
+    size_t GetDormantRecordCount() const { return collectedMasks.size(); }
+    size_t GetCollectedCount() const { return collectedCount; }
+    size_t GetWokenRegionCount() const { return wokenRegionCount; }
+    size_t GetSleptRegionCount() const { return sleptRegionCount; }
+
+private:
+    static constexpr uint32_t NoBody = 0xFFFFFFFFu;
+
+    struct ActiveRegion {
+        int32_t x;
+        int32_t z;
+        std::vector<uint32_t> bodies; // по номеру мяча в регионе; NoBody - подобран
+    };
+    // Откуда живое тело: регион и номер мяча в нём
+    struct BodySource {
+        uint64_t region = 0;
+        uint32_t slot = NoBody;
+    };
+
+    static uint64_t RegionKey(int32_t x, int32_t z);
+    void Wake(int32_t regionX, int32_t regionZ);
+    void Sleep(ActiveRegion& region);
+
+    KatamariWorld& world;
+    uint32_t seed;
+    uint32_t activeRadius;
+    uint32_t pickupsPerRegion;
+    std::string modelPath;
+
+    std::unordered_map<uint64_t, ActiveRegion> activeRegions;
+    std::unordered_map<uint64_t, uint64_t> collectedMasks;
+    std::vector<BodySource> bodySources; // по индексу тела в мире
+    std::vector<PickupSpawn> generated;
+    std::vector<uint64_t> sleeping;
+    std::vector<uint32_t> spawnedBodies;
+    std::vector<uint32_t> removedBodies;
+    int32_t focusX;
+    int32_t focusZ;
+    bool hasFocus;
+    size_t livePickupCount;
+    size_t collectedCount;
+    size_t wokenRegionCount;
+    size_t sleptRegionCount;
+};
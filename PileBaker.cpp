@@ -0,0 +1,281 @@
+#include "PileBaker.h"
+#include "Logger.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+namespace {
+    constexpr size_t DefaultBatchSize = 256;
+    constexpr uint32_t NoVertex = 0xFFFFFFFFu;
+
+    uint32_t GetIndex(const ModelLoader& loader, size_t i) {
+        if (loader.GetIndexSize() == sizeof(uint16_t)) return static_cast<const uint16_t*>(loader.GetIndexData())[i];
+        return static_cast<const uint32_t*>(loader.GetIndexData())[i];
+    }
+}
+
+bool PileBaker::ChunkKey::operator<(const ChunkKey& other) const {
+    if (texture != other.texture) return std::less<const Texture*>()(texture, other.texture);
+    int order = std::memcmp(color, other.color, sizeof(color));
+    if (order != 0) return order < 0;
+    return std::memcmp(emissive, other.emissive, sizeof(emissive)) < 0;
+}
+
+PileBaker::PileBaker(RenderDevice& device, AssetLoader& assetLoader)
+    : device(device), assetLoader(assetLoader), store(std::make_shared<BakeStore>()), rootBody(nullptr),
+      indexedBodies(0), scannedChildren(0), bakedBodyCount(0), batchSize(DefaultBatchSize), inFlight(false),
+      inFlightBodies(0) {
+    store->owner = this;
+}
+
+PileBaker::~PileBaker() {
+    // Рабочий поток мог ещё собирать пачку; выгрузка, оставшаяся в очереди, увидит owner == nullptr
+    assetLoader.Flush();
+    store->owner = nullptr;
+    for (BakedPileChunk& chunk : chunks) {
+        device.DestroyBuffer(chunk.vertexBuffer);
+        device.DestroyBuffer(chunk.indexBuffer);
+    }
+}
+
+bool PileBaker::IsLoading(const CelestialBody& body, const MeshHandle& mesh) {
+    return mesh->GetState() == AssetState::Pending || (body.useTexture && mesh->HasPendingTexture());
+}
+
+void PileBaker::Update(const std::vector<std::unique_ptr<CelestialBody>>& bodies,
+                       const std::vector<MeshHandle>& bodyMeshes, uint32_t root) {
+    PROFILE_ZONE("PileBaker::Update");
+    if (root >= bodies.size()) return;
+    if (rootBody && rootBody != bodies[root].get()) {
+        LOG_WARNING << "[PileBaker] Корень кучи сменился, новые тела не запекаются" << std::endl;
+        return;
+    }
+    rootBody = bodies[root].get();
+
+    // Новые тела дописываются в конец, их индексы достаточно дописать. Слоты удалённых свободных тел
+    // занимаются заново, поэтому найденный индекс сверяется с телом, а при расхождении карта строится заново
+    for (size_t i = indexedBodies; i < bodies.size(); ++i) {
+        if (bodies[i]) bodyIndices[bodies[i].get()] = static_cast<uint32_t>(i);
+    }
+    indexedBodies = bodies.size();
+    baked.resize(bodies.size(), 0);
+
+    // Дети только дописываются в конец, и прикрепление необратимо
+    const std::vector<CelestialBody*>& children = rootBody->GetChildren();
+    for (; scannedChildren < children.size(); ++scannedChildren) {
+        const CelestialBody* child = children[scannedChildren];
+        auto it = bodyIndices.find(child);
+        if (it == bodyIndices.end() || bodies[it->second].get() != child) {
+            bodyIndices.clear();
+            for (size_t i = 0; i < bodies.size(); ++i) {
+                if (bodies[i]) bodyIndices[bodies[i].get()] = static_cast<uint32_t>(i);
+            }
+            it = bodyIndices.find(child);
+        }
+        if (it != bodyIndices.end()) waiting.push_back(it->second);
+    }
+    if (inFlight || waiting.empty()) return;
+
+    auto batch = std::make_shared<std::vector<BakeBody>>();
+    DirectX::XMMATRIX inverseRoot = DirectX::XMMatrixInverse(nullptr, rootBody->GetWorldMatrix());
+    size_t kept = 0;
+    for (size_t i = 0; i < waiting.size(); ++i) {
+        uint32_t index = waiting[i];
+        const CelestialBody& body = *bodies[index];
+        const MeshHandle& mesh = index < bodyMeshes.size() ? bodyMeshes[index] : MeshHandle();
+        // Меш с ошибкой загрузки не рисуется вовсе, а слишком большой (подмеш не влез бы в 16-битный кусок)
+        // так и рисуется отдельно
+        if (!mesh || mesh->GetState() == AssetState::Failed) continue;
+        if (!IsLoading(body, mesh) &&
+            mesh->loader.GetVertexFloatCount() / VertexQuantizer::FloatsPerVertex > MaxChunkVertices) {
+            continue;
+        }
+        if (batch->size() >= batchSize || IsLoading(body, mesh)) {
+            waiting[kept++] = index;
+            continue;
+        }
+
+        BakeBody bakeBody;
+        bakeBody.body = index;
+        bakeBody.mesh = mesh;
+        DirectX::XMStoreFloat4x4(&bakeBody.toRoot, body.GetWorldMatrix() * inverseRoot);
+        bakeBody.textures.resize(mesh->materialTextures.size());
+        for (size_t material = 0; body.useTexture && material < bakeBody.textures.size(); ++material) {
+            if (mesh->GetMaterialTexture(static_cast<uint32_t>(material))) bakeBody.textures[material] = mesh->materialTextures[material];
+        }
+        bakeBody.color = body.color;
+        bakeBody.emissiveColor = body.emissiveColor;
+        batch->push_back(std::move(bakeBody));
+    }
+    waiting.resize(kept);
+    if (batch->empty()) return;
+
+    inFlight = true;
+    inFlightBodies = batch->size();
+    std::shared_ptr<BakeStore> sharedStore = store;
+    assetLoader.Submit(
+        [sharedStore, batch]() -> size_t {
+            PROFILE_ZONE("PileBaker::BakeBatch");
+            return BakeBatch(*sharedStore, *batch);
+        },
+        [sharedStore, batch]() {
+            if (sharedStore->owner) sharedStore->owner->FinishBatch(*batch);
+        });
+}
+
+size_t PileBaker::BakeBatch(BakeStore& store, const std::vector<BakeBody>& batch) {
+    std::vector<uint32_t> remap;
+    for (const BakeBody& body : batch) {
+        const Mesh& mesh = *body.mesh;
+        remap.assign(mesh.loader.GetVertexFloatCount() / VertexQuantizer::FloatsPerVertex, NoVertex);
+        // Вблизи куча занимает пол-экрана, поэтому запекается базовый уровень детализации
+        const MeshSubmesh* submeshes = mesh.GetSubmeshes(0);
+        for (size_t i = 0; i < mesh.submeshCount; ++i) {
+            if (submeshes[i].indexCount > 0) AppendSubmesh(store, body, submeshes[i], remap);
+        }
+    }
+
+    size_t bytes = 0;
+    for (const auto& chunk : store.chunks) {
+        if (!chunk->dirty) continue;
+        ComputeBounds(*chunk);
+        bytes += chunk->vertices.size() * sizeof(float) + chunk->indices.size() * sizeof(uint16_t);
+    }
+    return bytes;
+}
+
+void PileBaker::AppendSubmesh(BakeStore& store, const BakeBody& body, const MeshSubmesh& submesh,
+                              std::vector<uint32_t>& remap) {
+    const ModelLoader& loader = body.mesh->loader;
+    const float* source = loader.GetVertexData();
+
+    // Новые номера вершин подмеша, пока без места в куске
+    std::vector<uint32_t> used;
+    for (uint32_t i = 0; i < submesh.indexCount; ++i) {
+        uint32_t vertex = GetIndex(loader, submesh.firstIndex + i);
+        if (remap[vertex] == NoVertex) {
+            remap[vertex] = static_cast<uint32_t>(used.size());
+            used.push_back(vertex);
+        }
+    }
+
+    const Texture* texture = submesh.material < body.textures.size() ? body.textures[submesh.material].get() : nullptr;
+    ChunkKey key = { texture, { body.color.x, body.color.y, body.color.z, body.color.w },
+                     { body.emissiveColor.x, body.emissiveColor.y, body.emissiveColor.z } };
+    auto open = store.openChunks.find(key);
+    ChunkData* chunk = open != store.openChunks.end() ? store.chunks[open->second].get() : nullptr;
+    if (chunk && chunk->vertices.size() / VertexQuantizer::FloatsPerVertex + used.size() > MaxChunkVertices) {
+        chunk->full = true;
+        chunk = nullptr;
+    }
+    if (!chunk) {
+        store.chunks.push_back(std::make_unique<ChunkData>());
+        chunk = store.chunks.back().get();
+        chunk->texture = texture ? body.textures[submesh.material] : TextureHandle();
+        chunk->color = body.color;
+        chunk->emissiveColor = body.emissiveColor;
+        store.openChunks[key] = store.chunks.size() - 1;
+    }
+
+    // Позиция и нормаль переводятся в координаты корня; масштаб тела однородный, нормаль достаточно нормировать
+    DirectX::XMMATRIX toRoot = DirectX::XMLoadFloat4x4(&body.toRoot);
+    uint32_t base = static_cast<uint32_t>(chunk->vertices.size() / VertexQuantizer::FloatsPerVertex);
+    chunk->vertices.reserve(chunk->vertices.size() + used.size() * VertexQuantizer::FloatsPerVertex);
+    for (uint32_t vertex : used) {
+        const float* v = source + size_t(vertex) * VertexQuantizer::FloatsPerVertex;
+        DirectX::XMFLOAT3 position, normal;
+        DirectX::XMStoreFloat3(&position, DirectX::XMVector3TransformCoord(DirectX::XMVectorSet(v[0], v[1], v[2], 1.0f), toRoot));
+        DirectX::XMStoreFloat3(&normal, DirectX::XMVector3Normalize(
+            DirectX::XMVector3TransformNormal(DirectX::XMVectorSet(v[3], v[4], v[5], 0.0f), toRoot)));
+        chunk->vertices.insert(chunk->vertices.end(), { position.x, position.y, position.z,
+                                                        normal.x, normal.y, normal.z, v[6], v[7] });
+    }
+    chunk->indices.reserve(chunk->indices.size() + submesh.indexCount);
+    for (uint32_t i = 0; i < submesh.indexCount; ++i) {
+        chunk->indices.push_back(static_cast<uint16_t>(base + remap[GetIndex(loader, submesh.firstIndex + i)]));
+    }
+    chunk->dirty = true;
+
+    for (uint32_t vertex : used) remap[vertex] = NoVertex;
+}
+
+void PileBaker::ComputeBounds(ChunkData& chunk) {
+    // Центр рамки и наибольшее расстояние до него: сфера чуть шире оптимальной, зато за два прохода
+    const std::vector<float>& v = chunk.vertices;
+    DirectX::XMFLOAT3 lower(v[0], v[1], v[2]), upper(v[0], v[1], v[2]);
+    for (size_t i = 0; i < v.size(); i += VertexQuantizer::FloatsPerVertex) {
+        lower = DirectX::XMFLOAT3(std::min(lower.x, v[i]), std::min(lower.y, v[i + 1]), std::min(lower.z, v[i + 2]));
+        upper = DirectX::XMFLOAT3(std::max(upper.x, v[i]), std::max(upper.y, v[i + 1]), std::max(upper.z, v[i + 2]));
+    }
+    chunk.boundsCenter = DirectX::XMFLOAT3((lower.x + upper.x) * 0.5f, (lower.y + upper.y) * 0.5f, (lower.z + upper.z) * 0.5f);
+    float radiusSq = 0.0f;
+    for (size_t i = 0; i < v.size(); i += VertexQuantizer::FloatsPerVertex) {
+        float dx = v[i] - chunk.boundsCenter.x, dy = v[i + 1] - chunk.boundsCenter.y, dz = v[i + 2] - chunk.boundsCenter.z;
+        radiusSq = std::max(radiusSq, dx * dx + dy * dy + dz * dz);
+    }
+    chunk.boundsRadius = std::sqrt(radiusSq);
+}
+
+bool PileBaker::UploadChunk(const ChunkData& data, BakedPileChunk& chunk) {
+    // Кусок пересоздаётся целиком: он не больше MaxChunkVertices вершин, а заполненный больше не меняется
+    RenderBufferId vertexBuffer = device.CreateBuffer(RenderBufferType::Vertex, RenderBufferUsage::Immutable,
+                                                      data.vertices.size() * sizeof(float), data.vertices.data());
+    RenderBufferId indexBuffer = device.CreateBuffer(RenderBufferType::Index, RenderBufferUsage::Immutable,
+                                                     data.indices.size() * sizeof(uint16_t), data.indices.data());
+    if (vertexBuffer == InvalidRenderBuffer || indexBuffer == InvalidRenderBuffer) {
+        LOG_ERROR << "[PileBaker] Ошибка: не удалось создать буферы куска кучи" << std::endl;
+        device.DestroyBuffer(vertexBuffer);
+        device.DestroyBuffer(indexBuffer);
+        return false;
+    }
+    device.DestroyBuffer(chunk.vertexBuffer);
+    device.DestroyBuffer(chunk.indexBuffer);
+    chunk.texture = data.texture;
+    chunk.color = data.color;
+    chunk.emissiveColor = data.emissiveColor;
+    chunk.vertexBuffer = vertexBuffer;
+    chunk.indexBuffer = indexBuffer;
+    chunk.indexCount = static_cast<uint32_t>(data.indices.size());
+    chunk.boundsCenter = data.boundsCenter;
+    chunk.boundsRadius = data.boundsRadius;
+    return true;
+}
+
+void PileBaker::FinishBatch(const std::vector<BakeBody>& batch) {
+    // Рабочий поток закончил пачку, куски на CPU до следующей отправки принадлежат главному потоку
+    chunks.resize(store->chunks.size(), BakedPileChunk{ TextureHandle(), DirectX::XMFLOAT4(), DirectX::XMFLOAT3(),
+                                                        InvalidRenderBuffer, InvalidRenderBuffer, 0,
+                                                        DirectX::XMFLOAT3(), 0.0f });
+    size_t uploaded = 0;
+    bool complete = true;
+    for (size_t i = 0; i < store->chunks.size(); ++i) {
+        ChunkData& data = *store->chunks[i];
+        if (data.dirty && UploadChunk(data, chunks[i])) {
+            data.dirty = false;
+            ++uploaded;
+        } else if (data.dirty) {
+            complete = false; // повторная попытка со следующей пачкой
+        }
+        // Заполненный кусок больше не меняется, CPU-копия ему не нужна
+        if (data.full && !data.dirty) {
+            std::vector<float>().swap(data.vertices);
+            std::vector<uint16_t>().swap(data.indices);
+        }
+    }
+
+    // Тело прячется, только когда все изменённые куски уже на GPU; до тех пор оно рисуется отдельно
+    for (const BakeBody& body : batch) unshown.push_back(body.body);
+    if (complete) {
+        for (uint32_t body : unshown) {
+            baked[body] = 1;
+            ++bakedBodyCount;
+        }
+        unshown.clear();
+    }
+    inFlight = false;
+    inFlightBodies = 0;
+    LOG_DEBUG << "[PileBaker] Запечено тел: " << batch.size() << ", всего: " << bakedBodyCount << ", кусков: "
+              << chunks.size() << ", перезагружено: " << uploaded << std::endl;
+}
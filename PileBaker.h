@@ -0,0 +1,116 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "AssetLoader.h"
+#include "CelestialBody.h"
+#include "MeshRegistry.h"
+#include "RenderDevice.h"
+
+// Кусок запечённой кучи: геометрия прикреплённых тел одного вида (текстура, цвет, подсветка)
+// в локальных координатах корня. Рисуется одним DrawIndexed с мировой матрицей корня.
+struct BakedPileChunk {
+    TextureHandle texture; // пустой - цветной материал
+    DirectX::XMFLOAT4 color;
+    DirectX::XMFLOAT3 emissiveColor;
+    RenderBufferId vertexBuffer; // Float32, 8 float на вершину
+    RenderBufferId indexBuffer;  // 16-битные индексы
+    uint32_t indexCount;
+    DirectX::XMFLOAT3 boundsCenter; // сфера в координатах корня, для отсечения
+    float boundsRadius;
+};
+
+// Запекание кучи: положение прикреплённого тела относительно катамари больше не меняется, поэтому его
+// вершины один раз переводятся в координаты катамари и дописываются в общие куски. Сборка идёт на рабочем
+// потоке AssetLoader пачками не больше GetBatchSize() тел, главный поток только выгружает готовые куски.
+// Пока тело не запечено, оно рисуется как обычно.
+class PileBaker {
+public:
+    static constexpr uint32_t MaxChunkVertices = 65535; // индексы куска помещаются в 16 бит
+
+    PileBaker(RenderDevice& device, AssetLoader& assetLoader);
+    ~PileBaker();
+    PileBaker(const PileBaker&) = delete;
+    PileBaker& operator=(const PileBaker&) = delete;
+
+    // Вызывается раз в кадр после шага мира: находит новые потомки корня и отправляет следующую пачку
+    void Update(const std::vector<std::unique_ptr<CelestialBody>>& bodies, const std::vector<MeshHandle>& bodyMeshes,
+                uint32_t root);
+    void SetBatchSize(size_t bodies) { batchSize = bodies ? bodies : 1; }
+    size_t GetBatchSize() const { return batchSize; }
+
+    bool IsBaked(uint32_t body) const { return body < baked.size() && baked[body]; }
+    const CelestialBody* GetRoot() const { return rootBody; }
+    const std::vector<BakedPileChunk>& GetChunks() const { return chunks; }
+    size_t GetBakedBodyCount() const { return bakedBodyCount; }
+    // Прикреплённые тела, ещё не попавшие в куски
+    size_t GetPendingBodyCount() const { return waiting.size() + unshown.size() + (inFlight ? inFlightBodies : 0); }
+
+private:
+    // Тело пачки: всё, что нужно рабочему потоку, снимается на главном потоке при отправке
+    struct BakeBody {
+        uint32_t body;
+        MeshHandle mesh;
+        DirectX::XMFLOAT4X4 toRoot; // мировая матрица тела, умноженная на обратную матрицу корня
+        std::vector<TextureHandle> textures; // по материалам меша; пустой - без текстуры
+        DirectX::XMFLOAT4 color;
+        DirectX::XMFLOAT3 emissiveColor;
+    };
+
+    // Геометрия куска на CPU. Пока пачка в работе, её трогает только рабочий поток
+    struct ChunkData {
+        TextureHandle texture;
+        DirectX::XMFLOAT4 color;
+        DirectX::XMFLOAT3 emissiveColor;
+        std::vector<float> vertices;
+        std::vector<uint16_t> indices;
+        DirectX::XMFLOAT3 boundsCenter;
+        float boundsRadius = 0.0f;
+        bool dirty = false;
+        bool full = false; // больше не пополняется; CPU-копия освобождается после выгрузки
+    };
+
+    // Вид куска: тела с одинаковым видом сливаются в один вызов отрисовки
+    struct ChunkKey {
+        const Texture* texture;
+        float color[4];
+        float emissive[3];
+        bool operator<(const ChunkKey& other) const;
+    };
+
+    // Переживает PileBaker, если пачка ещё ждёт выгрузки в очереди AssetLoader
+    struct BakeStore {
+        PileBaker* owner = nullptr;
+        std::vector<std::unique_ptr<ChunkData>> chunks;
+        std::map<ChunkKey, size_t> openChunks; // кусок каждого вида, который ещё пополняется
+    };
+
+    static bool IsLoading(const CelestialBody& body, const MeshHandle& mesh);
+    static size_t BakeBatch(BakeStore& store, const std::vector<BakeBody>& batch);
+    static void AppendSubmesh(BakeStore& store, const BakeBody& body, const MeshSubmesh& submesh,
+                              std::vector<uint32_t>& remap);
+    static void ComputeBounds(ChunkData& chunk);
+    bool UploadChunk(const ChunkData& data, BakedPileChunk& chunk);
+    void FinishBatch(const std::vector<BakeBody>& batch);
+
+    RenderDevice& device;
+    AssetLoader& assetLoader;
+    std::shared_ptr<BakeStore> store;
+    std::vector<BakedPileChunk> chunks; // по индексу совпадают с store->chunks
+    const CelestialBody* rootBody;
+    size_t indexedBodies; // bodies[0, indexedBodies) уже внесены в bodyIndices
+    size_t scannedChildren;
+    std::unordered_map<const CelestialBody*, uint32_t> bodyIndices;
+    std::vector<uint32_t> waiting; // прикреплены, но меш или текстура ещё грузятся
+    std::vector<uint32_t> unshown; // уже в кусках на CPU, но куски ещё не выгружены
+    std::vector<uint8_t> baked;
+    size_t bakedBodyCount;
+    size_t batchSize;
+    bool inFlight;
+    size_t inFlightBodies;
+};
@@ -0,0 +1,291 @@
+#include "Profiler.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+Profiler profiler;
+
+namespace {
+    constexpr size_t DefaultTraceCapacity = 256 * 1024;
+    constexpr size_t DefaultHistoryFrames = 1024;
+    const char* const FrameZoneName = "Frame";
+
+    // Ближайший ранг по отсортированным значениям
+    double Percentile(const std::vector<float>& sorted, double fraction) {
+        if (sorted.empty()) return 0.0;
+        size_t rank = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+        return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+    }
+
+    void WriteJsonString(std::ostream& out, const std::string& text) {
+        out << '"';
+        for (char c : text) {
+            switch (c) {
+                case '"': out << "\\\""; break;
+                case '\\': out << "\\\\"; break;
+                case '\n': out << "\\n"; break;
+                case '\t': out << "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        char escaped[8];
+                        std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                        out << escaped;
+                    } else {
+                        out << c;
+                    }
+            }
+        }
+        out << '"';
+    }
+}
+
+Profiler::Profiler()
+    : enabled(true), epoch(std::chrono::steady_clock::now()), traceCapacity(DefaultTraceCapacity),
+      historyFrames(DefaultHistoryFrames), historyHead(0), historyCount(0), droppedTraceEvents(0), frameCount(0),
+      frameStart(0) {
+}
+
+void Profiler::SetTraceCapacity(size_t events) {
+    std::lock_guard<std::mutex> lock(framesMutex);
+    traceCapacity = events;
+}
+
+void Profiler::SetHistoryFrames(size_t frames) {
+    std::lock_guard<std::mutex> lock(framesMutex);
+    historyFrames = std::max<size_t>(frames, 1);
+    historyHead = 0;
+    historyCount = 0;
+    for (ZoneHistory& zone : zones) {
+        zone.frameMs.assign(historyFrames, 0.0f);
+        zone.frameMs.shrink_to_fit();
+    }
+}
+
+void Profiler::SetThreadName(const std::string& name) {
+    ProfileThreadBuffer& buffer = GetThreadBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.name = name;
+}
+
+ProfileThreadBuffer& Profiler::GetThreadBuffer() {
+    // Буфер переживает поток: зоны, закрытые перед выходом, соберёт следующий NextFrame
+    thread_local std::shared_ptr<ProfileThreadBuffer> local;
+    if (!local) {
+        local = std::make_shared<ProfileThreadBuffer>();
+        std::lock_guard<std::mutex> lock(threadsMutex);
+        local->threadIndex = static_cast<uint32_t>(threads.size());
+        threads.push_back(local);
+    }
+    return *local;
+}
+
+uint32_t Profiler::GetZoneIndex(const char* name) {
+    auto byPointer = zonesByPointer.find(name);
+    if (byPointer != zonesByPointer.end()) return byPointer->second;
+
+    auto byName = zonesByName.emplace(name, static_cast<uint32_t>(zones.size()));
+    if (byName.second) {
+        zoneNames.emplace_back(name);
+        zones.emplace_back();
+        // Кадры окна до первого появления зоны - нулевые
+        zones.back().frameMs.assign(historyFrames, 0.0f);
+        frameTotals.push_back(0.0);
+        frameCalls.push_back(0);
+    }
+    zonesByPointer.emplace(name, byName.first->second);
+    return byName.first->second;
+}
+
+void Profiler::Collect(const ProfileEvent& event, uint32_t threadIndex) {
+    uint32_t zone = GetZoneIndex(event.name);
+    frameTotals[zone] += (event.end - event.start) * 1e-6;
+    ++frameCalls[zone];
+    if (trace.size() < traceCapacity) {
+        trace.push_back(TraceEvent{ event, threadIndex });
+    } else {
+        ++droppedTraceEvents;
+    }
+}
+
+void Profiler::NextFrame() {
+    int64_t now = Now();
+    std::lock_guard<std::mutex> lock(framesMutex);
+    if (!IsEnabled()) {
+        frameStart = now;
+        return;
+    }
+
+    std::vector<std::shared_ptr<ProfileThreadBuffer>> snapshot;
+    {
+        std::lock_guard<std::mutex> threadsLock(threadsMutex);
+        snapshot = threads;
+    }
+
+    std::vector<ProfileEvent> events;
+    for (const auto& buffer : snapshot) {
+        {
+            std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+            events.swap(buffer->events);
+        }
+        for (const ProfileEvent& event : events) Collect(event, buffer->threadIndex);
+        events.clear();
+        // Вернуть выделенную память потоку, чтобы следующий кадр не рос заново
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        if (buffer->events.empty()) buffer->events.swap(events);
+    }
+    Collect(ProfileEvent{ FrameZoneName, frameStart, now, 0 }, GetThreadBuffer().threadIndex);
+
+    for (size_t i = 0; i < zones.size(); ++i) {
+        zones[i].frameMs[historyHead] = static_cast<float>(frameTotals[i]);
+        zones[i].calls += frameCalls[i];
+        frameTotals[i] = 0.0;
+        frameCalls[i] = 0;
+    }
+    historyHead = (historyHead + 1) % historyFrames;
+    historyCount = std::min(historyCount + 1, historyFrames);
+    ++frameCount;
+    frameStart = now;
+}
+
+void Profiler::Reset() {
+    std::vector<std::shared_ptr<ProfileThreadBuffer>> snapshot;
+    {
+        std::lock_guard<std::mutex> threadsLock(threadsMutex);
+        snapshot = threads;
+    }
+    for (const auto& buffer : snapshot) {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        buffer->events.clear();
+    }
+
+    std::lock_guard<std::mutex> lock(framesMutex);
+    zonesByPointer.clear();
+    zonesByName.clear();
+    zoneNames.clear();
+    zones.clear();
+    frameTotals.clear();
+    frameCalls.clear();
+    trace.clear();
+    droppedTraceEvents = 0;
+    historyHead = 0;
+    historyCount = 0;
+    frameCount = 0;
+    frameStart = Now();
+}
+
+size_t Profiler::GetFrameCount() const {
+    std::lock_guard<std::mutex> lock(framesMutex);
+    return frameCount;
+}
+
+size_t Profiler::GetHistoryFrames() const {
+    std::lock_guard<std::mutex> lock(framesMutex);
+    return historyFrames;
+}
+
+size_t Profiler::GetHistoryBytes() const {
+    std::lock_guard<std::mutex> lock(framesMutex);
+    size_t bytes = 0;
+    for (const ZoneHistory& zone : zones) bytes += zone.frameMs.capacity() * sizeof(float);
+    return bytes;
+}
+
+size_t Profiler::GetTraceEventCount() const {
+    std::lock_guard<std::mutex> lock(framesMutex);
+    return trace.size();
+}
+
+size_t Profiler::GetDroppedTraceEvents() const {
+    std::lock_guard<std::mutex> lock(framesMutex);
+    return droppedTraceEvents;
+}
+
+std::vector<ProfileZoneStats> Profiler::GetZoneStats() const {
+    std::lock_guard<std::mutex> lock(framesMutex);
+    std::vector<ProfileZoneStats> result;
+    std::vector<float> sorted;
+    for (size_t i = 0; i < zones.size(); ++i) {
+        const ZoneHistory& zone = zones[i];
+        ProfileZoneStats stats;
+        stats.name = zoneNames[i];
+        // Порядок кадров для перцентилей не важен: сортируется заполненная часть кольца
+        sorted.assign(zone.frameMs.begin(), zone.frameMs.begin() + historyCount);
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0.0;
+        for (float ms : sorted) sum += ms;
+        stats.callsPerFrame = frameCount ? double(zone.calls) / frameCount : 0.0;
+        stats.meanMs = sorted.empty() ? 0.0 : sum / sorted.size();
+        stats.p50Ms = Percentile(sorted, 0.50);
+        stats.p95Ms = Percentile(sorted, 0.95);
+        stats.p99Ms = Percentile(sorted, 0.99);
+        stats.maxMs = sorted.empty() ? 0.0 : sorted.back();
+        result.push_back(stats);
+    }
+    // Самые дорогие зоны первыми
+    std::sort(result.begin(), result.end(),
+              [](const ProfileZoneStats& a, const ProfileZoneStats& b) { return a.meanMs > b.meanMs; });
+    return result;
+}
+
+void Profiler::LogReport() const {
+    LOG_INFO << "[Profiler] Кадров: " << GetFrameCount() << ", окно статистики: " << GetHistoryFrames()
+             << ", событий трассы: " << GetTraceEventCount()
+             << ", не вошло в трассу: " << GetDroppedTraceEvents() << std::endl;
+    for (const ProfileZoneStats& stats : GetZoneStats()) {
+        LOG_INFO << "[Profiler] " << stats.name << ": вызовов за кадр=" << stats.callsPerFrame
+                 << ", мс среднее=" << stats.meanMs << ", p50=" << stats.p50Ms << ", p95=" << stats.p95Ms
+                 << ", p99=" << stats.p99Ms << ", макс=" << stats.maxMs << std::endl;
+    }
+}
+
+bool Profiler::WriteChromeTrace(const std::string& path) const {
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file.is_open()) {
+        LOG_ERROR << "[Profiler] Ошибка: не удалось создать файл трассы: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<std::shared_ptr<ProfileThreadBuffer>> snapshot;
+    {
+        std::lock_guard<std::mutex> threadsLock(threadsMutex);
+        snapshot = threads;
+    }
+
+    std::lock_guard<std::mutex> lock(framesMutex);
+    // Формат Trace Event: полные события "X" со временем в микросекундах
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (const auto& buffer : snapshot) {
+        std::string name;
+        {
+            std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+            name = buffer->name.empty() ? "Thread " + std::to_string(buffer->threadIndex) : buffer->name;
+        }
+        file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+             << buffer->threadIndex << ",\"args\":{\"name\":";
+        WriteJsonString(file, name);
+        file << "}}";
+        first = false;
+    }
+
+    char timing[96];
+    for (const TraceEvent& traceEvent : trace) {
+        const ProfileEvent& event = traceEvent.event;
+        file << (first ? "" : ",\n") << "{\"name\":";
+        WriteJsonString(file, event.name);
+        std::snprintf(timing, sizeof(timing), ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                      traceEvent.threadIndex, event.start * 1e-3, (event.end - event.start) * 1e-3);
+        file << timing;
+        first = false;
+    }
+    file << "\n]}\n";
+    file.close();
+    if (!file) {
+        LOG_ERROR << "[Profiler] Ошибка записи файла трассы: " << path << std::endl;
+        return false;
+    }
+    LOG_INFO << "[Profiler] Трасса записана: " << path << ", событий: " << trace.size() << std::endl;
+    return true;
+}
@@ -0,0 +1,158 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 0 - зоны PROFILE_ZONE и отметки кадров PROFILE_FRAME вырезаются при компиляции целиком
+#ifndef KATAMARI_PROFILER
+#define KATAMARI_PROFILER 1
+#endif
+
+// Закрытая зона: время в наносекундах от запуска профайлера
+struct ProfileEvent {
+    const char* name; // строковый литерал, живёт всё время работы программы
+    int64_t start;
+    int64_t end;
+    uint32_t depth;   // вложенность в пределах потока, 0 - внешняя зона
+};
+
+// Статистика зоны по кадрам окна: суммарное время зоны за кадр, кадры без зоны считаются нулевыми.
+// callsPerFrame - по всем кадрам с начала записи
+struct ProfileZoneStats {
+    std::string name;
+    double callsPerFrame;
+    double meanMs;
+    double p50Ms;
+    double p95Ms;
+    double p99Ms;
+    double maxMs;
+};
+
+// Буфер зон одного потока. Мьютекс берёт владелец при закрытии зоны и NextFrame при сборе,
+// поэтому он почти никогда не конкурирует
+struct ProfileThreadBuffer {
+    std::mutex mutex;
+    std::vector<ProfileEvent> events;
+    uint32_t threadIndex = 0;
+    uint32_t depth = 0; // трогает только владелец
+    std::string name;
+};
+
+// Профайлер зон процессора: вложенные зоны по потокам, статистика по кадрам и экспорт в Chrome trace
+// (chrome://tracing, Perfetto). Кадр закрывает PROFILE_FRAME в главном цикле.
+class Profiler {
+public:
+    Profiler();
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // Выключенный профайлер не пишет зон; стоимость зоны - одна проверка флага
+    void SetEnabled(bool enable) { enabled.store(enable, std::memory_order_relaxed); }
+    bool IsEnabled() const { return enabled.load(std::memory_order_relaxed); }
+    // Событий, хранимых для экспорта; сверх лимита события идут только в статистику
+    void SetTraceCapacity(size_t events);
+    // Кадров в окне статистики: старые кадры вытесняются, память не растёт со временем игры.
+    // Сбрасывает накопленное окно
+    void SetHistoryFrames(size_t frames);
+    void SetThreadName(const std::string& name);
+
+    int64_t Now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+    ProfileThreadBuffer& GetThreadBuffer();
+
+    // Собирает зоны всех потоков в статистику текущего кадра и открывает следующий кадр
+    void NextFrame();
+    void Reset();
+
+    size_t GetFrameCount() const;
+    size_t GetHistoryFrames() const;
+    size_t GetHistoryBytes() const;
+    std::vector<ProfileZoneStats> GetZoneStats() const;
+    size_t GetTraceEventCount() const;
+    size_t GetDroppedTraceEvents() const;
+    void LogReport() const;
+    bool WriteChromeTrace(const std::string& path) const;
+
+private:
+    struct TraceEvent {
+        ProfileEvent event;
+        uint32_t threadIndex;
+    };
+
+    struct ZoneHistory {
+        std::vector<float> frameMs; // кольцо из historyFrames кадров, пишется в historyHead
+        uint64_t calls = 0;
+    };
+
+    uint32_t GetZoneIndex(const char* name);
+    void Collect(const ProfileEvent& event, uint32_t threadIndex);
+
+    std::atomic<bool> enabled;
+    std::chrono::steady_clock::time_point epoch;
+
+    mutable std::mutex threadsMutex;
+    std::vector<std::shared_ptr<ProfileThreadBuffer>> threads;
+
+    mutable std::mutex framesMutex;
+    std::unordered_map<const char*, uint32_t> zonesByPointer;
+    std::unordered_map<std::string, uint32_t> zonesByName; // одинаковые литералы из разных единиц трансляции
+    std::vector<std::string> zoneNames;   // индекс - номер зоны в zones
+    std::vector<ZoneHistory> zones;
+    std::vector<double> frameTotals;      // рабочие буферы NextFrame
+    std::vector<uint32_t> frameCalls;
+    std::vector<TraceEvent> trace;
+    size_t traceCapacity;
+    size_t historyFrames;
+    size_t historyHead;
+    size_t historyCount;                  // заполненных кадров окна, не больше historyFrames
+    size_t droppedTraceEvents;
+    size_t frameCount;
+    int64_t frameStart;
+};
+
+extern Profiler profiler;
+
+// Зона до конца области видимости
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* name) : name(name), buffer(nullptr), start(0) {
+        if (!profiler.IsEnabled()) return;
+        buffer = &profiler.GetThreadBuffer();
+        ++buffer->depth;
+        start = profiler.Now();
+    }
+
+    ~ProfileZone() {
+        if (!buffer) return;
+        int64_t end = profiler.Now();
+        uint32_t depth = --buffer->depth;
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        buffer->events.push_back(ProfileEvent{ name, start, end, depth });
+    }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* name;
+    ProfileThreadBuffer* buffer;
+    int64_t start;
+};
+
+#define KATAMARI_PROFILE_CONCAT_INNER(a, b) a##b
+#define KATAMARI_PROFILE_CONCAT(a, b) KATAMARI_PROFILE_CONCAT_INNER(a, b)
+
+#if KATAMARI_PROFILER
+#define PROFILE_ZONE(name) ProfileZone KATAMARI_PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FRAME() profiler.NextFrame()
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#endif
@@ -1,268 +1,522 @@
 #include "Render.h"
 #include "Logger.h"
-#include <d3dcompiler.h>
+#include "ConstantBufferData.h"
 #include "CelestialBody.h"
-#include "Ground.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
 
-Render::Render(HWND hwnd) : hwnd(hwnd), device(nullptr), context(nullptr), swapChain(nullptr),
-    renderTargetView(nullptr), depthStencilView(nullptr), depthStencilState(nullptr), depthStencilBuffer(nullptr),
-    vertexShader(nullptr), pixelShaderTextured(nullptr), pixelShaderColored(nullptr), inputLayout(nullptr),
-    constantBuffer(nullptr), samplerState(nullptr) {
-    logger << "[Render] Создан объект Render" << std::endl;
+namespace {
+    // Более грубый уровень выбирается, только когда его ошибка заметно ниже порога,
+    // иначе тело на границе переключалось бы каждый кадр
+    constexpr float LodCoarsenFactor = 0.75f;
+
+    // Проход тел в ключе очереди отрисовки; земля и куски кучи рисуются своими путями
+    constexpr uint32_t BodyPass = 0;
+
+    // Тел на задачу планировщика: отсечение, выбор LOD, ключи очереди и данные экземпляров
+    constexpr size_t CullChunkBodies = 16384;
+    constexpr size_t ParallelGrain = 2048;
+
+    // w точки после viewProj - расстояние вдоль взгляда, по нему LOD и порядок от ближних к дальним
+    float ViewDepth(const DirectX::XMFLOAT4X4& viewProj, DirectX::XMFLOAT3 point) {
+        return point.x * viewProj._14 + point.y * viewProj._24 + point.z * viewProj._34 + viewProj._44;
+    }
+
+    // Освещение и материал общие для всех тел
+    void FillBodyLighting(ConstantBufferData& cbData, DirectX::XMFLOAT3 cameraPos) {
+        cbData.lightPos = DirectX::XMFLOAT3(0.0f, -1.0f, -1.0f);//DirectX::XMFLOAT3(-1.0f, -1.0f, -1.0f);//DirectX::XMFLOAT3(0.0f, 10.0f, 0.0f);       // Свет сверху
+        cbData.lightColor = DirectX::XMFLOAT3(2.0f, 2.0f, 2.0f);      // Яркий белый свет
+        cbData.materialDiffuse = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f); // Полное диффузное отражение
+        cbData.materialSpecular = DirectX::XMFLOAT3(0.5f, 0.5f, 0.5f); // Зеркальные блики
+        cbData.shininess = 64.0f;                                      // Глянцевость
+        cbData.cameraPos = cameraPos;                                  // Позиция камеры
+        cbData.padding = 0.0f;
+    }
+
+    // Границы меша для VSMainCompact; конвейеры Float32 эти поля не читают
+    void FillVertexQuantization(ConstantBufferData& cbData, const Mesh& mesh) {
+        const VertexQuantization& quantization = mesh.quantization;
+        cbData.positionOffset = DirectX::XMFLOAT4(quantization.positionOffset[0], quantization.positionOffset[1],
+                                                  quantization.positionOffset[2], 0.0f);
+        cbData.positionScale = DirectX::XMFLOAT4(quantization.positionScale[0], quantization.positionScale[1],
+                                                 quantization.positionScale[2], 0.0f);
+        cbData.texCoordTransform = DirectX::XMFLOAT4(quantization.texCoordOffset[0], quantization.texCoordOffset[1],
+                                                     quantization.texCoordScale[0], quantization.texCoordScale[1]);
+    }
+}
+
+Render::Render(RenderDevice& device) : device(device), constantBuffer(InvalidRenderBuffer),
+    instanceBuffer(InvalidRenderBuffer), instanceCapacity(0), instancingEnabled(true), sortingEnabled(true),
+    culledBodyCount(0), cullingEnabled(true), lodEnabled(true), lodPixelThreshold(1.0f), viewportHalfHeight(300.0f),
+    pileBaker(nullptr), drawnChunkCount(0), taskScheduler(nullptr) {
+    LOG_INFO << "[Render] Создан объект Render" << std::endl;
 }
 
 Render::~Render() {
-    if (constantBuffer) constantBuffer->Release();
-    if (inputLayout) inputLayout->Release();
-    if (pixelShaderTextured) pixelShaderTextured->Release();
-    if (pixelShaderColored) pixelShaderColored->Release();
-    if (vertexShader) vertexShader->Release();
-    if (depthStencilState) depthStencilState->Release();
-    if (depthStencilView) depthStencilView->Release();
-    if (depthStencilBuffer) depthStencilBuffer->Release();
-    if (renderTargetView) renderTargetView->Release();
-    if (swapChain) swapChain->Release();
-    if (context) context->Release();
-    if (device) device->Release();
-    logger << "[Render] Объект Render уничтожен" << std::endl;
+    device.DestroyBuffer(instanceBuffer);
+    device.DestroyBuffer(constantBuffer);
+    LOG_INFO << "[Render] Объект Render уничтожен" << std::endl;
+}
+
+void Render::SetLodThreshold(float pixels, uint32_t viewportHeight) {
+    lodPixelThreshold = pixels;
+    viewportHalfHeight = viewportHeight * 0.5f;
 }
 
 bool Render::Initialize() {
-    logger << "[Render] Начало инициализации рендера" << std::endl;
-
-    DXGI_SWAP_CHAIN_DESC scd = {};
-    scd.BufferCount = 1;
-    scd.BufferDesc.Width = 800;
-    scd.BufferDesc.Height = 600;
-    scd.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-    scd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-    scd.OutputWindow = hwnd;
-    scd.SampleDesc.Count = 1;
-    scd.Windowed = TRUE;
-
-    HRESULT hr = D3D11CreateDeviceAndSwapChain(nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr, 0, nullptr, 0,
-        D3D11_SDK_VERSION, &scd, &swapChain, &device, nullptr, &context);
-    if (FAILED(hr)) {
-        logger << "[Render] Ошибка: не удалось создать устройство и цепочку обмена" << std::endl;
+    constantBuffer = device.CreateBuffer(RenderBufferType::Constant, RenderBufferUsage::Default,
+                                         sizeof(ConstantBufferData), nullptr);
+    if (constantBuffer == InvalidRenderBuffer) {
+        LOG_ERROR << "[Render] Ошибка: не удалось создать константный буфер" << std::endl;
         return false;
     }
-    logger << "[Render] Устройство и цепочка обмена созданы" << std::endl;
-
-    ID3D11Texture2D* backBuffer;
-    swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), (void**)&backBuffer);
-    hr = device->CreateRenderTargetView(backBuffer, nullptr, &renderTargetView);
-    backBuffer->Release();
-    if (FAILED(hr)) {
-        logger << "[Render] Ошибка: не удалось создать RenderTargetView" << std::endl;
-        return false;
+    device.SetConstantBuffer(constantBuffer);
+    LOG_INFO << "[Render] Константный буфер создан" << std::endl;
+    return true;
+}
+
+void Render::RenderScene(const std::vector<std::unique_ptr<CelestialBody>>& bodies, const std::vector<MeshHandle>& bodyMeshes,
+                        const GroundSurface* ground, DirectX::XMMATRIX viewProj, DirectX::XMFLOAT3 cameraPos) {
+    PROFILE_ZONE("Render::RenderScene");
+    LOG_TRACE << "[Render] Начало рендеринга сцены" << std::endl;
+
+    if (!ground || constantBuffer == InvalidRenderBuffer) {
+        LOG_ERROR << "[Render] Ошибка: недействительный ground или constantBuffer" << std::endl;
+        return;
     }
-    logger << "[Render] RenderTargetView создан" << std::endl;
-
-    D3D11_TEXTURE2D_DESC depthDesc = {};
-    depthDesc.Width = 800;
-    depthDesc.Height = 600;
-    depthDesc.MipLevels = 1;
-    depthDesc.ArraySize = 1;
-    depthDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
-    depthDesc.SampleDesc.Count = 1;
-    depthDesc.Usage = D3D11_USAGE_DEFAULT;
-    depthDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
-
-    hr = device->CreateTexture2D(&depthDesc, nullptr, &depthStencilBuffer);
-    if (FAILED(hr)) {
-        logger << "[Render] Ошибка: не удалось создать буфер глубины" << std::endl;
-        return false;
+
+    float clearColor[] = { 0.53f, 0.81f, 0.92f, 1.0f };
+    device.BeginFrame(clearColor);
+    device.SetConstantBuffer(constantBuffer);
+    LOG_TRACE << "[Render] Буферы очищены" << std::endl;
+
+    LOG_TRACE << "[Render] Вызов Draw для ground" << std::endl;
+    {
+        PROFILE_ZONE("GroundSurface::Draw");
+        ground->Draw(device, constantBuffer, viewProj, cameraPos);
     }
-    logger << "[Render] Буфер глубины создан" << std::endl;
 
-    hr = device->CreateDepthStencilView(depthStencilBuffer, nullptr, &depthStencilView);
-    if (FAILED(hr)) {
-        logger << "[Render] Ошибка: не удалось создать DepthStencilView" << std::endl;
-        return false;
+    // Граф кадра: отсечение тел -> LOD -> список отрисовки, отсечение кусков кучи - параллельно с ними.
+    // Задачи не трогают устройство; без планировщика выполняются по порядку в этом потоке
+    bool instanced = instancingEnabled && device.SupportsPipeline(RenderPipeline::TexturedInstanced) &&
+                     device.SupportsPipeline(RenderPipeline::ColoredInstanced);
+    frameGraph.Clear();
+    TaskGraph::TaskId cull = frameGraph.AddTask("Render::CullBodies", [&] {
+        CullBodies(bodies, bodyMeshes, viewProj);
+        LOG_TRACE << "[Render] Тел видимо: " << visibleBodies.size() << ", отсечено: " << culledBodyCount << std::endl;
+    });
+    TaskGraph::TaskId lods = frameGraph.AddTask("Render::SelectLods", [&] { SelectLods(bodies, bodyMeshes, viewProj); });
+    TaskGraph::TaskId drawList = frameGraph.AddTask("Render::BuildDrawList", [&] {
+        if (instanced) {
+            BuildInstanceBatches(bodies, bodyMeshes);
+        } else {
+            BuildBodyDrawList(bodies, bodyMeshes, viewProj);
+        }
+    });
+    frameGraph.AddTask("Render::CullBakedPiles", [&] { CullBakedPiles(viewProj); });
+    frameGraph.AddDependency(cull, lods);
+    frameGraph.AddDependency(lods, drawList);
+    if (taskScheduler) {
+        taskScheduler->Run(frameGraph);
+    } else {
+        frameGraph.RunInOrder();
     }
-    logger << "[Render] DepthStencilView создан" << std::endl;
 
-    D3D11_DEPTH_STENCIL_DESC dsDesc = {};
-    dsDesc.DepthEnable = TRUE;
-    dsDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
-    dsDesc.DepthFunc = D3D11_COMPARISON_LESS;
-    dsDesc.StencilEnable = FALSE;
+    {
+        PROFILE_ZONE("Render::DrawBodies");
+        if (instanced) {
+            DrawBodiesInstanced(viewProj, cameraPos);
+        } else {
+            DrawBodies(bodies, bodyMeshes, viewProj, cameraPos);
+        }
+    }
+    {
+        PROFILE_ZONE("Render::DrawBakedPiles");
+        DrawBakedPiles(viewProj, cameraPos);
+    }
 
-    hr = device->CreateDepthStencilState(&dsDesc, &depthStencilState);
-    if (FAILED(hr)) {
-        logger << "[Render] Ошибка: не удалось создать DepthStencilState" << std::endl;
-        return false;
+    {
+        // В D3D11 здесь Present; у программного устройства - ожидание растеризации
+        PROFILE_ZONE("RenderDevice::EndFrame");
+        device.EndFrame();
     }
-    logger << "[Render] DepthStencilState создан" << std::endl;
-
-    context->OMSetRenderTargets(1, &renderTargetView, depthStencilView);
-    context->OMSetDepthStencilState(depthStencilState, 1);
-    logger << "[Render] RenderTargets и DepthStencilState установлены" << std::endl;
-
-    D3D11_VIEWPORT viewport = {};
-    viewport.Width = 800.0f;
-    viewport.Height = 600.0f;
-    viewport.MinDepth = 0.0f;
-    viewport.MaxDepth = 1.0f;
-    context->RSSetViewports(1, &viewport);
-    logger << "[Render] Viewport установлен" << std::endl;
-
-    ID3DBlob* vsBlob, *psTexturedBlob, *psColoredBlob, *errorBlob;
-    hr = D3DCompileFromFile(L"shader.hlsl", nullptr, nullptr, "VSMain", "vs_5_0", 0, 0, &vsBlob, &errorBlob);
-    if (FAILED(hr)) {
-        if (errorBlob) {
-            logger << "[Render] Ошибка компиляции вершинного шейдера: " << (const char*)errorBlob->GetBufferPointer() << std::endl;
-            errorBlob->Release();
-        }
-        return false;
+    const RenderFrameStats& stats = device.GetFrameStats();
+    LOG_TRACE << "[Render] Сцена представлена на экран, вызовов отрисовки: " << stats.drawCalls
+           << ", смен состояния: " << stats.stateChanges << ", загружено байт: " << stats.bytesUploaded
+           << ", треугольников: " << stats.primitives << std::endl;
+    LOG_TRACE << "[Render] Рендеринг сцены завершен" << std::endl;
+}
+
+void Render::ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& function) {
+    if (taskScheduler) {
+        taskScheduler->ParallelFor(count, grain, function);
+    } else if (count > 0) {
+        function(0, count);
     }
-    logger << "[Render] Вершинный шейдер скомпилирован" << std::endl;
+}
 
-    hr = D3DCompileFromFile(L"shader.hlsl", nullptr, nullptr, "PSMainTextured", "ps_5_0", 0, 0, &psTexturedBlob, &errorBlob);
-    if (FAILED(hr)) {
-        if (errorBlob) {
-            logger << "[Render] Ошибка компиляции пиксельного шейдера (Textured): " << (const char*)errorBlob->GetBufferPointer() << std::endl;
-            errorBlob->Release();
+void Render::CullBodies(const std::vector<std::unique_ptr<CelestialBody>>& bodies,
+                        const std::vector<MeshHandle>& bodyMeshes, DirectX::XMMATRIX viewProj) {
+    // Куски идут подряд по индексам тел, поэтому склеенные видимые тела упорядочены так же, как в одном потоке
+    size_t chunkCount = taskScheduler ? std::max<size_t>(1, (bodies.size() + CullChunkBodies - 1) / CullChunkBodies) : 1;
+    size_t chunkSize = (bodies.size() + chunkCount - 1) / chunkCount;
+    if (cullChunks.size() < chunkCount) cullChunks.resize(chunkCount);
+    ParallelFor(chunkCount, 1, [&](size_t first, size_t last) {
+        for (size_t c = first; c < last; ++c) {
+            CullBodyRange(bodies, bodyMeshes, viewProj, std::min(c * chunkSize, bodies.size()),
+                          std::min((c + 1) * chunkSize, bodies.size()), cullChunks[c]);
         }
-        vsBlob->Release();
-        return false;
+    });
+
+    visibleBodies.clear();
+    culledBodyCount = 0;
+    for (size_t c = 0; c < chunkCount; ++c) {
+        visibleBodies.insert(visibleBodies.end(), cullChunks[c].visible.begin(), cullChunks[c].visible.end());
+        culledBodyCount += cullChunks[c].culledCount;
     }
-    logger << "[Render] Пиксельный шейдер (Textured) скомпилирован" << std::endl;
+}
 
-    hr = D3DCompileFromFile(L"shader.hlsl", nullptr, nullptr, "PSMainColored", "ps_5_0", 0, 0, &psColoredBlob, &errorBlob);
-    if (FAILED(hr)) {
-        if (errorBlob) {
-            logger << "[Render] Ошибка компиляции пиксельного шейдера (Colored): " << (const char*)errorBlob->GetBufferPointer() << std::endl;
-            errorBlob->Release();
+void Render::CullBodyRange(const std::vector<std::unique_ptr<CelestialBody>>& bodies,
+                           const std::vector<MeshHandle>& bodyMeshes, DirectX::XMMATRIX viewProj, size_t begin,
+                           size_t end, CullChunk& chunk) {
+    chunk.visible.clear();
+    chunk.candidates.clear();
+    chunk.culler.Begin();
+    for (size_t i = begin; i < end; ++i) {
+        if (!bodies[i]) continue; // слот удалённого тела
+        const CelestialBody& body = *bodies[i];
+        // Без копии MeshHandle: счётчик ссылок общий у всех тел с этим мешем и стал бы узким местом между потоками
+        const Mesh* mesh = i < bodyMeshes.size() ? bodyMeshes[i].get() : nullptr;
+        if (!IsReadyToDraw(body, mesh)) {
+            LOG_TRACE << "[Render] Ресурсы тела ещё загружаются, рендеринг пропущен" << std::endl;
+            continue;
         }
-        vsBlob->Release();
-        psTexturedBlob->Release();
-        return false;
+        if (pileBaker && pileBaker->IsBaked(static_cast<uint32_t>(i))) continue; // рисуется в куске кучи
+        if (!cullingEnabled) {
+            chunk.visible.push_back(static_cast<uint32_t>(i));
+            continue;
+        }
+        // Сфера меша в мировых координатах: масштаб узла уже учитывает радиус тела
+        chunk.candidates.push_back(static_cast<uint32_t>(i));
+        chunk.culler.Add(body.GetPosition(), body.transforms->GetWorldScale(body.node) * mesh->boundingRadius);
     }
-    logger << "[Render] Пиксельный шейдер (Colored) скомпилирован" << std::endl;
 
-    hr = device->CreateVertexShader(vsBlob->GetBufferPointer(), vsBlob->GetBufferSize(), nullptr, &vertexShader);
-    if (FAILED(hr)) {
-        logger << "[Render] Ошибка: не удалось создать вершинный шейдер" << std::endl;
-        return false;
+    chunk.culledCount = 0;
+    if (!cullingEnabled) return;
+    for (uint32_t sphere : chunk.culler.Cull(viewProj)) {
+        chunk.visible.push_back(chunk.candidates[sphere]);
     }
-    logger << "[Render] Вершинный шейдер создан" << std::endl;
+    chunk.culledCount = chunk.culler.GetCulledCount();
+}
 
-    hr = device->CreatePixelShader(psTexturedBlob->GetBufferPointer(), psTexturedBlob->GetBufferSize(), nullptr, &pixelShaderTextured);
-    if (FAILED(hr)) {
-        logger << "[Render] Ошибка: не удалось создать пиксельный шейдер (Textured)" << std::endl;
-        return false;
+void Render::SelectLods(const std::vector<std::unique_ptr<CelestialBody>>& bodies,
+                        const std::vector<MeshHandle>& bodyMeshes, DirectX::XMMATRIX viewProj) {
+    bodyLods.resize(bodies.size(), 0);
+    if (!lodEnabled) return;
+
+    // Ошибка в пикселях: error * scale * proj._22 / w * (height / 2); длина второго столбца viewProj равна proj._22
+    DirectX::XMFLOAT4X4 m;
+    DirectX::XMStoreFloat4x4(&m, viewProj);
+    float projectionScale = std::sqrt(m._12 * m._12 + m._22 * m._22 + m._32 * m._32) * viewportHalfHeight;
+    // Уровень тела зависит только от него самого: куски видимых тел независимы
+    ParallelFor(visibleBodies.size(), ParallelGrain, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+            uint32_t i = visibleBodies[k];
+            const CelestialBody& body = *bodies[i];
+            const Mesh& mesh = *bodyMeshes[i];
+            uint8_t& level = bodyLods[i];
+            size_t lodCount = mesh.lods.size();
+            if (level >= lodCount) level = static_cast<uint8_t>(lodCount - 1);
+
+            DirectX::XMFLOAT3 center = body.GetPosition();
+            float w = ViewDepth(m, center);
+            // Камера внутри тела или вплотную к нему: считаем по ближайшей точке сферы, без скачка уровня
+            float scale = body.transforms->GetWorldScale(body.node);
+            w = std::max(w, scale * mesh.boundingRadius);
+            float pixelsPerUnit = scale * projectionScale / w;
+
+            while (level > 0 && mesh.lods[level].error * pixelsPerUnit > lodPixelThreshold) --level;
+            while (level + 1u < lodCount &&
+                   mesh.lods[level + 1].error * pixelsPerUnit <= lodPixelThreshold * LodCoarsenFactor) {
+                ++level;
+            }
+        }
+    });
+}
+
+uint32_t Render::GetBodyLod(uint32_t body, const Mesh& mesh) const {
+    return lodEnabled ? std::min<uint32_t>(bodyLods[body], static_cast<uint32_t>(mesh.lods.size() - 1)) : 0;
+}
+
+bool Render::IsReadyToDraw(const CelestialBody& body, const Mesh* mesh) {
+    if (!mesh || !mesh->IsReady()) return false;
+    // Если текстура ещё грузится, ждём её, а не мигаем нетекстурированным мячом
+    return !body.useTexture || !mesh->HasPendingTexture();
+}
+
+void Render::BuildBodyDrawList(const std::vector<std::unique_ptr<CelestialBody>>& bodies,
+                               const std::vector<MeshHandle>& bodyMeshes, DirectX::XMMATRIX viewProj) {
+    // Заявки и номера ресурсов выдаются в одном потоке в порядке видимости, как при сборке целиком в одном потоке:
+    // номер зависит от порядка первого появления. Соседние тела с тем же мешем, уровнем и useTexture пропускаются
+    renderQueue.Begin(bodies.size());
+    drawnBodies.clear();
+    const Mesh* registeredMesh = nullptr;
+    uint32_t registeredLod = 0;
+    bool registeredTexture = false;
+    for (uint32_t i : visibleBodies) {
+        if (!renderQueue.Claim(i)) continue;
+        drawnBodies.push_back(i);
+        const Mesh& mesh = *bodyMeshes[i];
+        uint32_t lod = GetBodyLod(i, mesh);
+        bool useTexture = bodies[i]->useTexture;
+        if (&mesh == registeredMesh && lod == registeredLod && useTexture == registeredTexture) continue;
+        registeredMesh = &mesh;
+        registeredLod = lod;
+        registeredTexture = useTexture;
+        renderQueue.GetResourceId(&mesh);
+        const MeshSubmesh* submeshes = mesh.GetSubmeshes(lod);
+        for (uint32_t s = 0; s < mesh.submeshCount; ++s) {
+            if (submeshes[s].indexCount != 0 && useTexture) renderQueue.GetResourceId(mesh.GetMaterialTexture(submeshes[s].material));
+        }
     }
-    logger << "[Render] Пиксельный шейдер (Textured) создан" << std::endl;
 
-    hr = device->CreatePixelShader(psColoredBlob->GetBufferPointer(), psColoredBlob->GetBufferSize(), nullptr, &pixelShaderColored);
-    if (FAILED(hr)) {
-        logger << "[Render] Ошибка: не удалось создать пиксельный шейдер (Colored)" << std::endl;
-        return false;
+    // Ключи считаются кусками в разных потоках и склеиваются по порядку кусков
+    DirectX::XMFLOAT4X4 m;
+    DirectX::XMStoreFloat4x4(&m, viewProj);
+    size_t chunkCount = taskScheduler ? std::max<size_t>(1, (drawnBodies.size() + ParallelGrain - 1) / ParallelGrain) : 1;
+    size_t chunkSize = (drawnBodies.size() + chunkCount - 1) / chunkCount;
+    if (drawListChunks.size() < chunkCount) drawListChunks.resize(chunkCount);
+    ParallelFor(chunkCount, 1, [&](size_t first, size_t last) {
+        for (size_t c = first; c < last; ++c) {
+            std::vector<RenderQueueItem>& items = drawListChunks[c];
+            items.clear();
+            for (size_t k = c * chunkSize; k < std::min((c + 1) * chunkSize, drawnBodies.size()); ++k) {
+                uint32_t i = drawnBodies[k];
+                const CelestialBody& body = *bodies[i];
+                const Mesh& mesh = *bodyMeshes[i];
+                bool compact = mesh.vertexFormat == VertexFormat::Compact;
+                uint32_t meshId = renderQueue.FindResourceId(&mesh);
+                float depth = ViewDepth(m, body.GetPosition());
+                const MeshSubmesh* submeshes = mesh.GetSubmeshes(GetBodyLod(i, mesh));
+                for (uint32_t s = 0; s < mesh.submeshCount; ++s) {
+                    if (submeshes[s].indexCount == 0) continue;
+                    const Texture* texture = body.useTexture ? mesh.GetMaterialTexture(submeshes[s].material) : nullptr;
+                    RenderPipeline pipeline = SelectPipeline(texture != nullptr, false, compact);
+                    items.push_back({ RenderQueue::MakeKey(BodyPass, static_cast<uint32_t>(pipeline),
+                                                           renderQueue.FindResourceId(texture), meshId, depth), i, s });
+                }
+            }
+        }
+    });
+    for (size_t c = 0; c < chunkCount; ++c) renderQueue.Append(drawListChunks[c]);
+    if (sortingEnabled) {
+        PROFILE_ZONE("RenderQueue::Sort");
+        renderQueue.Sort();
     }
-    logger << "[Render] Пиксельный шейдер (Colored) создан" << std::endl;
-
-    D3D11_INPUT_ELEMENT_DESC layout[] = {
-        {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
-        {"NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0},
-        {"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0},
-    };
-    hr = device->CreateInputLayout(layout, 3, vsBlob->GetBufferPointer(), vsBlob->GetBufferSize(), &inputLayout);
-    if (FAILED(hr)) {
-        logger << "[Render] Ошибка: не удалось создать InputLayout" << std::endl;
-        vsBlob->Release();
-        psTexturedBlob->Release();
-        psColoredBlob->Release();
-        return false;
+}
+
+void Render::DrawBodies(const std::vector<std::unique_ptr<CelestialBody>>& bodies,
+                        const std::vector<MeshHandle>& bodyMeshes, DirectX::XMMATRIX viewProj,
+                        DirectX::XMFLOAT3 cameraPos) {
+    ConstantBufferData cbData{};
+    FillBodyLighting(cbData, cameraPos);
+    device.SetTopology(RenderTopology::TriangleList);
+    // Константный буфер перезаписывается при смене тела или useTexture, буферы меша - при смене меша
+    uint32_t currentBody = UINT32_MAX;
+    const Mesh* boundMesh = nullptr;
+    for (const RenderQueueItem& item : renderQueue.GetItems()) {
+        const CelestialBody& body = *bodies[item.object];
+        const Mesh& mesh = *bodyMeshes[item.object];
+        const MeshSubmesh& submesh = mesh.GetSubmeshes(GetBodyLod(item.object, mesh))[item.part];
+        const Texture* texture = body.useTexture ? mesh.GetMaterialTexture(submesh.material) : nullptr;
+        int32_t useTexture = texture != nullptr;
+        if (item.object != currentBody) {
+            DirectX::XMMATRIX world = body.GetWorldMatrix();
+            cbData.worldViewProj = DirectX::XMMatrixTranspose(world * viewProj);
+            cbData.world = DirectX::XMMatrixTranspose(world);
+            cbData.color = body.color;
+            cbData.emissiveColor = body.emissiveColor;
+            FillVertexQuantization(cbData, mesh);
+            cbData.useTexture = useTexture;
+            device.UpdateBuffer(constantBuffer, &cbData, sizeof(cbData));
+            currentBody = item.object;
+        } else if (cbData.useTexture != useTexture) {
+            cbData.useTexture = useTexture;
+            device.UpdateBuffer(constantBuffer, &cbData, sizeof(cbData));
+        }
+        bool compact = mesh.vertexFormat == VertexFormat::Compact;
+        if (&mesh != boundMesh) {
+            device.SetVertexBuffer(0, mesh.vertexBuffer, static_cast<uint32_t>(VertexQuantizer::GetStride(mesh.vertexFormat)));
+            device.SetIndexBuffer(mesh.indexBuffer, mesh.indexFormat);
+            boundMesh = &mesh;
+        }
+        // PSMainTextured не смотрит на useTexture, поэтому подмеш без текстуры идёт цветным конвейером
+        device.SetPipeline(SelectPipeline(texture != nullptr, false, compact));
+        if (texture) device.SetTexture(texture->gpuTexture);
+        device.DrawIndexed(submesh.indexCount, submesh.firstIndex, 0);
     }
-    logger << "[Render] InputLayout создан" << std::endl;
-
-    vsBlob->Release();
-    psTexturedBlob->Release();
-    psColoredBlob->Release();
-
-    struct ConstantBufferData {
-        DirectX::XMMATRIX worldViewProj;
-        DirectX::XMMATRIX world;
-        DirectX::XMFLOAT4 color;
-        BOOL useTexture;
-        DirectX::XMFLOAT3 lightDir; // Заменяем lightPos на lightDir
-        DirectX::XMFLOAT3 lightColor;
-        DirectX::XMFLOAT3 materialDiffuse;
-        DirectX::XMFLOAT3 materialSpecular;
-        float shininess;
-        DirectX::XMFLOAT3 emissiveColor;
-        DirectX::XMFLOAT3 cameraPos;
-        float padding;
-    };
-    D3D11_BUFFER_DESC cbDesc = {};
-    cbDesc.Usage = D3D11_USAGE_DEFAULT;
-    cbDesc.ByteWidth = sizeof(ConstantBufferData);
-    cbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-    hr = device->CreateBuffer(&cbDesc, nullptr, &constantBuffer);
-    if (FAILED(hr)) {
-        logger << "[Render] Ошибка: не удалось создать константный буфер" << std::endl;
-        return false;
+    LOG_TRACE << "[Render] Отправлено вызовов из очереди: " << renderQueue.GetItems().size()
+           << ", отброшено повторов: " << renderQueue.GetDeduplicatedCount() << std::endl;
+}
+
+void Render::BuildInstanceBatches(const std::vector<std::unique_ptr<CelestialBody>>& bodies,
+                                  const std::vector<MeshHandle>& bodyMeshes) {
+    // Группы раскладываются в одном потоке, данные экземпляров пишутся в свои слоты параллельно
+    instanceBatcher.Begin();
+    renderQueue.Begin(bodies.size());
+    drawnBodies.clear();
+    for (uint32_t i : visibleBodies) {
+        if (!renderQueue.Claim(i)) continue;
+        const CelestialBody& body = *bodies[i];
+        const Mesh& mesh = *bodyMeshes[i];
+        bool textured = body.useTexture && mesh.HasReadyTexture();
+        instanceBatcher.Reserve(&mesh, GetBodyLod(i, mesh), textured);
+        drawnBodies.push_back(i);
     }
-    logger << "[Render] Константный буфер создан" << std::endl;
-
-    D3D11_SAMPLER_DESC sampDesc = {};
-    sampDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
-    sampDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
-    sampDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
-    sampDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
-    sampDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
-    sampDesc.MinLOD = 0;
-    sampDesc.MaxLOD = D3D11_FLOAT32_MAX;
-    hr = device->CreateSamplerState(&sampDesc, &samplerState);
-    if (FAILED(hr)) {
-        logger << "[Render] Ошибка: не удалось создать SamplerState" << std::endl;
-        return false;
+    instanceBatcher.Build();
+    ParallelFor(drawnBodies.size(), ParallelGrain, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+            const CelestialBody& body = *bodies[drawnBodies[k]];
+            instanceBatcher.SetInstance(k, body.GetWorldMatrix(), body.color, body.emissiveColor);
+        }
+    });
+
+    // Вызов на подмеш группы; очередь собирает одинаковые конвейеры и текстуры подряд, глубина у группы не одна
+    const std::vector<InstanceBatch>& batches = instanceBatcher.GetBatches();
+    for (uint32_t b = 0; b < batches.size(); ++b) {
+        const InstanceBatch& batch = batches[b];
+        const Mesh& mesh = *static_cast<const Mesh*>(batch.mesh);
+        bool compact = mesh.vertexFormat == VertexFormat::Compact;
+        uint32_t meshId = renderQueue.GetResourceId(&mesh);
+        const MeshSubmesh* submeshes = mesh.GetSubmeshes(batch.lod);
+        for (uint32_t s = 0; s < mesh.submeshCount; ++s) {
+            if (submeshes[s].indexCount == 0) continue;
+            const Texture* texture = batch.textured ? mesh.GetMaterialTexture(submeshes[s].material) : nullptr;
+            RenderPipeline pipeline = SelectPipeline(texture != nullptr, true, compact);
+            renderQueue.Add(RenderQueue::MakeKey(BodyPass, static_cast<uint32_t>(pipeline),
+                                                 renderQueue.GetResourceId(texture), meshId, 0.0f), b, s);
+        }
     }
-    logger << "[Render] SamplerState создан" << std::endl;
+    if (sortingEnabled) {
+        PROFILE_ZONE("RenderQueue::Sort");
+        renderQueue.Sort();
+    }
+}
 
-    context->VSSetShader(vertexShader, nullptr, 0);
-    context->IASetInputLayout(inputLayout);
-    context->VSSetConstantBuffers(0, 1, &constantBuffer);
-    context->PSSetConstantBuffers(0, 1, &constantBuffer);
-    context->PSSetSamplers(0, 1, &samplerState);
-    logger << "[Render] Шейдеры и состояния установлены" << std::endl;
+void Render::DrawBodiesInstanced(DirectX::XMMATRIX viewProj, DirectX::XMFLOAT3 cameraPos) {
+    if (instanceBatcher.GetBatches().empty()) return;
+    if (!UploadInstances(instanceBatcher.GetInstances())) return;
 
-    logger << "[Render] Инициализация рендера завершена успешно" << std::endl;
-    return true;
+    // Один константный буфер на все группы: цвет, подсветка и мировая матрица приходят из экземпляра
+    ConstantBufferData cbData{};
+    cbData.worldViewProj = DirectX::XMMatrixTranspose(viewProj);
+    cbData.world = DirectX::XMMatrixIdentity();
+    cbData.color = DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+    cbData.useTexture = 1;
+    cbData.emissiveColor = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+    FillBodyLighting(cbData, cameraPos);
+    device.UpdateBuffer(constantBuffer, &cbData, sizeof(cbData));
+
+    const std::vector<InstanceBatch>& batches = instanceBatcher.GetBatches();
+    device.SetTopology(RenderTopology::TriangleList);
+    device.SetVertexBuffer(1, instanceBuffer, sizeof(InstanceData));
+    const Mesh* boundMesh = nullptr;
+    const Mesh* quantizedMesh = nullptr;
+    for (const RenderQueueItem& item : renderQueue.GetItems()) {
+        const InstanceBatch& batch = batches[item.object];
+        const Mesh& mesh = *static_cast<const Mesh*>(batch.mesh);
+        bool compact = mesh.vertexFormat == VertexFormat::Compact;
+        // Границы сжатого меша лежат в общем константном буфере и обновляются только при смене меша
+        if (compact && &mesh != quantizedMesh) {
+            FillVertexQuantization(cbData, mesh);
+            device.UpdateBuffer(constantBuffer, &cbData, sizeof(cbData));
+            quantizedMesh = &mesh;
+        }
+        if (&mesh != boundMesh) {
+            device.SetVertexBuffer(0, mesh.vertexBuffer, static_cast<uint32_t>(VertexQuantizer::GetStride(mesh.vertexFormat)));
+            device.SetIndexBuffer(mesh.indexBuffer, mesh.indexFormat);
+            boundMesh = &mesh;
+        }
+
+        // Подмеш без готовой текстуры рисуется цветным конвейером, остальные - со своей текстурой
+        const MeshSubmesh& submesh = mesh.GetSubmeshes(batch.lod)[item.part];
+        const Texture* texture = batch.textured ? mesh.GetMaterialTexture(submesh.material) : nullptr;
+        device.SetPipeline(SelectPipeline(texture != nullptr, true, compact));
+        if (texture) device.SetTexture(texture->gpuTexture);
+        device.DrawIndexedInstanced(submesh.indexCount, batch.instanceCount, submesh.firstIndex, 0, batch.firstInstance);
+    }
 }
-void Render::RenderScene(const std::vector<std::unique_ptr<CelestialBody>>& bodies, const Ground* ground,
-                        DirectX::XMMATRIX viewProj, DirectX::XMFLOAT3 cameraPos) {
-    logger << "[Render] Начало рендеринга сцены" << std::endl;
 
-    if (!context || !ground || !constantBuffer) {
-        logger << "[Render] Ошибка: недействительный контекст, ground или constantBuffer" << std::endl;
-        return;
+bool Render::UploadInstances(const std::vector<InstanceData>& instances) {
+    if (instances.size() > instanceCapacity) {
+        device.DestroyBuffer(instanceBuffer);
+        instanceCapacity = 0;
+
+        size_t capacity = 256;
+        while (capacity < instances.size()) capacity *= 2;
+
+        instanceBuffer = device.CreateBuffer(RenderBufferType::Vertex, RenderBufferUsage::Dynamic,
+                                             capacity * sizeof(InstanceData), nullptr);
+        if (instanceBuffer == InvalidRenderBuffer) {
+            LOG_ERROR << "[Render] Ошибка: не удалось создать буфер экземпляров на " << capacity << " тел" << std::endl;
+            return false;
+        }
+        instanceCapacity = capacity;
+        LOG_INFO << "[Render] Буфер экземпляров увеличен до " << capacity << " тел" << std::endl;
     }
 
-    float clearColor[] = { 0.53f, 0.81f, 0.92f, 1.0f };
-    context->ClearRenderTargetView(renderTargetView, clearColor);
-    context->ClearDepthStencilView(depthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
-    logger << "[Render] Буферы очищены" << std::endl;
+    return device.UpdateBuffer(instanceBuffer, instances.data(), instances.size() * sizeof(InstanceData));
+}
 
-    if (ground->HasTexture()) {
-        logger << "[Render] Используется текстурный шейдер для ground" << std::endl;
-        context->PSSetShader(pixelShaderTextured, nullptr, 0);
+void Render::CullBakedPiles(DirectX::XMMATRIX viewProj) {
+    visibleChunks.clear();
+    if (!pileBaker || !pileBaker->GetRoot() || pileBaker->GetChunks().empty()) return;
+
+    // Куски лежат в координатах корня: у всех одна мировая матрица, меняются цвет и текстура
+    DirectX::XMMATRIX world = pileBaker->GetRoot()->GetWorldMatrix();
+    DirectX::XMStoreFloat4x4(&pileWorld, world);
+    const std::vector<BakedPileChunk>& chunks = pileBaker->GetChunks();
+    if (cullingEnabled) {
+        float scale = DirectX::XMVectorGetX(DirectX::XMVector3Length(world.r[0]));
+        chunkCuller.Begin();
+        for (const BakedPileChunk& chunk : chunks) {
+            DirectX::XMFLOAT3 center;
+            DirectX::XMStoreFloat3(&center, DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&chunk.boundsCenter), world));
+            chunkCuller.Add(center, chunk.boundsRadius * scale);
+        }
+        visibleChunks = chunkCuller.Cull(viewProj);
     } else {
-        logger << "[Render] Используется цветной шейдер для ground" << std::endl;
-        context->PSSetShader(pixelShaderColored, nullptr, 0);
-    }
-    logger << "[Render] Вызов Draw для ground" << std::endl;
-    ground->Draw(context, constantBuffer, viewProj, cameraPos);
-
-    context->PSSetShader(pixelShaderTextured, nullptr, 0);
-    logger << "[Render] Установлен текстурный шейдер для тел" << std::endl;
-    for (const auto& body : bodies) {
-        logger << "[Render] Рендеринг тела" << std::endl;
-        body->Draw(context, constantBuffer, viewProj, cameraPos);
+        for (uint32_t i = 0; i < chunks.size(); ++i) visibleChunks.push_back(i);
     }
+}
+
+void Render::DrawBakedPiles(DirectX::XMMATRIX viewProj, DirectX::XMFLOAT3 cameraPos) {
+    drawnChunkCount = 0;
+    if (visibleChunks.empty()) return;
+
+    DirectX::XMMATRIX world = DirectX::XMLoadFloat4x4(&pileWorld);
+    const std::vector<BakedPileChunk>& chunks = pileBaker->GetChunks();
+    ConstantBufferData cbData{};
+    cbData.worldViewProj = DirectX::XMMatrixTranspose(world * viewProj);
+    cbData.world = DirectX::XMMatrixTranspose(world);
+    FillBodyLighting(cbData, cameraPos);
 
-    swapChain->Present(1, 0);
-    logger << "[Render] Сцена представлена на экран" << std::endl;
-    logger << "[Render] Рендеринг сцены завершен" << std::endl;
-}
\ No newline at end of file
+    device.SetTopology(RenderTopology::TriangleList);
+    for (uint32_t i : visibleChunks) {
+        const BakedPileChunk& chunk = chunks[i];
+        if (chunk.indexCount == 0) continue;
+        const Texture* texture = chunk.texture && chunk.texture->IsReady() ? chunk.texture.get() : nullptr;
+        cbData.color = chunk.color;
+        cbData.useTexture = texture != nullptr;
+        cbData.emissiveColor = chunk.emissiveColor;
+        device.UpdateBuffer(constantBuffer, &cbData, sizeof(cbData));
+        // PSMainTextured не смотрит на useTexture, поэтому кусок без текстуры идёт цветным конвейером
+        device.SetPipeline(SelectPipeline(texture != nullptr, false, false));
+        if (texture) device.SetTexture(texture->gpuTexture);
+        device.SetVertexBuffer(0, chunk.vertexBuffer, static_cast<uint32_t>(VertexQuantizer::GetStride(VertexFormat::Float32)));
+        device.SetIndexBuffer(chunk.indexBuffer, RenderIndexFormat::UInt16);
+        device.DrawIndexed(chunk.indexCount, 0, 0);
+        ++drawnChunkCount;
+    }
+}
@@ -1,33 +1,105 @@
 #pragma once
-#include <d3d11.h>
+#include <functional>
 #include <vector>
 #include <memory>
 #include "CelestialBody.h"
-#include "Ground.h"
+#include "GroundSurface.h"
+#include "MeshRegistry.h"
+#include "InstanceBatcher.h"
+#include "RenderQueue.h"
+#include "FrustumCuller.h"
+#include "RenderDevice.h"
+#include "PileBaker.h"
+#include "TaskScheduler.h"
 
+// Отправка сцены на RenderDevice; сам рендер не зависит от графического API
 class Render {
 public:
-    Render(HWND hwnd);
+    explicit Render(RenderDevice& device);
     ~Render();
 
     bool Initialize();
-    void RenderScene(const std::vector<std::unique_ptr<CelestialBody>>& bodies, const Ground* ground,
-                     DirectX::XMMATRIX viewProj, DirectX::XMFLOAT3 cameraPos);
-    ID3D11Device* GetDevice() { return device; }
+    // bodyMeshes[i] - меш тела bodies[i]; пустые слоты и тела без готового меша пропускаются
+    void RenderScene(const std::vector<std::unique_ptr<CelestialBody>>& bodies, const std::vector<MeshHandle>& bodyMeshes,
+                     const GroundSurface* ground, DirectX::XMMATRIX viewProj, DirectX::XMFLOAT3 cameraPos);
+    RenderDevice& GetDevice() { return device; }
+    // Одинаковые меши рисуются одним DrawIndexedInstanced на группу; false - по вызову на тело
+    void SetInstancingEnabled(bool enabled) { instancingEnabled = enabled; }
+    size_t GetLastDrawCallCount() const { return device.GetFrameStats().drawCalls; }
+    // Тела вне пирамиды видимости не отправляются; false - рисовать все готовые тела
+    void SetCullingEnabled(bool enabled) { cullingEnabled = enabled; }
+    size_t GetLastVisibleBodyCount() const { return visibleBodies.size(); }
+    size_t GetLastCulledBodyCount() const { return culledBodyCount; }
+    // Уровень детализации тела выбирается по экранному размеру его ошибки упрощения; false - всегда lods[0]
+    void SetLodEnabled(bool enabled) { lodEnabled = enabled; }
+    // Допустимая ошибка в пикселях при заданной высоте области вывода
+    void SetLodThreshold(float pixels, uint32_t viewportHeight);
+    size_t GetLastPrimitiveCount() const { return device.GetFrameStats().primitives; }
+    // Запечённые тела не рисуются по отдельности, вместо них - куски кучи; nullptr - без запекания
+    void SetPileBaker(const PileBaker* baker) { pileBaker = baker; }
+    size_t GetLastBakedChunkCount() const { return drawnChunkCount; }
+    // Вызовы тел, отправленные через очередь отрисовки, и отброшенные повторные заявки того же тела за кадр
+    size_t GetLastQueuedDrawCount() const { return renderQueue.GetItems().size(); }
+    size_t GetLastDeduplicatedDrawCount() const { return renderQueue.GetDeduplicatedCount(); }
+    // Вызовы тел сортируются по ключу очереди; false - в порядке видимости тел
+    void SetSortingEnabled(bool enabled) { sortingEnabled = enabled; }
+    // Отсечение, выбор LOD и сборка списка отрисовки идут графом задач кадра на планировщике, вызовы устройства -
+    // в вызывающем потоке. Результат тот же, что в одном потоке; nullptr - всё в вызывающем потоке
+    void SetTaskScheduler(TaskScheduler* scheduler) { taskScheduler = scheduler; }
 
 private:
-    HWND hwnd;
-    ID3D11Device* device;
-    ID3D11DeviceContext* context;
-    IDXGISwapChain* swapChain;
-    ID3D11RenderTargetView* renderTargetView;
-    ID3D11DepthStencilView* depthStencilView;
-    ID3D11DepthStencilState* depthStencilState;
-    ID3D11Texture2D* depthStencilBuffer;
-    ID3D11VertexShader* vertexShader;
-    ID3D11PixelShader* pixelShaderTextured;
-    ID3D11PixelShader* pixelShaderColored;
-    ID3D11InputLayout* inputLayout;
-    ID3D11Buffer* constantBuffer;
-    ID3D11SamplerState* samplerState;
-};
\ No newline at end of file
+    // Кусок тел для отсечения в одном потоке: свои сферы и свои видимые
+    struct CullChunk {
+        FrustumCuller culler;
+        std::vector<uint32_t> candidates; // индекс тела для каждой сферы в culler
+        std::vector<uint32_t> visible;
+        size_t culledCount = 0;
+    };
+
+    static bool IsReadyToDraw(const CelestialBody& body, const Mesh* mesh);
+    void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& function);
+    void CullBodies(const std::vector<std::unique_ptr<CelestialBody>>& bodies, const std::vector<MeshHandle>& bodyMeshes,
+                    DirectX::XMMATRIX viewProj);
+    void CullBodyRange(const std::vector<std::unique_ptr<CelestialBody>>& bodies, const std::vector<MeshHandle>& bodyMeshes,
+                       DirectX::XMMATRIX viewProj, size_t begin, size_t end, CullChunk& chunk);
+    void SelectLods(const std::vector<std::unique_ptr<CelestialBody>>& bodies, const std::vector<MeshHandle>& bodyMeshes,
+                    DirectX::XMMATRIX viewProj);
+    uint32_t GetBodyLod(uint32_t body, const Mesh& mesh) const;
+    // Build* заполняют очередь отрисовки кадра и не трогают устройство, Draw* отправляют её на устройство
+    void BuildBodyDrawList(const std::vector<std::unique_ptr<CelestialBody>>& bodies,
+                           const std::vector<MeshHandle>& bodyMeshes, DirectX::XMMATRIX viewProj);
+    void DrawBodies(const std::vector<std::unique_ptr<CelestialBody>>& bodies,
+                    const std::vector<MeshHandle>& bodyMeshes, DirectX::XMMATRIX viewProj, DirectX::XMFLOAT3 cameraPos);
+    void BuildInstanceBatches(const std::vector<std::unique_ptr<CelestialBody>>& bodies,
+                              const std::vector<MeshHandle>& bodyMeshes);
+    void DrawBodiesInstanced(DirectX::XMMATRIX viewProj, DirectX::XMFLOAT3 cameraPos);
+    bool UploadInstances(const std::vector<InstanceData>& instances);
+    void CullBakedPiles(DirectX::XMMATRIX viewProj);
+    void DrawBakedPiles(DirectX::XMMATRIX viewProj, DirectX::XMFLOAT3 cameraPos);
+
+    RenderDevice& device;
+    RenderBufferId constantBuffer;
+    RenderBufferId instanceBuffer;
+    size_t instanceCapacity;
+    InstanceBatcher instanceBatcher;
+    bool instancingEnabled;
+    RenderQueue renderQueue; // вызовы тел текущего кадра, отсортированные по состоянию и глубине
+    bool sortingEnabled;
+    std::vector<CullChunk> cullChunks;
+    std::vector<uint32_t> visibleBodies;  // индексы тел, отправляемых в текущем кадре
+    std::vector<uint32_t> drawnBodies;    // видимые тела, заявленные в очереди, в порядке заявки
+    std::vector<std::vector<RenderQueueItem>> drawListChunks;
+    size_t culledBodyCount;
+    bool cullingEnabled;
+    std::vector<uint8_t> bodyLods; // текущий уровень каждого тела, хранится между кадрами для гистерезиса
+    bool lodEnabled;
+    float lodPixelThreshold;
+    float viewportHalfHeight;
+    const PileBaker* pileBaker;
+    FrustumCuller chunkCuller;
+    std::vector<uint32_t> visibleChunks;
+    DirectX::XMFLOAT4X4 pileWorld; // мировая матрица корня кучи на текущий кадр
+    size_t drawnChunkCount;
+    TaskScheduler* taskScheduler;
+    TaskGraph frameGraph;
+};
@@ -0,0 +1,142 @@
+#include "RenderDevice.h"
+#include "Logger.h"
+
+RenderBufferId RenderDevice::CreateBuffer(RenderBufferType type, RenderBufferUsage usage, size_t byteSize,
+                                          const void* initialData) {
+    if (byteSize == 0 || (usage == RenderBufferUsage::Immutable && !initialData)) {
+        LOG_ERROR << "[RenderDevice] Ошибка: пустой буфер или неизменяемый буфер без данных" << std::endl;
+        return InvalidRenderBuffer;
+    }
+    RenderBufferId id = nextResourceId++;
+    if (!DoCreateBuffer(id, type, usage, byteSize, initialData)) return InvalidRenderBuffer;
+
+    ++frameStats.resourcesCreated;
+    if (initialData) frameStats.bytesUploaded += byteSize;
+    return id;
+}
+
+void RenderDevice::DestroyBuffer(RenderBufferId buffer) {
+    if (buffer != InvalidRenderBuffer) DoDestroyBuffer(buffer);
+}
+
+bool RenderDevice::UpdateBuffer(RenderBufferId buffer, const void* data, size_t byteSize) {
+    if (buffer == InvalidRenderBuffer || !data || byteSize == 0) return false;
+    if (!DoUpdateBuffer(buffer, data, byteSize)) return false;
+    frameStats.bytesUploaded += byteSize;
+    return true;
+}
+
+RenderTextureId RenderDevice::CreateTexture(const RenderTextureLevel* levels, uint32_t levelCount) {
+    if (!levels || levelCount == 0) return InvalidRenderTexture;
+    RenderTextureId id = nextResourceId++;
+    if (!DoCreateTexture(id, levels, levelCount)) return InvalidRenderTexture;
+
+    ++frameStats.resourcesCreated;
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        frameStats.bytesUploaded += size_t(levels[level].rowPitch) * levels[level].height;
+    }
+    return id;
+}
+
+void RenderDevice::DestroyTexture(RenderTextureId texture) {
+    if (texture != InvalidRenderTexture) DoDestroyTexture(texture);
+}
+
+void RenderDevice::BeginFrame(const float clearColor[4]) {
+    DoBeginFrame(clearColor);
+}
+
+void RenderDevice::EndFrame() {
+    DoEndFrame();
+    // Загрузки между кадрами (например, из AssetLoader::PumpUploads) попадают в статистику следующего кадра
+    lastFrameStats = frameStats;
+    frameStats = RenderFrameStats();
+}
+
+void RenderDevice::SetPipeline(RenderPipeline pipeline) {
+    if (bound.pipeline == pipeline) {
+        ++frameStats.redundantBinds;
+        return;
+    }
+    bound.pipeline = pipeline;
+    ++frameStats.stateChanges;
+    DoSetPipeline(pipeline);
+}
+
+void RenderDevice::SetConstantBuffer(RenderBufferId buffer) {
+    if (bound.constantBuffer == buffer) {
+        ++frameStats.redundantBinds;
+        return;
+    }
+    bound.constantBuffer = buffer;
+    ++frameStats.stateChanges;
+    DoSetConstantBuffer(buffer);
+}
+
+void RenderDevice::SetVertexBuffer(uint32_t slot, RenderBufferId buffer, uint32_t stride) {
+    if (slot >= MaxVertexSlots) {
+        LOG_ERROR << "[RenderDevice] Ошибка: недопустимый слот вершинного буфера " << slot << std::endl;
+        return;
+    }
+    if (bound.vertexBuffers[slot] == buffer && bound.vertexStrides[slot] == stride) {
+        ++frameStats.redundantBinds;
+        return;
+    }
+    bound.vertexBuffers[slot] = buffer;
+    bound.vertexStrides[slot] = stride;
+    ++frameStats.stateChanges;
+    DoSetVertexBuffer(slot, buffer, stride);
+}
+
+void RenderDevice::SetIndexBuffer(RenderBufferId buffer, RenderIndexFormat format) {
+    if (bound.indexBuffer == buffer && bound.indexFormat == format) {
+        ++frameStats.redundantBinds;
+        return;
+    }
+    bound.indexBuffer = buffer;
+    bound.indexFormat = format;
+    ++frameStats.stateChanges;
+    DoSetIndexBuffer(buffer, format);
+}
+
+void RenderDevice::SetTopology(RenderTopology topology) {
+    if (bound.topologySet && bound.topology == topology) {
+        ++frameStats.redundantBinds;
+        return;
+    }
+    bound.topology = topology;
+    bound.topologySet = true;
+    ++frameStats.stateChanges;
+    DoSetTopology(topology);
+}
+
+void RenderDevice::SetTexture(RenderTextureId texture) {
+    if (bound.texture == texture) {
+        ++frameStats.redundantBinds;
+        return;
+    }
+    bound.texture = texture;
+    ++frameStats.stateChanges;
+    DoSetTexture(texture);
+}
+
+void RenderDevice::DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex) {
+    if (indexCount == 0) return;
+    ++frameStats.drawCalls;
+    CountPrimitives(indexCount, 1);
+    DoDrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+void RenderDevice::DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex,
+                                        int32_t baseVertex, uint32_t startInstance) {
+    if (indexCount == 0 || instanceCount == 0) return;
+    ++frameStats.drawCalls;
+    CountPrimitives(indexCount, instanceCount);
+    DoDrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+void RenderDevice::CountPrimitives(uint32_t indexCount, uint32_t instanceCount) {
+    uint32_t verticesPerPrimitive = bound.topology == RenderTopology::LineList ? 2 : 3;
+    frameStats.instances += instanceCount;
+    frameStats.primitives += size_t(indexCount / verticesPerPrimitive) * instanceCount;
+}
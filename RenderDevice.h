@@ -0,0 +1,169 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Идентификаторы ресурсов устройства. Не переиспользуются, 0 - пустой ресурс.
+using RenderBufferId = uint32_t;
+using RenderTextureId = uint32_t;
+constexpr RenderBufferId InvalidRenderBuffer = 0;
+constexpr RenderTextureId InvalidRenderTexture = 0;
+
+enum class RenderBufferType {
+    Vertex,
+    Index,   // формат индексов задаётся при привязке, RenderIndexFormat
+    Constant
+};
+
+enum class RenderIndexFormat {
+    UInt16,
+    UInt32
+};
+
+inline size_t GetIndexFormatSize(RenderIndexFormat format) {
+    return format == RenderIndexFormat::UInt16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+enum class RenderBufferUsage {
+    Immutable, // данные задаются при создании
+    Default,   // редкие обновления через UpdateBuffer
+    Dynamic    // перезаписывается целиком каждый кадр
+};
+
+enum class RenderTopology {
+    TriangleList,
+    LineList
+};
+
+// Связка шейдеров и входного layout из shader.hlsl
+enum class RenderPipeline {
+    None,
+    Textured,          // VSMain + PSMainTextured
+    Colored,           // VSMain + PSMainColored
+    TexturedInstanced, // VSMainInstanced + PSMainTextured
+    ColoredInstanced,  // VSMainInstanced + PSMainColored
+    // Те же связки для сжатых вершин (CompactVertex), границы меша - в константном буфере
+    TexturedCompact,          // VSMainCompact + PSMainTextured
+    ColoredCompact,           // VSMainCompact + PSMainColored
+    TexturedInstancedCompact, // VSMainInstancedCompact + PSMainTextured
+    ColoredInstancedCompact   // VSMainInstancedCompact + PSMainColored
+};
+
+inline bool IsInstancedPipeline(RenderPipeline pipeline) {
+    return pipeline == RenderPipeline::TexturedInstanced || pipeline == RenderPipeline::ColoredInstanced ||
+           pipeline == RenderPipeline::TexturedInstancedCompact || pipeline == RenderPipeline::ColoredInstancedCompact;
+}
+
+inline bool IsTexturedPipeline(RenderPipeline pipeline) {
+    return pipeline == RenderPipeline::Textured || pipeline == RenderPipeline::TexturedInstanced ||
+           pipeline == RenderPipeline::TexturedCompact || pipeline == RenderPipeline::TexturedInstancedCompact;
+}
+
+inline bool IsCompactPipeline(RenderPipeline pipeline) {
+    return pipeline == RenderPipeline::TexturedCompact || pipeline == RenderPipeline::ColoredCompact ||
+           pipeline == RenderPipeline::TexturedInstancedCompact || pipeline == RenderPipeline::ColoredInstancedCompact;
+}
+
+inline RenderPipeline SelectPipeline(bool textured, bool instanced, bool compact) {
+    if (compact) {
+        if (instanced) return textured ? RenderPipeline::TexturedInstancedCompact : RenderPipeline::ColoredInstancedCompact;
+        return textured ? RenderPipeline::TexturedCompact : RenderPipeline::ColoredCompact;
+    }
+    if (instanced) return textured ? RenderPipeline::TexturedInstanced : RenderPipeline::ColoredInstanced;
+    return textured ? RenderPipeline::Textured : RenderPipeline::Colored;
+}
+
+// Один мип-уровень текстуры в формате RGBA8
+struct RenderTextureLevel {
+    const void* pixels;
+    uint32_t width;
+    uint32_t height;
+    uint32_t rowPitch;
+};
+
+// Счётчики отправки команд за кадр (между двумя EndFrame)
+struct RenderFrameStats {
+    size_t drawCalls = 0;
+    size_t instances = 0;
+    size_t primitives = 0;
+    size_t stateChanges = 0;      // привязки, реально дошедшие до бэкенда
+    size_t redundantBinds = 0;    // привязки того же состояния, отброшенные без вызова бэкенда
+    size_t bytesUploaded = 0;     // начальные данные ресурсов и обновления буферов
+    size_t resourcesCreated = 0;
+};
+
+// Тонкий слой над графическим API: создание ресурсов, привязки и вызовы отрисовки.
+// Публичные методы отслеживают текущее состояние и считают статистику одинаково для всех бэкендов,
+// бэкенд реализует только защищённые Do*-методы.
+class RenderDevice {
+public:
+    virtual ~RenderDevice() = default;
+
+    virtual bool SupportsPipeline(RenderPipeline pipeline) const = 0;
+
+    RenderBufferId CreateBuffer(RenderBufferType type, RenderBufferUsage usage, size_t byteSize, const void* initialData);
+    void DestroyBuffer(RenderBufferId buffer);
+    bool UpdateBuffer(RenderBufferId buffer, const void* data, size_t byteSize);
+    RenderTextureId CreateTexture(const RenderTextureLevel* levels, uint32_t levelCount);
+    void DestroyTexture(RenderTextureId texture);
+
+    void BeginFrame(const float clearColor[4]);
+    void EndFrame();
+
+    void SetPipeline(RenderPipeline pipeline);
+    void SetConstantBuffer(RenderBufferId buffer);
+    void SetVertexBuffer(uint32_t slot, RenderBufferId buffer, uint32_t stride);
+    void SetIndexBuffer(RenderBufferId buffer, RenderIndexFormat format = RenderIndexFormat::UInt32);
+    void SetTopology(RenderTopology topology);
+    void SetTexture(RenderTextureId texture);
+
+    void DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex);
+    void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex,
+                              uint32_t startInstance);
+
+    // Статистика последнего завершённого кадра
+    const RenderFrameStats& GetFrameStats() const { return lastFrameStats; }
+
+protected:
+    static constexpr uint32_t MaxVertexSlots = 2;
+
+    virtual bool DoCreateBuffer(RenderBufferId id, RenderBufferType type, RenderBufferUsage usage, size_t byteSize,
+                                const void* initialData) = 0;
+    virtual void DoDestroyBuffer(RenderBufferId id) = 0;
+    virtual bool DoUpdateBuffer(RenderBufferId id, const void* data, size_t byteSize) = 0;
+    virtual bool DoCreateTexture(RenderTextureId id, const RenderTextureLevel* levels, uint32_t levelCount) = 0;
+    virtual void DoDestroyTexture(RenderTextureId id) = 0;
+
+    virtual void DoBeginFrame(const float clearColor[4]) = 0;
+    virtual void DoEndFrame() = 0;
+
+    virtual void DoSetPipeline(RenderPipeline pipeline) = 0;
+    virtual void DoSetConstantBuffer(RenderBufferId buffer) = 0;
+    virtual void DoSetVertexBuffer(uint32_t slot, RenderBufferId buffer, uint32_t stride) = 0;
+    virtual void DoSetIndexBuffer(RenderBufferId buffer, RenderIndexFormat format) = 0;
+    virtual void DoSetTopology(RenderTopology topology) = 0;
+    virtual void DoSetTexture(RenderTextureId texture) = 0;
+
+    virtual void DoDrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex) = 0;
+    virtual void DoDrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex,
+                                        int32_t baseVertex, uint32_t startInstance) = 0;
+
+private:
+    void CountPrimitives(uint32_t indexCount, uint32_t instanceCount);
+
+    // Текущие привязки; идентификаторы не переиспользуются, поэтому сравнение по id безопасно
+    struct BoundState {
+        RenderPipeline pipeline = RenderPipeline::None;
+        RenderBufferId constantBuffer = InvalidRenderBuffer;
+        RenderBufferId vertexBuffers[MaxVertexSlots] = {};
+        uint32_t vertexStrides[MaxVertexSlots] = {};
+        RenderBufferId indexBuffer = InvalidRenderBuffer;
+        RenderIndexFormat indexFormat = RenderIndexFormat::UInt32;
+        RenderTopology topology = RenderTopology::TriangleList;
+        bool topologySet = false;
+        RenderTextureId texture = InvalidRenderTexture;
+    } bound;
+
+    uint32_t nextResourceId = 1;
+    RenderFrameStats frameStats;
+    RenderFrameStats lastFrameStats;
+};
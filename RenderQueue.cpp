@@ -0,0 +1,83 @@
+#include "RenderQueue.h"
+#include <algorithm>
+#include <cstring>
+
+uint64_t RenderQueue::MakeKey(uint32_t pass, uint32_t pipeline, uint32_t texture, uint32_t mesh, float depth) {
+    // У неотрицательного float биты растут вместе со значением, поэтому глубина кладётся старшими битами
+    // своего представления без знания дальней плоскости
+    uint32_t depthBits = 0;
+    if (depth > 0.0f) std::memcpy(&depthBits, &depth, sizeof(depthBits));
+    uint64_t key = std::min<uint64_t>(pass, (1u << PassBits) - 1);
+    key = (key << PipelineBits) | std::min<uint64_t>(pipeline, (1u << PipelineBits) - 1);
+    key = (key << TextureBits) | std::min<uint64_t>(texture, (1u << TextureBits) - 1);
+    key = (key << MeshBits) | std::min<uint64_t>(mesh, (1u << MeshBits) - 1);
+    key = (key << DepthBits) | (depthBits >> (32 - DepthBits));
+    return key;
+}
+
+void RenderQueue::Begin(size_t objectCount) {
+    items.clear();
+    resourceIds.clear();
+    deduplicatedCount = 0;
+    if (++frame == 0) {
+        // Счётчик кадров обернулся: старые отметки могли бы совпасть с новым номером
+        std::fill(claimedFrame.begin(), claimedFrame.end(), 0u);
+        frame = 1;
+    }
+    if (claimedFrame.size() < objectCount) claimedFrame.resize(objectCount, 0u);
+}
+
+bool RenderQueue::Claim(uint32_t object) {
+    if (object >= claimedFrame.size()) claimedFrame.resize(object + 1, 0u);
+    if (claimedFrame[object] == frame) {
+        ++deduplicatedCount;
+        return false;
+    }
+    claimedFrame[object] = frame;
+    return true;
+}
+
+uint32_t RenderQueue::GetResourceId(const void* resource) {
+    if (!resource) return 0;
+    // Номера выдаются в порядке первого появления; переполнение поля ключа лишь ухудшает группировку
+    auto inserted = resourceIds.emplace(resource, static_cast<uint32_t>(resourceIds.size() + 1));
+    return inserted.first->second;
+}
+
+uint32_t RenderQueue::FindResourceId(const void* resource) const {
+    if (!resource) return 0;
+    auto found = resourceIds.find(resource);
+    return found != resourceIds.end() ? found->second : 0;
+}
+
+void RenderQueue::Sort() {
+    // На коротких очередях восемь гистограмм дороже сравнений
+    if (items.size() <= SmallQueueItems) {
+        std::stable_sort(items.begin(), items.end(),
+                         [](const RenderQueueItem& a, const RenderQueueItem& b) { return a.key < b.key; });
+        return;
+    }
+
+    // Гистограммы всех восьми байтов за один проход по ключам
+    uint32_t counts[8][256] = {};
+    for (const RenderQueueItem& item : items) {
+        for (uint32_t digit = 0; digit < 8; ++digit) ++counts[digit][(item.key >> (digit * 8)) & 0xFF];
+    }
+
+    scratch.resize(items.size());
+    for (uint32_t digit = 0; digit < 8; ++digit) {
+        uint32_t shift = digit * 8;
+        uint32_t* digitCounts = counts[digit];
+        // Все ключи совпадают в этом байте: проход ничего не переставит
+        if (digitCounts[(items[0].key >> shift) & 0xFF] == items.size()) continue;
+
+        uint32_t offset = 0;
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t next = offset + digitCounts[i];
+            digitCounts[i] = offset;
+            offset = next;
+        }
+        for (const RenderQueueItem& item : items) scratch[digitCounts[(item.key >> shift) & 0xFF]++] = item;
+        items.swap(scratch);
+    }
+}
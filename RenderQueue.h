@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Один вызов отрисовки в очереди: object и part толкует тот, кто заполнял очередь (тело и подмеш, группа и подмеш)
+struct RenderQueueItem {
+    uint64_t key;
+    uint32_t object;
+    uint32_t part;
+};
+
+// Очередь отрисовки кадра. Тело заявляется один раз за кадр, его вызовы получают 64-битный ключ
+// (проход, конвейер, текстура, меш, глубина) и сортируются поразрядно, чтобы одинаковое состояние шло подряд,
+// а внутри него - от ближних к дальним. Не зависит от D3D, как и InstanceBatcher.
+class RenderQueue {
+public:
+    // Разряды ключа от старших к младшим
+    static constexpr uint32_t PassBits = 2;
+    static constexpr uint32_t PipelineBits = 6;
+    static constexpr uint32_t TextureBits = 16;
+    static constexpr uint32_t MeshBits = 16;
+    static constexpr uint32_t DepthBits = 24;
+    // До этого размера Sort сортирует сравнениями
+    static constexpr size_t SmallQueueItems = 1536;
+
+    // depth - расстояние вдоль взгляда; отрицательное (за камерой) считается нулём
+    static uint64_t MakeKey(uint32_t pass, uint32_t pipeline, uint32_t texture, uint32_t mesh, float depth);
+
+    // objectCount - верхняя граница номеров, передаваемых в Claim
+    void Begin(size_t objectCount);
+    // true при первой заявке объекта за кадр; повторная отбрасывается и учитывается в GetDeduplicatedCount
+    bool Claim(uint32_t object);
+    // Плотный номер текстуры или меша в пределах кадра для ключа; nullptr - 0
+    uint32_t GetResourceId(const void* resource);
+    // Номер ресурса, уже заявленного через GetResourceId в этом кадре; очередь не меняет, поэтому
+    // вызывается из нескольких потоков. Незаявленный ресурс - 0
+    uint32_t FindResourceId(const void* resource) const;
+    void Add(uint64_t key, uint32_t object, uint32_t part) { items.push_back({ key, object, part }); }
+    // Вызовы, собранные вне очереди (кусками в разных потоках), в конец очереди
+    void Append(const std::vector<RenderQueueItem>& chunk) { items.insert(items.end(), chunk.begin(), chunk.end()); }
+    // Устойчивая поразрядная сортировка по ключу, байт за проход; байты, одинаковые у всех ключей, пропускаются
+    void Sort();
+
+    const std::vector<RenderQueueItem>& GetItems() const { return items; }
+    size_t GetDeduplicatedCount() const { return deduplicatedCount; }
+
+private:
+    std::vector<RenderQueueItem> items;
+    std::vector<RenderQueueItem> scratch;
+    std::vector<uint32_t> claimedFrame; // по объекту: номер кадра последней заявки
+    uint32_t frame = 0;
+    size_t deduplicatedCount = 0;
+    std::unordered_map<const void*, uint32_t> resourceIds;
+};
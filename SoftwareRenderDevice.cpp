@@ -0,0 +1,673 @@
+#include "SoftwareRenderDevice.h"
+#include "InstanceBatcher.h"
+#include "Logger.h"
+#include "VertexQuantizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace {
+    uint32_t PackColor(float r, float g, float b, float a) {
+        auto channel = [](float value) {
+            return static_cast<uint32_t>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+        };
+        return channel(r) | (channel(g) << 8) | (channel(b) << 16) | (channel(a) << 24);
+    }
+
+    float Frac(float value) {
+        return value - std::floor(value);
+    }
+
+    void Normalize3(float v[3]) {
+        float lengthSq = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+        if (lengthSq > 0.0f) {
+            float invLength = 1.0f / std::sqrt(lengthSq);
+            v[0] *= invLength;
+            v[1] *= invLength;
+            v[2] *= invLength;
+        }
+    }
+
+    float Dot3(const float a[3], const float b[3]) {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    // Снап к сетке 1/256 пикселя, как у растеризатора D3D
+    float SnapToSubpixel(float value) {
+        return std::round(value * 256.0f) / 256.0f;
+    }
+
+    // Билинейная выборка с повтором (D3D11_TEXTURE_ADDRESS_WRAP)
+    void SampleBilinear(const std::vector<uint32_t>& texels, uint32_t width, uint32_t height, float u, float v,
+                        float out[4]) {
+        float fx = u * float(width) - 0.5f;
+        float fy = v * float(height) - 0.5f;
+        float floorX = std::floor(fx);
+        float floorY = std::floor(fy);
+        float tx = fx - floorX;
+        float ty = fy - floorY;
+        auto wrap = [](int64_t value, uint32_t size) { return uint32_t(((value % size) + size) % size); };
+        uint32_t xa = wrap(int64_t(floorX), width), xb = wrap(int64_t(floorX) + 1, width);
+        uint32_t ya = wrap(int64_t(floorY), height), yb = wrap(int64_t(floorY) + 1, height);
+        uint32_t corners[4] = { texels[size_t(ya) * width + xa], texels[size_t(ya) * width + xb],
+                                texels[size_t(yb) * width + xa], texels[size_t(yb) * width + xb] };
+        float weights[4] = { (1 - tx) * (1 - ty), tx * (1 - ty), (1 - tx) * ty, tx * ty };
+        for (int c = 0; c < 4; ++c) {
+            float sum = 0.0f;
+            for (int i = 0; i < 4; ++i) sum += weights[i] * float((corners[i] >> (8 * c)) & 0xff);
+            out[c] = sum / 255.0f;
+        }
+    }
+}
+
+SoftwareRenderDevice::SoftwareRenderDevice(uint32_t width, uint32_t height, size_t threadCount)
+    : width(width), height(height), pitch((width + 3) & ~3u), tilesX((width + TileSize - 1) / TileSize),
+      tilesY((height + TileSize - 1) / TileSize), clearColor(0) {
+    colorBuffer.assign(size_t(pitch) * height, 0);
+    depthBuffer.assign(size_t(pitch) * height, 1.0f);
+    tileBins.resize(size_t(tilesX) * tilesY);
+
+    if (threadCount == 0) {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        threadCount = hardware > 0 ? hardware : 1;
+    }
+    for (size_t i = 1; i < threadCount; ++i) {
+        workers.emplace_back(&SoftwareRenderDevice::WorkerLoop, this);
+    }
+    LOG_INFO << "[SoftwareRenderDevice] Создан растеризатор " << width << "x" << height << ", тайлов: "
+           << tileBins.size() << ", потоков: " << threadCount << std::endl;
+}
+
+SoftwareRenderDevice::~SoftwareRenderDevice() {
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (std::thread& worker : workers) worker.join();
+    LOG_INFO << "[SoftwareRenderDevice] Объект SoftwareRenderDevice уничтожен" << std::endl;
+}
+
+bool SoftwareRenderDevice::DoCreateBuffer(RenderBufferId id, RenderBufferType type, RenderBufferUsage usage,
+                                          size_t byteSize, const void* initialData) {
+    Buffer buffer;
+    buffer.type = type;
+    buffer.data.resize(byteSize);
+    if (initialData) std::memcpy(buffer.data.data(), initialData, byteSize);
+
+    std::lock_guard<std::mutex> lock(resourceMutex);
+    buffers[id] = std::move(buffer);
+    return true;
+}
+
+void SoftwareRenderDevice::DoDestroyBuffer(RenderBufferId id) {
+    std::lock_guard<std::mutex> lock(resourceMutex);
+    buffers.erase(id);
+}
+
+bool SoftwareRenderDevice::DoUpdateBuffer(RenderBufferId id, const void* data, size_t byteSize) {
+    std::lock_guard<std::mutex> lock(resourceMutex);
+    auto it = buffers.find(id);
+    if (it == buffers.end() || byteSize > it->second.data.size()) {
+        LOG_ERROR << "[SoftwareRenderDevice] Ошибка: обновление неизвестного буфера или выход за его размер" << std::endl;
+        return false;
+    }
+    std::memcpy(it->second.data.data(), data, byteSize);
+    return true;
+}
+
+bool SoftwareRenderDevice::DoCreateTexture(RenderTextureId id, const RenderTextureLevel* levels, uint32_t levelCount) {
+    auto texture = std::make_shared<Texture>();
+    texture->levels.resize(levelCount);
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        const RenderTextureLevel& source = levels[level];
+        TextureLevel& destination = texture->levels[level];
+        if (!source.pixels || source.width == 0 || source.height == 0) {
+            LOG_ERROR << "[SoftwareRenderDevice] Ошибка: пустой мип-уровень " << level << std::endl;
+            return false;
+        }
+        destination.width = source.width;
+        destination.height = source.height;
+        destination.texels.resize(size_t(source.width) * source.height);
+        for (uint32_t y = 0; y < source.height; ++y) {
+            std::memcpy(&destination.texels[size_t(y) * source.width],
+                        static_cast<const uint8_t*>(source.pixels) + size_t(y) * source.rowPitch, source.width * 4);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(resourceMutex);
+    textures[id] = std::move(texture);
+    return true;
+}
+
+void SoftwareRenderDevice::DoDestroyTexture(RenderTextureId id) {
+    // Кадр в работе держит свою ссылку на текстуру через ShadeParams
+    std::lock_guard<std::mutex> lock(resourceMutex);
+    textures.erase(id);
+}
+
+void SoftwareRenderDevice::DoBeginFrame(const float color[4]) {
+    clearColor = PackColor(color[0], color[1], color[2], color[3]);
+    shades.clear();
+    triangles.clear();
+    for (std::vector<uint32_t>& bin : tileBins) bin.clear();
+}
+
+void SoftwareRenderDevice::DoEndFrame() {
+    RunTiles();
+    lastTriangleCount = triangles.size();
+}
+
+void SoftwareRenderDevice::DoSetVertexBuffer(uint32_t slot, RenderBufferId buffer, uint32_t stride) {
+    state.vertexBuffers[slot] = buffer;
+    state.vertexStrides[slot] = stride;
+}
+
+void SoftwareRenderDevice::DoDrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex) {
+    Draw(indexCount, 1, startIndex, baseVertex, 0);
+}
+
+void SoftwareRenderDevice::DoDrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex,
+                                                  int32_t baseVertex, uint32_t startInstance) {
+    Draw(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+void SoftwareRenderDevice::Draw(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex,
+                                uint32_t startInstance) {
+    if (state.topology != RenderTopology::TriangleList) {
+        if (!lineWarningLogged) {
+            LOG_WARNING << "[SoftwareRenderDevice] Предупреждение: линии не растеризуются, вызов пропущен" << std::endl;
+            lineWarningLogged = true;
+        }
+        return;
+    }
+    bool instanced = IsInstancedPipeline(state.pipeline);
+    bool textured = IsTexturedPipeline(state.pipeline);
+    bool compact = IsCompactPipeline(state.pipeline);
+    size_t vertexSize = VertexQuantizer::GetStride(compact ? VertexFormat::Compact : VertexFormat::Float32);
+
+    std::lock_guard<std::mutex> lock(resourceMutex);
+    auto constantIt = buffers.find(state.constantBuffer);
+    auto vertexIt = buffers.find(state.vertexBuffers[0]);
+    auto indexIt = buffers.find(state.indexBuffer);
+    if (state.pipeline == RenderPipeline::None || constantIt == buffers.end() || vertexIt == buffers.end() ||
+        indexIt == buffers.end() || constantIt->second.data.size() < sizeof(ConstantBufferData)) {
+        LOG_ERROR << "[SoftwareRenderDevice] Ошибка: не привязан конвейер, константный, вершинный или индексный буфер" << std::endl;
+        return;
+    }
+    const std::vector<uint8_t>& indexData = indexIt->second.data;
+    size_t indexSize = GetIndexFormatSize(state.indexFormat);
+    if ((size_t(startIndex) + indexCount) * indexSize > indexData.size()) {
+        LOG_ERROR << "[SoftwareRenderDevice] Ошибка: диапазон индексов выходит за буфер" << std::endl;
+        return;
+    }
+    const uint32_t* indices = nullptr;
+    if (state.indexFormat == RenderIndexFormat::UInt16) {
+        const uint16_t* shortIndices = reinterpret_cast<const uint16_t*>(indexData.data()) + startIndex;
+        widenedIndices.assign(shortIndices, shortIndices + indexCount);
+        indices = widenedIndices.data();
+    } else {
+        indices = reinterpret_cast<const uint32_t*>(indexData.data()) + startIndex;
+    }
+
+    const Buffer* instanceBuffer = nullptr;
+    uint32_t instanceStride = state.vertexStrides[1];
+    if (instanced) {
+        auto instanceIt = buffers.find(state.vertexBuffers[1]);
+        if (instanceIt == buffers.end() || instanceStride < sizeof(InstanceData) ||
+            (size_t(startInstance) + instanceCount) * instanceStride > instanceIt->second.data.size()) {
+            LOG_ERROR << "[SoftwareRenderDevice] Ошибка: буфер экземпляров не привязан или слишком мал" << std::endl;
+            return;
+        }
+        instanceBuffer = &instanceIt->second;
+    }
+
+    // Вершинный шейдер выполняется один раз на вершину из используемого диапазона
+    uint32_t minIndex = indices[0];
+    uint32_t maxIndex = indices[0];
+    for (uint32_t i = 1; i < indexCount; ++i) {
+        minIndex = std::min(minIndex, indices[i]);
+        maxIndex = std::max(maxIndex, indices[i]);
+    }
+    int64_t firstVertex = int64_t(minIndex) + baseVertex;
+    int64_t lastVertex = int64_t(maxIndex) + baseVertex;
+    uint32_t vertexStride = state.vertexStrides[0];
+    const std::vector<uint8_t>& vertexData = vertexIt->second.data;
+    if (firstVertex < 0 || vertexStride < vertexSize || size_t(lastVertex) * vertexStride + vertexSize > vertexData.size()) {
+        LOG_ERROR << "[SoftwareRenderDevice] Ошибка: индексы выходят за вершинный буфер" << std::endl;
+        return;
+    }
+
+    ConstantBufferData constants;
+    std::memcpy(&constants, constantIt->second.data.data(), sizeof(constants));
+    std::shared_ptr<const Texture> texture;
+    if (textured) {
+        auto textureIt = textures.find(state.texture);
+        if (textureIt != textures.end()) texture = textureIt->second;
+    }
+
+    // Матрицы в cbuffer транспонированы под HLSL; mul(v, M) в шейдере - это v * M в DirectXMath
+    DirectX::XMMATRIX cbWorldViewProj = DirectX::XMMatrixTranspose(constants.worldViewProj);
+    DirectX::XMMATRIX cbWorld = DirectX::XMMatrixTranspose(constants.world);
+    VertexQuantization quantization = {
+        { constants.positionOffset.x, constants.positionOffset.y, constants.positionOffset.z },
+        { constants.positionScale.x, constants.positionScale.y, constants.positionScale.z },
+        { constants.texCoordTransform.x, constants.texCoordTransform.y },
+        { constants.texCoordTransform.z, constants.texCoordTransform.w }
+    };
+
+    transformed.resize(size_t(maxIndex - minIndex) + 1);
+    for (uint32_t instance = 0; instance < instanceCount; ++instance) {
+        ShadeParams shade;
+        shade.constants = constants;
+        shade.lightDirection[0] = constants.lightPos.x;
+        shade.lightDirection[1] = constants.lightPos.y;
+        shade.lightDirection[2] = constants.lightPos.z;
+        Normalize3(shade.lightDirection);
+        shade.textured = textured;
+        shade.texture = texture;
+        DirectX::XMMATRIX world = cbWorld;
+        DirectX::XMMATRIX worldViewProj = cbWorldViewProj;
+        if (instanced) {
+            InstanceData data;
+            std::memcpy(&data, instanceBuffer->data.data() + size_t(startInstance + instance) * instanceStride, sizeof(data));
+            // В инстансном пути worldViewProj содержит только viewProj
+            world = DirectX::XMLoadFloat4x4(&data.world);
+            worldViewProj = world * cbWorldViewProj;
+            shade.color = data.color;
+            shade.emissive = DirectX::XMFLOAT3(data.emissive.x, data.emissive.y, data.emissive.z);
+        } else {
+            shade.color = constants.color;
+            shade.emissive = constants.emissiveColor;
+        }
+        uint32_t shadeIndex = static_cast<uint32_t>(shades.size());
+        shades.push_back(std::move(shade));
+
+        for (uint32_t index = minIndex; index <= maxIndex; ++index) {
+            float vertex[VertexQuantizer::FloatsPerVertex];
+            const uint8_t* source = vertexData.data() + size_t(int64_t(index) + baseVertex) * vertexStride;
+            if (compact) {
+                CompactVertex packed;
+                std::memcpy(&packed, source, sizeof(packed));
+                VertexQuantizer::Decode(packed, quantization, vertex);
+            } else {
+                std::memcpy(vertex, source, sizeof(vertex));
+            }
+            DirectX::XMVECTOR position = DirectX::XMVectorSet(vertex[0], vertex[1], vertex[2], 1.0f);
+            DirectX::XMVECTOR normal = DirectX::XMVectorSet(vertex[3], vertex[4], vertex[5], 0.0f);
+
+            ClipVertex& out = transformed[index - minIndex];
+            DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*>(out.position),
+                                   DirectX::XMVector4Transform(position, worldViewProj));
+            DirectX::XMStoreFloat3(reinterpret_cast<DirectX::XMFLOAT3*>(&out.attributes[0]),
+                                   DirectX::XMVector3Normalize(DirectX::XMVector3TransformNormal(normal, world)));
+            out.attributes[3] = vertex[6];
+            out.attributes[4] = vertex[7];
+            DirectX::XMStoreFloat3(reinterpret_cast<DirectX::XMFLOAT3*>(&out.attributes[5]),
+                                   DirectX::XMVector3Transform(position, world));
+        }
+
+        for (uint32_t i = 0; i + 2 < indexCount; i += 3) {
+            ClipAndSetup(transformed[indices[i] - minIndex], transformed[indices[i + 1] - minIndex],
+                         transformed[indices[i + 2] - minIndex], shadeIndex, texture.get());
+        }
+    }
+}
+
+void SoftwareRenderDevice::ClipAndSetup(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2,
+                                        uint32_t shade, const Texture* texture) {
+    const ClipVertex* input[3] = { &v0, &v1, &v2 };
+
+    // Треугольник целиком за одной плоскостью усечённой пирамиды отбрасывается сразу
+    uint32_t outsideAll = 0x3f;
+    uint32_t outsideAny = 0;
+    for (const ClipVertex* vertex : input) {
+        float x = vertex->position[0], y = vertex->position[1], z = vertex->position[2], w = vertex->position[3];
+        uint32_t code = (x < -w ? 1u : 0u) | (x > w ? 2u : 0u) | (y < -w ? 4u : 0u) | (y > w ? 8u : 0u) |
+                        (z < 0.0f ? 16u : 0u) | (z > w ? 32u : 0u);
+        outsideAll &= code;
+        outsideAny |= code;
+    }
+    if (outsideAll) return;
+    if (!(outsideAny & 16u)) {
+        SetupTriangle(v0, v1, v2, shade, texture);
+        return;
+    }
+
+    // Отсечение ближней плоскостью z >= 0; остальные плоскости покрывает ограничение прямоугольника экраном
+    ClipVertex clipped[4];
+    int clippedCount = 0;
+    for (int i = 0; i < 3; ++i) {
+        const ClipVertex& a = *input[i];
+        const ClipVertex& b = *input[(i + 1) % 3];
+        bool aInside = a.position[2] >= 0.0f;
+        bool bInside = b.position[2] >= 0.0f;
+        if (aInside) clipped[clippedCount++] = a;
+        if (aInside != bInside) {
+            float t = a.position[2] / (a.position[2] - b.position[2]);
+            ClipVertex& out = clipped[clippedCount++];
+            for (int c = 0; c < 4; ++c) out.position[c] = a.position[c] + (b.position[c] - a.position[c]) * t;
+            for (int c = 0; c < AttributeCount; ++c) {
+                out.attributes[c] = a.attributes[c] + (b.attributes[c] - a.attributes[c]) * t;
+            }
+        }
+    }
+    for (int i = 1; i + 1 < clippedCount; ++i) {
+        SetupTriangle(clipped[0], clipped[i], clipped[i + 1], shade, texture);
+    }
+}
+
+void SoftwareRenderDevice::SetupTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2,
+                                         uint32_t shade, const Texture* texture) {
+    const ClipVertex* vertices[3] = { &v0, &v1, &v2 };
+    float x[3], y[3], z[3], invW[3];
+    for (int i = 0; i < 3; ++i) {
+        const float* position = vertices[i]->position;
+        if (position[3] <= 1e-6f) return;
+        invW[i] = 1.0f / position[3];
+        x[i] = SnapToSubpixel((position[0] * invW[i] * 0.5f + 0.5f) * width);
+        y[i] = SnapToSubpixel((0.5f - position[1] * invW[i] * 0.5f) * height);
+        z[i] = position[2] * invW[i];
+    }
+
+    // В экранных координатах (y вниз) у лицевых граней по часовой стрелке площадь положительна
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+    if (!(area > 0.0f)) return;
+
+    Triangle triangle;
+    triangle.minX = std::max(0, static_cast<int>(std::floor(std::min({ x[0], x[1], x[2] }))));
+    triangle.minY = std::max(0, static_cast<int>(std::floor(std::min({ y[0], y[1], y[2] }))));
+    triangle.maxX = std::min(static_cast<int>(width) - 1, static_cast<int>(std::ceil(std::max({ x[0], x[1], x[2] }))));
+    triangle.maxY = std::min(static_cast<int>(height) - 1, static_cast<int>(std::ceil(std::max({ y[0], y[1], y[2] }))));
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) return;
+
+    float invArea = 1.0f / area;
+    for (int i = 0; i < 3; ++i) {
+        int j = (i + 1) % 3;
+        int k = (i + 2) % 3;
+        float dx = x[k] - x[j];
+        float dy = y[k] - y[j];
+        triangle.edgeA[i] = -dy;
+        triangle.edgeB[i] = dx;
+        triangle.originX[i] = x[j];
+        triangle.originY[i] = y[j];
+        // Правило верхнего левого ребра D3D для обхода по часовой стрелке
+        triangle.topLeft[i] = dy < 0.0f || (dy == 0.0f && dx > 0.0f);
+        triangle.depth[i] = z[i] * invArea;
+        triangle.invW[i] = invW[i];
+        for (int c = 0; c < AttributeCount; ++c) {
+            triangle.attributes[i][c] = vertices[i]->attributes[c] * invW[i];
+        }
+    }
+
+    // Мип-уровень выбирается на весь треугольник по отношению площади в текселях к площади на экране
+    triangle.mipLevel = 0.0f;
+    if (texture && !texture->levels.empty()) {
+        const TextureLevel& base = texture->levels[0];
+        const float* uv0 = &vertices[0]->attributes[3];
+        const float* uv1 = &vertices[1]->attributes[3];
+        const float* uv2 = &vertices[2]->attributes[3];
+        float texelArea = std::fabs((uv1[0] - uv0[0]) * (uv2[1] - uv0[1]) - (uv1[1] - uv0[1]) * (uv2[0] - uv0[0])) *
+                          float(base.width) * float(base.height);
+        if (texelArea > area) {
+            float maxLevel = float(texture->levels.size() - 1);
+            triangle.mipLevel = std::min(0.5f * std::log2(texelArea / area), maxLevel);
+        }
+    }
+    triangle.shade = shade;
+
+    uint32_t triangleIndex = static_cast<uint32_t>(triangles.size());
+    triangles.push_back(triangle);
+    for (uint32_t tileY = triangle.minY / TileSize; tileY <= uint32_t(triangle.maxY) / TileSize; ++tileY) {
+        for (uint32_t tileX = triangle.minX / TileSize; tileX <= uint32_t(triangle.maxX) / TileSize; ++tileX) {
+            tileBins[size_t(tileY) * tilesX + tileX].push_back(triangleIndex);
+        }
+    }
+}
+
+void SoftwareRenderDevice::RunTiles() {
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        nextTile.store(0, std::memory_order_relaxed);
+        workersActive = workers.size();
+        ++frameGeneration;
+    }
+    workAvailable.notify_all();
+
+    uint32_t tileCount = static_cast<uint32_t>(tileBins.size());
+    for (uint32_t tile; (tile = nextTile.fetch_add(1)) < tileCount;) RasterizeTile(tile);
+
+    std::unique_lock<std::mutex> lock(poolMutex);
+    tilesFinished.wait(lock, [this] { return workersActive == 0; });
+}
+
+void SoftwareRenderDevice::WorkerLoop() {
+    uint64_t seenGeneration = 0;
+    uint32_t tileCount = static_cast<uint32_t>(tileBins.size());
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(poolMutex);
+            workAvailable.wait(lock, [&] { return stopping || frameGeneration != seenGeneration; });
+            if (stopping) return;
+            seenGeneration = frameGeneration;
+        }
+
+        for (uint32_t tile; (tile = nextTile.fetch_add(1)) < tileCount;) RasterizeTile(tile);
+
+        std::lock_guard<std::mutex> lock(poolMutex);
+        if (--workersActive == 0) tilesFinished.notify_all();
+    }
+}
+
+void SoftwareRenderDevice::RasterizeTile(uint32_t tile) {
+    using namespace DirectX;
+
+    uint32_t tileX = tile % tilesX;
+    uint32_t tileY = tile / tilesX;
+    int x0 = static_cast<int>(tileX * TileSize);
+    int y0 = static_cast<int>(tileY * TileSize);
+    int x1 = std::min(x0 + static_cast<int>(TileSize), static_cast<int>(width));
+    int y1 = std::min(y0 + static_cast<int>(TileSize), static_cast<int>(height));
+
+    // Очистка своего тайла; у последнего столбца тайлов заодно чистится выравнивание строки
+    int clearEnd = tileX + 1 == tilesX ? static_cast<int>(pitch) : x1;
+    for (int y = y0; y < y1; ++y) {
+        std::fill(colorBuffer.begin() + size_t(y) * pitch + x0, colorBuffer.begin() + size_t(y) * pitch + clearEnd, clearColor);
+        std::fill(depthBuffer.begin() + size_t(y) * pitch + x0, depthBuffer.begin() + size_t(y) * pitch + clearEnd, 1.0f);
+    }
+
+    const XMVECTOR laneOffsets = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+    const XMVECTOR zero = XMVectorZero();
+    const XMVECTOR tileEnd = XMVectorReplicate(float(x1));
+
+    for (uint32_t triangleIndex : tileBins[tile]) {
+        const Triangle& triangle = triangles[triangleIndex];
+        int startX = std::max(triangle.minX, x0) & ~3;
+        int endX = std::min(triangle.maxX, x1 - 1);
+        int startY = std::max(triangle.minY, y0);
+        int endY = std::min(triangle.maxY, y1 - 1);
+
+        XMVECTOR edgeA[3], topLeft[3];
+        for (int i = 0; i < 3; ++i) {
+            edgeA[i] = XMVectorReplicate(triangle.edgeA[i]);
+            uint32_t mask = triangle.topLeft[i] ? 0xffffffffu : 0u;
+            float maskBits;
+            std::memcpy(&maskBits, &mask, sizeof(mask));
+            topLeft[i] = XMVectorReplicate(maskBits);
+        }
+        const XMVECTOR depth0 = XMVectorReplicate(triangle.depth[0]);
+        const XMVECTOR depth1 = XMVectorReplicate(triangle.depth[1]);
+        const XMVECTOR depth2 = XMVectorReplicate(triangle.depth[2]);
+
+        for (int y = startY; y <= endY; ++y) {
+            float py = float(y) + 0.5f;
+            float* depthRow = &depthBuffer[size_t(y) * pitch];
+            uint32_t* colorRow = &colorBuffer[size_t(y) * pitch];
+
+            // Функции рёбер считаются сразу для четырёх соседних пикселей строки
+            XMVECTOR edgeRow[3];
+            for (int i = 0; i < 3; ++i) {
+                float rowValue = triangle.edgeA[i] * (float(startX) - triangle.originX[i]) +
+                                 triangle.edgeB[i] * (py - triangle.originY[i]);
+                edgeRow[i] = XMVectorMultiplyAdd(edgeA[i], laneOffsets, XMVectorReplicate(rowValue));
+            }
+            const XMVECTOR edgeStep[3] = { XMVectorScale(edgeA[0], 4.0f), XMVectorScale(edgeA[1], 4.0f),
+                                           XMVectorScale(edgeA[2], 4.0f) };
+
+            for (int x = startX; x <= endX; x += 4) {
+                XMVECTOR e0 = edgeRow[0];
+                XMVECTOR e1 = edgeRow[1];
+                XMVECTOR e2 = edgeRow[2];
+                for (int i = 0; i < 3; ++i) edgeRow[i] = XMVectorAdd(edgeRow[i], edgeStep[i]);
+
+                XMVECTOR inside = XMVectorAndInt(
+                    XMVectorSelect(XMVectorGreater(e0, zero), XMVectorGreaterOrEqual(e0, zero), topLeft[0]),
+                    XMVectorSelect(XMVectorGreater(e1, zero), XMVectorGreaterOrEqual(e1, zero), topLeft[1]));
+                inside = XMVectorAndInt(inside,
+                    XMVectorSelect(XMVectorGreater(e2, zero), XMVectorGreaterOrEqual(e2, zero), topLeft[2]));
+                inside = XMVectorAndInt(inside, XMVectorLess(XMVectorAdd(XMVectorReplicate(float(x)), laneOffsets), tileEnd));
+
+                XMVECTOR z = XMVectorMultiplyAdd(e0, depth0, XMVectorMultiplyAdd(e1, depth1, XMVectorMultiply(e2, depth2)));
+                XMVECTOR storedDepth = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(depthRow + x));
+                XMVECTOR pass = XMVectorAndInt(inside, XMVectorLess(z, storedDepth));
+
+                uint32_t passMask[4];
+                XMStoreInt4(passMask, pass);
+                if (!(passMask[0] | passMask[1] | passMask[2] | passMask[3])) continue;
+
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(depthRow + x), XMVectorSelect(storedDepth, z, pass));
+                XMFLOAT4 lane0, lane1, lane2;
+                XMStoreFloat4(&lane0, e0);
+                XMStoreFloat4(&lane1, e1);
+                XMStoreFloat4(&lane2, e2);
+                const float* edges0 = &lane0.x;
+                const float* edges1 = &lane1.x;
+                const float* edges2 = &lane2.x;
+                for (int lane = 0; lane < 4; ++lane) {
+                    if (passMask[lane]) ShadePixel(triangle, edges0[lane], edges1[lane], edges2[lane], colorRow[x + lane]);
+                }
+            }
+        }
+    }
+}
+
+void SoftwareRenderDevice::ShadePixel(const Triangle& triangle, float e0, float e1, float e2, uint32_t& color) const {
+    const ShadeParams& shade = shades[triangle.shade];
+    const ConstantBufferData& cb = shade.constants;
+
+    // Перспективно-корректная интерполяция: 1/площадь сокращается в числителе и знаменателе
+    float w = 1.0f / (e0 * triangle.invW[0] + e1 * triangle.invW[1] + e2 * triangle.invW[2]);
+    float attributes[AttributeCount];
+    for (int c = 0; c < AttributeCount; ++c) {
+        attributes[c] = (e0 * triangle.attributes[0][c] + e1 * triangle.attributes[1][c] +
+                         e2 * triangle.attributes[2][c]) * w;
+    }
+    float normal[3] = { attributes[0], attributes[1], attributes[2] };
+    float u = attributes[3];
+    float v = attributes[4];
+    float worldPos[3] = { attributes[5], attributes[6], attributes[7] };
+
+    // Дальше построчно повторяет PSMainTextured/PSMainColored
+    Normalize3(normal);
+    if (std::fabs(worldPos[1]) < 0.1f) {
+        float noiseX = Frac(std::sin(u * 123.45f) * 43758.5453f);
+        float noiseY = Frac(std::sin(v * 123.45f) * 43758.5453f);
+        normal[0] += noiseX * 0.1f;
+        normal[2] += noiseY * 0.1f;
+        Normalize3(normal);
+    }
+    const float* lightDirection = shade.lightDirection;
+    float viewDir[3] = { cb.cameraPos.x - worldPos[0], cb.cameraPos.y - worldPos[1], cb.cameraPos.z - worldPos[2] };
+    Normalize3(viewDir);
+    float normalDotLight = Dot3(normal, lightDirection);
+    float diff = std::max(normalDotLight, 0.0f);
+    float reflectDir[3];
+    for (int c = 0; c < 3; ++c) reflectDir[c] = 2.0f * normalDotLight * normal[c] - lightDirection[c];
+    float viewDotReflect = Dot3(viewDir, reflectDir);
+    float spec = viewDotReflect > 0.0f ? std::pow(viewDotReflect, cb.shininess) : 0.0f;
+
+    const float lightColor[3] = { cb.lightColor.x, cb.lightColor.y, cb.lightColor.z };
+    const float materialDiffuse[3] = { cb.materialDiffuse.x, cb.materialDiffuse.y, cb.materialDiffuse.z };
+    const float materialSpecular[3] = { cb.materialSpecular.x, cb.materialSpecular.y, cb.materialSpecular.z };
+    const float emissive[3] = { shade.emissive.x, shade.emissive.y, shade.emissive.z };
+    float lighting[3];
+    for (int c = 0; c < 3; ++c) {
+        float ambient = lightColor[c] * 0.3f;
+        float diffuse = lightColor[c] * (diff * materialDiffuse[c]);
+        float specular = lightColor[c] * (spec * materialSpecular[c]) * 2.0f;
+        lighting[c] = std::min(std::max(ambient + diffuse + specular + emissive[c], 0.0f), 1.0f);
+    }
+
+    float base[4] = { shade.color.x, shade.color.y, shade.color.z, shade.color.w };
+    if (shade.textured) {
+        base[0] = base[1] = base[2] = base[3] = 0.0f;
+        if (shade.texture) {
+            // Трилинейная фильтрация, как D3D11_FILTER_MIN_MAG_MIP_LINEAR
+            const std::vector<TextureLevel>& levels = shade.texture->levels;
+            uint32_t level = static_cast<uint32_t>(triangle.mipLevel);
+            float blend = triangle.mipLevel - float(level);
+            SampleBilinear(levels[level].texels, levels[level].width, levels[level].height, u, v, base);
+            if (blend > 0.0f && level + 1 < levels.size()) {
+                float next[4];
+                SampleBilinear(levels[level + 1].texels, levels[level + 1].width, levels[level + 1].height, u, v, next);
+                for (int c = 0; c < 4; ++c) base[c] += (next[c] - base[c]) * blend;
+            }
+        }
+    }
+    color = PackColor(base[0] * lighting[0], base[1] * lighting[1], base[2] * lighting[2], base[3]);
+}
+
+size_t SoftwareRenderDevice::CountCoveredPixels() const {
+    size_t covered = 0;
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            if (depthBuffer[size_t(y) * pitch + x] < 1.0f) ++covered;
+        }
+    }
+    return covered;
+}
+
+bool SoftwareRenderDevice::SaveImage(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        LOG_ERROR << "[SoftwareRenderDevice] Ошибка: не удалось открыть файл изображения " << path << std::endl;
+        return false;
+    }
+
+    uint32_t rowBytes = (width * 3 + 3) & ~3u;
+    uint32_t imageBytes = rowBytes * height;
+    uint8_t header[54] = {};
+    auto put32 = [&header](int offset, uint32_t value) {
+        for (int i = 0; i < 4; ++i) header[offset + i] = uint8_t(value >> (8 * i));
+    };
+    header[0] = 'B';
+    header[1] = 'M';
+    put32(2, 54 + imageBytes);
+    put32(10, 54);
+    put32(14, 40);
+    put32(18, width);
+    put32(22, height);
+    header[26] = 1;
+    header[28] = 24;
+    put32(34, imageBytes);
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+    // BMP хранит строки снизу вверх в порядке BGR
+    std::vector<uint8_t> row(rowBytes, 0);
+    for (uint32_t y = height; y-- > 0;) {
+        for (uint32_t x = 0; x < width; ++x) {
+            uint32_t pixel = colorBuffer[size_t(y) * pitch + x];
+            row[x * 3 + 0] = uint8_t(pixel >> 16);
+            row[x * 3 + 1] = uint8_t(pixel >> 8);
+            row[x * 3 + 2] = uint8_t(pixel);
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+    if (!file) {
+        LOG_ERROR << "[SoftwareRenderDevice] Ошибка: не удалось записать изображение " << path << std::endl;
+        return false;
+    }
+    LOG_INFO << "[SoftwareRenderDevice] Кадр сохранён в " << path << std::endl;
+    return true;
+}
@@ -0,0 +1,165 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "ConstantBufferData.h"
+#include "RenderDevice.h"
+
+// Растеризатор на CPU: эталонные кадры и замеры на машинах без GPU.
+// Вершины обрабатываются сразу при вызове отрисовки, треугольники раскладываются по тайлам,
+// а в EndFrame тайлы растеризуются параллельно. Освещение повторяет PSMainTextured/PSMainColored из shader.hlsl,
+// состояние конвейера - как у D3D11RenderDevice: отсечение задних (против часовой) граней, тест глубины LESS.
+class SoftwareRenderDevice : public RenderDevice {
+public:
+    static constexpr uint32_t TileSize = 64;
+
+    SoftwareRenderDevice(uint32_t width, uint32_t height, size_t threadCount = 0);
+    ~SoftwareRenderDevice() override;
+    SoftwareRenderDevice(const SoftwareRenderDevice&) = delete;
+    SoftwareRenderDevice& operator=(const SoftwareRenderDevice&) = delete;
+
+    bool SupportsPipeline(RenderPipeline pipeline) const override { return pipeline != RenderPipeline::None; }
+
+    // Последний завершённый кадр в BMP (24 бита)
+    bool SaveImage(const std::string& path) const;
+    // Цвет пикселя последнего кадра в формате RGBA8 (R в младшем байте)
+    uint32_t GetPixel(uint32_t x, uint32_t y) const { return colorBuffer[size_t(y) * pitch + x]; }
+    uint32_t GetWidth() const { return width; }
+    uint32_t GetHeight() const { return height; }
+    size_t GetThreadCount() const { return workers.size() + 1; }
+    size_t GetTriangleCount() const { return lastTriangleCount; } // треугольники, дошедшие до тайлов в последнем кадре
+    size_t CountCoveredPixels() const; // пиксели последнего кадра, прошедшие тест глубины хотя бы раз
+
+protected:
+    bool DoCreateBuffer(RenderBufferId id, RenderBufferType type, RenderBufferUsage usage, size_t byteSize,
+                        const void* initialData) override;
+    void DoDestroyBuffer(RenderBufferId id) override;
+    bool DoUpdateBuffer(RenderBufferId id, const void* data, size_t byteSize) override;
+    bool DoCreateTexture(RenderTextureId id, const RenderTextureLevel* levels, uint32_t levelCount) override;
+    void DoDestroyTexture(RenderTextureId id) override;
+
+    void DoBeginFrame(const float clearColor[4]) override;
+    void DoEndFrame() override;
+
+    void DoSetPipeline(RenderPipeline pipeline) override { state.pipeline = pipeline; }
+    void DoSetConstantBuffer(RenderBufferId buffer) override { state.constantBuffer = buffer; }
+    void DoSetVertexBuffer(uint32_t slot, RenderBufferId buffer, uint32_t stride) override;
+    void DoSetIndexBuffer(RenderBufferId buffer, RenderIndexFormat format) override {
+        state.indexBuffer = buffer;
+        state.indexFormat = format;
+    }
+    void DoSetTopology(RenderTopology topology) override { state.topology = topology; }
+    void DoSetTexture(RenderTextureId texture) override { state.texture = texture; }
+
+    void DoDrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex) override;
+    void DoDrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex,
+                                uint32_t startInstance) override;
+
+private:
+    struct Buffer {
+        RenderBufferType type;
+        std::vector<uint8_t> data;
+    };
+
+    struct TextureLevel {
+        uint32_t width;
+        uint32_t height;
+        std::vector<uint32_t> texels;
+    };
+
+    struct Texture {
+        std::vector<TextureLevel> levels;
+    };
+
+    // Атрибуты PS_INPUT, кроме цвета и подсветки: нормаль, texCoord, worldPos
+    static constexpr int AttributeCount = 8;
+
+    struct ClipVertex {
+        float position[4];
+        float attributes[AttributeCount];
+    };
+
+    // Параметры пиксельного шейдера, общие для треугольников одного тела (одного экземпляра)
+    struct ShadeParams {
+        ConstantBufferData constants;
+        float lightDirection[3];                // normalize(lightDir) из шейдера, один раз на тело
+        DirectX::XMFLOAT4 color;
+        DirectX::XMFLOAT3 emissive;
+        bool textured;                          // PSMainTextured; без привязанной текстуры выборка даёт 0, как в D3D
+        std::shared_ptr<const Texture> texture;
+    };
+
+    // Треугольник после отсечения и перспективного деления, с коэффициентами функций рёбер
+    struct Triangle {
+        // E_i(x, y) = A*(x - originX) + B*(y - originY), пропорциональна барицентрической координате вершины i
+        float edgeA[3], edgeB[3], originX[3], originY[3];
+        bool topLeft[3];
+        float depth[3];                      // z/w вершин, уже умноженные на 1/площадь
+        float invW[3];
+        float attributes[3][AttributeCount]; // атрибуты, делённые на w
+        float mipLevel;
+        uint32_t shade;
+        int minX, minY, maxX, maxY;
+    };
+
+    struct DrawState {
+        RenderPipeline pipeline = RenderPipeline::None;
+        RenderBufferId constantBuffer = InvalidRenderBuffer;
+        RenderBufferId vertexBuffers[MaxVertexSlots] = {};
+        uint32_t vertexStrides[MaxVertexSlots] = {};
+        RenderBufferId indexBuffer = InvalidRenderBuffer;
+        RenderIndexFormat indexFormat = RenderIndexFormat::UInt32;
+        RenderTopology topology = RenderTopology::TriangleList;
+        RenderTextureId texture = InvalidRenderTexture;
+    };
+
+    void Draw(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance);
+    void SetupTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2, uint32_t shade,
+                       const Texture* texture);
+    void ClipAndSetup(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2, uint32_t shade,
+                      const Texture* texture);
+    void RasterizeTile(uint32_t tile);
+    void ShadePixel(const Triangle& triangle, float e0, float e1, float e2, uint32_t& color) const;
+    void WorkerLoop();
+    void RunTiles();
+
+    uint32_t width;
+    uint32_t height;
+    uint32_t pitch; // ширина, выровненная до 4 пикселей для SIMD-строк
+    uint32_t tilesX;
+    uint32_t tilesY;
+    std::vector<uint32_t> colorBuffer;
+    std::vector<float> depthBuffer;
+    uint32_t clearColor;
+
+    DrawState state;
+    std::vector<ShadeParams> shades;
+    std::vector<Triangle> triangles;
+    std::vector<std::vector<uint32_t>> tileBins; // индексы треугольников в порядке отправки
+    std::vector<ClipVertex> transformed;
+    std::vector<uint32_t> widenedIndices; // 16-битные индексы вызова, расширенные до 32 бит
+    size_t lastTriangleCount = 0;
+    bool lineWarningLogged = false;
+
+    // Ресурсы могут создаваться и освобождаться из любого потока, отпустившего последний хэндл
+    mutable std::mutex resourceMutex;
+    std::unordered_map<RenderBufferId, Buffer> buffers;
+    std::unordered_map<RenderTextureId, std::shared_ptr<const Texture>> textures;
+
+    // Пул потоков растеризации: главный поток тоже берёт тайлы
+    std::mutex poolMutex;
+    std::condition_variable workAvailable;
+    std::condition_variable tilesFinished;
+    uint64_t frameGeneration = 0;
+    size_t workersActive = 0;
+    bool stopping = false;
+    std::atomic<uint32_t> nextTile{0};
+    std::vector<std::thread> workers;
+};
@@ -0,0 +1,108 @@
+#include "SpatialHash.h"
+#include <cmath>
+
+namespace {
+    // 21 бит на координату ячейки: ±1M ячеек по каждой оси
+    constexpr uint64_t CoordMask = (1ull << 21) - 1;
+}
+
+SpatialHash::SpatialHash(float size)
+    : cellSize(size), inverseCellSize(1.0f / size), maxRadius(0.0f), objectCount(0) {
+}
+
+int32_t SpatialHash::CellCoord(float value) const {
+    return static_cast<int32_t>(std::floor(value * inverseCellSize));
+}
+
+uint64_t SpatialHash::CellKey(int32_t x, int32_t y, int32_t z) {
+    return (static_cast<uint64_t>(x) & CoordMask) |
+           ((static_cast<uint64_t>(y) & CoordMask) << 21) |
+           ((static_cast<uint64_t>(z) & CoordMask) << 42);
+}
+
+void SpatialHash::AddToCell(uint32_t id, uint64_t key) {
+    std::vector<uint32_t>& cell = cells[key];
+    entries[id].cell = key;
+    entries[id].slot = static_cast<uint32_t>(cell.size());
+    cell.push_back(id);
+}
+
+void SpatialHash::RemoveFromCell(uint32_t id) {
+    auto it = cells.find(entries[id].cell);
+    std::vector<uint32_t>& cell = it->second;
+    // Удаление перестановкой с последним: O(1) без сдвига
+    uint32_t slot = entries[id].slot;
+    uint32_t moved = cell.back();
+    cell[slot] = moved;
+    entries[moved].slot = slot;
+    cell.pop_back();
+    if (cell.empty()) cells.erase(it);
+}
+
+void SpatialHash::Insert(uint32_t id, DirectX::XMFLOAT3 position, float radius) {
+    if (id >= entries.size()) entries.resize(id + 1);
+    if (entries[id].active) {
+        Update(id, position, radius);
+        return;
+    }
+    entries[id].active = true;
+    ++objectCount;
+    if (radius > maxRadius) maxRadius = radius;
+    AddToCell(id, CellKey(CellCoord(position.x), CellCoord(position.y), CellCoord(position.z)));
+}
+
+void SpatialHash::Update(uint32_t id, DirectX::XMFLOAT3 position, float radius) {
+    if (!Contains(id)) {
+        Insert(id, position, radius);
+        return;
+    }
+    if (radius > maxRadius) maxRadius = radius;
+    uint64_t key = CellKey(CellCoord(position.x), CellCoord(position.y), CellCoord(position.z));
+    if (key == entries[id].cell) return;
+    RemoveFromCell(id);
+    AddToCell(id, key);
+}
+
+void SpatialHash::Remove(uint32_t id) {
+    if (!Contains(id)) return;
+    RemoveFromCell(id);
+    entries[id].active = false;
+    --objectCount;
+}
+
+void SpatialHash::Clear() {
+    entries.clear();
+    cells.clear();
+    objectCount = 0;
+    maxRadius = 0.0f;
+}
+
+void SpatialHash::Query(DirectX::XMFLOAT3 center, float radius, std::vector<uint32_t>& candidates) const {
+    candidates.clear();
+    if (objectCount == 0) return;
+
+    float reach = radius + maxRadius;
+    int32_t minX = CellCoord(center.x - reach), maxX = CellCoord(center.x + reach);
+    int32_t minY = CellCoord(center.y - reach), maxY = CellCoord(center.y + reach);
+    int32_t minZ = CellCoord(center.z - reach), maxZ = CellCoord(center.z + reach);
+
+    uint64_t rangeCells = uint64_t(maxX - minX + 1) * uint64_t(maxY - minY + 1) * uint64_t(maxZ - minZ + 1);
+    if (rangeCells > cells.size()) {
+        // Сфера запроса больше заселённой области: дешевле пройти по занятым ячейкам
+        for (const auto& cell : cells) {
+            candidates.insert(candidates.end(), cell.second.begin(), cell.second.end());
+        }
+        return;
+    }
+
+    for (int32_t z = minZ; z <= maxZ; ++z) {
+        for (int32_t y = minY; y <= maxY; ++y) {
+            for (int32_t x = minX; x <= maxX; ++x) {
+                auto it = cells.find(CellKey(x, y, z));
+                if (it != cells.end()) {
+                    candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Равномерная пространственная хеш-сетка для широкой фазы столкновений.
+// Объект хранится в одной ячейке по центру; запрос расширяется на максимальный радиус объектов (loose grid).
+class SpatialHash {
+public:
+    explicit SpatialHash(float cellSize = 2.0f);
+
+    void Insert(uint32_t id, DirectX::XMFLOAT3 position, float radius);
+    void Update(uint32_t id, DirectX::XMFLOAT3 position, float radius);
+    void Remove(uint32_t id);
+    bool Contains(uint32_t id) const { return id < entries.size() && entries[id].active; }
+    void Clear();
+
+    // Кандидаты, чьи ячейки пересекаются со сферой запроса; точную проверку делает вызывающий
+    void Query(DirectX::XMFLOAT3 center, float radius, std::vector<uint32_t>& candidates) const;
+
+    size_t GetObjectCount() const { return objectCount; }
+    size_t GetCellCount() const { return cells.size(); }
+    float GetCellSize() const { return cellSize; }
+
+private:
+    struct Entry {
+        uint64_t cell = 0;
+        uint32_t slot = 0;
+        bool active = false;
+    };
+
+    int32_t CellCoord(float value) const;
+    static uint64_t CellKey(int32_t x, int32_t y, int32_t z);
+    void AddToCell(uint32_t id, uint64_t key);
+    void RemoveFromCell(uint32_t id);
+
+    float cellSize;
+    float inverseCellSize;
+    float maxRadius;
+    size_t objectCount;
+    std::vector<Entry> entries;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> cells;
+};
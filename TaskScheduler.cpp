@@ -0,0 +1,225 @@
+#include "TaskScheduler.h"
+#include "Logger.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <exception>
+
+namespace {
+    // Сколько раз простаивающий поток уступает процессор перед сном: задачи кадра приходят пачками
+    constexpr int SpinCount = 64;
+    // Кусков ParallelFor на поток: запас для перехвата, если куски оказались неравными
+    constexpr size_t ChunksPerThread = 4;
+
+    // Очередь текущего потока, если он рабочий поток этого планировщика
+    thread_local const TaskScheduler* currentScheduler = nullptr;
+    thread_local size_t currentQueue = 0;
+}
+
+TaskGraph::TaskId TaskGraph::AddTask(const char* name, std::function<void()> function) {
+    tasks.emplace_back();
+    Task& task = tasks.back();
+    task.name = name;
+    task.function = std::move(function);
+    return static_cast<TaskId>(tasks.size() - 1);
+}
+
+bool TaskGraph::AddDependency(TaskId before, TaskId after) {
+    if (before >= after || after >= tasks.size()) {
+        LOG_ERROR << "[TaskGraph] Ошибка: задача " << after << " может зависеть только от добавленной раньше, а не от "
+                  << before << std::endl;
+        return false;
+    }
+    tasks[before].successors.push_back(after);
+    ++tasks[after].dependencyCount;
+    return true;
+}
+
+void TaskGraph::RunInOrder() {
+    for (Task& task : tasks) {
+        PROFILE_ZONE(task.name);
+        if (task.function) task.function();
+    }
+}
+
+TaskScheduler::TaskScheduler(size_t threadCount)
+    : queuedJobs(0), sleepingWorkers(0), stolenTasks(0), stopping(false) {
+    if (threadCount == 0) {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        threadCount = hardware > 0 ? hardware : 1;
+    }
+    for (size_t i = 0; i < threadCount; ++i) {
+        queues.push_back(std::make_unique<JobQueue>());
+    }
+    for (size_t i = 1; i < threadCount; ++i) {
+        workers.emplace_back([this, i] { WorkerLoop(i); });
+    }
+    LOG_INFO << "[TaskScheduler] Запущено рабочих потоков: " << workers.size() << std::endl;
+}
+
+TaskScheduler::~TaskScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+size_t TaskScheduler::GetCurrentQueue() const {
+    return currentScheduler == this ? currentQueue : 0;
+}
+
+void TaskScheduler::Push(size_t queue, const Job* jobs, size_t count) {
+    {
+        std::lock_guard<std::mutex> lock(queues[queue]->mutex);
+        queues[queue]->jobs.insert(queues[queue]->jobs.end(), jobs, jobs + count);
+    }
+    queuedJobs.fetch_add(count);
+    // Рабочий поток увеличивает sleepingWorkers до проверки queuedJobs, поэтому хотя бы одна сторона видит другую.
+    // Мьютекс гарантирует, что проверивший и не нашедший задач поток уже ждёт и получит уведомление
+    if (sleepingWorkers.load() > 0) {
+        { std::lock_guard<std::mutex> lock(sleepMutex); }
+        if (count > 1) {
+            workAvailable.notify_all();
+        } else {
+            workAvailable.notify_one();
+        }
+    }
+}
+
+bool TaskScheduler::RunOneJob(size_t queue) {
+    Job job;
+    bool found = false;
+    {
+        JobQueue& own = *queues[queue];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = own.jobs.back();
+            own.jobs.pop_back();
+            found = true;
+        }
+    }
+    for (size_t offset = 1; !found && offset < queues.size(); ++offset) {
+        JobQueue& victim = *queues[(queue + offset) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            job = victim.jobs.front();
+            victim.jobs.pop_front();
+            stolenTasks.fetch_add(1, std::memory_order_relaxed);
+            found = true;
+        }
+    }
+    if (!found) return false;
+
+    queuedJobs.fetch_sub(1);
+    try {
+        job.execute(*this, job);
+    } catch (const std::exception& e) {
+        LOG_ERROR << "[TaskScheduler] Ошибка в задаче: " << e.what() << std::endl;
+    }
+    // Ждущий поток может сразу вернуться и освободить данные задачи, поэтому счётчик уменьшается последним
+    job.pending->fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+void TaskScheduler::Wait(size_t queue, const std::atomic<size_t>& pending) {
+    while (pending.load(std::memory_order_acquire) != 0) {
+        // Пока свои задачи выполняются в других потоках, помогаем с любыми; уступаем процессор, если их нет
+        if (!RunOneJob(queue)) std::this_thread::yield();
+    }
+}
+
+void TaskScheduler::WorkerLoop(size_t queue) {
+    currentScheduler = this;
+    currentQueue = queue;
+    profiler.SetThreadName("TaskWorker");
+
+    while (true) {
+        if (RunOneJob(queue)) continue;
+
+        bool found = false;
+        for (int i = 0; i < SpinCount && !found; ++i) {
+            std::this_thread::yield();
+            found = queuedJobs.load() > 0;
+        }
+        if (found) continue;
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepingWorkers.fetch_add(1);
+        workAvailable.wait(lock, [this] { return stopping || queuedJobs.load() > 0; });
+        sleepingWorkers.fetch_sub(1);
+        if (stopping) return;
+    }
+}
+
+void TaskScheduler::ExecuteGraphTask(TaskScheduler& scheduler, const Job& job) {
+    TaskGraph& graph = *static_cast<TaskGraph*>(job.data);
+    TaskGraph::Task& task = graph.tasks[job.begin];
+    try {
+        PROFILE_ZONE(task.name);
+        if (task.function) task.function();
+    } catch (const std::exception& e) {
+        // Зависимые задачи всё равно запускаются, иначе Run не вернётся
+        LOG_ERROR << "[TaskScheduler] Ошибка в задаче " << task.name << ": " << e.what() << std::endl;
+    }
+
+    // Освободившиеся задачи ставятся в очередь потока, который выполнил последнюю из их зависимостей
+    size_t queue = scheduler.GetCurrentQueue();
+    for (TaskGraph::TaskId successor : task.successors) {
+        if (graph.tasks[successor].remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) continue;
+        Job next = { &ExecuteGraphTask, job.data, successor, successor + 1, job.pending };
+        scheduler.Push(queue, &next, 1);
+    }
+}
+
+void TaskScheduler::ExecuteRange(TaskScheduler&, const Job& job) {
+    (*static_cast<const std::function<void(size_t, size_t)>*>(job.data))(job.begin, job.end);
+}
+
+void TaskScheduler::Run(TaskGraph& graph) {
+    if (graph.tasks.empty()) return;
+
+    std::atomic<size_t> pending(graph.tasks.size());
+    std::vector<Job> ready;
+    for (size_t i = 0; i < graph.tasks.size(); ++i) {
+        TaskGraph::Task& task = graph.tasks[i];
+        task.remaining.store(task.dependencyCount, std::memory_order_relaxed);
+        if (task.dependencyCount == 0) ready.push_back({ &ExecuteGraphTask, &graph, i, i + 1, &pending });
+    }
+
+    size_t queue = GetCurrentQueue();
+    Push(queue, ready.data(), ready.size());
+    Wait(queue, pending);
+}
+
+void TaskScheduler::ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& function) {
+    if (count == 0) return;
+    grain = std::max<size_t>(grain, 1);
+    size_t chunkCount = std::min((count + grain - 1) / grain, queues.size() * ChunksPerThread);
+    if (queues.size() == 1 || chunkCount <= 1) {
+        function(0, count);
+        return;
+    }
+
+    // Куски, кроме первого, уходят в очередь; первый выполняется сразу, остальные заберут другие потоки
+    size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+    std::atomic<size_t> pending(0);
+    std::vector<Job> chunks;
+    for (size_t begin = chunkSize; begin < count; begin += chunkSize) {
+        chunks.push_back({ &ExecuteRange, const_cast<std::function<void(size_t, size_t)>*>(&function), begin,
+                           std::min(begin + chunkSize, count), &pending });
+    }
+    pending.store(chunks.size());
+
+    size_t queue = GetCurrentQueue();
+    Push(queue, chunks.data(), chunks.size());
+    try {
+        function(0, chunkSize);
+    } catch (const std::exception& e) {
+        // Куски в очереди ссылаются на этот кадр стека: выходить до их выполнения нельзя
+        LOG_ERROR << "[TaskScheduler] Ошибка в задаче: " << e.what() << std::endl;
+    }
+    Wait(queue, pending);
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Граф задач кадра: задача запускается, когда выполнены все задачи, от которых она зависит.
+// Граф выполняется TaskScheduler::Run и может выполняться повторно без перестройки
+class TaskGraph {
+public:
+    using TaskId = uint32_t;
+
+    // name - строковый литерал: под ним задача видна в профайлере
+    TaskId AddTask(const char* name, std::function<void()> function);
+    // after запускается только после before; before должна быть добавлена раньше, поэтому циклов не бывает
+    bool AddDependency(TaskId before, TaskId after);
+    void Clear() { tasks.clear(); }
+    size_t GetTaskCount() const { return tasks.size(); }
+    // Все задачи в вызывающем потоке в порядке добавления - тоже допустимый порядок, раз зависимости добавлены раньше
+    void RunInOrder();
+
+private:
+    friend class TaskScheduler;
+
+    struct Task {
+        const char* name;
+        std::function<void()> function;
+        std::vector<TaskId> successors;
+        uint32_t dependencyCount = 0;
+        std::atomic<uint32_t> remaining{ 0 }; // невыполненные зависимости в текущем Run
+    };
+
+    std::deque<Task> tasks; // deque: адреса задач не меняются при добавлении
+};
+
+// Планировщик с перехватом работы: у каждого потока своя очередь, свои задачи он берёт с конца (последние
+// поставленные, их данные ещё в кэше), а простаивающий поток забирает задачи с начала чужих очередей.
+// Поток, вызвавший Run или ParallelFor, сам выполняет задачи, пока ждёт, поэтому вложенные ParallelFor
+// внутри задач графа не блокируют рабочие потоки. Простаивающие рабочие потоки спят.
+class TaskScheduler {
+public:
+    // threadCount - потоков вместе с вызывающим; 0 - по числу ядер, 1 - всё выполняется в вызывающем потоке
+    explicit TaskScheduler(size_t threadCount = 0);
+    ~TaskScheduler();
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    // Выполняет все задачи графа с учётом зависимостей и возвращается, когда они закончены
+    void Run(TaskGraph& graph);
+    // Делит [0, count) на куски не меньше grain и вызывает function(begin, end) для каждого куска
+    // в разных потоках; меньше grain элементов - один вызов в текущем потоке
+    void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& function);
+
+    size_t GetThreadCount() const { return queues.size(); }
+    // Задачи, выполненные не тем потоком, который их поставил
+    size_t GetStolenTaskCount() const { return stolenTasks.load(std::memory_order_relaxed); }
+
+private:
+    struct Job {
+        void (*execute)(TaskScheduler& scheduler, const Job& job);
+        void* data;
+        size_t begin;
+        size_t end;
+        std::atomic<size_t>* pending; // уменьшается после выполнения
+    };
+    struct JobQueue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    static void ExecuteGraphTask(TaskScheduler& scheduler, const Job& job);
+    static void ExecuteRange(TaskScheduler& scheduler, const Job& job);
+
+    size_t GetCurrentQueue() const;
+    void Push(size_t queue, const Job* jobs, size_t count);
+    bool RunOneJob(size_t queue);
+    void Wait(size_t queue, const std::atomic<size_t>& pending);
+    void WorkerLoop(size_t queue);
+
+    std::vector<std::unique_ptr<JobQueue>> queues; // 0 - потоки вне планировщика
+    std::vector<std::thread> workers;
+    std::atomic<size_t> queuedJobs;
+    std::atomic<size_t> sleepingWorkers;
+    std::atomic<size_t> stolenTasks;
+    std::mutex sleepMutex;
+    std::condition_variable workAvailable;
+    bool stopping;
+};
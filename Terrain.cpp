@@ -0,0 +1,321 @@
+#include "Terrain.h"
+#include "ConstantBufferData.h"
+#include "Logger.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+    constexpr float TileSize = Terrain::TileSize;
+    constexpr uint32_t RingsPerLod = 2; // колец тайлов на один уровень детализации
+    constexpr size_t DefaultMemoryBudget = 24 * 1024 * 1024;
+    constexpr uint64_t TileRetryDelay = 30; // кадров до первого повтора тайла, который не удалось создать
+
+    uint32_t Ring(int32_t dx, int32_t dz) {
+        return static_cast<uint32_t>(std::max(std::abs(dx), std::abs(dz)));
+    }
+}
+
+Terrain::Terrain(RenderDevice& device, AssetLoader& assetLoader, const TerrainHeightfield& heightfield)
+    : device(device), assetLoader(assetLoader), heightfield(heightfield), buildState(std::make_shared<BuildState>()),
+      indexBuffer(InvalidRenderBuffer), lodRanges(), focusX(0), focusZ(0), viewRadius(0),
+      memoryBudget(DefaultMemoryBudget), maxPendingTiles(8), builtTileCount(0), evictedTileCount(0),
+      missingTileCount(0), failedTileCount(0), updateCount(0), touchedTileCount(0), budgetWarningLogged(false),
+      drawnTileCount(0) {
+    buildState->owner = this;
+    SetViewRadius(8);
+    LOG_INFO << "[Terrain] Создан объект Terrain" << std::endl;
+}
+
+Terrain::~Terrain() {
+    // Рабочие потоки могли ещё строить тайлы; выгрузка, оставшаяся в очереди, увидит owner == nullptr
+    assetLoader.Flush();
+    buildState->owner = nullptr;
+    for (auto& entry : tiles) device.DestroyBuffer(entry.second.vertexBuffer);
+    device.DestroyBuffer(indexBuffer);
+    LOG_INFO << "[Terrain] Объект Terrain уничтожен" << std::endl;
+}
+
+bool Terrain::Initialize() {
+    // Сетка у всех тайлов одна, поэтому индексы всех уровней и вариантов сшивки лежат в одном буфере
+    std::vector<uint16_t> indices;
+    std::vector<uint16_t> variant;
+    for (uint32_t lod = 0; lod < LodCount; ++lod) {
+        for (uint32_t mask = 0; mask < 16; ++mask) {
+            // У самого грубого уровня нет более грубых соседей
+            if (lod + 1 == LodCount && mask != 0) {
+                lodRanges[lod][mask] = lodRanges[lod][0];
+                continue;
+            }
+            BuildLodIndices(lod, mask, variant);
+            lodRanges[lod][mask] = { static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(variant.size()) };
+            indices.insert(indices.end(), variant.begin(), variant.end());
+        }
+    }
+    indexBuffer = device.CreateBuffer(RenderBufferType::Index, RenderBufferUsage::Immutable,
+                                      indices.size() * sizeof(uint16_t), indices.data());
+    if (indexBuffer == InvalidRenderBuffer) {
+        LOG_ERROR << "[Terrain] Ошибка: не удалось создать индексный буфер" << std::endl;
+        return false;
+    }
+    LOG_INFO << "[Terrain] Индексный буфер создан, индексов: " << indices.size() << std::endl;
+    return true;
+}
+
+void Terrain::SetViewRadius(uint32_t tiles) {
+    viewRadius = tiles;
+    // Заказ идёт на кольцо дальше видимости, чтобы тайл успел построиться до появления на экране
+    int32_t radius = static_cast<int32_t>(viewRadius + 1);
+    ringOffsets.clear();
+    for (int32_t dz = -radius; dz <= radius; ++dz) {
+        for (int32_t dx = -radius; dx <= radius; ++dx) ringOffsets.push_back({ dx, dz });
+    }
+    std::stable_sort(ringOffsets.begin(), ringOffsets.end(), [](const TileOffset& a, const TileOffset& b) {
+        return Ring(a.x, a.z) < Ring(b.x, b.z);
+    });
+}
+
+uint64_t Terrain::TileKey(int32_t x, int32_t z) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(z);
+}
+
+uint32_t Terrain::GetRingLod(uint32_t ring) {
+    return std::min(LodCount - 1, ring / RingsPerLod);
+}
+
+void Terrain::Update(DirectX::XMFLOAT3 focus) {
+    PROFILE_ZONE("Terrain::Update");
+    int32_t previousX = focusX, previousZ = focusZ;
+    focusX = static_cast<int32_t>(std::floor(focus.x / TileSize));
+    focusZ = static_cast<int32_t>(std::floor(focus.z / TileSize));
+    ++updateCount;
+    if ((focusX != previousX || focusZ != previousZ) && !failedTiles.empty()) ForgetDistantFailures();
+
+    // Нужные тайлы переносятся в начало LRU; всё, что осталось позади них, можно вытеснять
+    visibleTiles.clear();
+    missingTileCount = 0;
+    failedTileCount = 0;
+    touchedTileCount = 0;
+    for (const TileOffset& offset : ringOffsets) {
+        int32_t x = focusX + offset.x, z = focusZ + offset.z;
+        bool visible = Ring(offset.x, offset.z) <= viewRadius;
+        uint64_t key = TileKey(x, z);
+        auto found = tiles.find(key);
+        if (found != tiles.end()) {
+            lru.splice(lru.begin(), lru, found->second.lruPosition);
+            ++touchedTileCount;
+            if (visible) visibleTiles.push_back(key);
+            continue;
+        }
+        if (visible) ++missingTileCount;
+        // Тайл с ошибкой не заказывается каждый кадр заново
+        auto failed = failedTiles.find(key);
+        if (failed != failedTiles.end() && updateCount < failed->second.retryUpdate) {
+            if (visible) ++failedTileCount;
+            continue;
+        }
+        // Кольца идут от ближних к дальним, поэтому при полной очереди ждут только дальние тайлы
+        if (pendingTiles.size() < maxPendingTiles && !pendingTiles.count(key)) RequestTile(x, z);
+    }
+    EvictOverBudget();
+}
+
+void Terrain::RequestTile(int32_t x, int32_t z) {
+    pendingTiles.insert(TileKey(x, z));
+    auto build = std::make_shared<TileBuild>();
+    build->x = x;
+    build->z = z;
+    std::shared_ptr<BuildState> state = buildState;
+    const TerrainHeightfield* field = &heightfield;
+    assetLoader.Submit(
+        [build, field]() -> size_t {
+            PROFILE_ZONE("Terrain::BuildTile");
+            BuildTileVertices(*field, build->x, build->z, build->vertices, build->minHeight, build->maxHeight);
+            return build->vertices.size() * sizeof(float);
+        },
+        [state, build]() {
+            if (state->owner) state->owner->FinishTile(*build);
+        });
+}
+
+void Terrain::FinishTile(const TileBuild& build) {
+    uint64_t key = TileKey(build.x, build.z);
+    pendingTiles.erase(key);
+    if (tiles.count(key)) return;
+
+    Tile tile;
+    tile.x = build.x;
+    tile.z = build.z;
+    tile.vertexBuffer = device.CreateBuffer(RenderBufferType::Vertex, RenderBufferUsage::Immutable,
+                                            build.vertices.size() * sizeof(float), build.vertices.data());
+    if (tile.vertexBuffer == InvalidRenderBuffer) {
+        TileFailure& failure = failedTiles[key];
+        ++failure.failures;
+        if (failure.failures >= MaxTileFailures) {
+            failure.retryUpdate = UINT64_MAX;
+            LOG_ERROR << "[Terrain] Ошибка: не удалось создать вершинный буфер тайла " << build.x << ", " << build.z
+                      << ", попыток: " << failure.failures << ", тайл больше не заказывается" << std::endl;
+        } else {
+            uint64_t delay = TileRetryDelay << (failure.failures - 1);
+            failure.retryUpdate = updateCount + delay;
+            LOG_ERROR << "[Terrain] Ошибка: не удалось создать вершинный буфер тайла " << build.x << ", " << build.z
+                      << ", повтор через " << delay << " кадров" << std::endl;
+        }
+        return;
+    }
+    if (!failedTiles.empty()) failedTiles.erase(key);
+    float halfHeight = (build.maxHeight - build.minHeight) * 0.5f;
+    tile.boundsCenter = DirectX::XMFLOAT3((build.x + 0.5f) * TileSize, build.minHeight + halfHeight,
+                                          (build.z + 0.5f) * TileSize);
+    tile.boundsRadius = std::sqrt(TileSize * TileSize * 0.5f + halfHeight * halfHeight);
+
+    // Тайл, который фокус уже покинул, сразу становится первым кандидатом на вытеснение
+    bool wanted = Ring(build.x - focusX, build.z - focusZ) <= viewRadius + 1;
+    tile.lruPosition = wanted ? lru.insert(lru.begin(), key) : lru.insert(lru.end(), key);
+    if (wanted) ++touchedTileCount;
+    tiles.emplace(key, tile);
+    ++builtTileCount;
+    EvictOverBudget();
+}
+
+void Terrain::EvictOverBudget() {
+    while (GetResidentBytes() > memoryBudget && tiles.size() > touchedTileCount) {
+        uint64_t key = lru.back();
+        lru.pop_back();
+        auto found = tiles.find(key);
+        device.DestroyBuffer(found->second.vertexBuffer);
+        tiles.erase(found);
+        ++evictedTileCount;
+    }
+    if (GetResidentBytes() > memoryBudget && !budgetWarningLogged) {
+        budgetWarningLogged = true;
+        LOG_WARNING << "[Terrain] Тайлы радиуса видимости не помещаются в бюджет " << memoryBudget
+                    << " байт, занято " << GetResidentBytes() << std::endl;
+    }
+}
+
+void Terrain::ForgetDistantFailures() {
+    // Тайл, покинувший радиус заказа, при возвращении получает попытки заново
+    for (auto it = failedTiles.begin(); it != failedTiles.end();) {
+        int32_t x = static_cast<int32_t>(static_cast<uint32_t>(it->first >> 32));
+        int32_t z = static_cast<int32_t>(static_cast<uint32_t>(it->first));
+        if (Ring(x - focusX, z - focusZ) > viewRadius + 1) it = failedTiles.erase(it);
+        else ++it;
+    }
+}
+
+uint32_t Terrain::GetStitchMask(int32_t x, int32_t z) const {
+    uint32_t lod = GetRingLod(Ring(x - focusX, z - focusZ));
+    uint32_t mask = 0;
+    if (GetRingLod(Ring(x - 1 - focusX, z - focusZ)) > lod) mask |= StitchNegX;
+    if (GetRingLod(Ring(x + 1 - focusX, z - focusZ)) > lod) mask |= StitchPosX;
+    if (GetRingLod(Ring(x - focusX, z - 1 - focusZ)) > lod) mask |= StitchNegZ;
+    if (GetRingLod(Ring(x - focusX, z + 1 - focusZ)) > lod) mask |= StitchPosZ;
+    return mask;
+}
+
+void Terrain::BuildTileVertices(const TerrainHeightfield& heightfield, int32_t tileX, int32_t tileZ,
+                                std::vector<float>& vertices, float& minHeight, float& maxHeight) {
+    vertices.resize(TileVertexCount * 8);
+    minHeight = 1e30f;
+    maxHeight = -1e30f;
+    for (uint32_t j = 0; j <= TileCells; ++j) {
+        for (uint32_t i = 0; i <= TileCells; ++i) {
+            // Мировые координаты из целого номера вершины: на общем ребре соседи получают одинаковые высоты и нормали
+            float worldX = static_cast<float>(static_cast<int64_t>(tileX) * TileCells + i) * CellSize;
+            float worldZ = static_cast<float>(static_cast<int64_t>(tileZ) * TileCells + j) * CellSize;
+            float height = heightfield.GetHeight(worldX, worldZ);
+            DirectX::XMFLOAT3 normal = heightfield.GetNormal(worldX, worldZ, CellSize);
+            float* vertex = &vertices[(j * (TileCells + 1) + i) * 8];
+            vertex[0] = i * CellSize;
+            vertex[1] = height;
+            vertex[2] = j * CellSize;
+            vertex[3] = normal.x;
+            vertex[4] = normal.y;
+            vertex[5] = normal.z;
+            vertex[6] = static_cast<float>(i) / TileCells;
+            vertex[7] = static_cast<float>(j) / TileCells;
+            minHeight = std::min(minHeight, height);
+            maxHeight = std::max(maxHeight, height);
+        }
+    }
+}
+
+void Terrain::BuildLodIndices(uint32_t lod, uint32_t stitchMask, std::vector<uint16_t>& indices) {
+    indices.clear();
+    uint32_t step = 1u << lod;
+    // Вершина посередине ребра соседа стягивается к предыдущей: треугольники у шва превращаются в веер
+    // к вершинам соседа
+    auto vertex = [&](uint32_t i, uint32_t j) {
+        if ((stitchMask & StitchNegX) && i == 0 && (j / step) % 2) j -= step;
+        if ((stitchMask & StitchPosX) && i == TileCells && (j / step) % 2) j -= step;
+        if ((stitchMask & StitchNegZ) && j == 0 && (i / step) % 2) i -= step;
+        if ((stitchMask & StitchPosZ) && j == TileCells && (i / step) % 2) i -= step;
+        return static_cast<uint16_t>(j * (TileCells + 1) + i);
+    };
+    // Стянутые вершины дают вырожденные треугольники: совпавшие вершины или три точки на одной прямой в углу
+    auto emit = [&](uint16_t a, uint16_t b, uint16_t c) {
+        int32_t side = TileCells + 1;
+        int32_t ax = a % side, az = a / side, bx = b % side, bz = b / side, cx = c % side, cz = c / side;
+        if ((bx - ax) * (cz - az) - (bz - az) * (cx - ax) == 0) return;
+        indices.push_back(a);
+        indices.push_back(b);
+        indices.push_back(c);
+    };
+    for (uint32_t j = 0; j < TileCells; j += step) {
+        for (uint32_t i = 0; i < TileCells; i += step) {
+            uint16_t a = vertex(i, j), b = vertex(i + step, j);
+            uint16_t c = vertex(i, j + step), d = vertex(i + step, j + step);
+            // Обход как у плоскости Ground
+            emit(a, b, c);
+            emit(b, d, c);
+        }
+    }
+}
+
+void Terrain::Draw(RenderDevice& device, RenderBufferId constantBuffer, DirectX::XMMATRIX viewProj,
+                   DirectX::XMFLOAT3 cameraPos) const {
+    drawnTileCount = 0;
+    if (indexBuffer == InvalidRenderBuffer || visibleTiles.empty()) return;
+
+    tileCuller.Begin();
+    cullCandidates.clear();
+    for (uint64_t key : visibleTiles) {
+        auto found = tiles.find(key);
+        if (found == tiles.end()) continue;
+        cullCandidates.push_back(&found->second);
+        tileCuller.Add(found->second.boundsCenter, found->second.boundsRadius);
+    }
+
+    // Освещение и материал как у плоскости Ground; меняется только сдвиг тайла
+    ConstantBufferData cbData{};
+    cbData.color = DirectX::XMFLOAT4(0.0f, 0.392f, 0.0f, 1.0f);
+    cbData.useTexture = 0;
+    cbData.lightPos = DirectX::XMFLOAT3(0.0f, -1.0f, -1.0f);
+    cbData.lightColor = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f);
+    cbData.materialDiffuse = DirectX::XMFLOAT3(0.8f, 0.8f, 0.8f);
+    cbData.materialSpecular = DirectX::XMFLOAT3(0.2f, 0.2f, 0.2f);
+    cbData.shininess = 16.0f;
+    cbData.emissiveColor = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+    cbData.cameraPos = cameraPos;
+    cbData.padding = 0.0f;
+
+    device.SetPipeline(RenderPipeline::Colored);
+    device.SetIndexBuffer(indexBuffer, RenderIndexFormat::UInt16);
+    device.SetTopology(RenderTopology::TriangleList);
+    for (uint32_t candidate : tileCuller.Cull(viewProj)) {
+        const Tile& tile = *cullCandidates[candidate];
+        const TerrainIndexRange& range =
+            lodRanges[GetRingLod(Ring(tile.x - focusX, tile.z - focusZ))][GetStitchMask(tile.x, tile.z)];
+
+        DirectX::XMMATRIX world = DirectX::XMMatrixTranslation(tile.x * TileSize, 0.0f, tile.z * TileSize);
+        cbData.worldViewProj = DirectX::XMMatrixTranspose(world * viewProj);
+        cbData.world = DirectX::XMMatrixTranspose(world);
+        device.UpdateBuffer(constantBuffer, &cbData, sizeof(cbData));
+        device.SetVertexBuffer(0, tile.vertexBuffer, 8 * sizeof(float));
+        device.DrawIndexed(range.indexCount, range.firstIndex, 0);
+        ++drawnTileCount;
+    }
+    LOG_TRACE << "[Terrain] Нарисовано тайлов: " << drawnTileCount << " из " << visibleTiles.size() << std::endl;
+}
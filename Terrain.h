@@ -0,0 +1,145 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "AssetLoader.h"
+#include "FrustumCuller.h"
+#include "GroundSurface.h"
+#include "RenderDevice.h"
+#include "TerrainHeightfield.h"
+
+// Диапазон общего индексного буфера для одного уровня детализации и набора сшитых сторон
+struct TerrainIndexRange {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+};
+
+// Потоковая земля из квадратных тайлов карты высот. Вокруг фокуса (катамари) держатся тайлы в радиусе видимости,
+// недостающие строятся рабочими потоками AssetLoader, лишние остаются в LRU-кэше, пока он укладывается в бюджет
+// памяти. Дальние тайлы рисуются грубее; сторона, граничащая с более грубым соседом, стягивает лишние вершины
+// к его рёбрам, поэтому швы остаются без трещин. Все тайлы делят одну сетку и один индексный буфер.
+class Terrain : public GroundSurface {
+public:
+    static constexpr uint32_t TileCells = 32;     // ячеек по стороне тайла
+    static constexpr float CellSize = 2.0f;       // метров на ячейку
+    static constexpr float TileSize = TileCells * CellSize;
+    static constexpr uint32_t LodCount = 5;       // шаг сетки 1, 2, 4, 8 и 16 ячеек
+    static constexpr uint32_t TileVertexCount = (TileCells + 1) * (TileCells + 1);
+    static constexpr size_t TileBytes = TileVertexCount * 8 * sizeof(float);
+    // Попыток создать буфер тайла, после которых он не заказывается, пока не выйдет из радиуса заказа
+    static constexpr uint32_t MaxTileFailures = 5;
+    // Стороны тайла, соседи по которым на уровень грубее
+    enum StitchSide : uint32_t { StitchNegX = 1, StitchPosX = 2, StitchNegZ = 4, StitchPosZ = 8 };
+
+    Terrain(RenderDevice& device, AssetLoader& assetLoader, const TerrainHeightfield& heightfield);
+    ~Terrain() override;
+    Terrain(const Terrain&) = delete;
+    Terrain& operator=(const Terrain&) = delete;
+
+    bool Initialize();
+    // Вызывается раз в кадр на главном потоке: заказывает тайлы вокруг фокуса и вытесняет старые сверх бюджета
+    void Update(DirectX::XMFLOAT3 focus);
+    void Draw(RenderDevice& device, RenderBufferId constantBuffer, DirectX::XMMATRIX viewProj,
+              DirectX::XMFLOAT3 cameraPos) const override;
+
+    // Радиус видимости в тайлах; на тайл дальше заказывается заранее
+    void SetViewRadius(uint32_t tiles);
+    uint32_t GetViewRadius() const { return viewRadius; }
+    // Бюджет вершинных буферов кэша; нужные в текущем кадре тайлы не вытесняются даже сверх него
+    void SetMemoryBudget(size_t bytes) { memoryBudget = bytes; }
+    size_t GetMemoryBudget() const { return memoryBudget; }
+    void SetMaxPendingTiles(size_t tiles) { maxPendingTiles = tiles ? tiles : 1; }
+
+    size_t GetResidentTileCount() const { return tiles.size(); }
+    size_t GetResidentBytes() const { return tiles.size() * TileBytes; }
+    size_t GetPendingTileCount() const { return pendingTiles.size(); }
+    size_t GetBuiltTileCount() const { return builtTileCount; }
+    size_t GetEvictedTileCount() const { return evictedTileCount; }
+    // Тайлы в радиусе видимости, которых ещё нет в кэше
+    size_t GetMissingTileCount() const { return missingTileCount; }
+    // Недостающие тайлы радиуса видимости, которые после ошибки создания буфера ждут повтора
+    size_t GetFailedTileCount() const { return failedTileCount; }
+    size_t GetLastDrawnTileCount() const { return drawnTileCount; }
+
+    // Уровень детализации тайла в кольце ring вокруг фокуса; у соседей уровни отличаются не больше чем на 1
+    static uint32_t GetRingLod(uint32_t ring);
+    // Вершины тайла (x, z) в его локальных координатах: позиция, нормаль, uv - 8 float на вершину
+    static void BuildTileVertices(const TerrainHeightfield& heightfield, int32_t tileX, int32_t tileZ,
+                                  std::vector<float>& vertices, float& minHeight, float& maxHeight);
+    // Треугольники сетки с шагом 2^lod; на сторонах из stitchMask нечётные по шагу соседа вершины не используются
+    static void BuildLodIndices(uint32_t lod, uint32_t stitchMask, std::vector<uint16_t>& indices);
+
+private:
+    struct Tile {
+        int32_t x;
+        int32_t z;
+        RenderBufferId vertexBuffer;
+        DirectX::XMFLOAT3 boundsCenter; // в мировых координатах
+        float boundsRadius;
+        std::list<uint64_t>::iterator lruPosition;
+    };
+
+    // Результат рабочего потока; переживает Terrain, если выгрузка ещё стоит в очереди AssetLoader
+    struct TileBuild {
+        int32_t x;
+        int32_t z;
+        std::vector<float> vertices;
+        float minHeight;
+        float maxHeight;
+    };
+    struct BuildState {
+        Terrain* owner = nullptr;
+    };
+    struct TileOffset {
+        int32_t x;
+        int32_t z;
+    };
+    // Повтор после ошибки откладывается вдвое дольше с каждой неудачей
+    struct TileFailure {
+        uint32_t failures;
+        uint64_t retryUpdate; // номер Update, с которого тайл снова заказывается
+    };
+
+    static uint64_t TileKey(int32_t x, int32_t z);
+    void RequestTile(int32_t x, int32_t z);
+    void FinishTile(const TileBuild& build);
+    void EvictOverBudget();
+    void ForgetDistantFailures();
+    uint32_t GetStitchMask(int32_t x, int32_t z) const;
+
+    RenderDevice& device;
+    AssetLoader& assetLoader;
+    const TerrainHeightfield& heightfield;
+    std::shared_ptr<BuildState> buildState;
+    RenderBufferId indexBuffer;
+    TerrainIndexRange lodRanges[LodCount][16];
+
+    std::unordered_map<uint64_t, Tile> tiles;
+    std::list<uint64_t> lru; // спереди - использованные последними
+    std::unordered_set<uint64_t> pendingTiles;
+    std::unordered_map<uint64_t, TileFailure> failedTiles;
+    std::vector<TileOffset> ringOffsets;      // смещения тайлов в радиусе заказа, от ближних колец к дальним
+    std::vector<uint64_t> visibleTiles;       // тайлы радиуса видимости в текущем кадре
+    int32_t focusX;
+    int32_t focusZ;
+    uint32_t viewRadius;
+    size_t memoryBudget;
+    size_t maxPendingTiles;
+    size_t builtTileCount;
+    size_t evictedTileCount;
+    size_t missingTileCount;
+    size_t failedTileCount;
+    uint64_t updateCount;
+    size_t touchedTileCount; // нужные тайлы в начале LRU, их не вытесняют
+    bool budgetWarningLogged;
+
+    mutable FrustumCuller tileCuller;
+    mutable std::vector<const Tile*> cullCandidates;
+    mutable size_t drawnTileCount;
+};
@@ -0,0 +1,53 @@
+#include "TerrainHeightfield.h"
+#include <cmath>
+
+namespace {
+    constexpr int OctaveCount = 4;
+
+    // Целочисленный хеш узла решётки в [0, 1)
+    float LatticeValue(int32_t x, int32_t z, uint32_t seed) {
+        uint32_t h = static_cast<uint32_t>(x) * 0x8DA6B343u ^ static_cast<uint32_t>(z) * 0xD8163841u ^ seed * 0xCB1AB31Fu;
+        h ^= h >> 13;
+        h *= 0x5BD1E995u;
+        h ^= h >> 15;
+        return (h & 0xFFFFFFu) / 16777216.0f;
+    }
+
+    float Smooth(float t) { return t * t * (3.0f - 2.0f * t); }
+}
+
+TerrainHeightfield::TerrainHeightfield(uint32_t seed, float amplitude, float featureSize)
+    : seed(seed), amplitude(amplitude), frequency(featureSize > 0.0f ? 1.0f / featureSize : 0.0f) {
+}
+
+float TerrainHeightfield::ValueNoise(float x, float z, uint32_t octaveSeed) const {
+    float fx = std::floor(x), fz = std::floor(z);
+    int32_t ix = static_cast<int32_t>(fx), iz = static_cast<int32_t>(fz);
+    float tx = Smooth(x - fx), tz = Smooth(z - fz);
+    float v00 = LatticeValue(ix, iz, octaveSeed), v10 = LatticeValue(ix + 1, iz, octaveSeed);
+    float v01 = LatticeValue(ix, iz + 1, octaveSeed), v11 = LatticeValue(ix + 1, iz + 1, octaveSeed);
+    float a = v00 + (v10 - v00) * tx;
+    float b = v01 + (v11 - v01) * tx;
+    return (a + (b - a) * tz) * 2.0f - 1.0f;
+}
+
+float TerrainHeightfield::GetHeight(float x, float z) const {
+    if (amplitude == 0.0f) return 0.0f;
+    // Каждая следующая октава вдвое мельче и вдвое слабее; сумма весов нормируется к 1
+    float sum = 0.0f, weight = 1.0f, weights = 0.0f, scale = frequency;
+    for (int octave = 0; octave < OctaveCount; ++octave) {
+        sum += ValueNoise(x * scale, z * scale, seed + octave) * weight;
+        weights += weight;
+        weight *= 0.5f;
+        scale *= 2.0f;
+    }
+    return amplitude * sum / weights;
+}
+
+DirectX::XMFLOAT3 TerrainHeightfield::GetNormal(float x, float z, float step) const {
+    float dx = GetHeight(x + step, z) - GetHeight(x - step, z);
+    float dz = GetHeight(x, z + step) - GetHeight(x, z - step);
+    DirectX::XMFLOAT3 normal;
+    DirectX::XMStoreFloat3(&normal, DirectX::XMVector3Normalize(DirectX::XMVectorSet(-dx, 2.0f * step, -dz, 0.0f)));
+    return normal;
+}
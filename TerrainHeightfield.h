@@ -0,0 +1,23 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+
+// Процедурный рельеф: сумма октав value noise по мировым x и z. Чистая функция координат без состояния,
+// поэтому её одновременно читают симуляция и рабочие потоки, собирающие тайлы земли.
+class TerrainHeightfield {
+public:
+    // amplitude - наибольшее отклонение от нуля, featureSize - размер крупных холмов в метрах
+    explicit TerrainHeightfield(uint32_t seed = 1, float amplitude = 4.0f, float featureSize = 96.0f);
+
+    float GetHeight(float x, float z) const;
+    // Нормаль по центральным разностям с шагом step
+    DirectX::XMFLOAT3 GetNormal(float x, float z, float step) const;
+    float GetAmplitude() const { return amplitude; }
+
+private:
+    float ValueNoise(float x, float z, uint32_t octaveSeed) const;
+
+    uint32_t seed;
+    float amplitude;
+    float frequency;
+};
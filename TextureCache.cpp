@@ -0,0 +1,175 @@
+#include "TextureCache.h"
+#include "Logger.h"
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+#ifdef _WIN32
+#include <DirectXTex.h>
+#endif
+
+TextureCache textureCache;
+
+namespace {
+    // Декодированное изображение RGBA8 со всеми мип-уровнями, готовое к загрузке на устройство
+    struct DecodedTexture {
+        std::vector<uint8_t> pixels;
+        std::vector<RenderTextureLevel> levels;
+        std::vector<size_t> levelOffsets;
+
+        size_t GetByteSize() const { return pixels.size(); }
+    };
+
+    bool Decode(const std::string& texturePath, uint32_t flags, DecodedTexture& decoded) {
+        LOG_DEBUG << "[TextureCache] Начало загрузки текстуры: " << texturePath << std::endl;
+#ifdef _WIN32
+        std::wstring wTexPath(texturePath.begin(), texturePath.end());
+        DirectX::ScratchImage image;
+        HRESULT hr = DirectX::LoadFromWICFile(wTexPath.c_str(), static_cast<DirectX::WIC_FLAGS>(flags), nullptr, image);
+        if (FAILED(hr)) {
+            LOG_ERROR << "[TextureCache] Ошибка: не удалось загрузить текстуру из файла: " << texturePath << std::endl;
+            return false;
+        }
+
+        // Устройство принимает только RGBA8; преобразование идёт здесь, в рабочем потоке
+        if (image.GetMetadata().format != DXGI_FORMAT_R8G8B8A8_UNORM) {
+            DirectX::ScratchImage converted;
+            hr = DirectX::Convert(image.GetImages(), image.GetImageCount(), image.GetMetadata(),
+                                  DXGI_FORMAT_R8G8B8A8_UNORM, DirectX::TEX_FILTER_DEFAULT,
+                                  DirectX::TEX_THRESHOLD_DEFAULT, converted);
+            if (FAILED(hr)) {
+                LOG_ERROR << "[TextureCache] Ошибка: не удалось преобразовать текстуру в RGBA8: " << texturePath << std::endl;
+                return false;
+            }
+            image = std::move(converted);
+        }
+
+        size_t levelCount = image.GetMetadata().mipLevels;
+        decoded.pixels.resize(image.GetPixelsSize());
+        size_t offset = 0;
+        for (size_t level = 0; level < levelCount; ++level) {
+            const DirectX::Image* source = image.GetImage(level, 0, 0);
+            std::memcpy(decoded.pixels.data() + offset, source->pixels, source->slicePitch);
+            decoded.levelOffsets.push_back(offset);
+            decoded.levels.push_back({ nullptr, static_cast<uint32_t>(source->width), static_cast<uint32_t>(source->height),
+                                       static_cast<uint32_t>(source->rowPitch) });
+            offset += source->slicePitch;
+        }
+        decoded.pixels.resize(offset);
+        return true;
+#else
+        LOG_ERROR << "[TextureCache] Ошибка: декодер WIC недоступен на этой платформе: " << texturePath << std::endl;
+        return false;
+#endif
+    }
+
+    RenderTextureId Upload(RenderDevice& device, const std::string& texturePath, DecodedTexture& decoded) {
+        for (size_t level = 0; level < decoded.levels.size(); ++level) {
+            decoded.levels[level].pixels = decoded.pixels.data() + decoded.levelOffsets[level];
+        }
+        RenderTextureId texture = device.CreateTexture(decoded.levels.data(), static_cast<uint32_t>(decoded.levels.size()));
+        if (texture == InvalidRenderTexture) {
+            LOG_ERROR << "[TextureCache] Ошибка: не удалось создать ресурс текстуры: " << texturePath << std::endl;
+            return InvalidRenderTexture;
+        }
+        LOG_INFO << "[TextureCache] Текстура загружена на устройство: " << texturePath << std::endl;
+        return texture;
+    }
+}
+
+Texture::Texture() : device(nullptr), gpuTexture(InvalidRenderTexture), state(AssetState::Pending) {
+}
+
+Texture::~Texture() {
+    if (device) device->DestroyTexture(gpuTexture);
+    LOG_DEBUG << "[TextureCache] Текстура выгружена: " << key << std::endl;
+}
+
+TextureHandle TextureCache::Acquire(RenderDevice& device, const std::string& texturePath, uint32_t flags) {
+    std::string key = MakeKey(texturePath, flags);
+    auto texture = std::make_shared<Texture>();
+    texture->key = key;
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        if (TextureHandle existing = FindShared(key)) return existing;
+        textures[key] = texture;
+    }
+
+    DecodedTexture decoded;
+    texture->device = &device;
+    texture->gpuTexture = Decode(texturePath, flags, decoded) ? Upload(device, texturePath, decoded) : InvalidRenderTexture;
+    texture->state.store(texture->gpuTexture != InvalidRenderTexture ? AssetState::Ready : AssetState::Failed,
+                         std::memory_order_release);
+    return texture;
+}
+
+TextureHandle TextureCache::AcquireAsync(AssetLoader& assetLoader, RenderDevice& device, const std::string& texturePath,
+                                         uint32_t flags) {
+    std::string key = MakeKey(texturePath, flags);
+    auto texture = std::make_shared<Texture>();
+    texture->key = key;
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        if (TextureHandle existing = FindShared(key)) return existing;
+        textures[key] = texture;
+    }
+
+    auto image = std::make_shared<DecodedTexture>();
+    auto decoded = std::make_shared<bool>(false);
+    assetLoader.Submit(
+        [image, decoded, texturePath, flags]() -> size_t {
+            *decoded = Decode(texturePath, flags, *image);
+            return *decoded ? image->GetByteSize() : 0;
+        },
+        [texture, image, decoded, &device, texturePath]() {
+            texture->device = &device;
+            texture->gpuTexture = *decoded ? Upload(device, texturePath, *image) : InvalidRenderTexture;
+            texture->state.store(texture->gpuTexture != InvalidRenderTexture ? AssetState::Ready : AssetState::Failed,
+                                 std::memory_order_release);
+            *image = DecodedTexture();
+        });
+    return texture;
+}
+
+TextureHandle TextureCache::FindShared(const std::string& key) {
+    auto it = textures.find(key);
+    if (it != textures.end()) {
+        if (TextureHandle existing = it->second.lock()) {
+            ++hits;
+            return existing;
+        }
+    }
+    ++misses;
+    return nullptr;
+}
+
+std::string TextureCache::MakeKey(const std::string& texturePath, uint32_t flags) {
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(texturePath, error);
+    std::string resolved = error ? texturePath : canonical.string();
+    return resolved + "|" + std::to_string(static_cast<unsigned long>(flags));
+}
+
+size_t TextureCache::GetHitCount() const {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    return hits;
+}
+
+size_t TextureCache::GetMissCount() const {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    return misses;
+}
+
+size_t TextureCache::GetLiveTextureCount() const {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    size_t live = 0;
+    for (const auto& entry : textures) {
+        if (!entry.second.expired()) ++live;
+    }
+    return live;
+}
+
+void TextureCache::LogStats() const {
+    LOG_INFO << "[TextureCache] Попаданий: " << GetHitCount() << ", промахов: " << GetMissCount()
+           << ", живых текстур: " << GetLiveTextureCount() << std::endl;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "AssetLoader.h"
+#include "RenderDevice.h"
+
+// Загруженная текстура. Ресурс устройства освобождается вместе с последним хэндлом.
+struct Texture {
+    Texture();
+    ~Texture();
+    Texture(const Texture&) = delete;
+    Texture& operator=(const Texture&) = delete;
+
+    bool IsReady() const { return state.load(std::memory_order_acquire) == AssetState::Ready; }
+    AssetState GetState() const { return state.load(std::memory_order_acquire); }
+
+    std::string key;
+    RenderDevice* device;
+    RenderTextureId gpuTexture;
+    std::atomic<AssetState> state;
+};
+
+using TextureHandle = std::shared_ptr<const Texture>;
+
+// Кэш текстур по разрешённому пути и флагам загрузки: каждое изображение декодируется и загружается на GPU один раз.
+// flags - значение DirectX::WIC_FLAGS, передаётся декодеру без изменений.
+class TextureCache {
+public:
+    TextureHandle Acquire(RenderDevice& device, const std::string& texturePath, uint32_t flags = 0);
+    // Декодирование выполняется в фоне, создание ресурса на GPU — в AssetLoader::PumpUploads
+    TextureHandle AcquireAsync(AssetLoader& assetLoader, RenderDevice& device, const std::string& texturePath,
+                               uint32_t flags = 0);
+
+    size_t GetHitCount() const;
+    size_t GetMissCount() const;
+    size_t GetLiveTextureCount() const;
+    void LogStats() const;
+
+private:
+    static std::string MakeKey(const std::string& texturePath, uint32_t flags);
+
+    TextureHandle FindShared(const std::string& key);
+
+    mutable std::mutex cacheMutex;
+    std::unordered_map<std::string, std::weak_ptr<const Texture>> textures;
+    size_t hits = 0;
+    size_t misses = 0;
+};
+
+extern TextureCache textureCache;
@@ -0,0 +1,382 @@
+#include "TransformHierarchy.h"
+#include "TaskScheduler.h"
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <type_traits>
+
+namespace {
+    // Меньше узлов в проходе или уровне - пересчёт в одном потоке: раздача задач дороже
+    constexpr uint32_t ParallelGrain = 1024;
+}
+
+TransformHierarchy::NodeId TransformHierarchy::CreateNode(DirectX::XMFLOAT3 position, DirectX::XMFLOAT4 rotation,
+                                                          float scale) {
+    NodeId node;
+    if (!freeNodes.empty()) {
+        node = freeNodes.back();
+        freeNodes.pop_back();
+    } else {
+        node = static_cast<NodeId>(nodeSlots.size());
+        nodeSlots.push_back(InvalidSlot);
+        firstChildren.push_back(InvalidNode);
+        nextSiblings.push_back(InvalidNode);
+        prevSiblings.push_back(InvalidNode);
+        dirtyNodes.push_back(0);
+    }
+
+    uint32_t slot = static_cast<uint32_t>(slotNodes.size());
+    nodeSlots[node] = slot;
+    slotNodes.push_back(node);
+    localPositions.push_back(position);
+    localRotations.push_back(rotation);
+    localScales.push_back(scale);
+    parentNodes.push_back(InvalidNode);
+    parentSlots.push_back(InvalidSlot);
+    worldPositions.push_back(position);
+    worldRotations.push_back(rotation);
+    worldScales.push_back(scale);
+    worldMatrices.emplace_back();
+    ComposeSlot(slot);
+
+    // Корень добавлен в последний уровень и поднимается в нулевой: по обмену на каждую границу уровней
+    if (ReserveMoves(levelStarts.size() - 1)) MoveToLevel(slot, 0);
+    return node;
+}
+
+void TransformHierarchy::DestroyNode(NodeId node) {
+    if (parentNodes[nodeSlots[node]] != InvalidNode) UnlinkChild(node);
+
+    // Потомки становятся корнями и сохраняют мировую трансформацию
+    while (firstChildren[node] != InvalidNode) {
+        NodeId child = firstChildren[node];
+        UnlinkChild(child);
+        uint32_t slot = nodeSlots[child];
+        parentNodes[slot] = InvalidNode;
+        parentSlots[slot] = InvalidSlot;
+        localPositions[slot] = worldPositions[slot];
+        localRotations[slot] = worldRotations[slot];
+        localScales[slot] = worldScales[slot];
+        RelocateSubtree(child, 0);
+    }
+
+    // Узел спускается в последний уровень, дыру в каждом уровне закрывает его же последний узел;
+    // из последнего уровня узел уходит в конец массива
+    uint32_t slot = nodeSlots[node];
+    uint32_t lastLevel = static_cast<uint32_t>(levelStarts.size() - 1);
+    if (ReserveMoves(lastLevel - GetLevel(slot))) slot = MoveToLevel(slot, lastLevel);
+    SwapSlots(slot, static_cast<uint32_t>(slotNodes.size() - 1));
+
+    slotNodes.pop_back();
+    localPositions.pop_back();
+    localRotations.pop_back();
+    localScales.pop_back();
+    parentNodes.pop_back();
+    parentSlots.pop_back();
+    worldPositions.pop_back();
+    worldRotations.pop_back();
+    worldScales.pop_back();
+    worldMatrices.pop_back();
+    TrimLevels();
+
+    nodeSlots[node] = InvalidSlot;
+    freeNodes.push_back(node);
+}
+
+void TransformHierarchy::SetParent(NodeId child, NodeId parent) {
+    uint32_t childSlot = nodeSlots[child];
+
+    for (NodeId ancestor = parent; ancestor != InvalidNode; ancestor = parentNodes[nodeSlots[ancestor]]) {
+        if (ancestor == child) return; // цикл в иерархии
+    }
+
+    DirectX::XMVECTOR worldPos = DirectX::XMLoadFloat3(&worldPositions[childSlot]);
+    DirectX::XMVECTOR worldRot = DirectX::XMLoadFloat4(&worldRotations[childSlot]);
+    float worldScale = worldScales[childSlot];
+
+    if (parentNodes[childSlot] != InvalidNode) UnlinkChild(child);
+    if (parent != InvalidNode) LinkChild(child, parent);
+    parentNodes[childSlot] = parent;
+    if (parent == InvalidNode) {
+        parentSlots[childSlot] = InvalidSlot;
+        localPositions[childSlot] = worldPositions[childSlot];
+        localRotations[childSlot] = worldRotations[childSlot];
+        localScales[childSlot] = worldScale;
+        RelocateSubtree(child, 0);
+        return;
+    }
+
+    uint32_t parentSlot = nodeSlots[parent];
+    DirectX::XMVECTOR parentPos = DirectX::XMLoadFloat3(&worldPositions[parentSlot]);
+    DirectX::XMVECTOR inverseParentRot = DirectX::XMQuaternionInverse(DirectX::XMLoadFloat4(&worldRotations[parentSlot]));
+    float parentScale = worldScales[parentSlot];
+
+    DirectX::XMVECTOR localPos = DirectX::XMVector3Rotate(DirectX::XMVectorSubtract(worldPos, parentPos), inverseParentRot);
+    DirectX::XMStoreFloat3(&localPositions[childSlot], DirectX::XMVectorScale(localPos, 1.0f / parentScale));
+    DirectX::XMStoreFloat4(&localRotations[childSlot], DirectX::XMQuaternionMultiply(worldRot, inverseParentRot));
+    localScales[childSlot] = worldScale / parentScale;
+    // Мировая трансформация из новой локальной совпадает с прежней лишь с точностью до округления;
+    // пересчёт делает результат тем же, что при полном проходе
+    MarkDirty(child);
+
+    // Узел встаёт на уровень под родителем, его потомки - каждый под своим; прикрепление лежащего мяча
+    // к катамари переносит один слот через одну границу
+    parentSlots[childSlot] = parentSlot;
+    RelocateSubtree(child, GetLevel(parentSlot) + 1);
+}
+
+void TransformHierarchy::LinkChild(NodeId child, NodeId parent) {
+    NodeId next = firstChildren[parent];
+    prevSiblings[child] = InvalidNode;
+    nextSiblings[child] = next;
+    if (next != InvalidNode) prevSiblings[next] = child;
+    firstChildren[parent] = child;
+}
+
+void TransformHierarchy::UnlinkChild(NodeId child) {
+    NodeId prev = prevSiblings[child];
+    NodeId next = nextSiblings[child];
+    if (prev != InvalidNode) {
+        nextSiblings[prev] = next;
+    } else {
+        firstChildren[parentNodes[nodeSlots[child]]] = next;
+    }
+    if (next != InvalidNode) prevSiblings[next] = prev;
+    prevSiblings[child] = InvalidNode;
+    nextSiblings[child] = InvalidNode;
+}
+
+void TransformHierarchy::SwapSlots(uint32_t a, uint32_t b) {
+    if (a == b) return;
+    std::swap(slotNodes[a], slotNodes[b]);
+    std::swap(localPositions[a], localPositions[b]);
+    std::swap(localRotations[a], localRotations[b]);
+    std::swap(localScales[a], localScales[b]);
+    std::swap(parentNodes[a], parentNodes[b]);
+    std::swap(parentSlots[a], parentSlots[b]);
+    std::swap(worldPositions[a], worldPositions[b]);
+    std::swap(worldRotations[a], worldRotations[b]);
+    std::swap(worldScales[a], worldScales[b]);
+    std::swap(worldMatrices[a], worldMatrices[b]);
+    nodeSlots[slotNodes[a]] = a;
+    nodeSlots[slotNodes[b]] = b;
+    for (uint32_t slot : { a, b }) {
+        for (NodeId child = firstChildren[slotNodes[slot]]; child != InvalidNode; child = nextSiblings[child]) {
+            parentSlots[nodeSlots[child]] = slot;
+        }
+    }
+}
+
+uint32_t TransformHierarchy::MoveToLevel(uint32_t slot, uint32_t level) {
+    uint32_t current = GetLevel(slot);
+    // Вниз: обмен с последним слотом уровня, следующий уровень начинается на слот раньше
+    for (; current < level; ++current) {
+        if (current + 1 == levelStarts.size()) levelStarts.push_back(static_cast<uint32_t>(slotNodes.size()));
+        uint32_t last = --levelStarts[current + 1];
+        SwapSlots(slot, last);
+        slot = last;
+    }
+    // Вверх: обмен с первым слотом уровня, уровень начинается на слот позже
+    for (; current > level; --current) {
+        uint32_t first = levelStarts[current]++;
+        SwapSlots(slot, first);
+        slot = first;
+    }
+    return slot;
+}
+
+void TransformHierarchy::RelocateSubtree(NodeId node, uint32_t level) {
+    if (orderDirty) return;
+    uint32_t current = GetLevel(nodeSlots[node]);
+    if (current == level) return;
+
+    subtreeNodes.assign(1, node);
+    for (size_t i = 0; i < subtreeNodes.size(); ++i) {
+        for (NodeId child = firstChildren[subtreeNodes[i]]; child != InvalidNode; child = nextSiblings[child]) {
+            subtreeNodes.push_back(child);
+        }
+    }
+    size_t shift = level > current ? level - current : current - level;
+    if (!ReserveMoves(subtreeNodes.size() * shift)) return;
+    for (NodeId moved : subtreeNodes) {
+        uint32_t slot = nodeSlots[moved];
+        MoveToLevel(slot, GetLevel(slot) + level - current);
+    }
+    TrimLevels();
+}
+
+bool TransformHierarchy::ReserveMoves(size_t moves) {
+    if (orderDirty) return false;
+    // Перестановок за кадр больше, чем узлов (длинная цепочка, перенос большого поддерева) - одна сортировка дешевле
+    if (movesThisFrame + moves > slotNodes.size()) {
+        orderDirty = true;
+        return false;
+    }
+    movesThisFrame += moves;
+    return true;
+}
+
+void TransformHierarchy::TrimLevels() {
+    while (levelStarts.size() > 1 && levelStarts.back() >= slotNodes.size()) levelStarts.pop_back();
+}
+
+void TransformHierarchy::ComposeSlot(uint32_t slot) {
+    uint32_t parentSlot = parentSlots[slot];
+    DirectX::XMVECTOR position = DirectX::XMLoadFloat3(&localPositions[slot]);
+    DirectX::XMVECTOR rotation = DirectX::XMLoadFloat4(&localRotations[slot]);
+    float scale = localScales[slot];
+
+    if (parentSlot != InvalidSlot) {
+        DirectX::XMVECTOR parentRot = DirectX::XMLoadFloat4(&worldRotations[parentSlot]);
+        float parentScale = worldScales[parentSlot];
+        position = DirectX::XMVectorAdd(DirectX::XMLoadFloat3(&worldPositions[parentSlot]),
+                                        DirectX::XMVector3Rotate(DirectX::XMVectorScale(position, parentScale), parentRot));
+        rotation = DirectX::XMQuaternionMultiply(rotation, parentRot);
+        scale *= parentScale;
+    }
+
+    DirectX::XMStoreFloat3(&worldPositions[slot], position);
+    DirectX::XMStoreFloat4(&worldRotations[slot], rotation);
+    worldScales[slot] = scale;
+
+    // scale * rotation * translation собирается напрямую из компонентов
+    DirectX::XMMATRIX world = DirectX::XMMatrixRotationQuaternion(rotation);
+    world.r[0] = DirectX::XMVectorScale(world.r[0], scale);
+    world.r[1] = DirectX::XMVectorScale(world.r[1], scale);
+    world.r[2] = DirectX::XMVectorScale(world.r[2], scale);
+    world.r[3] = DirectX::XMVectorSetW(position, 1.0f);
+    DirectX::XMStoreFloat4x4(&worldMatrices[slot], world);
+}
+
+uint32_t TransformHierarchy::GetLevel(uint32_t slot) const {
+    // Опустевший уровень имеет то же начало, что следующий; берётся последний уровень с началом не позже слота
+    return static_cast<uint32_t>(std::upper_bound(levelStarts.begin(), levelStarts.end(), slot) - levelStarts.begin() - 1);
+}
+
+template <typename Function>
+void TransformHierarchy::ForEachLevelRange(uint32_t begin, uint32_t end, const Function& function) {
+    if (!taskScheduler || end - begin < ParallelGrain) {
+        if (begin < end) function(begin, end);
+        return;
+    }
+    // Уровень равен глубине, поэтому родитель всегда пересчитан раньше: уровни идут по очереди, узлы уровня - вразнобой
+    for (size_t level = 0; level < levelStarts.size(); ++level) {
+        uint32_t levelBegin = std::max(levelStarts[level], begin);
+        uint32_t levelEnd = level + 1 < levelStarts.size() ? std::min(levelStarts[level + 1], end) : end;
+        if (levelBegin >= levelEnd) continue;
+        taskScheduler->ParallelFor(levelEnd - levelBegin, ParallelGrain, [&](size_t rangeBegin, size_t rangeEnd) {
+            function(levelBegin + static_cast<uint32_t>(rangeBegin), levelBegin + static_cast<uint32_t>(rangeEnd));
+        });
+    }
+}
+
+void TransformHierarchy::UpdateWorldTransforms() {
+    if (orderDirty) SortTopologically();
+    movesThisFrame = 0;
+
+    uint32_t count = static_cast<uint32_t>(slotNodes.size());
+    if (!incrementalUpdates) {
+        for (NodeId node : dirtyList) dirtyNodes[node] = 0;
+        dirtyList.clear();
+        ForEachLevelRange(0, count, [this](uint32_t begin, uint32_t end) {
+            for (uint32_t slot = begin; slot < end; ++slot) ComposeSlot(slot);
+        });
+        lastRecomputed = count;
+        return;
+    }
+
+    // Грязные корни из начала массива не зависят от других узлов и пересчитываются первыми.
+    // Остальные помечаются и пересчитываются в проходе по хвосту вместе с потомками пересчитанных узлов
+    changedSlots.resize(count, 0);
+    uint32_t scanStart = levelStarts.size() > 1 ? levelStarts[1] : count;
+    for (NodeId node : dirtyList) {
+        dirtyNodes[node] = 0;
+        uint32_t slot = nodeSlots[node];
+        if (slot == InvalidSlot) continue; // узел удалён после изменения
+        changedSlots[slot] = 1;
+        if (slot < scanStart) changedRoots.push_back(slot);
+    }
+    dirtyList.clear();
+
+    auto composeRoots = [this](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) ComposeSlot(changedRoots[i]);
+    };
+    if (taskScheduler) {
+        taskScheduler->ParallelFor(changedRoots.size(), ParallelGrain, composeRoots);
+    } else {
+        composeRoots(0, changedRoots.size());
+    }
+
+    std::atomic<size_t> recomputed(changedRoots.size());
+    ForEachLevelRange(scanStart, count, [this, &recomputed](uint32_t begin, uint32_t end) {
+        size_t rangeRecomputed = 0;
+        for (uint32_t slot = begin; slot < end; ++slot) {
+            uint32_t parentSlot = parentSlots[slot];
+            if (changedSlots[slot] || (parentSlot != InvalidSlot && changedSlots[parentSlot])) {
+                ComposeSlot(slot);
+                changedSlots[slot] = 1;
+                ++rangeRecomputed;
+            }
+        }
+        recomputed.fetch_add(rangeRecomputed, std::memory_order_relaxed);
+    });
+    std::fill(changedSlots.begin() + scanStart, changedSlots.end(), 0);
+    for (uint32_t slot : changedRoots) changedSlots[slot] = 0;
+    changedRoots.clear();
+    lastRecomputed = recomputed.load(std::memory_order_relaxed);
+}
+
+void TransformHierarchy::SortTopologically() {
+    uint32_t count = static_cast<uint32_t>(slotNodes.size());
+
+    // Глубина каждого узла без рекурсии: поднимаемся до известного предка и размечаем цепочку обратно
+    std::vector<uint32_t> depth(count, InvalidSlot);
+    std::vector<uint32_t> chain;
+    for (uint32_t slot = 0; slot < count; ++slot) {
+        uint32_t current = slot;
+        while (depth[current] == InvalidSlot && parentNodes[current] != InvalidNode) {
+            chain.push_back(current);
+            current = nodeSlots[parentNodes[current]];
+        }
+        uint32_t d = depth[current] == InvalidSlot ? 0 : depth[current];
+        depth[current] = d;
+        while (!chain.empty()) {
+            depth[chain.back()] = ++d;
+            chain.pop_back();
+        }
+    }
+
+    std::vector<uint32_t> order(count);
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&depth](uint32_t a, uint32_t b) { return depth[a] < depth[b]; });
+
+    auto permute = [&order](auto& values) {
+        std::remove_reference_t<decltype(values)> sorted;
+        sorted.reserve(values.size());
+        for (uint32_t slot : order) sorted.push_back(values[slot]);
+        values.swap(sorted);
+    };
+    permute(slotNodes);
+    permute(localPositions);
+    permute(localRotations);
+    permute(localScales);
+    permute(parentNodes);
+    permute(worldPositions);
+    permute(worldRotations);
+    permute(worldScales);
+    permute(worldMatrices);
+
+    for (uint32_t slot = 0; slot < count; ++slot) {
+        nodeSlots[slotNodes[slot]] = slot;
+    }
+    levelStarts.assign(1, 0);
+    for (uint32_t slot = 1; slot < count; ++slot) {
+        if (depth[order[slot]] != depth[order[slot - 1]]) levelStarts.push_back(slot);
+    }
+    parentSlots.assign(count, InvalidSlot);
+    for (uint32_t slot = levelStarts.size() > 1 ? levelStarts[1] : count; slot < count; ++slot) {
+        parentSlots[slot] = nodeSlots[parentNodes[slot]];
+    }
+    orderDirty = false;
+    ++sortCount;
+}
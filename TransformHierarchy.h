@@ -0,0 +1,119 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class TaskScheduler;
+
+// Плоская иерархия трансформаций: структура массивов в топологическом порядке (родитель всегда раньше потомков).
+// Мировые трансформации считаются одним линейным проходом, без рекурсии и без XMMatrixDecompose.
+// Пересчитываются только узлы с изменённой локальной трансформацией и их потомки; неподвижный корень
+// (лежащий мяч) не стоит ничего за кадр. Узлы лежат по уровням глубины; создание, прикрепление и удаление
+// переставляют несколько слотов на границах уровней, а не сортируют весь массив.
+class TransformHierarchy {
+public:
+    using NodeId = uint32_t;
+    static constexpr NodeId InvalidNode = 0xFFFFFFFFu;
+
+    NodeId CreateNode(DirectX::XMFLOAT3 position, DirectX::XMFLOAT4 rotation, float scale);
+    void DestroyNode(NodeId node);
+
+    // Прикрепляет узел к родителю, сохраняя его текущую мировую трансформацию
+    void SetParent(NodeId child, NodeId parent);
+    NodeId GetParent(NodeId node) const { return parentNodes[nodeSlots[node]]; }
+
+    // Сеттеры помечают узел грязным: он и его потомки пересчитаются в следующем UpdateWorldTransforms
+    void SetLocalPosition(NodeId node, DirectX::XMFLOAT3 position) {
+        localPositions[nodeSlots[node]] = position;
+        MarkDirty(node);
+    }
+    void SetLocalRotation(NodeId node, DirectX::XMFLOAT4 rotation) {
+        localRotations[nodeSlots[node]] = rotation;
+        MarkDirty(node);
+    }
+    void SetLocalScale(NodeId node, float scale) {
+        localScales[nodeSlots[node]] = scale;
+        MarkDirty(node);
+    }
+    DirectX::XMFLOAT3 GetLocalPosition(NodeId node) const { return localPositions[nodeSlots[node]]; }
+    DirectX::XMFLOAT4 GetLocalRotation(NodeId node) const { return localRotations[nodeSlots[node]]; }
+    float GetLocalScale(NodeId node) const { return localScales[nodeSlots[node]]; }
+
+    void UpdateWorldTransforms();
+    // false - каждый UpdateWorldTransforms пересчитывает все узлы, как до грязных флагов (для сравнения)
+    void SetIncrementalUpdates(bool enabled) { incrementalUpdates = enabled; }
+    // Узлы, чья мировая трансформация пересчитана и взята из кэша в последнем UpdateWorldTransforms
+    size_t GetLastRecomputedCount() const { return lastRecomputed; }
+    size_t GetLastReusedCount() const { return slotNodes.size() - lastRecomputed; }
+    // Узлы одного уровня глубины не зависят друг от друга и пересчитываются параллельно; nullptr - в одном потоке
+    void SetTaskScheduler(TaskScheduler* scheduler) { taskScheduler = scheduler; }
+
+    DirectX::XMFLOAT3 GetWorldPosition(NodeId node) const { return worldPositions[nodeSlots[node]]; }
+    DirectX::XMFLOAT4 GetWorldRotation(NodeId node) const { return worldRotations[nodeSlots[node]]; }
+    float GetWorldScale(NodeId node) const { return worldScales[nodeSlots[node]]; }
+    DirectX::XMMATRIX GetWorldMatrix(NodeId node) const { return DirectX::XMLoadFloat4x4(&worldMatrices[nodeSlots[node]]); }
+
+    size_t GetNodeCount() const { return slotNodes.size(); }
+    // Полные сортировки порядка: нужны, только если перестановок за кадр больше, чем узлов
+    size_t GetSortCount() const { return sortCount; }
+
+private:
+    static constexpr uint32_t InvalidSlot = 0xFFFFFFFFu;
+
+    void MarkDirty(NodeId node) {
+        if (dirtyNodes[node]) return;
+        dirtyNodes[node] = 1;
+        dirtyList.push_back(node);
+    }
+    void ComposeSlot(uint32_t slot);
+    void SortTopologically();
+    uint32_t GetLevel(uint32_t slot) const;
+    void SwapSlots(uint32_t a, uint32_t b);
+    uint32_t MoveToLevel(uint32_t slot, uint32_t level);
+    void RelocateSubtree(NodeId node, uint32_t level);
+    bool ReserveMoves(size_t moves);
+    void TrimLevels();
+    void LinkChild(NodeId child, NodeId parent);
+    void UnlinkChild(NodeId child);
+    // Вызывает function для [begin, end); с планировщиком - по уровням, куски уровня в разных потоках
+    template <typename Function>
+    void ForEachLevelRange(uint32_t begin, uint32_t end, const Function& function);
+
+    // Локальные трансформации
+    std::vector<DirectX::XMFLOAT3> localPositions;
+    std::vector<DirectX::XMFLOAT4> localRotations;
+    std::vector<float> localScales;
+    std::vector<NodeId> parentNodes;
+    std::vector<uint32_t> parentSlots;
+
+    // Мировые трансформации
+    std::vector<DirectX::XMFLOAT3> worldPositions;
+    std::vector<DirectX::XMFLOAT4> worldRotations;
+    std::vector<float> worldScales;
+    std::vector<DirectX::XMFLOAT4X4> worldMatrices;
+
+    std::vector<NodeId> slotNodes;
+    std::vector<uint32_t> nodeSlots;
+    std::vector<NodeId> freeNodes;
+    // Списки детей по NodeId: перенос слота родителя правит parentSlots только его детей
+    std::vector<NodeId> firstChildren;
+    std::vector<NodeId> nextSiblings;
+    std::vector<NodeId> prevSiblings;
+    std::vector<NodeId> subtreeNodes;
+    size_t movesThisFrame = 0;
+    size_t sortCount = 0;
+    bool orderDirty = false;
+
+    // Грязные флаги: по NodeId, чтобы перестановки слотов их не трогали
+    std::vector<uint8_t> dirtyNodes;
+    std::vector<NodeId> dirtyList;
+    std::vector<uint8_t> changedSlots; // пересчитаны в текущем проходе; потомки смотрят на флаг родителя
+    std::vector<uint32_t> changedRoots;
+    size_t lastRecomputed = 0;
+    bool incrementalUpdates = true;
+
+    // Начала уровней в массиве: уровень узла равен его глубине, все корни в нулевом уровне
+    std::vector<uint32_t> levelStarts = { 0 };
+    TaskScheduler* taskScheduler = nullptr;
+};
@@ -0,0 +1,128 @@
+#include "VertexQuantizer.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    constexpr float UnormMax = 65535.0f;
+    constexpr float SnormMax = 32767.0f;
+
+    uint16_t QuantizeUnorm(float value, float offset, float scale) {
+        if (scale <= 0.0f) return 0;
+        float normalized = std::clamp((value - offset) / scale, 0.0f, 1.0f);
+        return static_cast<uint16_t>(std::lround(normalized * UnormMax));
+    }
+
+    // Правило D3D для SNORM: -32768 и -32767 оба дают -1
+    float DecodeSnorm(int16_t value) {
+        return std::max(value / SnormMax, -1.0f);
+    }
+
+    float SignNotZero(float value) {
+        return value >= 0.0f ? 1.0f : -1.0f;
+    }
+}
+
+size_t VertexQuantizer::GetStride(VertexFormat format) {
+    return format == VertexFormat::Compact ? sizeof(CompactVertex) : FloatsPerVertex * sizeof(float);
+}
+
+VertexQuantization VertexQuantizer::ComputeQuantization(const float* vertices, size_t vertexCount) {
+    VertexQuantization quantization = {};
+    if (vertexCount == 0) return quantization;
+
+    float minimum[5], maximum[5];
+    const int components[5] = { 0, 1, 2, 6, 7 };
+    for (int c = 0; c < 5; ++c) minimum[c] = maximum[c] = vertices[components[c]];
+    for (size_t i = 1; i < vertexCount; ++i) {
+        const float* vertex = vertices + i * FloatsPerVertex;
+        for (int c = 0; c < 5; ++c) {
+            minimum[c] = std::min(minimum[c], vertex[components[c]]);
+            maximum[c] = std::max(maximum[c], vertex[components[c]]);
+        }
+    }
+    for (int c = 0; c < 3; ++c) {
+        quantization.positionOffset[c] = minimum[c];
+        quantization.positionScale[c] = maximum[c] - minimum[c];
+    }
+    for (int c = 0; c < 2; ++c) {
+        quantization.texCoordOffset[c] = minimum[3 + c];
+        quantization.texCoordScale[c] = maximum[3 + c] - minimum[3 + c];
+    }
+    return quantization;
+}
+
+void VertexQuantizer::Encode(const float* vertices, size_t vertexCount, const VertexQuantization& quantization,
+                             std::vector<CompactVertex>& result) {
+    result.resize(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        const float* vertex = vertices + i * FloatsPerVertex;
+        CompactVertex& packed = result[i];
+        for (int c = 0; c < 3; ++c) {
+            packed.position[c] = QuantizeUnorm(vertex[c], quantization.positionOffset[c], quantization.positionScale[c]);
+        }
+        packed.position[3] = 0;
+        EncodeOctahedral(vertex + 3, packed.normal);
+        for (int c = 0; c < 2; ++c) {
+            packed.texCoord[c] = QuantizeUnorm(vertex[6 + c], quantization.texCoordOffset[c], quantization.texCoordScale[c]);
+        }
+    }
+}
+
+void VertexQuantizer::Decode(const CompactVertex& vertex, const VertexQuantization& quantization, float out[FloatsPerVertex]) {
+    for (int c = 0; c < 3; ++c) {
+        out[c] = quantization.positionOffset[c] + (vertex.position[c] / UnormMax) * quantization.positionScale[c];
+    }
+    DecodeOctahedral(vertex.normal, out + 3);
+    for (int c = 0; c < 2; ++c) {
+        out[6 + c] = quantization.texCoordOffset[c] + (vertex.texCoord[c] / UnormMax) * quantization.texCoordScale[c];
+    }
+}
+
+void VertexQuantizer::EncodeOctahedral(const float normal[3], int16_t encoded[2]) {
+    float length = std::fabs(normal[0]) + std::fabs(normal[1]) + std::fabs(normal[2]);
+    if (length <= 0.0f) {
+        encoded[0] = encoded[1] = 0;
+        return;
+    }
+    // Проекция на октаэдр |x| + |y| + |z| = 1; нижняя половина отражается на углы квадрата
+    float x = normal[0] / length;
+    float y = normal[1] / length;
+    if (normal[2] < 0.0f) {
+        float foldedX = (1.0f - std::fabs(y)) * SignNotZero(x);
+        float foldedY = (1.0f - std::fabs(x)) * SignNotZero(y);
+        x = foldedX;
+        y = foldedY;
+    }
+
+    float scaledX = std::clamp(x, -1.0f, 1.0f) * SnormMax;
+    float scaledY = std::clamp(y, -1.0f, 1.0f) * SnormMax;
+    float inverseLength = 1.0f / std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    float bestDot = -2.0f;
+    for (int i = 0; i < 4; ++i) {
+        int16_t candidate[2] = {
+            static_cast<int16_t>((i & 1) ? std::ceil(scaledX) : std::floor(scaledX)),
+            static_cast<int16_t>((i & 2) ? std::ceil(scaledY) : std::floor(scaledY))
+        };
+        float decoded[3];
+        DecodeOctahedral(candidate, decoded);
+        float dot = (decoded[0] * normal[0] + decoded[1] * normal[1] + decoded[2] * normal[2]) * inverseLength;
+        if (dot > bestDot) {
+            bestDot = dot;
+            encoded[0] = candidate[0];
+            encoded[1] = candidate[1];
+        }
+    }
+}
+
+void VertexQuantizer::DecodeOctahedral(const int16_t encoded[2], float normal[3]) {
+    float x = DecodeSnorm(encoded[0]);
+    float y = DecodeSnorm(encoded[1]);
+    float z = 1.0f - std::fabs(x) - std::fabs(y);
+    float fold = std::max(-z, 0.0f);
+    x += x >= 0.0f ? -fold : fold;
+    y += y >= 0.0f ? -fold : fold;
+    float inverseLength = 1.0f / std::sqrt(x * x + y * y + z * z);
+    normal[0] = x * inverseLength;
+    normal[1] = y * inverseLength;
+    normal[2] = z * inverseLength;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Формат вершин в вершинном буфере меша
+enum class VertexFormat {
+    Float32, // 8 float: позиция, нормаль, texCoord - 32 байта
+    Compact  // CompactVertex - 16 байт
+};
+
+// Сжатая вершина, вход VS_COMPACT_INPUT в shader.hlsl.
+// Позиция и texCoord - UNORM16 внутри границ меша, нормаль - октаэдрическая развёртка в SNORM16
+struct CompactVertex {
+    uint16_t position[4]; // w не используется: у DXGI нет трёхкомпонентного 16-битного формата
+    int16_t normal[2];
+    uint16_t texCoord[2];
+};
+
+// Границы меша для восстановления: значение = offset + unorm * scale
+struct VertexQuantization {
+    float positionOffset[3];
+    float positionScale[3];
+    float texCoordOffset[2];
+    float texCoordScale[2];
+};
+
+// Упаковка вершин ModelLoader (8 float) в CompactVertex и обратно.
+// Decode повторяет VSMainCompact, включая правила нормированных форматов D3D
+class VertexQuantizer {
+public:
+    static constexpr size_t FloatsPerVertex = 8;
+
+    static size_t GetStride(VertexFormat format);
+    static VertexQuantization ComputeQuantization(const float* vertices, size_t vertexCount);
+    static void Encode(const float* vertices, size_t vertexCount, const VertexQuantization& quantization,
+                       std::vector<CompactVertex>& result);
+    static void Decode(const CompactVertex& vertex, const VertexQuantization& quantization, float out[FloatsPerVertex]);
+
+    // Из всех соседних узлов SNORM16-решётки выбирается тот, что декодируется ближе всего к исходной нормали
+    static void EncodeOctahedral(const float normal[3], int16_t encoded[2]);
+    static void DecodeOctahedral(const int16_t encoded[2], float normal[3]);
+};
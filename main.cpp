@@ -1,11 +1,19 @@
 #include "Render.h"
-#include "CelestialBody.h"
-#include "Ground.h"
-#include "FollowCamera.h"
+#include "D3D11RenderDevice.h"
+#include "Terrain.h"
+#include "KatamariWorld.h"
 #include <windows.h>
+#include <objbase.h>
 #include <memory>
 #include <vector>
 #include "Logger.h"
+#include "Profiler.h"
+#include "AssetLoader.h"
+#include "MeshRegistry.h"
+#include "PickupSpawner.h"
+#include "PileBaker.h"
+#include "TaskScheduler.h"
+#include "TextureCache.h"
 #include <DirectXMath.h>
 
 int main() {
@@ -18,134 +26,138 @@ int main() {
     ShowWindow(hwnd, SW_SHOW);
     UpdateWindow(hwnd);
 
-    Render render(hwnd);
+    D3D11RenderDevice renderDevice(hwnd);
+    if (!renderDevice.Initialize()) {
+        LOG_ERROR << "[main] Ошибка инициализации устройства D3D11" << std::endl;
+        return -1;
+    }
+    Render render(renderDevice);
     if (!render.Initialize()) {
-        logger << "[main] Ошибка инициализации рендера" << std::endl;
+        LOG_ERROR << "[main] Ошибка инициализации рендера" << std::endl;
+        return -1;
+    }
+
+    // WIC-декодер текстур требует инициализированного COM в каждом рабочем потоке
+    AssetLoader assetLoader(0, [] { CoInitializeEx(nullptr, COINIT_MULTITHREADED); });
+    AssetUploadBudget uploadBudget;
+    uploadBudget.maxMilliseconds = 2.0;
+    uploadBudget.maxBytes = 16 * 1024 * 1024;
+    bool assetsLoaded = false;
+
+    // Земля - потоковые тайлы рельефа вокруг катамари; тела ставятся на тот же рельеф
+    TerrainHeightfield heightfield;
+    Terrain terrain(renderDevice, assetLoader, heightfield);
+    if (!terrain.Initialize()) {
+        LOG_ERROR << "[main] Ошибка инициализации земли" << std::endl;
         return -1;
     }
 
-    std::unique_ptr<Ground> ground = std::make_unique<Ground>(render.GetDevice(), "Textures/ground.obj");
+    KatamariWorld world;
+    world.SetGround(&heightfield);
+    world.AddDefaultKatamari();
+    // Мячи порождаются по seed в регионах вокруг катамари; дальние регионы спят и не стоят ничего за кадр
+    PickupSpawner spawner(world);
+    spawner.Update();
 
-    std::vector<std::unique_ptr<CelestialBody>> bodies;
-    // Katamari (основной объект)
-    bodies.push_back(std::make_unique<CelestialBody>(
-        render.GetDevice(),
-        "Textures/soccer_ball.obj",
-        DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f),
-        DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f),
-        1.0f,
-        true,
-        DirectX::XMFLOAT3(0.5f, 0.5f, 0.5f) // Увеличиваем свечение
-    ));
+    // Тайлы вокруг стартовой точки строятся до первого кадра, дальше подгружаются в фоне.
+    // Тайлы, которые не удалось создать, не держат запуск: их повторяет Terrain::Update в игровом цикле
+    do {
+        terrain.Update(world.GetKatamari()->GetPosition());
+        assetLoader.Flush();
+    } while (terrain.GetMissingTileCount() > terrain.GetFailedTileCount());
 
-    // Дополнительные мячи для налипания
-    bodies.push_back(std::make_unique<CelestialBody>(
-        render.GetDevice(),
-        "Textures/soccer_ball.obj",
-        DirectX::XMFLOAT3(5.0f, 1.0f, 5.0f),
-        DirectX::XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f),
-        0.5f,
-        true,
-        DirectX::XMFLOAT3(0.8f, 0.0f, 0.0f) // Красное свечение
-    ));
-    bodies.push_back(std::make_unique<CelestialBody>(
-        render.GetDevice(),
-        "Textures/soccer_ball.obj",
-        DirectX::XMFLOAT3(-5.0f, 1.0f, -5.0f),
-        DirectX::XMFLOAT4(0.0f, 1.0f, 0.0f, 1.0f),
-        0.5f,
-        true,
-        DirectX::XMFLOAT3(0.0f, 0.8f, 0.0f) // Зеленое свечение
-    ));
-    bodies.push_back(std::make_unique<CelestialBody>(
-        render.GetDevice(),
-        "Textures/soccer_ball.obj",
-        DirectX::XMFLOAT3(3.0f, 1.0f, -3.0f),
-        DirectX::XMFLOAT4(0.0f, 0.0f, 1.0f, 1.0f),
-        0.5f,
-        true,
-        DirectX::XMFLOAT3(0.0f, 0.0f, 0.8f) // Синее свечение
-    ));
-    bodies.push_back(std::make_unique<CelestialBody>(
-        render.GetDevice(),
-        "Textures/soccer_ball.obj",
-        DirectX::XMFLOAT3(-3.0f, 1.0f, 4.0f),
-        DirectX::XMFLOAT4(1.0f, 1.0f, 0.0f, 1.0f),
-        0.5f,
-        true,
-        DirectX::XMFLOAT3(0.5f, 0.5f, 0.0f) // Желтое свечение
-    ));
+    // Меши тел живут на стороне рендера, индекс совпадает с индексом тела в мире
+    std::vector<MeshHandle> bodyMeshes;
+    // Тела, чей меш ещё грузится: после загрузки они получают его BVH и подбираются по форме, а не по сфере
+    std::vector<uint32_t> collisionPending;
+    auto acquireBodyMesh = [&](uint32_t id) {
+        if (id >= bodyMeshes.size()) bodyMeshes.resize(id + 1);
+        const CelestialBody& body = *world.GetBodies()[id];
+        if (body.modelPath.empty()) {
+            LOG_ERROR << "[main] Ошибка: путь к модели тела не указан" << std::endl;
+            bodyMeshes[id] = nullptr;
+            return;
+        }
+        // Импорт модели и её текстуры идёт в фоне; до готовности тело не рисуется.
+        // Вершины тел хранятся сжатыми (16 байт вместо 32)
+        bodyMeshes[id] = meshRegistry.AcquireAsync(assetLoader, renderDevice, body.modelPath, VertexFormat::Compact);
+        collisionPending.push_back(id);
+    };
+    for (uint32_t id = 0; id < world.GetBodies().size(); ++id) {
+        if (world.GetBodies()[id]) acquireBodyMesh(id);
+    }
 
-    DirectX::XMFLOAT3 camPos(0.0f, 5.0f, -10.0f);
-    DirectX::XMFLOAT3 target(0.0f, 0.0f, 0.0f);
-    FollowCamera camera(camPos, target);
+    // Подобранные тела сливаются в куски кучи в фоне: тысяча тел на катамари - несколько вызовов отрисовки
+    PileBaker pileBaker(renderDevice, assetLoader);
+    render.SetPileBaker(&pileBaker);
 
-    CelestialBody* katamari = bodies[0].get();
-    float deltaTime = 1.0f / 60.0f;
-    DirectX::XMVECTOR velocity = DirectX::XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f);
+    // Мировые трансформации и подготовка кадра (отсечение, LOD, очередь отрисовки) делятся между ядрами;
+    // вызовы устройства остаются в главном потоке
+    TaskScheduler scheduler;
+    world.SetTaskScheduler(&scheduler);
+    render.SetTaskScheduler(&scheduler);
 
+    profiler.SetThreadName("Main");
     MSG msg = {};
     while (true) {
         if (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE)) {
             if (msg.message == WM_QUIT) break;
+            PROFILE_ZONE("Window::Messages");
             TranslateMessage(&msg);
             DispatchMessage(&msg);
         } else {
-            if (GetAsyncKeyState('W') & 0x8000) {
-                velocity = DirectX::XMVectorSet(0.0f, 0.0f, 5.0f, 0.0f);
-                DirectX::XMVECTOR deltaRotation = DirectX::XMQuaternionRotationAxis(DirectX::XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f), deltaTime * 2.0f);
-                DirectX::XMVECTOR currentRotation = DirectX::XMLoadFloat4(&katamari->rotation);
-                DirectX::XMStoreFloat4(&katamari->rotation, DirectX::XMQuaternionMultiply(currentRotation, deltaRotation));
+            KatamariInput input;
+            {
+                PROFILE_ZONE("Input");
+                input.forward = (GetAsyncKeyState('W') & 0x8000) != 0;
+                input.backward = (GetAsyncKeyState('S') & 0x8000) != 0;
+                input.left = (GetAsyncKeyState('A') & 0x8000) != 0;
+                input.right = (GetAsyncKeyState('D') & 0x8000) != 0;
             }
-            if (GetAsyncKeyState('S') & 0x8000) {
-                velocity = DirectX::XMVectorSet(0.0f, 0.0f, -5.0f, 0.0f);
-                DirectX::XMVECTOR deltaRotation = DirectX::XMQuaternionRotationAxis(DirectX::XMVectorSet(-1.0f, 0.0f, 0.0f, 0.0f), deltaTime * 2.0f);
-                DirectX::XMVECTOR currentRotation = DirectX::XMLoadFloat4(&katamari->rotation);
-                DirectX::XMStoreFloat4(&katamari->rotation, DirectX::XMQuaternionMultiply(currentRotation, deltaRotation));
-            }
-            if (GetAsyncKeyState('A') & 0x8000) {
-                velocity = DirectX::XMVectorSet(-5.0f, 0.0f, 0.0f, 0.0f);
-                DirectX::XMVECTOR deltaRotation = DirectX::XMQuaternionRotationAxis(DirectX::XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), deltaTime * 2.0f);
-                DirectX::XMVECTOR currentRotation = DirectX::XMLoadFloat4(&katamari->rotation);
-                DirectX::XMStoreFloat4(&katamari->rotation, DirectX::XMQuaternionMultiply(currentRotation, deltaRotation));
-            }
-            if (GetAsyncKeyState('D') & 0x8000) {
-                velocity = DirectX::XMVectorSet(5.0f, 0.0f, 0.0f, 0.0f);
-                DirectX::XMVECTOR deltaRotation = DirectX::XMQuaternionRotationAxis(DirectX::XMVectorSet(0.0f, 0.0f, -1.0f, 0.0f), deltaTime * 2.0f);
-                DirectX::XMVECTOR currentRotation = DirectX::XMLoadFloat4(&katamari->rotation);
-                DirectX::XMStoreFloat4(&katamari->rotation, DirectX::XMQuaternionMultiply(currentRotation, deltaRotation));
-            }
-
-            katamari->UpdatePosition(velocity, deltaTime);
+            world.Step(input);
+            spawner.Update();
+            // Уснувшие регионы освобождают индексы тел раньше, чем проснувшиеся их занимают
+            for (uint32_t id : spawner.GetRemovedBodies()) bodyMeshes[id] = nullptr;
+            for (uint32_t id : spawner.GetSpawnedBodies()) acquireBodyMesh(id);
+            pileBaker.Update(world.GetBodies(), bodyMeshes, world.GetKatamariIndex());
+            terrain.Update(world.GetKatamari()->GetPosition());
 
-            for (auto& obj : bodies) {
-                if (!obj->parent) {
-                    DirectX::XMVECTOR attachmentPoint;
-                    const CelestialBody* collidedBody = katamari->CheckCollision(obj.get(), attachmentPoint);
-                    if (collidedBody) {
-                        logger << "[main] Столкновение обнаружено, прикрепляем объект" << std::endl;
-                        const_cast<CelestialBody*>(katamari)->AttachChild(obj.get());
-                    }
+            assetLoader.PumpUploads(uploadBudget);
+            size_t stillLoading = 0;
+            for (uint32_t id : collisionPending) {
+                // Тело удалили, а индекс мог занять новое: тогда оно уже стоит в списке ещё раз
+                const MeshHandle& mesh = bodyMeshes[id];
+                if (!mesh || mesh->GetState() == AssetState::Failed) continue;
+                if (!mesh->IsReady()) {
+                    collisionPending[stillLoading++] = id;
+                    continue;
                 }
+                if (mesh->collision) world.SetCollisionMesh(id, mesh->collision);
             }
-
-            for (const auto& body : bodies) {
-                body->Update();
+            collisionPending.resize(stillLoading);
+            if (!assetsLoaded && assetLoader.GetPendingCount() == 0) {
+                assetsLoaded = true;
+                meshRegistry.LogStats();
+                textureCache.LogStats();
             }
 
-            camera.Update(katamari->GetPosition(), static_cast<float>(katamari->GetChildren().size()));
-            DirectX::XMMATRIX viewProj = camera.GetViewProjMatrix();
+            FollowCamera& camera = world.GetCamera();
+            DirectX::XMMATRIX viewProj;
+            {
+                PROFILE_ZONE("FollowCamera::GetViewProjMatrix");
+                viewProj = camera.GetViewProjMatrix();
+            }
             DirectX::XMFLOAT3 cameraPos = camera.GetPosition();
 
-            render.RenderScene(bodies, ground.get(), viewProj, cameraPos);
-
-            if (!(GetAsyncKeyState('W') & 0x8000) && !(GetAsyncKeyState('S') & 0x8000) &&
-                !(GetAsyncKeyState('A') & 0x8000) && !(GetAsyncKeyState('D') & 0x8000)) {
-                velocity = DirectX::XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f);
-            }
+            render.RenderScene(world.GetBodies(), bodyMeshes, &terrain, viewProj, cameraPos);
+            PROFILE_FRAME();
         }
     }
 
-    logger << "[main] Программа завершена" << std::endl;
+#if KATAMARI_PROFILER
+    profiler.LogReport();
+    profiler.WriteChromeTrace("katamari_trace.json");
+#endif
+    LOG_INFO << "[main] Программа завершена" << std::endl;
     return 0;
 }
\ No newline at end of file
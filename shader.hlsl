@@ -11,6 +11,9 @@ cbuffer ConstantBuffer : register(b0) {
     float3 emissiveColor;
     float3 cameraPos;
     float padding;
+    float4 positionOffset;    // границы меша для сжатых вершин
+    float4 positionScale;
+    float4 texCoordTransform; // xy - смещение, zw - масштаб
 };
 
 struct VS_INPUT {
@@ -19,11 +22,45 @@ struct VS_INPUT {
     float2 texCoord : TEXCOORD;
 };
 
+// Данные экземпляра из второго вершинного буфера (D3D11_INPUT_PER_INSTANCE_DATA)
+struct VS_INSTANCE_INPUT {
+    float3 pos : POSITION;
+    float3 normal : NORMAL;
+    float2 texCoord : TEXCOORD;
+    float4 world0 : INSTANCE_WORLD0;
+    float4 world1 : INSTANCE_WORLD1;
+    float4 world2 : INSTANCE_WORLD2;
+    float4 world3 : INSTANCE_WORLD3;
+    float4 color : INSTANCE_COLOR;
+    float4 emissive : INSTANCE_EMISSIVE;
+};
+
+// Сжатая вершина (CompactVertex): позиция и texCoord - UNORM16, нормаль - октаэдрическая развёртка в SNORM16
+struct VS_COMPACT_INPUT {
+    float4 pos : POSITION;
+    float2 normal : NORMAL;
+    float2 texCoord : TEXCOORD;
+};
+
+struct VS_INSTANCE_COMPACT_INPUT {
+    float4 pos : POSITION;
+    float2 normal : NORMAL;
+    float2 texCoord : TEXCOORD;
+    float4 world0 : INSTANCE_WORLD0;
+    float4 world1 : INSTANCE_WORLD1;
+    float4 world2 : INSTANCE_WORLD2;
+    float4 world3 : INSTANCE_WORLD3;
+    float4 color : INSTANCE_COLOR;
+    float4 emissive : INSTANCE_EMISSIVE;
+};
+
 struct PS_INPUT {
     float4 pos : SV_POSITION;
     float3 normal : NORMAL;
     float2 texCoord : TEXCOORD0;
     float3 worldPos : TEXCOORD1;
+    float4 color : COLOR0;
+    float3 emissive : COLOR1;
 };
 
 PS_INPUT VSMain(VS_INPUT input) {
@@ -32,9 +69,60 @@ PS_INPUT VSMain(VS_INPUT input) {
     output.normal = normalize(mul(input.normal, (float3x3)world));
     output.texCoord = input.texCoord;
     output.worldPos = mul(float4(input.pos, 1.0f), world).xyz;
+    output.color = color;
+    output.emissive = emissiveColor;
+    return output;
+}
+
+// В инстансном пути worldViewProj содержит только viewProj, мировая матрица приходит из экземпляра
+PS_INPUT VSMainInstanced(VS_INSTANCE_INPUT input) {
+    float4x4 instanceWorld = float4x4(input.world0, input.world1, input.world2, input.world3);
+    float4 worldPos = mul(float4(input.pos, 1.0f), instanceWorld);
+
+    PS_INPUT output;
+    output.pos = mul(worldPos, worldViewProj);
+    output.normal = normalize(mul(input.normal, (float3x3)instanceWorld));
+    output.texCoord = input.texCoord;
+    output.worldPos = worldPos.xyz;
+    output.color = input.color;
+    output.emissive = input.emissive.xyz;
     return output;
 }
 
+float3 DecodeOctahedral(float2 encoded) {
+    float3 normal = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+    float fold = saturate(-normal.z);
+    normal.xy -= (2.0f * step(0.0f, normal.xy) - 1.0f) * fold; // как в VertexQuantizer::DecodeOctahedral
+    return normalize(normal);
+}
+
+VS_INPUT DecodeCompact(float4 pos, float2 normal, float2 texCoord) {
+    VS_INPUT output;
+    output.pos = positionOffset.xyz + pos.xyz * positionScale.xyz;
+    output.normal = DecodeOctahedral(normal);
+    output.texCoord = texCoordTransform.xy + texCoord * texCoordTransform.zw;
+    return output;
+}
+
+PS_INPUT VSMainCompact(VS_COMPACT_INPUT input) {
+    return VSMain(DecodeCompact(input.pos, input.normal, input.texCoord));
+}
+
+PS_INPUT VSMainInstancedCompact(VS_INSTANCE_COMPACT_INPUT input) {
+    VS_INPUT decoded = DecodeCompact(input.pos, input.normal, input.texCoord);
+    VS_INSTANCE_INPUT instance;
+    instance.pos = decoded.pos;
+    instance.normal = decoded.normal;
+    instance.texCoord = decoded.texCoord;
+    instance.world0 = input.world0;
+    instance.world1 = input.world1;
+    instance.world2 = input.world2;
+    instance.world3 = input.world3;
+    instance.color = input.color;
+    instance.emissive = input.emissive;
+    return VSMainInstanced(instance);
+}
+
 Texture2D tex : register(t0);
 SamplerState samp : register(s0);
 
@@ -56,7 +144,7 @@ float4 PSMainTextured(PS_INPUT input) : SV_TARGET {
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
     float3 specular = lightColor * (spec * materialSpecular) * 2.0f; // Увеличиваем вклад зеркального света
     float3 lighting = ambient + diffuse + specular;
-    float3 finalLighting = lighting + emissiveColor;
+    float3 finalLighting = lighting + input.emissive;
     finalLighting = saturate(finalLighting);
     float4 finalColor = texColor * float4(finalLighting, 1.0);
     return finalColor;
@@ -78,8 +166,8 @@ float4 PSMainColored(PS_INPUT input) : SV_TARGET {
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
     float3 specular = lightColor * (spec * materialSpecular) * 2.0f; // Увеличиваем вклад зеркального света
     float3 lighting = ambient + diffuse + specular;
-    float3 finalLighting = lighting + emissiveColor;
+    float3 finalLighting = lighting + input.emissive;
     finalLighting = saturate(finalLighting);
-    float4 finalColor = color * float4(finalLighting, 1.0);
+    float4 finalColor = input.color * float4(finalLighting, 1.0);
     return finalColor;
 }
\ No newline at end of file